@@ -0,0 +1,153 @@
+#include "AsyncLLFS.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Constructor
+AsyncLLFS::AsyncLLFS(LLFS& fs, EventLoop& loop)
+    : fs(fs), loop(loop), blockSize(fs.getDiskManager().getBlockSize()) {
+    diskFile = ::open(fs.getDiskManager().getDiskFileName().c_str(), O_RDONLY | O_CLOEXEC);
+    if (diskFile < 0) {
+        throw std::runtime_error("Failed to open the disk file for asynchronous reads.");
+    }
+}
+
+// Destructor
+AsyncLLFS::~AsyncLLFS() {
+    ::close(diskFile);
+}
+
+// Open a file: resolve it and publish its inode
+// (Awaiters are named, and co_await is kept out of conditions and co_return: GCC 12 miscompiles
+// both, freeing a throwing awaiter's captures twice and skipping the coroutine body)
+Task<uint32_t> AsyncLLFS::open(std::string fileName) {
+    auto work = loop.offload([this, &fileName] { return fs.openFile(fileName); });
+    uint32_t inodeId = co_await work;
+    co_return inodeId;
+}
+
+// Read data from a file, without a lock if its inode is published
+Task<std::vector<char>> AsyncLLFS::readFile(std::string fileName) {
+    std::vector<char> data;
+    bool done = co_await readLockFree(fileName, data);
+    if (!done) {
+        ++stats.offloadedReads;
+        auto work = loop.offload([this, &fileName] { return fs.readFile(fileName); });
+        data = co_await work;
+    }
+    co_return data;
+}
+
+// Write data to a file
+Task<void> AsyncLLFS::writeFile(std::string fileName, std::vector<char> data) {
+    auto work = loop.offload([this, &fileName, &data] { fs.writeFile(fileName, data); });
+    co_await work;
+}
+
+// Create a file
+Task<void> AsyncLLFS::createFile(std::string fileName) {
+    auto work = loop.offload([this, &fileName] { fs.createFile(fileName); });
+    co_await work;
+}
+
+// Delete a file
+Task<void> AsyncLLFS::deleteFile(std::string fileName) {
+    auto work = loop.offload([this, &fileName] { fs.deleteFile(fileName); });
+    co_await work;
+}
+
+// Get how reads were served
+AsyncReadStats AsyncLLFS::getReadStats() const {
+    return stats;
+}
+
+// Helper function to read a file from its published inode; false if it must take the locks
+Task<bool> AsyncLLFS::readLockFree(const std::string& fileName, std::vector<char>& data) {
+    co_await ReadSlot{*this};
+    LockFreeRead read;
+    if (!fs.beginLockFreeRead(fileName, read, false)) {
+        releaseSlot();
+        co_return false;
+    }
+
+    // One read per run of consecutive blocks, all issued at once; holes stay zeros
+    const size_t blocks = std::min(read.blocks.size(), (read.fileSize + blockSize - 1) / blockSize);
+    std::vector<char> buffer(blocks * blockSize, 0);
+    std::vector<EventLoop::Read> reads;
+    for (size_t i = 0; i < blocks; ++i) {
+        uint16_t block = read.blocks[i];
+        if (block == 0) continue;
+        EventLoop::Read* last = reads.empty() ? nullptr : &reads.back();
+        if (last && last->buffer + last->length == buffer.data() + i * blockSize &&
+            last->offset + last->length == static_cast<uint64_t>(block) * blockSize) {
+            last->length += blockSize;
+        } else {
+            EventLoop::Read next;
+            next.fd = diskFile;
+            next.buffer = buffer.data() + i * blockSize;
+            next.length = blockSize;
+            next.offset = static_cast<uint64_t>(block) * blockSize;
+            reads.push_back(next);
+        }
+    }
+    auto batch = loop.read(reads);
+    co_await batch;
+
+    try {
+        for (const EventLoop::Read& done : reads) {
+            if (done.result < 0) {
+                throw std::runtime_error("Read failed: offset " + std::to_string(done.offset));
+            }
+            // Short reads end at the end of the disk file, past which blocks read as zeros
+        }
+        if (fs.getDiskManager().hasBlockChecksums()) {
+            for (size_t i = 0; i < blocks; ++i) {
+                if (read.blocks[i] == 0) continue;
+                fs.checkLockFreeBlock(read.blocks[i], std::vector<char>(buffer.begin() + i * blockSize,
+                                                                        buffer.begin() + (i + 1) * blockSize));
+            }
+        }
+    } catch (const std::exception&) {
+        bool unchanged = fs.endLockFreeRead(read);
+        releaseSlot();
+        if (!unchanged) {
+            co_return false; // The file went while it was read
+        }
+        throw;
+    }
+    bool unchanged = fs.endLockFreeRead(read);
+    releaseSlot();
+    if (unchanged) {
+        buffer.resize(read.fileSize);
+        data = std::move(buffer);
+        ++stats.lockFreeReads;
+    }
+    co_return unchanged;
+}
+
+// Helper function to give up a read slot, handing it to the next waiting reader
+void AsyncLLFS::releaseSlot() {
+    if (waitingReaders.empty()) {
+        --readsInFlight;
+        return;
+    }
+    loop.schedule(waitingReaders.front());
+    waitingReaders.pop_front();
+}
+
+// ReadSlot
+
+bool AsyncLLFS::ReadSlot::await_ready() noexcept {
+    if (owner.readsInFlight < MAX_LOCK_FREE_READS) {
+        ++owner.readsInFlight;
+        return true;
+    }
+    return false;
+}
+
+void AsyncLLFS::ReadSlot::await_suspend(std::coroutine_handle<> awaiting) {
+    ++owner.stats.waitedForSlot;
+    owner.waitingReaders.push_back(awaiting);
+}
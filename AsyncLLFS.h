@@ -0,0 +1,82 @@
+#ifndef ASYNCLLFS_H
+#define ASYNCLLFS_H
+
+#include "EventLoop.h"
+#include "LLFS.h"
+#include "Task.h"
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// How asynchronous reads were served
+struct AsyncReadStats {
+    size_t lockFreeReads = 0;       // Read through the event loop, without a thread
+    size_t offloadedReads = 0;      // Read with LLFS::readFile on a worker thread
+    size_t waitedForSlot = 0;       // Waited for another lock-free read to finish first
+};
+
+// Awaitable LLFS operations for coroutines on an EventLoop (all calls from the loop thread).
+// Reads of plain files take no lock: the blocks of the file's published inode are read from the
+// disk file in one batch and the coroutine suspends until they arrive. Everything else (and
+// reads that must take the locks) runs on the loop's worker threads.
+class AsyncLLFS {
+public:
+    // Lock-free reads in flight at once (each holds an epoch slot until its blocks arrive)
+    static constexpr size_t MAX_LOCK_FREE_READS = EpochManager::SLOTS / 2;
+
+    // Constructor; opens the disk file for reading
+    AsyncLLFS(LLFS& fs, EventLoop& loop);
+
+    // Destructor
+    ~AsyncLLFS();
+
+    AsyncLLFS(const AsyncLLFS&) = delete;
+    AsyncLLFS& operator=(const AsyncLLFS&) = delete;
+
+    // Open a file: resolve it and publish its inode, so reads of it take no lock; returns its inode
+    Task<uint32_t> open(std::string fileName);
+
+    // Read data from a file
+    Task<std::vector<char>> readFile(std::string fileName);
+
+    // Write data to a file
+    Task<void> writeFile(std::string fileName, std::vector<char> data);
+
+    // Create a file
+    Task<void> createFile(std::string fileName);
+
+    // Delete a file
+    Task<void> deleteFile(std::string fileName);
+
+    // Get how reads were served
+    AsyncReadStats getReadStats() const;
+
+private:
+    // Suspends a coroutine until fewer than MAX_LOCK_FREE_READS reads are in flight
+    struct ReadSlot {
+        AsyncLLFS& owner;
+
+        bool await_ready() noexcept;
+        void await_suspend(std::coroutine_handle<> awaiting);
+        void await_resume() const noexcept {}
+    };
+
+    LLFS& fs;
+    EventLoop& loop;
+    int diskFile = -1;              // Opened read-only; file blocks are never written in place
+    size_t blockSize;
+    size_t readsInFlight = 0;
+    std::deque<std::coroutine_handle<>> waitingReaders; // Each is handed a slot when one frees
+    AsyncReadStats stats;
+
+    // Helper function to read a file from its published inode; false if it must take the locks
+    Task<bool> readLockFree(const std::string& fileName, std::vector<char>& data);
+
+    // Helper function to give up a read slot, handing it to the next waiting reader
+    void releaseSlot();
+};
+
+#endif // ASYNCLLFS_H
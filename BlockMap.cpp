@@ -0,0 +1,238 @@
+#include "BlockMap.h"
+#include <algorithm>
+#include <cstring> // For memcpy
+
+// Constructor
+BlockMap::BlockMap(DiskManager& diskManager, FreeBlockManager& freeBlockManager)
+    : diskManager(diskManager), freeBlockManager(freeBlockManager),
+      pointersPerBlock(diskManager.getBlockSize() / sizeof(uint16_t)) {}
+
+// Get the physical block of a logical block (0 if it is not mapped)
+uint32_t BlockMap::lookup(const Inode& inode, size_t logicalBlock) {
+    if (logicalBlock < DIRECT_BLOCKS) {
+        return inode.directBlocks[logicalBlock];
+    }
+
+    logicalBlock -= DIRECT_BLOCKS;
+    if (logicalBlock < pointersPerBlock) {
+        if (inode.singleIndirect == 0) return 0;
+        return readPointer(inode.singleIndirect, logicalBlock);
+    }
+
+    logicalBlock -= pointersPerBlock;
+    if (logicalBlock < pointersPerBlock * pointersPerBlock) {
+        if (inode.doubleIndirect == 0) return 0;
+        uint16_t indirect = readPointer(inode.doubleIndirect, logicalBlock / pointersPerBlock);
+        if (indirect == 0) return 0;
+        return readPointer(indirect, logicalBlock % pointersPerBlock);
+    }
+
+    throw std::out_of_range("Logical block exceeds the maximum file size.");
+}
+
+// Get the physical blocks of a range of logical blocks, reading each indirect block once
+std::vector<uint32_t> BlockMap::lookupRange(const Inode& inode, size_t firstBlock, size_t count) {
+    std::vector<uint32_t> blocks(count, 0);
+    std::vector<char> outer, inner;     // The double indirect block and the last leaf read
+    uint16_t innerBlock = 0;
+    auto pointerAt = [](const std::vector<char>& block, size_t index) {
+        uint16_t pointer;
+        std::memcpy(&pointer, block.data() + index * sizeof(uint16_t), sizeof(pointer));
+        return pointer;
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t logicalBlock = firstBlock + i;
+        if (logicalBlock < DIRECT_BLOCKS) {
+            blocks[i] = inode.directBlocks[logicalBlock];
+            continue;
+        }
+
+        logicalBlock -= DIRECT_BLOCKS;
+        uint16_t leaf;
+        if (logicalBlock < pointersPerBlock) {
+            leaf = inode.singleIndirect;
+        } else {
+            logicalBlock -= pointersPerBlock;
+            if (logicalBlock >= pointersPerBlock * pointersPerBlock) {
+                throw std::out_of_range("Logical block exceeds the maximum file size.");
+            }
+            if (inode.doubleIndirect == 0) continue;
+            if (outer.empty()) {
+                outer = diskManager.readBlock(inode.doubleIndirect);
+            }
+            leaf = pointerAt(outer, logicalBlock / pointersPerBlock);
+            logicalBlock %= pointersPerBlock;
+        }
+        if (leaf == 0) continue;
+        if (leaf != innerBlock) {
+            inner = diskManager.readBlock(leaf);
+            innerBlock = leaf;
+        }
+        blocks[i] = pointerAt(inner, logicalBlock);
+    }
+    return blocks;
+}
+
+// Get the physical block of a logical block, allocating it and any indirect blocks on the way
+uint32_t BlockMap::map(Inode& inode, size_t logicalBlock) {
+    if (logicalBlock < DIRECT_BLOCKS) {
+        if (inode.directBlocks[logicalBlock] == 0) {
+            inode.directBlocks[logicalBlock] = allocate(false);
+        }
+        return inode.directBlocks[logicalBlock];
+    }
+
+    logicalBlock -= DIRECT_BLOCKS;
+    if (logicalBlock < pointersPerBlock) {
+        if (inode.singleIndirect == 0) {
+            inode.singleIndirect = allocate(true);
+        }
+        return mapPointer(inode.singleIndirect, logicalBlock, false);
+    }
+
+    logicalBlock -= pointersPerBlock;
+    if (logicalBlock < pointersPerBlock * pointersPerBlock) {
+        if (inode.doubleIndirect == 0) {
+            inode.doubleIndirect = allocate(true);
+        }
+        uint16_t indirect = mapPointer(inode.doubleIndirect, logicalBlock / pointersPerBlock, true);
+        return mapPointer(indirect, logicalBlock % pointersPerBlock, false);
+    }
+
+    throw std::out_of_range("Logical block exceeds the maximum file size.");
+}
+
+// Unmap a logical block and free it, along with indirect blocks it leaves empty
+bool BlockMap::unmap(Inode& inode, size_t logicalBlock) {
+    if (logicalBlock < DIRECT_BLOCKS) {
+        uint16_t& pointer = inode.directBlocks[logicalBlock];
+        if (pointer == 0) return false;
+        freeBlockManager.freeBlock(pointer);
+        pointer = 0;
+        return true;
+    }
+
+    bool emptied;
+    logicalBlock -= DIRECT_BLOCKS;
+    if (logicalBlock < pointersPerBlock) {
+        if (inode.singleIndirect == 0 || !clearPointer(inode.singleIndirect, logicalBlock, emptied)) {
+            return false;
+        }
+        if (emptied) {
+            freeBlockManager.freeBlock(inode.singleIndirect);
+            inode.singleIndirect = 0;
+        }
+        return true;
+    }
+
+    logicalBlock -= pointersPerBlock;
+    if (logicalBlock < pointersPerBlock * pointersPerBlock) {
+        if (inode.doubleIndirect == 0) return false;
+        uint16_t indirect = readPointer(inode.doubleIndirect, logicalBlock / pointersPerBlock);
+        if (indirect == 0 || !clearPointer(indirect, logicalBlock % pointersPerBlock, emptied)) {
+            return false;
+        }
+        if (emptied) {
+            clearPointer(inode.doubleIndirect, logicalBlock / pointersPerBlock, emptied); // Frees the leaf
+            if (emptied) {
+                freeBlockManager.freeBlock(inode.doubleIndirect);
+                inode.doubleIndirect = 0;
+            }
+        }
+        return true;
+    }
+
+    throw std::out_of_range("Logical block exceeds the maximum file size.");
+}
+
+// Free every block of the inode, including indirect blocks
+void BlockMap::release(Inode& inode) {
+    for (auto& block : inode.directBlocks) {
+        if (block != 0) {
+            freeBlockManager.freeBlock(block);
+            block = 0;
+        }
+    }
+    if (inode.singleIndirect != 0) {
+        releaseIndirect(inode.singleIndirect, 1);
+        inode.singleIndirect = 0;
+    }
+    if (inode.doubleIndirect != 0) {
+        releaseIndirect(inode.doubleIndirect, 2);
+        inode.doubleIndirect = 0;
+    }
+}
+
+// Largest number of logical blocks an inode can address
+size_t BlockMap::getMaxBlocks() const {
+    return DIRECT_BLOCKS + pointersPerBlock + pointersPerBlock * pointersPerBlock;
+}
+
+// Read one pointer from an indirect block
+uint16_t BlockMap::readPointer(uint16_t indirectBlock, size_t index) {
+    std::vector<char> block = diskManager.readBlock(indirectBlock);
+    uint16_t pointer;
+    std::memcpy(&pointer, block.data() + index * sizeof(uint16_t), sizeof(pointer));
+    return pointer;
+}
+
+// Get a pointer from an indirect block, allocating the target if it is missing
+uint16_t BlockMap::mapPointer(uint16_t indirectBlock, size_t index, bool zeroFill) {
+    std::vector<char> block = diskManager.readBlock(indirectBlock);
+    uint16_t pointer;
+    std::memcpy(&pointer, block.data() + index * sizeof(uint16_t), sizeof(pointer));
+    if (pointer == 0) {
+        pointer = allocate(zeroFill);
+        std::memcpy(block.data() + index * sizeof(uint16_t), &pointer, sizeof(pointer));
+        diskManager.writeMetadataBlock(indirectBlock, block);
+    }
+    return pointer;
+}
+
+// Clear a pointer in an indirect block and free its target
+bool BlockMap::clearPointer(uint16_t indirectBlock, size_t index, bool& emptied) {
+    std::vector<char> block = diskManager.readBlock(indirectBlock);
+    uint16_t pointer;
+    std::memcpy(&pointer, block.data() + index * sizeof(uint16_t), sizeof(pointer));
+    if (pointer == 0) {
+        emptied = false;
+        return false;
+    }
+    freeBlockManager.freeBlock(pointer);
+    std::memset(block.data() + index * sizeof(uint16_t), 0, sizeof(uint16_t));
+    emptied = std::all_of(block.begin(), block.end(), [](char c) { return c == 0; });
+    if (!emptied) {
+        diskManager.writeMetadataBlock(indirectBlock, block); // An emptied block is freed instead
+    }
+    return true;
+}
+
+// Allocate a block, optionally clearing it (indirect blocks must start out empty)
+uint16_t BlockMap::allocate(bool zeroFill) {
+    int block = freeBlockManager.allocateBlock();
+    if (block > UINT16_MAX) {
+        freeBlockManager.freeBlock(block);
+        throw std::runtime_error("Block number does not fit in a block pointer.");
+    }
+    if (zeroFill) {
+        diskManager.writeMetadataBlock(block, std::vector<char>(diskManager.getBlockSize(), 0));
+    }
+    return static_cast<uint16_t>(block);
+}
+
+// Free all blocks referenced by an indirect block, then the block itself
+void BlockMap::releaseIndirect(uint16_t indirectBlock, int depth) {
+    std::vector<char> block = diskManager.readBlock(indirectBlock);
+    for (size_t i = 0; i < pointersPerBlock; ++i) {
+        uint16_t pointer;
+        std::memcpy(&pointer, block.data() + i * sizeof(uint16_t), sizeof(pointer));
+        if (pointer == 0) continue;
+        if (depth > 1) {
+            releaseIndirect(pointer, depth - 1);
+        } else {
+            freeBlockManager.freeBlock(pointer);
+        }
+    }
+    freeBlockManager.freeBlock(indirectBlock);
+}
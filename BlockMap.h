@@ -0,0 +1,63 @@
+#ifndef BLOCKMAP_H
+#define BLOCKMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "DiskManager.h"
+#include "FreeBlockManager.h"
+#include "InodeManager.h"
+
+// Maps the logical blocks of an inode to physical blocks through its direct,
+// single indirect and double indirect pointers
+class BlockMap {
+public:
+    static constexpr size_t DIRECT_BLOCKS = 10;
+
+    // Constructor
+    BlockMap(DiskManager& diskManager, FreeBlockManager& freeBlockManager);
+
+    // Get the physical block of a logical block (0 if it is not mapped)
+    uint32_t lookup(const Inode& inode, size_t logicalBlock);
+
+    // Get the physical blocks of count logical blocks from firstBlock (0 where not mapped),
+    // reading each indirect block once
+    std::vector<uint32_t> lookupRange(const Inode& inode, size_t firstBlock, size_t count);
+
+    // Get the physical block of a logical block, allocating it and any indirect blocks on the way
+    uint32_t map(Inode& inode, size_t logicalBlock);
+
+    // Unmap a logical block and free it, along with indirect blocks it leaves empty; returns
+    // whether it was mapped
+    bool unmap(Inode& inode, size_t logicalBlock);
+
+    // Free every block of the inode, including indirect blocks
+    void release(Inode& inode);
+
+    // Largest number of logical blocks an inode can address
+    size_t getMaxBlocks() const;
+
+private:
+    DiskManager& diskManager;
+    FreeBlockManager& freeBlockManager;
+    size_t pointersPerBlock;    // Block pointers held by one indirect block
+
+    // Read one pointer from an indirect block
+    uint16_t readPointer(uint16_t indirectBlock, size_t index);
+
+    // Get a pointer from an indirect block, allocating the target if it is missing
+    uint16_t mapPointer(uint16_t indirectBlock, size_t index, bool zeroFill);
+
+    // Clear a pointer in an indirect block and free its target; emptied tells whether the
+    // indirect block holds no pointers any more. Returns whether the pointer was set
+    bool clearPointer(uint16_t indirectBlock, size_t index, bool& emptied);
+
+    // Allocate a block, optionally clearing it (indirect blocks must start out empty)
+    uint16_t allocate(bool zeroFill);
+
+    // Free all blocks referenced by an indirect block, then the block itself
+    void releaseIndirect(uint16_t indirectBlock, int depth);
+};
+
+#endif // BLOCKMAP_H
@@ -0,0 +1,81 @@
+#include "ClusterCache.h"
+
+// Constructor
+ClusterCache::ClusterCache(size_t capacity)
+    : capacity(capacity) {}
+
+// Look up a cluster (null if it is not cached)
+std::shared_ptr<const std::vector<char>> ClusterCache::lookup(uint32_t inodeId, uint32_t cluster) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(Key{inodeId, cluster});
+    if (it == entries.end()) {
+        ++misses;
+        return nullptr;
+    }
+
+    // Move to the front of the LRU list
+    lru.splice(lru.begin(), lru, it->second);
+    ++hits;
+    return it->second->data;
+}
+
+// Cache a decompressed cluster, evicting the least recently used one when full
+void ClusterCache::insert(uint32_t inodeId, uint32_t cluster, std::vector<char> data) {
+    if (capacity == 0) {
+        return;
+    }
+
+    auto contents = std::make_shared<const std::vector<char>>(std::move(data));
+    std::lock_guard<std::mutex> lock(mutex);
+    Key key{inodeId, cluster};
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        it->second->data = std::move(contents);
+        lru.splice(lru.begin(), lru, it->second);
+        return;
+    }
+
+    if (entries.size() >= capacity) {
+        entries.erase(lru.back().key);
+        lru.pop_back();
+    }
+
+    lru.push_front(Node{key, std::move(contents)});
+    entries.emplace(key, lru.begin());
+}
+
+// Forget every cluster of an inode
+void ClusterCache::invalidate(uint32_t inodeId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.lower_bound(Key{inodeId, 0});
+    while (it != entries.end() && it->first.first == inodeId) {
+        lru.erase(it->second);
+        it = entries.erase(it);
+    }
+}
+
+// Forget everything
+void ClusterCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    lru.clear();
+}
+
+size_t ClusterCache::getSize() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t ClusterCache::getCapacity() const {
+    return capacity;
+}
+
+size_t ClusterCache::getHits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+size_t ClusterCache::getMisses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
@@ -0,0 +1,58 @@
+#ifndef CLUSTERCACHE_H
+#define CLUSTERCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Block cache for compressed files: holds whole decompressed clusters as
+// (inode, cluster) -> bytes, with bounded LRU eviction, so repeated reads of a compressed
+// file skip both the disk and the decompressor. LLFS invalidates an inode's clusters
+// whenever the file is rewritten or deleted. Safe to use from several threads.
+class ClusterCache {
+public:
+    // Constructor; capacity is counted in clusters
+    explicit ClusterCache(size_t capacity = 64);
+
+    // Look up a cluster (null if it is not cached); the contents stay valid while the pointer
+    // is held, even if the cluster is evicted
+    std::shared_ptr<const std::vector<char>> lookup(uint32_t inodeId, uint32_t cluster);
+
+    // Cache a decompressed cluster, evicting the least recently used one when full
+    void insert(uint32_t inodeId, uint32_t cluster, std::vector<char> data);
+
+    // Forget every cluster of an inode
+    void invalidate(uint32_t inodeId);
+
+    // Forget everything
+    void clear();
+
+    // Statistics
+    size_t getSize() const;
+    size_t getCapacity() const;
+    size_t getHits() const;
+    size_t getMisses() const;
+
+private:
+    using Key = std::pair<uint32_t, uint32_t>; // Inode, cluster
+
+    struct Node {
+        Key key;
+        std::shared_ptr<const std::vector<char>> data;
+    };
+
+    size_t capacity;
+    size_t hits = 0;
+    size_t misses = 0;
+    mutable std::mutex mutex; // Guards everything above and below
+
+    std::list<Node> lru; // Most recently used first
+    std::map<Key, std::list<Node>::iterator> entries; // Ordered, so an inode's clusters are adjacent
+};
+
+#endif // CLUSTERCACHE_H
@@ -1,26 +1,106 @@
 #include "CrashRecovery.h"
 #include "DirectoryManager.h"
 #include "InodeManager.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring> // For memcmp
-#include <iostream>
+#include <ctime>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include "Logger.h"
 
 CrashRecovery::CrashRecovery(DiskManager& diskManager, FreeBlockManager& freeBlockManager,
-                             InodeManager& inodeManager, DirectoryManager& directoryManager)
+                             InodeManager& inodeManager, DirectoryManager& directoryManager,
+                             Journal* journal, SegmentManager* segmentManager, size_t threadCount)
     : diskManager(diskManager), freeBlockManager(freeBlockManager),
-      inodeManager(inodeManager), directoryManager(directoryManager) {}
+      inodeManager(inodeManager), directoryManager(directoryManager), journal(journal),
+      segmentManager(segmentManager), layout(), threadCount(threadCount) {
+    if (this->threadCount == 0) {
+        this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+// What the inode scan found, merged from all workers
+struct CrashRecovery::ScanResult {
+    size_t inodes = 0;
+    size_t directories = 0;
+    size_t invalidPointers = 0;
+    size_t damagedDirectories = 0;
+    std::vector<uint8_t> allocated;                 // File type per inode (0 = free)
+    std::vector<std::atomic<uint64_t>> referenced;  // One bit per block inode pointers reach
+    std::vector<std::atomic<uint64_t>> exclusive;   // One bit per block reached by a pointer that may not share it
+    std::vector<uint32_t> duplicates;               // Blocks marked a second time
+    std::vector<std::pair<uint32_t, DirectoryEntry>> entries; // (directory inode, entry)
+    std::vector<uint8_t> rebuiltBitmap;             // Free block vector from the references
+    std::vector<uint32_t> leakedBlocks;
+    std::vector<std::pair<uint32_t, DirectoryEntry>> dangling;
+    std::unordered_map<uint32_t, std::pair<uint32_t, std::string>> parents; // Directory -> (parent, name)
+};
+
+// Check whether nothing was found
+bool ConsistencyReport::isConsistent() const {
+    return invalidPointers == 0 && leakedBlocks == 0 && unmarkedBlocks == 0 && danglingEntries == 0 &&
+           damagedDirectories == 0 && doublyReferencedBlocks.empty() && orphanInodes.empty();
+}
 
 // Perform crash recovery
 void CrashRecovery::recover() {
-    std::cout << "Performing crash recovery...\n";
+    LLFS_LOG_INFO("CrashRecovery", "Performing crash recovery");
 
     validateSuperblock();
+    if (journal) {
+        // Bring metadata up to the last committed transaction before checking it
+        size_t replayed = journal->recover();
+        LLFS_LOG_INFO("CrashRecovery", "Journal replayed: transactions=", replayed);
+    }
+    diskManager.loadChecksums(); // Blocks replayed above are described by the replayed table
+    if (segmentManager) {
+        // Load the last checkpoint and roll forward through the segments committed after it
+        size_t rolled = segmentManager->recover();
+        LLFS_LOG_INFO("CrashRecovery", "Log rolled forward: blocks=", rolled);
+    }
     rebuildFreeBlockVector();
+    rebuildReferenceCounts();
+    inodeManager.scanInodeTable();      // Pick up allocated inodes from the on-disk table
     inodeManager.initializeRootInode(); // Ensure root inode exists
     validateDirectories();
 
-    std::cout << "Crash recovery completed successfully.\n";
+    LLFS_LOG_INFO("CrashRecovery", "Crash recovery completed");
 }
 
+// Full consistency check (fsck) of the flushed file system
+ConsistencyReport CrashRecovery::check(bool repair) {
+    auto start = std::chrono::steady_clock::now();
+    LLFS_LOG_INFO("CrashRecovery", "Checking consistency");
+
+    validateSuperblock();
+    inodeManager.flush(); // The scan reads the inode table on disk
+
+    ScanResult result;
+    validateInodes(result);
+    ConsistencyReport report;
+    compareResults(result, report);
+    if (repair && !report.isConsistent()) {
+        applyRepairs(result, report);
+    }
+    if (repair) {
+        rebuildReferenceCounts(); // Also drops the counts of blocks the repairs freed
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!report.isConsistent()) {
+        LLFS_LOG_WARN("CrashRecovery", "Inconsistencies found: leakedBlocks=", report.leakedBlocks,
+                      " unmarkedBlocks=", report.unmarkedBlocks, " doublyReferenced=",
+                      report.doublyReferencedBlocks.size(), " invalidPointers=", report.invalidPointers,
+                      " orphans=", report.orphanInodes.size(), " danglingEntries=", report.danglingEntries,
+                      " damagedDirectories=", report.damagedDirectories, report.repaired ? " (repaired)" : "");
+    }
+    LLFS_LOG_INFO("CrashRecovery", "Consistency check completed: inodes=", report.inodesChecked,
+                  " blocks=", report.blocksReferenced, " seconds=", report.seconds);
+    return report;
+}
 
 // Validate the superblock
 void CrashRecovery::validateSuperblock() {
@@ -44,68 +124,331 @@ void CrashRecovery::validateSuperblock() {
         throw std::runtime_error("Invalid superblock: Total blocks mismatch.");
     }
 
-    std::cout << "Superblock validated successfully." << std::endl;
-    std::cout << "Superblock total blocks: " << superblockTotalBlocks << std::endl;
-    std::cout << "DiskManager total blocks: " << diskManagerTotalBlocks << std::endl;
+    // Check the rest of the layout
+    layout = diskManager.loadSuperblock();
+
+    LLFS_LOG_INFO("CrashRecovery", "Superblock validated: totalBlocks=", superblockTotalBlocks,
+                  " diskBlocks=", diskManagerTotalBlocks);
 }
 
 
 
 // Rebuild the free block vector
 void CrashRecovery::rebuildFreeBlockVector() {
-    // Read the free block vector from disk (Block 1)
-    std::vector<char> freeBlockVector = diskManager.readBlock(1);
-    freeBlockManager.loadFreeBlockVector(std::vector<uint8_t>(freeBlockVector.begin(), freeBlockVector.end()));
+    // Read the free block vector from disk (Block 1 onward)
+    std::vector<uint8_t> freeBlockVector;
+    for (size_t i = 0; i < layout.freeBlockVectorBlocks; ++i) {
+        std::vector<char> block = diskManager.readBlock(layout.freeBlockVectorStart + i);
+        freeBlockVector.insert(freeBlockVector.end(), block.begin(), block.end());
+    }
+    freeBlockVector.resize((layout.volumeBlocks + 7) / 8);
+    freeBlockManager.loadFreeBlockVector(freeBlockVector);
 
-    std::cout << "Free block vector restored successfully." << std::endl;
+    LLFS_LOG_INFO("CrashRecovery", "Free block vector restored: blocks=", layout.freeBlockVectorBlocks);
 }
 
-// Validate inodes
-void CrashRecovery::validateInodes() {
-    // Iterate over all inodes to ensure their integrity
-    for (size_t i = 0; i < inodeManager.getTotalInodes(); ++i) {
-        try {
-            Inode inode = inodeManager.getInode(i);
+// Rebuild the reference counts of deduplicated blocks from the file data pointers in the inode table
+void CrashRecovery::rebuildReferenceCounts() {
+    size_t blockSize = diskManager.getBlockSize();
+    size_t inodesPerBlock = blockSize / sizeof(Inode);
+    size_t totalInodes = inodeManager.getTotalInodes();
+    std::vector<uint32_t> counts(layout.volumeBlocks, 0);
+
+    for (size_t first = 0; first < totalInodes; first += inodesPerBlock) {
+        std::vector<char> block = diskManager.readBlock(layout.inodeTableStart + first / inodesPerBlock);
+        for (size_t i = first; i < std::min(first + inodesPerBlock, totalInodes); ++i) {
+            Inode inode;
+            std::memcpy(&inode, block.data() + (i - first) * sizeof(Inode), sizeof(Inode));
+            if (inode.fileType != 1 || (inode.flags & INODE_FLAG_COMPRESSED)) {
+                continue; // Only plain file data is deduplicated
+            }
+            for (uint16_t pointer : inode.directBlocks) {
+                if (pointer >= layout.dataStart && pointer < layout.volumeBlocks) {
+                    ++counts[pointer];
+                }
+            }
+        }
+    }
+
+    freeBlockManager.clearReferences();
+    size_t shared = 0;
+    for (size_t block = layout.dataStart; block < counts.size(); ++block) {
+        if (counts[block] > 1 && !freeBlockManager.isBlockFree(block)) {
+            freeBlockManager.setReferenceCount(block, counts[block]);
+            ++shared;
+        }
+    }
+    LLFS_LOG_INFO("CrashRecovery", "Reference counts rebuilt: sharedBlocks=", shared);
+}
+
+// Scan the inode table in parallel: mark every block an inode points at in an atomic bitmap
+// and collect directory entries
+void CrashRecovery::validateInodes(ScanResult& result) {
+    size_t blockSize = diskManager.getBlockSize();
+    size_t inodesPerBlock = blockSize / sizeof(Inode);
+    size_t pointersPerBlock = blockSize / sizeof(uint16_t);
+    size_t totalInodes = inodeManager.getTotalInodes();
+    size_t tableBlocks = (totalInodes + inodesPerBlock - 1) / inodesPerBlock;
+    bool onDisk = directoryManager.getStore() != nullptr; // In-memory directories have no entries to read
+
+    result.allocated.assign(totalInodes, 0);
+    result.referenced = std::vector<std::atomic<uint64_t>>((layout.volumeBlocks + 63) / 64);
+    result.exclusive = std::vector<std::atomic<uint64_t>>((layout.volumeBlocks + 63) / 64);
+
+    // Workers keep their findings to themselves; only the bitmap is shared
+    struct WorkerResult {
+        size_t inodes = 0;
+        size_t directories = 0;
+        size_t invalidPointers = 0;
+        size_t damagedDirectories = 0;
+        std::vector<uint32_t> duplicates;
+        std::vector<std::pair<uint32_t, DirectoryEntry>> entries;
+    };
+    size_t workers = std::max<size_t>(1, std::min(threadCount, tableBlocks));
+    std::vector<WorkerResult> workerResults(workers);
+    std::atomic<size_t> nextTableBlock{0};
+
+    auto scan = [&](WorkerResult& local) {
+        DirectoryStore store(diskManager, freeBlockManager); // Only reads
+
+        // Mark a block as referenced; false if the pointer is outside the data blocks. Only plain
+        // file data may be shared by several pointers
+        auto mark = [&](uint32_t block, bool shareable = false) {
+            if (block < layout.dataStart || block >= layout.volumeBlocks) {
+                ++local.invalidPointers;
+                return false;
+            }
+            uint64_t bit = uint64_t(1) << (block % 64);
+            if (result.referenced[block / 64].fetch_or(bit, std::memory_order_relaxed) & bit) {
+                local.duplicates.push_back(block);
+            }
+            if (!shareable) {
+                result.exclusive[block / 64].fetch_or(bit, std::memory_order_relaxed);
+            }
+            return true;
+        };
+
+        // Mark an indirect block and every block below it
+        std::function<void(uint16_t, int)> markIndirect = [&](uint16_t indirectBlock, int depth) {
+            if (!mark(indirectBlock)) {
+                return;
+            }
+            std::vector<char> block = diskManager.readBlock(indirectBlock);
+            for (size_t i = 0; i < pointersPerBlock; ++i) {
+                uint16_t pointer;
+                std::memcpy(&pointer, block.data() + i * sizeof(uint16_t), sizeof(pointer));
+                if (pointer == 0) continue;
+                if (depth > 1) {
+                    markIndirect(pointer, depth - 1);
+                } else {
+                    mark(pointer);
+                }
+            }
+        };
 
-            // Validate allocated blocks
-            for (size_t j = 0; j < 10; ++j) {
-                if (inode.directBlocks[j] != 0) {
-                    if (!freeBlockManager.isBlockFree(inode.directBlocks[j])) {
-                        throw std::runtime_error("Inconsistent free block vector for inode.");
+        // Inode table blocks are handed out one at a time, so large directories do not hold up
+        // a worker's whole share
+        for (size_t tableBlock = nextTableBlock++; tableBlock < tableBlocks; tableBlock = nextTableBlock++) {
+            std::vector<char> block = diskManager.readBlock(layout.inodeTableStart + tableBlock);
+            size_t first = tableBlock * inodesPerBlock;
+            for (size_t i = first; i < std::min(first + inodesPerBlock, totalInodes); ++i) {
+                Inode inode;
+                std::memcpy(&inode, block.data() + (i - first) * sizeof(Inode), sizeof(Inode));
+                if (inode.fileType == 0) continue;
+
+                result.allocated[i] = inode.fileType; // Each inode belongs to one worker
+                ++local.inodes;
+                bool shareable = inode.fileType == 1 && !(inode.flags & INODE_FLAG_COMPRESSED);
+                for (uint16_t pointer : inode.directBlocks) {
+                    if (pointer != 0) mark(pointer, shareable);
+                }
+                if (inode.singleIndirect != 0) markIndirect(inode.singleIndirect, 1);
+                if (inode.doubleIndirect != 0) markIndirect(inode.doubleIndirect, 2);
+
+                if (inode.fileType == 2 && onDisk) {
+                    ++local.directories;
+                    try {
+                        store.forEach(inode, [&](const DirectoryEntry& entry) {
+                            local.entries.emplace_back(static_cast<uint32_t>(i), entry);
+                        });
+                    } catch (const std::exception&) {
+                        ++local.damagedDirectories;
                     }
+                }
+            }
+        }
+    };
 
-                    // Mark block as allocated in the free block manager
-                    freeBlockManager.allocateBlock();
+    if (workers == 1) {
+        scan(workerResults[0]);
+    } else {
+        std::vector<std::exception_ptr> errors(workers);
+        std::vector<std::thread> threads;
+        threads.reserve(workers);
+        for (size_t worker = 0; worker < workers; ++worker) {
+            threads.emplace_back([&, worker]() {
+                try {
+                    scan(workerResults[worker]);
+                } catch (...) {
+                    errors[worker] = std::current_exception();
                 }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    }
+
+    for (auto& local : workerResults) {
+        result.inodes += local.inodes;
+        result.directories += local.directories;
+        result.invalidPointers += local.invalidPointers;
+        result.damagedDirectories += local.damagedDirectories;
+        result.duplicates.insert(result.duplicates.end(), local.duplicates.begin(), local.duplicates.end());
+        result.entries.insert(result.entries.end(), local.entries.begin(), local.entries.end());
+    }
+
+    LLFS_LOG_INFO("CrashRecovery", "Inode table validated: inodes=", result.inodes, " directories=",
+                  result.directories, " threads=", workers);
+}
+
+// Compare the rebuilt bitmap with the free block vector, find orphans and dangling entries
+void CrashRecovery::compareResults(ScanResult& result, ConsistencyReport& report) {
+    report.inodesChecked = result.inodes;
+    report.directoriesChecked = result.directories;
+    report.invalidPointers = result.invalidPointers;
+    report.damagedDirectories = result.damagedDirectories;
+    std::sort(result.duplicates.begin(), result.duplicates.end());
+    result.duplicates.erase(std::unique(result.duplicates.begin(), result.duplicates.end()), result.duplicates.end());
+    for (uint32_t block : result.duplicates) {
+        uint64_t bit = uint64_t(1) << (block % 64);
+        if (result.exclusive[block / 64].load(std::memory_order_relaxed) & bit) {
+            report.doublyReferencedBlocks.push_back(block);
+        } else {
+            ++report.sharedBlocks;
+        }
+    }
+
+    // Blocks below dataStart hold metadata and keep their bits (0 = in use)
+    std::vector<uint8_t> bitmap = freeBlockManager.getFreeBlockVector();
+    result.rebuiltBitmap = bitmap;
+    size_t limit = std::min<size_t>(layout.volumeBlocks, bitmap.size() * 8);
+    for (size_t block = layout.dataStart; block < limit; ++block) {
+        bool referenced = result.referenced[block / 64].load(std::memory_order_relaxed) & (uint64_t(1) << (block % 64));
+        bool inUse = !(bitmap[block / 8] & (1 << (block % 8)));
+        if (referenced) {
+            ++report.blocksReferenced;
+            report.unmarkedBlocks += !inUse;
+            result.rebuiltBitmap[block / 8] &= ~(1 << (block % 8));
+        } else {
+            if (inUse) {
+                ++report.leakedBlocks;
+                result.leakedBlocks.push_back(static_cast<uint32_t>(block));
             }
+            result.rebuiltBitmap[block / 8] |= (1 << (block % 8));
+        }
+    }
+
+    // Every allocated inode but the root needs a directory entry
+    if (!directoryManager.getStore()) {
+        return;
+    }
+    std::vector<uint32_t> links(result.allocated.size(), 0);
+    for (const auto& [directory, entry] : result.entries) {
+        if (entry.inodeId >= result.allocated.size() || result.allocated[entry.inodeId] == 0) {
+            result.dangling.emplace_back(directory, entry);
+            continue;
+        }
+        ++links[entry.inodeId];
+        if (result.allocated[entry.inodeId] == 2) {
+            result.parents[entry.inodeId] = {directory, entry.fileName};
+        }
+    }
+    report.danglingEntries = result.dangling.size();
+    for (size_t inodeId = 1; inodeId < links.size(); ++inodeId) { // Inode 0 is the root
+        if (result.allocated[inodeId] != 0 && links[inodeId] == 0) {
+            report.orphanInodes.push_back(static_cast<uint32_t>(inodeId));
+        }
+    }
+}
+
+// Apply the rebuilt bitmap, link orphans into /lost+found and drop dangling entries
+void CrashRecovery::applyRepairs(ScanResult& result, ConsistencyReport& report) {
+    freeBlockManager.loadFreeBlockVector(result.rebuiltBitmap);
+    if (segmentManager) {
+        for (uint32_t block : result.leakedBlocks) {
+            segmentManager->discardBlock(block); // Their copies in the log are dead too
+        }
+    }
+
+    if (!report.orphanInodes.empty()) {
+        uint32_t lostFound;
+        try {
+            lostFound = directoryManager.resolveDirectory("/lost+found");
         } catch (const std::runtime_error&) {
-            // Ignore unallocated inodes
+            int inodeId = inodeManager.allocateInode();
+            Inode inode = {};
+            inode.fileType = 2;
+            inode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
+            inodeManager.updateInode(inodeId, inode);
+            directoryManager.createDirectory("/lost+found", static_cast<uint32_t>(inodeId));
+            lostFound = static_cast<uint32_t>(inodeId);
+        }
+        for (uint32_t inodeId : report.orphanInodes) {
+            std::string name = "#" + std::to_string(inodeId);
+            DirectoryEntry entry = {inodeId, ""};
+            std::strncpy(entry.fileName, name.c_str(), sizeof(entry.fileName) - 1);
+            directoryManager.addEntry("/lost+found", entry);
+            if (result.allocated[inodeId] == 2) {
+                result.parents[inodeId] = {lostFound, name};
+            }
         }
     }
 
-    std::cout << "Inode table validated successfully." << std::endl;
+    for (const auto& [directory, entry] : result.dangling) {
+        // Rebuild the directory's path from the parent links (empty if it is unreachable)
+        std::string path;
+        uint32_t current = directory;
+        for (size_t depth = 0; current != 0 && depth < result.allocated.size(); ++depth) {
+            auto parent = result.parents.find(current);
+            if (parent == result.parents.end()) {
+                path.clear();
+                break;
+            }
+            path = "/" + parent->second.second + path;
+            current = parent->second.first;
+        }
+        if (current != 0) {
+            LLFS_LOG_WARN("CrashRecovery", "Dangling entry in unreachable directory: directory=", directory,
+                          " name=", entry.fileName);
+            continue;
+        }
+        directoryManager.removeEntry(path.empty() ? "/" : path, entry.fileName);
+    }
+    report.repaired = true;
 }
 
 // Validate directory entries
 void CrashRecovery::validateDirectories() {
-    std::cout << "Validating directories...\n";
+    LLFS_LOG_DEBUG("CrashRecovery", "Validating directories");
 
     // Validate the root directory (inode 0)
     try {
         Inode rootInode = inodeManager.getInode(0); // Fetch inode 0
         directoryManager.loadRootDirectory(0, rootInode); // Load the root directory
 
-        std::cout << "Root directory validated successfully.\n";
+        LLFS_LOG_INFO("CrashRecovery", "Root directory validated");
     } catch (const std::exception& e) {
         throw std::runtime_error("Directory validation failed: " + std::string(e.what()));
     }
 
-    std::cout << "Root directory entries:\n";
-    for (const auto& entry : directoryManager.listEntries("/")) {
-        std::cout << " - " << entry.fileName << " (inode ID: " << int(entry.inodeId) << ")\n";
-    }
+    // Entries are not listed here: on-disk directories are only read when they are used,
+    // so mounting does not depend on directory size
 
-    // std::cout << "Validating additional directories...\n";
+    // LLFS_LOG_DEBUG("CrashRecovery", "Validating additional directories");
     //
     // // Additional directory validation logic can go here
 }
@@ -5,20 +5,63 @@
 #include "FreeBlockManager.h"
 #include "InodeManager.h"
 #include "DirectoryManager.h"
+#include "Journal.h"
+#include "SegmentManager.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Findings of a full consistency check
+struct ConsistencyReport {
+    size_t inodesChecked = 0;       // Allocated inodes in the inode table
+    size_t directoriesChecked = 0;
+    size_t blocksReferenced = 0;    // Distinct blocks reachable from inode pointers
+    size_t invalidPointers = 0;     // Pointers outside the data blocks (not followed)
+    size_t leakedBlocks = 0;        // Marked in use, but no inode points at them
+    size_t unmarkedBlocks = 0;      // Pointed at, but marked free
+    size_t danglingEntries = 0;     // Directory entries naming a free inode
+    size_t damagedDirectories = 0;  // Directories whose blocks could not be read as entries
+    size_t sharedBlocks = 0;        // Deduplicated: claimed by several file data pointers (fine)
+    std::vector<uint32_t> doublyReferencedBlocks; // Claimed by more than one pointer (not repaired)
+    std::vector<uint32_t> orphanInodes;           // Allocated, but in no directory
+    bool repaired = false;
+    double seconds = 0;
+
+    // Check whether nothing was found
+    bool isConsistent() const;
+};
 
 class CrashRecovery {
 public:
+    // Constructor; threadCount is used by check() (0 = one thread per core)
     CrashRecovery(DiskManager& diskManager, FreeBlockManager& freeBlockManager,
-                  InodeManager& inodeManager, DirectoryManager& directoryManager);
+                  InodeManager& inodeManager, DirectoryManager& directoryManager,
+                  Journal* journal = nullptr, SegmentManager* segmentManager = nullptr,
+                  size_t threadCount = 0);
 
     // Perform crash recovery
     void recover();
 
+    // Full consistency check (fsck) of the flushed file system. Inode table blocks are scanned
+    // in parallel and the block bitmap is rebuilt from inode pointers. With repair, the rebuilt
+    // bitmap replaces the free block vector, orphans are linked into /lost+found and dangling
+    // entries are removed; the caller commits the result. File data blocks may be shared
+    // (deduplication); any other block claimed twice is reported, not repaired.
+    ConsistencyReport check(bool repair);
+
 private:
     DiskManager& diskManager;
     FreeBlockManager& freeBlockManager;
     InodeManager& inodeManager;
     DirectoryManager& directoryManager;
+    Journal* journal;   // Replayed before anything else is read (optional)
+    SegmentManager* segmentManager; // Loaded from its checkpoint before anything else is read (LFS mode)
+    Superblock layout;  // Layout read from the superblock
+    size_t threadCount;
+
+    // What the inode scan found, merged from all workers
+    struct ScanResult;
 
     // Validate the superblock
     void validateSuperblock();
@@ -26,8 +69,19 @@ private:
     // Rebuild the free block vector
     void rebuildFreeBlockVector();
 
-    // Validate inodes
-    void validateInodes();
+    // Rebuild the reference counts of deduplicated blocks from the file data pointers in the
+    // inode table (the counts are not stored on disk)
+    void rebuildReferenceCounts();
+
+    // Scan the inode table in parallel: mark every block an inode points at in an atomic
+    // bitmap and collect directory entries
+    void validateInodes(ScanResult& result);
+
+    // Compare the rebuilt bitmap with the free block vector, find orphans and dangling entries
+    void compareResults(ScanResult& result, ConsistencyReport& report);
+
+    // Apply the rebuilt bitmap, link orphans into /lost+found and drop dangling entries
+    void applyRepairs(ScanResult& result, ConsistencyReport& report);
 
     // Validate directory entries
     void validateDirectories();
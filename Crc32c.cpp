@@ -0,0 +1,163 @@
+#include "Crc32c.h"
+#include <array>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define LLFS_CRC32C_SSE42 1
+#endif
+
+namespace {
+
+constexpr uint32_t POLYNOMIAL = 0x82F63B78u; // Castagnoli, bit-reversed
+
+// Interleaved lanes: long buffers are split into three streams of LONG_LANE bytes, what is
+// left (a 512-byte block, say) into streams of SHORT_LANE bytes
+constexpr size_t LONG_LANE = 1024;
+constexpr size_t SHORT_LANE = 128;
+
+struct Tables {
+    uint32_t slices[8][256];                  // Slicing-by-8 lookup tables
+    std::array<uint32_t[256], 4> longShift;   // CRC state advanced over LONG_LANE zero bytes
+    std::array<uint32_t[256], 4> shortShift;  // ... over SHORT_LANE zero bytes
+};
+
+uint32_t load32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Advance a raw (not inverted) CRC state over bytes, eight at a time
+uint32_t extendSoftware(const Tables& tables, uint32_t state, const uint8_t* p, size_t length) {
+    const auto& t = tables.slices;
+    while (length >= 8) {
+        uint32_t low = load32(p) ^ state;
+        uint32_t high = load32(p + 4);
+        state = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+                t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+        p += 8;
+        length -= 8;
+    }
+    while (length-- > 0) {
+        state = t[0][(state ^ *p++) & 0xFF] ^ (state >> 8);
+    }
+    return state;
+}
+
+// Shifting a state over zero bytes is linear, so it is a lookup per state byte
+void buildShiftTable(const Tables& tables, std::array<uint32_t[256], 4>& shift, size_t zeroBytes) {
+    std::vector<uint8_t> zeros(zeroBytes, 0);
+    for (size_t byte = 0; byte < 4; ++byte) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            shift[byte][i] = extendSoftware(tables, i << (8 * byte), zeros.data(), zeros.size());
+        }
+    }
+}
+
+const Tables& tables() {
+    static const Tables instance = []() {
+        Tables t = {};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (POLYNOMIAL & (0u - (crc & 1)));
+            }
+            t.slices[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (size_t slice = 1; slice < 8; ++slice) {
+                uint32_t previous = t.slices[slice - 1][i];
+                t.slices[slice][i] = (previous >> 8) ^ t.slices[0][previous & 0xFF];
+            }
+        }
+        buildShiftTable(t, t.longShift, LONG_LANE);
+        buildShiftTable(t, t.shortShift, SHORT_LANE);
+        return t;
+    }();
+    return instance;
+}
+
+uint32_t shift(const std::array<uint32_t[256], 4>& table, uint32_t state) {
+    return table[0][state & 0xFF] ^ table[1][(state >> 8) & 0xFF] ^ table[2][(state >> 16) & 0xFF] ^
+           table[3][state >> 24];
+}
+
+#ifdef LLFS_CRC32C_SSE42
+// Advance a raw CRC state over three interleaved lanes of lane bytes while they fit
+__attribute__((target("sse4.2")))
+uint32_t extendLanes(uint32_t state, const uint8_t*& p, size_t& length, size_t lane,
+                     const std::array<uint32_t[256], 4>& shiftTable) {
+    while (length >= 3 * lane) {
+        uint64_t a = state, b = 0, c = 0;
+        for (size_t i = 0; i < lane; i += 8) {
+            uint64_t wordA, wordB, wordC;
+            std::memcpy(&wordA, p + i, 8);
+            std::memcpy(&wordB, p + lane + i, 8);
+            std::memcpy(&wordC, p + 2 * lane + i, 8);
+            a = _mm_crc32_u64(a, wordA);
+            b = _mm_crc32_u64(b, wordB);
+            c = _mm_crc32_u64(c, wordC);
+        }
+        // CRC(x || y) = CRC(x) shifted over y's length ^ CRC(y) started from 0
+        state = shift(shiftTable, shift(shiftTable, static_cast<uint32_t>(a)) ^ static_cast<uint32_t>(b)) ^
+                static_cast<uint32_t>(c);
+        p += 3 * lane;
+        length -= 3 * lane;
+    }
+    return state;
+}
+
+// Advance a raw CRC state on the crc32 instruction: interleaved lanes, then the rest serially
+__attribute__((target("sse4.2")))
+uint32_t extendHardware(const Tables& tables, uint32_t state, const uint8_t* p, size_t length) {
+    state = extendLanes(state, p, length, LONG_LANE, tables.longShift);
+    state = extendLanes(state, p, length, SHORT_LANE, tables.shortShift);
+
+    uint64_t wide = state;
+    while (length >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        wide = _mm_crc32_u64(wide, word);
+        p += 8;
+        length -= 8;
+    }
+    state = static_cast<uint32_t>(wide);
+    while (length-- > 0) {
+        state = _mm_crc32_u8(state, *p++);
+    }
+    return state;
+}
+#endif
+
+} // namespace
+
+// Extend crc over length bytes, on the crc32 instruction when the CPU has it
+uint32_t Crc32c::compute(uint32_t crc, const void* data, size_t length) {
+    static const bool hardware = hasHardwareSupport();
+    return hardware ? computeHardware(crc, data, length) : computeSoftware(crc, data, length);
+}
+
+// Table-driven implementation (slicing-by-8)
+uint32_t Crc32c::computeSoftware(uint32_t crc, const void* data, size_t length) {
+    return ~extendSoftware(tables(), ~crc, static_cast<const uint8_t*>(data), length);
+}
+
+// SSE4.2 implementation (falls back to the tables where it is not compiled in)
+uint32_t Crc32c::computeHardware(uint32_t crc, const void* data, size_t length) {
+#ifdef LLFS_CRC32C_SSE42
+    return ~extendHardware(tables(), ~crc, static_cast<const uint8_t*>(data), length);
+#else
+    return computeSoftware(crc, data, length);
+#endif
+}
+
+// Check whether this CPU has the crc32 instruction
+bool Crc32c::hasHardwareSupport() {
+#ifdef LLFS_CRC32C_SSE42
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return false;
+#endif
+}
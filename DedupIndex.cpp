@@ -0,0 +1,105 @@
+#include "DedupIndex.h"
+#include "Sha256.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Constructor
+DedupIndex::DedupIndex(size_t totalBlocks) : slotOfBlock(totalBlocks, 0) {
+    size_t capacity = 16;
+    while (capacity * 2 < totalBlocks * 3) {
+        capacity *= 2;
+    }
+    table.resize(capacity);
+    mask = capacity - 1;
+}
+
+// Fingerprint length bytes
+DedupIndex::Fingerprint DedupIndex::fingerprint(const char* data, size_t length) {
+    Sha256::Digest digest = Sha256::hash(data, length);
+    Fingerprint result;
+    std::memcpy(&result.high, digest.data(), sizeof(result.high));
+    std::memcpy(&result.low, digest.data() + 8, sizeof(result.low));
+    return result;
+}
+
+// Find the block holding a fingerprint (0 if none does)
+uint32_t DedupIndex::find(const Fingerprint& fingerprint) const {
+    for (size_t slot = home(fingerprint);; slot = (slot + 1) & mask) {
+        const Entry& entry = table[slot];
+        if (entry.blockNumber == 0 || entry.fingerprint == fingerprint) {
+            return entry.blockNumber;
+        }
+    }
+}
+
+// Index a block; a block already indexed is moved to the new fingerprint
+void DedupIndex::insert(const Fingerprint& fingerprint, uint32_t blockNumber) {
+    if (blockNumber == 0 || blockNumber >= slotOfBlock.size()) {
+        throw std::out_of_range("Block number out of range.");
+    }
+    remove(blockNumber);
+
+    size_t slot = home(fingerprint);
+    while (table[slot].blockNumber != 0) {
+        if (table[slot].fingerprint == fingerprint) {
+            // Another block with the same bytes takes over the entry
+            slotOfBlock[table[slot].blockNumber] = 0;
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (table[slot].blockNumber == 0) {
+        ++size; // Cannot fill up: every block has at most one entry and the table is larger
+    }
+    table[slot] = Entry{fingerprint, blockNumber};
+    slotOfBlock[blockNumber] = static_cast<uint32_t>(slot + 1);
+}
+
+// Forget a block (no-op if it is not indexed)
+void DedupIndex::remove(uint32_t blockNumber) {
+    if (blockNumber >= slotOfBlock.size() || slotOfBlock[blockNumber] == 0) {
+        return;
+    }
+    size_t hole = slotOfBlock[blockNumber] - 1;
+    slotOfBlock[blockNumber] = 0;
+    table[hole] = Entry{};
+    --size;
+
+    // Shift later entries of the probe run back into the hole, so lookups never stop early
+    for (size_t slot = (hole + 1) & mask; table[slot].blockNumber != 0; slot = (slot + 1) & mask) {
+        size_t target = home(table[slot].fingerprint);
+        bool stays = hole < slot ? (target > hole && target <= slot) : (target > hole || target <= slot);
+        if (stays) {
+            continue;
+        }
+        table[hole] = table[slot];
+        slotOfBlock[table[hole].blockNumber] = static_cast<uint32_t>(hole + 1);
+        table[slot] = Entry{};
+        hole = slot;
+    }
+}
+
+// Forget everything
+void DedupIndex::clear() {
+    std::fill(table.begin(), table.end(), Entry{});
+    std::fill(slotOfBlock.begin(), slotOfBlock.end(), 0);
+    size = 0;
+}
+
+size_t DedupIndex::getSize() const {
+    return size;
+}
+
+size_t DedupIndex::getCapacity() const {
+    return table.size();
+}
+
+size_t DedupIndex::getMemoryUsage() const {
+    return table.size() * sizeof(Entry) + slotOfBlock.size() * sizeof(uint32_t);
+}
+
+// Helper function to get the slot a fingerprint hashes to
+size_t DedupIndex::home(const Fingerprint& fingerprint) const {
+    return static_cast<size_t>(fingerprint.low) & mask; // SHA-256 bits are already uniform
+}
@@ -0,0 +1,59 @@
+#ifndef DEDUPINDEX_H
+#define DEDUPINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fingerprint index for block deduplication: maps the first 128 bits of a block's SHA-256 to
+// the data block holding those bytes. The table is open-addressed and sized once for the
+// volume (at most two thirds full when every block is indexed), so its memory per block is
+// fixed and it never rehashes; entries are removed by block number when the block is freed.
+class DedupIndex {
+public:
+    struct Fingerprint {
+        uint64_t high = 0;
+        uint64_t low = 0;
+
+        bool operator==(const Fingerprint& other) const = default;
+    };
+
+    // Constructor; totalBlocks bounds the block numbers that can be indexed
+    explicit DedupIndex(size_t totalBlocks);
+
+    // Fingerprint length bytes
+    static Fingerprint fingerprint(const char* data, size_t length);
+
+    // Find the block holding a fingerprint (0 if none does)
+    uint32_t find(const Fingerprint& fingerprint) const;
+
+    // Index a block; a block already indexed is moved to the new fingerprint
+    void insert(const Fingerprint& fingerprint, uint32_t blockNumber);
+
+    // Forget a block (no-op if it is not indexed)
+    void remove(uint32_t blockNumber);
+
+    // Forget everything
+    void clear();
+
+    // Statistics
+    size_t getSize() const;
+    size_t getCapacity() const;
+    size_t getMemoryUsage() const; // Bytes held by the table and the reverse map
+
+private:
+    struct Entry {
+        Fingerprint fingerprint;
+        uint32_t blockNumber = 0; // 0 = empty slot
+    };
+
+    std::vector<Entry> table;         // Linear probing; capacity is a power of two
+    std::vector<uint32_t> slotOfBlock; // Table slot + 1 per block (0 = not indexed)
+    size_t mask;
+    size_t size = 0;
+
+    // Helper function to get the slot a fingerprint hashes to
+    size_t home(const Fingerprint& fingerprint) const;
+};
+
+#endif // DEDUPINDEX_H
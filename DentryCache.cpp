@@ -0,0 +1,130 @@
+#include "DentryCache.h"
+#include "DirectoryIndex.h"
+
+#include <algorithm>
+
+// Constructor
+DentryCache::DentryCache(size_t capacity)
+    : capacity(capacity), shards(std::clamp<size_t>(capacity / MIN_SHARD_CAPACITY, 1, MAX_SHARDS)) {
+    for (size_t i = 0; i < shards.size(); ++i) {
+        shards[i].capacity = capacity / shards.size() + (i < capacity % shards.size() ? 1 : 0);
+    }
+}
+
+// Look up a name in a directory
+DentryCache::Result DentryCache::lookup(uint32_t parentId, std::string_view name, uint32_t& childId) {
+    Key key{parentId, std::string(name)};
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& lru = shard.lru;
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        ++misses;
+        return Result::Miss;
+    }
+
+    // Move to the front of the LRU list
+    lru.splice(lru.begin(), lru, it->second);
+
+    const Node& node = *it->second;
+    if (node.negative) {
+        ++negativeHits;
+        return Result::Negative;
+    }
+    ++hits;
+    childId = node.childId;
+    return Result::Positive;
+}
+
+// Remember that a name maps to a child inode
+void DentryCache::insert(uint32_t parentId, std::string_view name, uint32_t childId) {
+    put(parentId, name, childId, false);
+}
+
+// Remember that a name does not exist
+void DentryCache::insertNegative(uint32_t parentId, std::string_view name) {
+    put(parentId, name, 0, true);
+}
+
+// Forget a name (positive or negative)
+void DentryCache::invalidate(uint32_t parentId, std::string_view name) {
+    Key key{parentId, std::string(name)};
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        shard.lru.erase(it->second);
+        shard.entries.erase(it);
+    }
+}
+
+// Forget everything
+void DentryCache::clear() {
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.clear();
+        shard.lru.clear();
+    }
+}
+
+size_t DentryCache::getSize() const {
+    size_t size = 0;
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size += shard.entries.size();
+    }
+    return size;
+}
+
+size_t DentryCache::getCapacity() const {
+    return capacity;
+}
+
+size_t DentryCache::getHits() const {
+    return hits;
+}
+
+size_t DentryCache::getNegativeHits() const {
+    return negativeHits;
+}
+
+size_t DentryCache::getMisses() const {
+    return misses;
+}
+
+size_t DentryCache::KeyHash::operator()(const Key& key) const {
+    return (static_cast<size_t>(key.parentId) << 32) ^ DirectoryIndex::hashName(key.name);
+}
+
+// Helper function to pick the shard holding a key
+DentryCache::Shard& DentryCache::shardFor(const Key& key) const {
+    return shards[KeyHash()(key) % shards.size()];
+}
+
+// Add or refresh an entry, evicting the shard's least recently used one when full
+void DentryCache::put(uint32_t parentId, std::string_view name, uint32_t childId, bool negative) {
+    if (capacity == 0) {
+        return;
+    }
+
+    Key key{parentId, std::string(name)};
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& lru = shard.lru;
+    auto& entries = shard.entries;
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        it->second->childId = childId;
+        it->second->negative = negative;
+        lru.splice(lru.begin(), lru, it->second);
+        return;
+    }
+
+    if (entries.size() >= shard.capacity) {
+        entries.erase(lru.back().key);
+        lru.pop_back();
+    }
+
+    lru.push_front(Node{key, childId, negative});
+    entries.emplace(std::move(key), lru.begin());
+}
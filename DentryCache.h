@@ -0,0 +1,95 @@
+#ifndef DENTRYCACHE_H
+#define DENTRYCACHE_H
+
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Caches name lookups as (parent inode, name) -> child inode, with bounded LRU eviction.
+// Negative entries remember names that do not exist so repeated failed lookups skip the
+// directory. DirectoryManager keeps the cache coherent on every insert and remove.
+// Entries are spread over shards by key, each with its own lock and LRU list, so lookups
+// from several threads rarely contend; small caches use a single shard (exact LRU).
+class DentryCache {
+public:
+    enum class Result {
+        Miss,       // Not cached: consult the directory
+        Positive,   // Name exists; childId is set
+        Negative    // Name is known not to exist
+    };
+
+    // Most shards a cache is split into, and the fewest entries per shard
+    static constexpr size_t MAX_SHARDS = 16;
+    static constexpr size_t MIN_SHARD_CAPACITY = 256;
+
+    // Constructor
+    explicit DentryCache(size_t capacity = 4096);
+
+    // Look up a name in a directory
+    Result lookup(uint32_t parentId, std::string_view name, uint32_t& childId);
+
+    // Remember that a name maps to a child inode
+    void insert(uint32_t parentId, std::string_view name, uint32_t childId);
+
+    // Remember that a name does not exist
+    void insertNegative(uint32_t parentId, std::string_view name);
+
+    // Forget a name (positive or negative)
+    void invalidate(uint32_t parentId, std::string_view name);
+
+    // Forget everything
+    void clear();
+
+    // Statistics
+    size_t getSize() const;
+    size_t getCapacity() const;
+    size_t getHits() const;
+    size_t getNegativeHits() const;
+    size_t getMisses() const;
+
+private:
+    struct Key {
+        uint32_t parentId;
+        std::string name;
+        bool operator==(const Key& other) const {
+            return parentId == other.parentId && name == other.name;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Node {
+        Key key;
+        uint32_t childId;
+        bool negative;      // Name does not exist
+    };
+
+    struct Shard {
+        std::mutex mutex;    // Guards the members below
+        size_t capacity = 0;
+        std::list<Node> lru; // Most recently used first
+        std::unordered_map<Key, std::list<Node>::iterator, KeyHash> entries;
+    };
+
+    size_t capacity;
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> negativeHits{0};
+    std::atomic<size_t> misses{0};
+    mutable std::vector<Shard> shards;
+
+    // Helper function to pick the shard holding a key
+    Shard& shardFor(const Key& key) const;
+
+    // Add or refresh an entry, evicting the shard's least recently used one when full
+    void put(uint32_t parentId, std::string_view name, uint32_t childId, bool negative);
+};
+
+#endif // DENTRYCACHE_H
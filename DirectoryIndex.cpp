@@ -0,0 +1,90 @@
+#include "DirectoryIndex.h"
+
+// Constructor
+DirectoryIndex::DirectoryIndex()
+    : buckets(16, Bucket{0, EMPTY}), mask(15), count(0) {}
+
+// Hash a file name (FNV-1a)
+uint32_t DirectoryIndex::hashName(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Add a slot under the given hash
+void DirectoryIndex::insert(uint32_t hash, uint32_t slot) {
+    // Keep the load factor at or below 3/4 so probe sequences stay short
+    if ((count + 1) * 4 > buckets.size() * 3) {
+        rehash(buckets.size() * 2);
+    }
+
+    size_t i = hash & mask;
+    while (buckets[i].slot != EMPTY) {
+        i = (i + 1) & mask;
+    }
+    buckets[i] = {hash, slot};
+    ++count;
+}
+
+// Remove a slot that was inserted under the given hash
+void DirectoryIndex::erase(uint32_t hash, uint32_t slot) {
+    size_t i = hash & mask;
+    while (buckets[i].slot != slot) {
+        if (buckets[i].slot == EMPTY) {
+            return; // Not indexed
+        }
+        i = (i + 1) & mask;
+    }
+
+    // Backward-shift deletion: pull later members of the probe run into the hole
+    // so lookups never need tombstones
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; buckets[j].slot != EMPTY; j = (j + 1) & mask) {
+        size_t home = buckets[j].hash & mask;
+        // Move j into the hole unless its home lies cyclically in (hole, j]
+        bool homeBetween = hole <= j ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (!homeBetween) {
+            buckets[hole] = buckets[j];
+            hole = j;
+        }
+    }
+    buckets[hole] = {0, EMPTY};
+    --count;
+}
+
+// Make room for at least the given number of slots without rehashing
+void DirectoryIndex::reserve(size_t slots) {
+    size_t bucketCount = buckets.size();
+    while (slots * 4 > bucketCount * 3) {
+        bucketCount *= 2;
+    }
+    if (bucketCount != buckets.size()) {
+        rehash(bucketCount);
+    }
+}
+
+// Number of indexed slots
+size_t DirectoryIndex::size() const {
+    return count;
+}
+
+// Rebuild the table with the given number of buckets
+void DirectoryIndex::rehash(size_t bucketCount) {
+    std::vector<Bucket> old(bucketCount, Bucket{0, EMPTY});
+    old.swap(buckets);
+    mask = bucketCount - 1;
+    count = 0;
+    for (const Bucket& bucket : old) {
+        if (bucket.slot != EMPTY) {
+            size_t i = bucket.hash & mask;
+            while (buckets[i].slot != EMPTY) {
+                i = (i + 1) & mask;
+            }
+            buckets[i] = bucket;
+            ++count;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef DIRECTORYINDEX_H
+#define DIRECTORYINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Open-addressing hash index from file name hashes to entry slots of one directory.
+// The index stores only hashes and slot numbers; callers confirm a match by comparing
+// the name stored in the slot.
+class DirectoryIndex {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    // Constructor
+    DirectoryIndex();
+
+    // Hash a file name (FNV-1a)
+    static uint32_t hashName(std::string_view name);
+
+    // Find the slot whose entry matches, probing only buckets with the same hash
+    template <typename Matches>
+    uint32_t find(uint32_t hash, Matches&& matches) const {
+        for (size_t i = hash & mask; buckets[i].slot != EMPTY; i = (i + 1) & mask) {
+            if (buckets[i].hash == hash && matches(buckets[i].slot)) {
+                return buckets[i].slot;
+            }
+        }
+        return NOT_FOUND;
+    }
+
+    // Add a slot under the given hash
+    void insert(uint32_t hash, uint32_t slot);
+
+    // Remove a slot that was inserted under the given hash
+    void erase(uint32_t hash, uint32_t slot);
+
+    // Make room for at least the given number of slots without rehashing
+    void reserve(size_t slots);
+
+    // Number of indexed slots
+    size_t size() const;
+
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    struct Bucket {
+        uint32_t hash;
+        uint32_t slot; // EMPTY if the bucket is unused
+    };
+
+    std::vector<Bucket> buckets; // Power-of-two sized table, linear probing
+    size_t mask;                 // buckets.size() - 1
+    size_t count;                // Number of used buckets
+
+    // Rebuild the table with the given number of buckets
+    void rehash(size_t bucketCount);
+};
+
+#endif // DIRECTORYINDEX_H
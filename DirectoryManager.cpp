@@ -1,21 +1,43 @@
 #include "DirectoryManager.h"
 #include "InodeManager.h"
+#include <algorithm>
 #include <cstring> // For strncpy
-#include <iostream>
+#include <ctime>
+#include <unordered_set>
+#include "Logger.h"
 
 
-// Constructor
-DirectoryManager::DirectoryManager() {
+// Constructor for directories kept only in memory
+DirectoryManager::DirectoryManager()
+    : inodeManager(nullptr), rootInodeId(0) {
     // Root directory is initialized later with createRootDirectory
 }
 
+// Constructor for directories stored in the data blocks of directory inodes
+DirectoryManager::DirectoryManager(DiskManager& diskManager, FreeBlockManager& freeBlockManager,
+                                   InodeManager& inodeManager)
+    : inodeManager(&inodeManager), store(std::make_unique<DirectoryStore>(diskManager, freeBlockManager)),
+      rootInodeId(0) {
+    // Root directory is initialized later with createRootDirectory or loadRootDirectory
+}
+
+DirectoryManager::~DirectoryManager() = default;
+
 // Create the root directory
-void DirectoryManager::createRootDirectory(uint8_t rootInodeId) {
-    if (directoryTable.find("/") != directoryTable.end()) {
+void DirectoryManager::createRootDirectory(uint32_t rootInodeId) {
+    if (store) {
+        // The root inode was written empty by formatDisk; its blocks hold the entries
+        this->rootInodeId = rootInodeId;
+        dentryCache.clear();
+        return;
+    }
+
+    if (directoryTable.find(rootInodeId) != directoryTable.end()) {
         throw std::runtime_error("Root directory already exists.");
     }
 
-    directoryTable["/"] = {}; // Initialize an empty list of entries
+    this->rootInodeId = rootInodeId;
+    directoryTable[rootInodeId] = {}; // Initialize an empty list of entries
 }
 
 
@@ -23,73 +45,524 @@ void DirectoryManager::createRootDirectory(uint8_t rootInodeId) {
 void DirectoryManager::addEntry(const std::string& path, const DirectoryEntry& entry) {
     validateName(entry.fileName);
 
-    if (directoryTable.find(path) == directoryTable.end()) {
-        throw std::runtime_error("Directory does not exist: " + path);
+    uint32_t directoryId = resolveDirectory(path);
+    insertEntry(directoryId, entry);
+    dentryCache.insert(directoryId, entry.fileName, entry.inodeId);
+
+    LLFS_LOG_DEBUG("DirectoryManager", "Added entry: name=", entry.fileName, " inode=", entry.inodeId,
+                   " path=", path);
+}
+
+
+// Get an entry from a directory
+DirectoryEntry DirectoryManager::getEntry(const std::string& path, const std::string& fileName) const {
+    uint32_t childId;
+    if (!lookupChild(resolveDirectory(path), fileName, childId)) {
+        throw std::runtime_error("File not found: " + fileName);
     }
 
-    // Check if the file already exists in the directory
-    for (const auto& e : directoryTable[path]) {
-        if (std::strcmp(e.fileName, entry.fileName) == 0) {
-            throw std::runtime_error("File already exists: " + std::string(entry.fileName));
+    DirectoryEntry entry = {childId, ""};
+    std::strncpy(entry.fileName, fileName.c_str(), sizeof(entry.fileName) - 1);
+    return entry;
+}
+
+// Remove an entry from a directory
+void DirectoryManager::removeEntry(const std::string& path, const std::string& fileName) {
+    uint32_t directoryId = resolveDirectory(path);
+    if (!eraseEntry(directoryId, fileName)) {
+        throw std::runtime_error("File not found: " + fileName);
+    }
+    dentryCache.insertNegative(directoryId, fileName);
+}
+
+// Link inodeIds[i] at paths[i], grouped by parent directory
+void DirectoryManager::addEntries(const std::vector<std::string>& paths, const std::vector<uint32_t>& inodeIds) {
+    if (paths.size() != inodeIds.size()) {
+        throw std::invalid_argument("Every path needs an inode.");
+    }
+    std::vector<BatchGroup> groups = groupByDirectory(paths);
+
+    // Check every name before adding any
+    for (const BatchGroup& group : groups) {
+        std::unordered_set<std::string> seen;
+        for (const auto& [name, position] : group.names) {
+            validateName(name);
+            uint32_t childId;
+            if (!seen.insert(name).second || lookupChild(group.directoryId, name, childId)) {
+                throw std::runtime_error("File already exists: " + name);
+            }
         }
     }
 
-    // Add the entry to the directory
-    directoryTable[path].push_back(entry);
+    // Only running out of directory blocks can fail now; the groups added so far are undone
+    size_t added = 0;
+    try {
+        for (; added < groups.size(); ++added) {
+            insertGroup(groups[added], inodeIds);
+        }
+    } catch (...) {
+        for (size_t i = 0; i < added; ++i) {
+            eraseGroup(groups[i]);
+        }
+        throw;
+    }
 
-    // Debug log
-    std::cout << "Added entry: " << entry.fileName << " to path: " << path << std::endl;
+    LLFS_LOG_DEBUG("DirectoryManager", "Added entries: count=", paths.size(), " directories=", groups.size());
 }
 
+// Unlink many paths, grouped by parent directory
+void DirectoryManager::removeEntries(const std::vector<std::string>& paths) {
+    std::vector<BatchGroup> groups = groupByDirectory(paths);
 
-// Get an entry from a directory
-DirectoryEntry DirectoryManager::getEntry(const std::string& path, const std::string& fileName) const {
-    if (directoryTable.find(path) == directoryTable.end()) {
-        throw std::runtime_error("Directory does not exist: " + path);
+    // Check every name before removing any
+    for (const BatchGroup& group : groups) {
+        std::unordered_set<std::string> seen;
+        for (const auto& [name, position] : group.names) {
+            uint32_t childId;
+            if (!seen.insert(name).second || !lookupChild(group.directoryId, name, childId)) {
+                throw std::runtime_error("File not found: " + name);
+            }
+        }
+    }
+
+    for (const BatchGroup& group : groups) {
+        eraseGroup(group);
     }
 
-    // Search for the file in the directory
-    for (const auto& entry : directoryTable.at(path)) {
-        if (std::strcmp(entry.fileName, fileName.c_str()) == 0) {
-            return entry;
+    LLFS_LOG_DEBUG("DirectoryManager", "Removed entries: count=", paths.size(), " directories=", groups.size());
+}
+
+// Map many paths to inodes, resolving each parent directory once
+std::vector<uint32_t> DirectoryManager::lookupEntries(const std::vector<std::string>& paths) const {
+    std::vector<uint32_t> inodeIds(paths.size(), NO_ENTRY);
+    for (const BatchGroup& group : groupByDirectory(paths)) {
+        for (const auto& [name, position] : group.names) {
+            uint32_t childId;
+            if (name.empty()) {
+                inodeIds[position] = group.directoryId;
+            } else if (lookupChild(group.directoryId, name, childId)) {
+                inodeIds[position] = childId;
+            }
         }
     }
+    return inodeIds;
+}
 
-    throw std::runtime_error("File not found: " + fileName);
+// Get all entries in a directory (copies the whole directory; prefer readDirectory)
+std::vector<DirectoryEntry> DirectoryManager::listEntries(const std::string& path) const {
+    std::vector<DirectoryEntry> entries;
+    uint64_t cookie = 0;
+    while (cookie != READDIR_END) {
+        cookie = readDirectory(path, cookie, SIZE_MAX, entries);
+    }
+    return entries;
 }
 
-// Remove an entry from a directory
-void DirectoryManager::removeEntry(const std::string& path, const std::string& fileName) {
-    if (directoryTable.find(path) == directoryTable.end()) {
-        throw std::runtime_error("Directory does not exist: " + path);
+// Append up to maxEntries entries of a directory, starting at a cookie (0 = beginning)
+uint64_t DirectoryManager::readDirectory(const std::string& path, uint64_t cookie, size_t maxEntries,
+                                         std::vector<DirectoryEntry>& batch) const {
+    uint32_t directoryId = resolveDirectory(path);
+    if (store) {
+        InodeHandle directoryInode = inodeManager->acquireInode(directoryId);
+        return store->readdir(*directoryInode, cookie, maxEntries, batch);
     }
 
-    auto& entries = directoryTable[path];
-    for (auto it = entries.begin(); it != entries.end(); ++it) {
-        if (std::strcmp(it->fileName, fileName.c_str()) == 0) {
-            entries.erase(it);
-            return;
+    // In memory the cookie is a slot number: slots never move, so it survives inserts and removals
+    const Directory& directory = findDirectory(directoryId);
+    size_t slot = cookie;
+    for (size_t returned = 0; slot < directory.slots.size(); ++slot) {
+        if (directory.slots[slot].fileName[0] == '\0') {
+            continue;
+        }
+        if (returned == maxEntries) {
+            return slot;
         }
+        batch.push_back(directory.slots[slot]);
+        ++returned;
     }
+    return READDIR_END;
+}
 
-    throw std::runtime_error("File not found: " + fileName);
+// Get the number of entries in a directory
+size_t DirectoryManager::getEntryCount(const std::string& path) const {
+    uint32_t directoryId = resolveDirectory(path);
+    if (store) {
+        size_t count = 0;
+        InodeHandle directoryInode = inodeManager->acquireInode(directoryId);
+        store->forEach(*directoryInode, [&](const DirectoryEntry&) { ++count; });
+        return count;
+    }
+    return findDirectory(directoryId).index.size();
 }
 
-// Get all entries in a directory
-std::vector<DirectoryEntry> DirectoryManager::listEntries(const std::string& path) const {
-    if (directoryTable.find(path) == directoryTable.end()) {
-        throw std::runtime_error("Directory does not exist: " + path);
+// Map a path ("/a/b/c", "." and ".." allowed) to the inode it names
+uint32_t DirectoryManager::resolvePath(const std::string& path) const {
+    return walk(splitComponents(path), path);
+}
+
+// Map a path to an inode using only names in the dentry cache
+bool DirectoryManager::resolveCached(const std::string& path, uint32_t& inodeId) const {
+    inodeId = rootInodeId;
+    for (const auto& component : splitComponents(path)) {
+        if (dentryCache.lookup(inodeId, component, inodeId) != DentryCache::Result::Positive) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Map a path to the inode of the directory it names
+uint32_t DirectoryManager::resolveDirectory(const std::string& path) const {
+    uint32_t inodeId = resolvePath(path);
+    if (!isDirectory(inodeId)) {
+        throw std::runtime_error("Not a directory: " + path);
+    }
+    return inodeId;
+}
+
+// Link a new directory inode at a path
+void DirectoryManager::createDirectory(const std::string& path, uint32_t inodeId) {
+    std::string parent, name;
+    splitPath(path, parent, name);
+    validateName(name);
+
+    if (store) {
+        if (!isDirectory(inodeId)) {
+            throw std::runtime_error("Inode is not a directory.");
+        }
+    } else if (directoryTable.find(inodeId) != directoryTable.end()) {
+        throw std::runtime_error("Directory already exists: " + path);
+    }
+
+    uint32_t parentId = resolveDirectory(parent);
+    DirectoryEntry entry = {inodeId, ""};
+    std::strncpy(entry.fileName, name.c_str(), sizeof(entry.fileName) - 1);
+    insertEntry(parentId, entry);
+    dentryCache.insert(parentId, name, inodeId);
+
+    if (!store) {
+        directoryTable[inodeId] = {};
+    }
+
+    LLFS_LOG_DEBUG("DirectoryManager", "Created directory: path=", path, " inode=", inodeId);
+}
+
+// Unlink an empty directory and free its blocks; returns its inode for the caller to free
+uint32_t DirectoryManager::removeDirectory(const std::string& path) {
+    std::string parent, name;
+    splitPath(path, parent, name);
+
+    uint32_t parentId = resolveDirectory(parent);
+    uint32_t directoryId;
+    if (!lookupChild(parentId, name, directoryId)) {
+        throw std::runtime_error("Path does not exist: " + path);
+    }
+    if (!isDirectory(directoryId)) {
+        throw std::runtime_error("Not a directory: " + path);
+    }
+
+    if (store) {
+        Inode directoryInode = *inodeManager->acquireInode(directoryId);
+        if (!store->isEmpty(directoryInode)) {
+            throw std::runtime_error("Directory not empty: " + path);
+        }
+        eraseEntry(parentId, name);
+        store->release(directoryInode);
+        inodeManager->updateInode(directoryId, directoryInode);
+    } else {
+        if (findDirectory(directoryId).index.size() != 0) {
+            throw std::runtime_error("Directory not empty: " + path);
+        }
+        eraseEntry(parentId, name);
+        directoryTable.erase(directoryId);
     }
+    dentryCache.insertNegative(parentId, name);
 
-    // Debug log
-    std::cout << "Listing entries in path: " << path << std::endl;
-    for (const auto& entry : directoryTable.at(path)) {
-        std::cout << " - " << entry.fileName << " (inode: " << int(entry.inodeId) << ")" << std::endl;
+    return directoryId;
+}
+
+// Split a path into its parent directory and final component
+void DirectoryManager::splitPath(const std::string& path, std::string& parent, std::string& name) {
+    std::vector<std::string> components = splitComponents(path);
+    if (components.empty()) {
+        throw std::invalid_argument("Path does not name an entry: " + path);
     }
 
-    return directoryTable.at(path);
+    name = components.back();
+    components.pop_back();
+    parent = "/";
+    for (size_t i = 0; i < components.size(); ++i) {
+        if (i > 0) parent += "/";
+        parent += components[i];
+    }
 }
 
+// Get the on-disk directory store (null when directories are kept in memory)
+const DirectoryStore* DirectoryManager::getStore() const {
+    return store.get();
+}
+
+// Get the dentry cache (for statistics)
+const DentryCache& DirectoryManager::getDentryCache() const {
+    return dentryCache;
+}
+
+// Helper function to split a path into components, applying "." and ".."
+std::vector<std::string> DirectoryManager::splitComponents(const std::string& path) {
+    std::vector<std::string> components;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find('/', start);
+        if (end == std::string::npos) end = path.size();
+
+        std::string component = path.substr(start, end - start);
+        if (component == "..") {
+            if (!components.empty()) components.pop_back(); // ".." of the root is the root
+        } else if (!component.empty() && component != ".") {
+            components.push_back(std::move(component));
+        }
+        start = end + 1;
+    }
+    return components;
+}
+
+// Helper function to walk path components from the root
+uint32_t DirectoryManager::walk(const std::vector<std::string>& components, const std::string& path) const {
+    uint32_t inodeId = rootInodeId;
+    for (const auto& component : components) {
+        if (!isDirectory(inodeId)) {
+            throw std::runtime_error("Not a directory: " + path);
+        }
+        if (!lookupChild(inodeId, component, inodeId)) {
+            throw std::runtime_error("Path does not exist: " + path);
+        }
+    }
+    return inodeId;
+}
+
+// Helper function to find a name in a directory, going through the dentry cache
+bool DirectoryManager::lookupChild(uint32_t directoryId, const std::string& name, uint32_t& childId) const {
+    switch (dentryCache.lookup(directoryId, name, childId)) {
+    case DentryCache::Result::Positive:
+        return true;
+    case DentryCache::Result::Negative:
+        return false;
+    case DentryCache::Result::Miss:
+        break;
+    }
+
+    DirectoryEntry entry;
+    if (!findEntry(directoryId, name, entry)) {
+        dentryCache.insertNegative(directoryId, name);
+        return false;
+    }
+    dentryCache.insert(directoryId, name, entry.inodeId);
+    childId = entry.inodeId;
+    return true;
+}
+
+// Helper function to find an entry of a directory inode (uncached)
+bool DirectoryManager::findEntry(uint32_t directoryId, const std::string& name, DirectoryEntry& entry) const {
+    if (store) {
+        InodeHandle directoryInode = inodeManager->acquireInode(directoryId);
+        return store->lookup(*directoryInode, name, entry);
+    }
+
+    const Directory& directory = findDirectory(directoryId);
+    uint32_t slot = findSlot(directory, DirectoryIndex::hashName(name), name.c_str());
+    if (slot == DirectoryIndex::NOT_FOUND) {
+        return false;
+    }
+    entry = directory.slots[slot];
+    return true;
+}
+
+// Helper function to add an entry to a directory inode (uncached)
+void DirectoryManager::insertEntry(uint32_t directoryId, const DirectoryEntry& entry) {
+    if (store) {
+        Inode directoryInode = *inodeManager->acquireInode(directoryId);
+        store->insert(directoryInode, entry);
+        directoryInode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
+        inodeManager->updateInode(directoryId, directoryInode);
+        return;
+    }
+
+    Directory& directory = findDirectory(directoryId);
+
+    // Check if the file already exists in the directory
+    uint32_t hash = DirectoryIndex::hashName(entry.fileName);
+    if (findSlot(directory, hash, entry.fileName) != DirectoryIndex::NOT_FOUND) {
+        throw std::runtime_error("File already exists: " + std::string(entry.fileName));
+    }
+
+    // Add the entry to the directory, reusing a free slot if there is one
+    uint32_t slot;
+    if (!directory.freeSlots.empty()) {
+        slot = directory.freeSlots.back();
+        directory.freeSlots.pop_back();
+        directory.slots[slot] = entry;
+    } else {
+        slot = static_cast<uint32_t>(directory.slots.size());
+        directory.slots.push_back(entry);
+    }
+    directory.index.insert(hash, slot);
+}
+
+// Helper function to remove an entry from a directory inode (uncached)
+bool DirectoryManager::eraseEntry(uint32_t directoryId, const std::string& name) {
+    if (store) {
+        Inode directoryInode = *inodeManager->acquireInode(directoryId);
+        if (!store->remove(directoryInode, name)) {
+            return false;
+        }
+        directoryInode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
+        inodeManager->updateInode(directoryId, directoryInode);
+        return true;
+    }
+
+    Directory& directory = findDirectory(directoryId);
+
+    uint32_t hash = DirectoryIndex::hashName(name);
+    uint32_t slot = findSlot(directory, hash, name.c_str());
+    if (slot == DirectoryIndex::NOT_FOUND) {
+        return false;
+    }
+
+    directory.index.erase(hash, slot);
+    directory.slots[slot] = {};
+    directory.freeSlots.push_back(slot);
+    return true;
+}
+
+// Helper function to group the paths of a batch by parent directory, resolving each once
+std::vector<DirectoryManager::BatchGroup> DirectoryManager::groupByDirectory(const std::vector<std::string>& paths) const {
+    std::vector<BatchGroup> groups;
+    std::unordered_map<std::string, size_t> groupOfParent;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        std::vector<std::string> components = splitComponents(paths[i]);
+        std::string name;
+        if (!components.empty()) {
+            name = std::move(components.back());
+            components.pop_back();
+        }
+        std::string parent = "/";
+        for (size_t j = 0; j < components.size(); ++j) {
+            if (j > 0) parent += "/";
+            parent += components[j];
+        }
+
+        auto [group, added] = groupOfParent.try_emplace(parent, groups.size());
+        if (added) {
+            groups.push_back({resolveDirectory(parent), {}});
+        }
+        groups[group->second].names.emplace_back(std::move(name), i);
+    }
+    return groups;
+}
+
+// Helper function to add the checked names of one group
+void DirectoryManager::insertGroup(const BatchGroup& group, const std::vector<uint32_t>& inodeIds) {
+    std::vector<DirectoryEntry> entries(group.names.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const auto& [name, position] = group.names[i];
+        entries[i] = {inodeIds[position], ""};
+        std::strncpy(entries[i].fileName, name.c_str(), sizeof(entries[i].fileName) - 1);
+    }
+
+    if (store) {
+        std::sort(entries.begin(), entries.end(), [](const DirectoryEntry& a, const DirectoryEntry& b) {
+            return DirectoryIndex::hashName(a.fileName) < DirectoryIndex::hashName(b.fileName);
+        });
+        Inode directoryInode = *inodeManager->acquireInode(group.directoryId);
+        size_t inserted = 0;
+        try {
+            for (; inserted < entries.size(); ++inserted) {
+                store->insert(directoryInode, entries[inserted]);
+            }
+        } catch (...) {
+            // Blocks the directory gained stay with it (leaves are never merged)
+            for (size_t i = 0; i < inserted; ++i) {
+                store->remove(directoryInode, entries[i].fileName);
+            }
+            inodeManager->updateInode(group.directoryId, directoryInode);
+            throw;
+        }
+        directoryInode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
+        inodeManager->updateInode(group.directoryId, directoryInode);
+    } else {
+        Directory& directory = findDirectory(group.directoryId);
+        directory.slots.reserve(directory.slots.size() + entries.size());
+        directory.index.reserve(directory.index.size() + entries.size());
+        for (const DirectoryEntry& entry : entries) {
+            insertEntry(group.directoryId, entry);
+        }
+    }
+
+    for (const DirectoryEntry& entry : entries) {
+        dentryCache.insert(group.directoryId, entry.fileName, entry.inodeId);
+    }
+}
+
+// Helper function to remove the checked names of one group
+void DirectoryManager::eraseGroup(const BatchGroup& group) {
+    if (store) {
+        std::vector<uint32_t> order(group.names.size());
+        std::vector<uint32_t> hashes(group.names.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = static_cast<uint32_t>(i);
+            hashes[i] = DirectoryIndex::hashName(group.names[i].first);
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return hashes[a] < hashes[b]; });
+
+        Inode directoryInode = *inodeManager->acquireInode(group.directoryId);
+        for (uint32_t i : order) {
+            store->remove(directoryInode, group.names[i].first);
+        }
+        directoryInode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
+        inodeManager->updateInode(group.directoryId, directoryInode);
+    } else {
+        for (const auto& [name, position] : group.names) {
+            eraseEntry(group.directoryId, name);
+        }
+    }
+
+    for (const auto& [name, position] : group.names) {
+        dentryCache.insertNegative(group.directoryId, name);
+    }
+}
+
+// Helper function to check whether an inode is a directory
+bool DirectoryManager::isDirectory(uint32_t inodeId) const {
+    if (store) {
+        return inodeId < inodeManager->getTotalInodes() && inodeManager->isAllocated(inodeId) &&
+               inodeManager->getInode(inodeId).fileType == 2; // A copy: a file's inode may be changing
+    }
+    return directoryTable.find(inodeId) != directoryTable.end();
+}
+
+// Helper function to find a directory or throw
+DirectoryManager::Directory& DirectoryManager::findDirectory(uint32_t directoryId) {
+    auto it = directoryTable.find(directoryId);
+    if (it == directoryTable.end()) {
+        throw std::runtime_error("Directory does not exist: inode " + std::to_string(directoryId));
+    }
+    return it->second;
+}
+
+const DirectoryManager::Directory& DirectoryManager::findDirectory(uint32_t directoryId) const {
+    auto it = directoryTable.find(directoryId);
+    if (it == directoryTable.end()) {
+        throw std::runtime_error("Directory does not exist: inode " + std::to_string(directoryId));
+    }
+    return it->second;
+}
+
+// Helper function to find the slot holding a name (DirectoryIndex::NOT_FOUND if absent)
+uint32_t DirectoryManager::findSlot(const Directory& directory, uint32_t hash, const char* fileName) {
+    return directory.index.find(hash, [&](uint32_t slot) {
+        return std::strcmp(directory.slots[slot].fileName, fileName) == 0;
+    });
+}
 
 // Helper function to validate directory and file names
 void DirectoryManager::validateName(const std::string& name) const {
@@ -98,14 +571,23 @@ void DirectoryManager::validateName(const std::string& name) const {
     }
 }
 
-void DirectoryManager::loadRootDirectory(uint8_t rootInodeId, const Inode& rootInode) {
+void DirectoryManager::loadRootDirectory(uint32_t rootInodeId, const Inode& rootInode) {
     if (rootInode.fileType != 2) { // Check if inode type is directory
         throw std::runtime_error("Root inode is not a directory.");
     }
 
-    // Initialize the root directory as an empty directory
-    directoryTable["/"] = {}; // Root directory exists in memory
-    std::cout << "Root directory loaded successfully.\n";
-    std::cout << "Loaded root directory with inode ID: " << int(rootInodeId) << "\n";
+    this->rootInodeId = rootInodeId;
+    dentryCache.clear();
+
+    if (store) {
+        // Entries stay on disk; only the root inode is needed to reach them
+        LLFS_LOG_INFO("DirectoryManager", "Root directory loaded: inode=", rootInodeId, " format=",
+                      (rootInode.flags & INODE_FLAG_HTREE) ? "htree" : "linear", " bytes=", rootInode.fileSize);
+        return;
+    }
 
+    // Without a disk there is nothing to load: start with an empty tree
+    directoryTable.clear();
+    directoryTable[rootInodeId] = {}; // Root directory exists in memory
+    LLFS_LOG_INFO("DirectoryManager", "Root directory loaded: inode=", rootInodeId, " format=memory");
 }
@@ -1,25 +1,38 @@
 #ifndef DIRECTORYMANAGER_H
 #define DIRECTORYMANAGER_H
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <stdexcept>
 
 #include "InodeManager.h"
+#include "DentryCache.h"
+#include "DirectoryIndex.h"
+#include "DirectoryStore.h"
 
 struct DirectoryEntry {
-    uint8_t inodeId;          // Inode ID associated with the file/directory
+    uint32_t inodeId;         // Inode ID associated with the file/directory
     char fileName[31];        // File or directory name (max 30 chars + null terminator)
 };
 
 class DirectoryManager {
 public:
-    // Constructor
+    // Inode of a path that does not exist, in the results of lookupEntries
+    static constexpr uint32_t NO_ENTRY = UINT32_MAX;
+
+    // Constructor for directories kept only in memory
     DirectoryManager();
 
+    // Constructor for directories stored in the data blocks of directory inodes
+    DirectoryManager(DiskManager& diskManager, FreeBlockManager& freeBlockManager, InodeManager& inodeManager);
+
+    // Destructor
+    ~DirectoryManager();
+
     // Create the root directory
-    void createRootDirectory(uint8_t rootInodeId);
+    void createRootDirectory(uint32_t rootInodeId);
 
     // Add an entry to a directory
     void addEntry(const std::string& path, const DirectoryEntry& entry);
@@ -30,13 +43,111 @@ public:
     // Remove an entry from a directory
     void removeEntry(const std::string& path, const std::string& fileName);
 
-    // Get all entries in a directory
+    // Link inodeIds[i] at paths[i]. Paths are grouped by parent directory, which is resolved once
+    // and, on disk, loaded and saved once; every name is checked before any is added, and
+    // nothing is added if one fails
+    void addEntries(const std::vector<std::string>& paths, const std::vector<uint32_t>& inodeIds);
+
+    // Unlink many paths, grouped by parent directory; all must exist, and nothing is removed if
+    // one does not
+    void removeEntries(const std::vector<std::string>& paths);
+
+    // Map many paths to inodes, resolving each parent directory once; NO_ENTRY where the final
+    // component does not exist (a missing parent directory throws)
+    std::vector<uint32_t> lookupEntries(const std::vector<std::string>& paths) const;
+
+    // Get all entries in a directory (copies the whole directory; prefer readDirectory)
     std::vector<DirectoryEntry> listEntries(const std::string& path) const;
-    void loadRootDirectory(uint8_t rootInodeId, const Inode &rootInode);
 
+    // Append up to maxEntries entries of a directory, starting at a cookie (0 = beginning).
+    // Returns the cookie for the next batch, or READDIR_END. Cookies stay valid while entries
+    // are added or removed; an entry added behind the cursor may not be returned.
+    uint64_t readDirectory(const std::string& path, uint64_t cookie, size_t maxEntries,
+                           std::vector<DirectoryEntry>& batch) const;
+    void loadRootDirectory(uint32_t rootInodeId, const Inode &rootInode);
+
+
+    // Get the number of entries in a directory
+    size_t getEntryCount(const std::string& path) const;
+
+    // Map a path ("/a/b/c", "." and ".." allowed) to the inode it names
+    uint32_t resolvePath(const std::string& path) const;
+
+    // Map a path to an inode using only names in the dentry cache; false if a component is not
+    // cached as existing, leaving it to resolvePath
+    bool resolveCached(const std::string& path, uint32_t& inodeId) const;
+
+    // Map a path to the inode of the directory it names
+    uint32_t resolveDirectory(const std::string& path) const;
+
+    // Link a new directory inode at a path
+    void createDirectory(const std::string& path, uint32_t inodeId);
+
+    // Unlink an empty directory and free its blocks; returns its inode for the caller to free
+    uint32_t removeDirectory(const std::string& path);
+
+    // Split a path into its parent directory and final component
+    static void splitPath(const std::string& path, std::string& parent, std::string& name);
+
+    // Get the on-disk directory store (null when directories are kept in memory)
+    const DirectoryStore* getStore() const;
+
+    // Get the dentry cache (for statistics)
+    const DentryCache& getDentryCache() const;
 
 private:
-    std::unordered_map<std::string, std::vector<DirectoryEntry>> directoryTable; // Maps directory paths to entries
+    // Entries of one directory; removed entries leave a free slot so other entries never move
+    struct Directory {
+        std::vector<DirectoryEntry> slots; // Entry storage (fileName[0] == '\0' marks a free slot)
+        std::vector<uint32_t> freeSlots;   // Free slots available for reuse
+        DirectoryIndex index;              // Name hash -> slot
+    };
+
+    // Names of a batch in one directory, with their positions in the batch ("" names the
+    // directory itself)
+    struct BatchGroup {
+        uint32_t directoryId;
+        std::vector<std::pair<std::string, size_t>> names;
+    };
+
+    std::unordered_map<uint32_t, Directory> directoryTable; // Maps directory inodes to entries (in memory)
+
+    InodeManager* inodeManager;             // Directory inodes (null when in memory)
+    std::unique_ptr<DirectoryStore> store;  // On-disk directory format (null when in memory)
+    uint32_t rootInodeId;                   // Inode of "/"
+    mutable DentryCache dentryCache;        // (parent inode, name) -> child inode
+
+    // Helper function to split a path into components, applying "." and ".."
+    static std::vector<std::string> splitComponents(const std::string& path);
+
+    // Helper function to walk path components from the root
+    uint32_t walk(const std::vector<std::string>& components, const std::string& path) const;
+
+    // Helper function to find a name in a directory, going through the dentry cache
+    bool lookupChild(uint32_t directoryId, const std::string& name, uint32_t& childId) const;
+
+    // Helper functions for entries of a directory inode (uncached)
+    bool findEntry(uint32_t directoryId, const std::string& name, DirectoryEntry& entry) const;
+    void insertEntry(uint32_t directoryId, const DirectoryEntry& entry);
+    bool eraseEntry(uint32_t directoryId, const std::string& name);
+
+    // Helper function to group the paths of a batch by parent directory, resolving each once
+    std::vector<BatchGroup> groupByDirectory(const std::vector<std::string>& paths) const;
+
+    // Helper functions to add or remove the (checked) names of one group; the directory inode is
+    // loaded and saved once, and on disk the names go in hash order so neighbours share leaves
+    void insertGroup(const BatchGroup& group, const std::vector<uint32_t>& inodeIds);
+    void eraseGroup(const BatchGroup& group);
+
+    // Helper function to check whether an inode is a directory
+    bool isDirectory(uint32_t inodeId) const;
+
+    // Helper function to find a directory or throw
+    Directory& findDirectory(uint32_t directoryId);
+    const Directory& findDirectory(uint32_t directoryId) const;
+
+    // Helper function to find the slot holding a name (DirectoryIndex::NOT_FOUND if absent)
+    static uint32_t findSlot(const Directory& directory, uint32_t hash, const char* fileName);
 
     // Helper function to validate directory and file names
     void validateName(const std::string& name) const;
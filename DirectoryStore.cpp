@@ -0,0 +1,497 @@
+#include "DirectoryStore.h"
+#include "DirectoryManager.h"
+#include "DirectoryIndex.h"
+#include <algorithm>
+#include <cstring> // For memcpy, strcmp
+
+namespace {
+constexpr uint32_t LEAF_MAGIC = 0x544E4544;  // "DENT"
+constexpr uint32_t INDEX_MAGIC = 0x58444944; // "DIDX"
+
+// Header at the start of every directory block
+struct BlockHeader {
+    uint32_t magic;
+    uint16_t count;     // Entries in the block
+    uint16_t level;     // Index blocks: height above the leaves; leaves: 0
+};
+
+// Directories stay linear up to this many blocks before they become a tree
+constexpr size_t LINEAR_MAX_BLOCKS = 1;
+}
+
+// Constructor
+DirectoryStore::DirectoryStore(DiskManager& diskManager, FreeBlockManager& freeBlockManager)
+    : diskManager(diskManager), blockMap(diskManager, freeBlockManager),
+      blockSize(diskManager.getBlockSize()),
+      leafCapacity((diskManager.getBlockSize() - sizeof(BlockHeader)) / sizeof(DiskEntry)),
+      indexCapacity((diskManager.getBlockSize() - sizeof(BlockHeader)) / sizeof(IndexEntry)) {
+    if (leafCapacity < 2 || indexCapacity < 3) {
+        throw std::invalid_argument("Block size is too small for directory blocks.");
+    }
+}
+
+// Find an entry by name
+bool DirectoryStore::lookup(const Inode& directory, const std::string& fileName, DirectoryEntry& entry) {
+    if (directory.fileSize == 0) {
+        return false;
+    }
+    uint32_t hash = DirectoryIndex::hashName(fileName);
+
+    if (directory.flags & INODE_FLAG_HTREE) {
+        Leaf leaf = readLeaf(directory, findLeaf(directory, hash, nullptr));
+        int position = findInLeaf(leaf, hash, fileName.c_str());
+        if (position < 0) return false;
+        entry = toDirectoryEntry(leaf.entries[position]);
+        return true;
+    }
+
+    // Linear directory: scan every block
+    uint32_t blockCount = directory.fileSize / blockSize;
+    for (uint32_t i = 0; i < blockCount; ++i) {
+        Leaf leaf = readLeaf(directory, i);
+        int position = findInLeaf(leaf, hash, fileName.c_str());
+        if (position >= 0) {
+            entry = toDirectoryEntry(leaf.entries[position]);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Add an entry; the directory inode is updated and must be saved by the caller
+void DirectoryStore::insert(Inode& directory, const DirectoryEntry& entry) {
+    DiskEntry diskEntry = {};
+    diskEntry.inodeId = entry.inodeId;
+    diskEntry.hash = DirectoryIndex::hashName(entry.fileName);
+    std::memcpy(diskEntry.fileName, entry.fileName, sizeof(diskEntry.fileName));
+
+    if (!(directory.flags & INODE_FLAG_HTREE)) {
+        uint32_t blockCount = directory.fileSize / blockSize;
+        int freeBlock = -1;
+        for (uint32_t i = 0; i < blockCount; ++i) {
+            Leaf leaf = readLeaf(directory, i);
+            if (findInLeaf(leaf, diskEntry.hash, diskEntry.fileName) >= 0) {
+                throw std::runtime_error("File already exists: " + std::string(entry.fileName));
+            }
+            if (freeBlock < 0 && leaf.entries.size() < leafCapacity) {
+                freeBlock = static_cast<int>(i);
+            }
+        }
+
+        if (freeBlock >= 0) {
+            Leaf leaf = readLeaf(directory, freeBlock);
+            leaf.entries.push_back(diskEntry);
+            writeLeaf(directory, freeBlock, leaf);
+            return;
+        }
+        if (blockCount < LINEAR_MAX_BLOCKS) {
+            Leaf leaf;
+            leaf.entries.push_back(diskEntry);
+            writeLeaf(directory, appendBlock(directory), leaf);
+            return;
+        }
+
+        // The linear block is full: switch to the tree layout and insert below
+        convertToTree(directory);
+    }
+
+    std::vector<PathStep> path;
+    uint32_t leafBlock = findLeaf(directory, diskEntry.hash, &path);
+    Leaf leaf = readLeaf(directory, leafBlock);
+    if (findInLeaf(leaf, diskEntry.hash, diskEntry.fileName) >= 0) {
+        throw std::runtime_error("File already exists: " + std::string(entry.fileName));
+    }
+
+    if (leaf.entries.size() < leafCapacity) {
+        leaf.entries.push_back(diskEntry);
+        writeLeaf(directory, leafBlock, leaf);
+    } else {
+        splitLeaf(directory, path, leafBlock, leaf, diskEntry);
+    }
+}
+
+// Remove an entry by name; returns false if it does not exist
+bool DirectoryStore::remove(Inode& directory, const std::string& fileName) {
+    if (directory.fileSize == 0) {
+        return false;
+    }
+    uint32_t hash = DirectoryIndex::hashName(fileName);
+
+    // Leaves are never merged; an emptied leaf stays in the tree for later inserts
+    auto removeFromLeaf = [&](uint32_t logicalBlock) {
+        Leaf leaf = readLeaf(directory, logicalBlock);
+        int position = findInLeaf(leaf, hash, fileName.c_str());
+        if (position < 0) return false;
+        leaf.entries[position] = leaf.entries.back();
+        leaf.entries.pop_back();
+        writeLeaf(directory, logicalBlock, leaf);
+        return true;
+    };
+
+    if (directory.flags & INODE_FLAG_HTREE) {
+        return removeFromLeaf(findLeaf(directory, hash, nullptr));
+    }
+
+    uint32_t blockCount = directory.fileSize / blockSize;
+    for (uint32_t i = 0; i < blockCount; ++i) {
+        if (removeFromLeaf(i)) return true;
+    }
+    return false;
+}
+
+// Visit every entry in hash order
+void DirectoryStore::forEach(const Inode& directory, const std::function<void(const DirectoryEntry&)>& visit) {
+    if (directory.fileSize == 0) {
+        return;
+    }
+
+    if (directory.flags & INODE_FLAG_HTREE) {
+        Index root = readIndex(directory, 0);
+        forEachBelow(directory, 0, root.level, visit);
+        return;
+    }
+
+    uint32_t blockCount = directory.fileSize / blockSize;
+    for (uint32_t i = 0; i < blockCount; ++i) {
+        Leaf leaf = readLeaf(directory, i);
+        std::sort(leaf.entries.begin(), leaf.entries.end(),
+                  [](const DiskEntry& a, const DiskEntry& b) { return a.hash < b.hash; });
+        for (const auto& diskEntry : leaf.entries) {
+            visit(toDirectoryEntry(diskEntry));
+        }
+    }
+}
+
+// Append up to maxEntries entries in hash order, starting at a cookie (0 = beginning)
+uint64_t DirectoryStore::readdir(const Inode& directory, uint64_t cookie, size_t maxEntries,
+                                 std::vector<DirectoryEntry>& batch) {
+    if (cookie == READDIR_END || directory.fileSize == 0) {
+        return READDIR_END;
+    }
+
+    // The cookie is (hash, number of entries with that hash already returned); entries with
+    // equal hashes are ordered by name
+    uint32_t hash = static_cast<uint32_t>(cookie >> 32);
+    uint32_t skip = static_cast<uint32_t>(cookie);
+    size_t returned = 0;
+
+    while (true) {
+        std::vector<PathStep> path;
+        bool tree = directory.flags & INODE_FLAG_HTREE;
+        Leaf leaf = readLeaf(directory, tree ? findLeaf(directory, hash, &path) : 0);
+        std::sort(leaf.entries.begin(), leaf.entries.end(), [](const DiskEntry& a, const DiskEntry& b) {
+            return a.hash != b.hash ? a.hash < b.hash : std::strcmp(a.fileName, b.fileName) < 0;
+        });
+
+        uint32_t seen = 0; // Entries with the cookie's hash passed so far
+        for (const auto& diskEntry : leaf.entries) {
+            if (diskEntry.hash < hash || (diskEntry.hash == hash && seen++ < skip)) {
+                continue;
+            }
+            if (returned == maxEntries) {
+                return (static_cast<uint64_t>(hash) << 32) | skip;
+            }
+
+            batch.push_back(toDirectoryEntry(diskEntry));
+            ++returned;
+            if (diskEntry.hash == hash) {
+                ++skip;
+            } else {
+                hash = diskEntry.hash;
+                skip = 1;
+                seen = 1;
+            }
+        }
+
+        // Continue with the next leaf, which only holds larger hashes
+        if (!tree || !nextLeafHash(path, hash)) {
+            return READDIR_END;
+        }
+        skip = 0;
+    }
+}
+
+// Check whether the directory has no entries (leaves are never merged, so this reads them)
+bool DirectoryStore::isEmpty(const Inode& directory) {
+    if (directory.fileSize == 0) {
+        return true;
+    }
+
+    if (directory.flags & INODE_FLAG_HTREE) {
+        Index root = readIndex(directory, 0);
+        return !hasEntriesBelow(directory, 0, root.level);
+    }
+
+    uint32_t blockCount = directory.fileSize / blockSize;
+    for (uint32_t i = 0; i < blockCount; ++i) {
+        if (!readLeaf(directory, i).entries.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Free all blocks of the directory
+void DirectoryStore::release(Inode& directory) {
+    blockMap.release(directory);
+    directory.fileSize = 0;
+    directory.flags &= ~INODE_FLAG_HTREE;
+}
+
+// Number of directory blocks read so far (for statistics)
+size_t DirectoryStore::getBlocksRead() const {
+    return blocksRead;
+}
+
+// Read a logical directory block
+std::vector<char> DirectoryStore::readDirectoryBlock(const Inode& directory, uint32_t logicalBlock) {
+    uint32_t physicalBlock = blockMap.lookup(directory, logicalBlock);
+    if (physicalBlock == 0) {
+        throw std::runtime_error("Directory block is not mapped.");
+    }
+    ++blocksRead;
+    return diskManager.readBlock(physicalBlock);
+}
+
+// Write a logical directory block
+void DirectoryStore::writeDirectoryBlock(const Inode& directory, uint32_t logicalBlock,
+                                         const std::vector<char>& data) {
+    uint32_t physicalBlock = blockMap.lookup(directory, logicalBlock);
+    if (physicalBlock == 0) {
+        throw std::runtime_error("Directory block is not mapped.");
+    }
+    diskManager.writeMetadataBlock(physicalBlock, data);
+}
+
+// Allocate the next logical block of the directory
+uint32_t DirectoryStore::appendBlock(Inode& directory) {
+    uint32_t logicalBlock = directory.fileSize / blockSize;
+    blockMap.map(directory, logicalBlock);
+    directory.fileSize += blockSize;
+    return logicalBlock;
+}
+
+DirectoryStore::Leaf DirectoryStore::readLeaf(const Inode& directory, uint32_t logicalBlock) {
+    std::vector<char> block = readDirectoryBlock(directory, logicalBlock);
+    BlockHeader header;
+    std::memcpy(&header, block.data(), sizeof(header));
+    if (header.magic != LEAF_MAGIC || header.count > leafCapacity) {
+        throw std::runtime_error("Corrupted directory leaf block.");
+    }
+
+    Leaf leaf;
+    leaf.entries.resize(header.count);
+    if (header.count != 0) { // An empty vector may have no storage to copy into
+        std::memcpy(leaf.entries.data(), block.data() + sizeof(header), header.count * sizeof(DiskEntry));
+    }
+    return leaf;
+}
+
+void DirectoryStore::writeLeaf(const Inode& directory, uint32_t logicalBlock, const Leaf& leaf) {
+    std::vector<char> block(blockSize, 0);
+    BlockHeader header = {LEAF_MAGIC, static_cast<uint16_t>(leaf.entries.size()), 0};
+    std::memcpy(block.data(), &header, sizeof(header));
+    if (!leaf.entries.empty()) {
+        std::memcpy(block.data() + sizeof(header), leaf.entries.data(), leaf.entries.size() * sizeof(DiskEntry));
+    }
+    writeDirectoryBlock(directory, logicalBlock, block);
+}
+
+DirectoryStore::Index DirectoryStore::readIndex(const Inode& directory, uint32_t logicalBlock) {
+    std::vector<char> block = readDirectoryBlock(directory, logicalBlock);
+    BlockHeader header;
+    std::memcpy(&header, block.data(), sizeof(header));
+    if (header.magic != INDEX_MAGIC || header.count == 0 || header.count > indexCapacity || header.level == 0) {
+        throw std::runtime_error("Corrupted directory index block.");
+    }
+
+    Index index;
+    index.level = header.level;
+    index.entries.resize(header.count);
+    std::memcpy(index.entries.data(), block.data() + sizeof(header), header.count * sizeof(IndexEntry));
+    return index;
+}
+
+void DirectoryStore::writeIndex(const Inode& directory, uint32_t logicalBlock, const Index& index) {
+    std::vector<char> block(blockSize, 0);
+    BlockHeader header = {INDEX_MAGIC, static_cast<uint16_t>(index.entries.size()), index.level};
+    std::memcpy(block.data(), &header, sizeof(header));
+    std::memcpy(block.data() + sizeof(header), index.entries.data(), index.entries.size() * sizeof(IndexEntry));
+    writeDirectoryBlock(directory, logicalBlock, block);
+}
+
+// Descend from the root index to the leaf covering a hash
+uint32_t DirectoryStore::findLeaf(const Inode& directory, uint32_t hash, std::vector<PathStep>* path) {
+    uint32_t logicalBlock = 0;
+    while (true) {
+        Index node = readIndex(directory, logicalBlock);
+
+        // Last child whose lowest hash is <= hash (entries are sorted by hash)
+        auto it = std::upper_bound(node.entries.begin(), node.entries.end(), hash,
+                                   [](uint32_t h, const IndexEntry& e) { return h < e.hash; });
+        size_t childIndex = (it == node.entries.begin()) ? 0 : (it - node.entries.begin()) - 1;
+        uint32_t child = node.entries[childIndex].block;
+        uint16_t level = node.level;
+
+        if (path) {
+            path->push_back({logicalBlock, std::move(node), childIndex});
+        }
+        if (level == 1) {
+            return child;
+        }
+        logicalBlock = child;
+    }
+}
+
+// Turn a full single-block directory into a one-leaf tree
+void DirectoryStore::convertToTree(Inode& directory) {
+    // Move the entries of block 0 into a new leaf and put the root index in block 0
+    Leaf leaf = readLeaf(directory, 0);
+    uint32_t leafBlock = appendBlock(directory);
+    writeLeaf(directory, leafBlock, leaf);
+
+    Index root;
+    root.level = 1;
+    root.entries.push_back({0, leafBlock});
+    writeIndex(directory, 0, root);
+
+    directory.flags |= INODE_FLAG_HTREE;
+}
+
+// Split a full leaf and link the new half into its parent
+void DirectoryStore::splitLeaf(Inode& directory, std::vector<PathStep>& path, uint32_t leafBlock,
+                               Leaf& leaf, const DiskEntry& entry) {
+    std::vector<DiskEntry> entries = std::move(leaf.entries);
+    entries.push_back(entry);
+    std::sort(entries.begin(), entries.end(),
+              [](const DiskEntry& a, const DiskEntry& b) { return a.hash < b.hash; });
+
+    // Split near the middle, but never between two entries with the same hash so
+    // that every name is found in the one leaf covering its hash
+    size_t middle = entries.size() / 2;
+    size_t split = 0;
+    for (size_t distance = 0; distance <= entries.size(); ++distance) {
+        if (middle + distance < entries.size() && middle + distance > 0 &&
+            entries[middle + distance].hash != entries[middle + distance - 1].hash) {
+            split = middle + distance;
+            break;
+        }
+        if (middle >= distance && middle - distance > 0 &&
+            entries[middle - distance].hash != entries[middle - distance - 1].hash) {
+            split = middle - distance;
+            break;
+        }
+    }
+    if (split == 0) {
+        throw std::runtime_error("Directory leaf is full of colliding name hashes.");
+    }
+
+    Leaf lower, upper;
+    lower.entries.assign(entries.begin(), entries.begin() + split);
+    upper.entries.assign(entries.begin() + split, entries.end());
+
+    uint32_t newBlock = appendBlock(directory);
+    writeLeaf(directory, newBlock, upper);
+    writeLeaf(directory, leafBlock, lower);
+
+    insertIndexEntry(directory, path, path.size() - 1, {upper.entries.front().hash, newBlock});
+}
+
+// Insert a child pointer into the index node at the given depth, splitting upwards as needed
+void DirectoryStore::insertIndexEntry(Inode& directory, std::vector<PathStep>& path, size_t depth,
+                                      IndexEntry entry) {
+    PathStep& step = path[depth];
+    Index& node = step.node;
+    node.entries.insert(node.entries.begin() + step.childIndex + 1, entry);
+
+    if (node.entries.size() <= indexCapacity) {
+        writeIndex(directory, step.block, node);
+        return;
+    }
+
+    size_t split = node.entries.size() / 2;
+    Index upper;
+    upper.level = node.level;
+    upper.entries.assign(node.entries.begin() + split, node.entries.end());
+    node.entries.resize(split);
+
+    if (depth == 0) {
+        // The root stays in block 0: move both halves out and grow the tree by one level
+        uint32_t lowerBlock = appendBlock(directory);
+        uint32_t upperBlock = appendBlock(directory);
+        writeIndex(directory, lowerBlock, node);
+        writeIndex(directory, upperBlock, upper);
+
+        Index root;
+        root.level = node.level + 1;
+        root.entries.push_back({0, lowerBlock});
+        root.entries.push_back({upper.entries.front().hash, upperBlock});
+        writeIndex(directory, 0, root);
+        return;
+    }
+
+    uint32_t upperBlock = appendBlock(directory);
+    writeIndex(directory, upperBlock, upper);
+    writeIndex(directory, step.block, node);
+    insertIndexEntry(directory, path, depth - 1, {upper.entries.front().hash, upperBlock});
+}
+
+// Visit the entries below an index node in hash order
+void DirectoryStore::forEachBelow(const Inode& directory, uint32_t logicalBlock, uint16_t level,
+                                  const std::function<void(const DirectoryEntry&)>& visit) {
+    Index node = readIndex(directory, logicalBlock);
+    for (const auto& child : node.entries) {
+        if (level > 1) {
+            forEachBelow(directory, child.block, level - 1, visit);
+            continue;
+        }
+        Leaf leaf = readLeaf(directory, child.block);
+        std::sort(leaf.entries.begin(), leaf.entries.end(),
+                  [](const DiskEntry& a, const DiskEntry& b) { return a.hash < b.hash; });
+        for (const auto& diskEntry : leaf.entries) {
+            visit(toDirectoryEntry(diskEntry));
+        }
+    }
+}
+
+// Lowest hash of the leaf after the one at the end of a path (false if it was the last leaf)
+bool DirectoryStore::nextLeafHash(const std::vector<PathStep>& path, uint32_t& hash) {
+    for (auto step = path.rbegin(); step != path.rend(); ++step) {
+        if (step->childIndex + 1 < step->node.entries.size()) {
+            hash = step->node.entries[step->childIndex + 1].hash;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Check whether any leaf below an index node holds an entry
+bool DirectoryStore::hasEntriesBelow(const Inode& directory, uint32_t logicalBlock, uint16_t level) {
+    Index node = readIndex(directory, logicalBlock);
+    for (const auto& child : node.entries) {
+        if (level > 1) {
+            if (hasEntriesBelow(directory, child.block, level - 1)) {
+                return true;
+            }
+        } else if (!readLeaf(directory, child.block).entries.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int DirectoryStore::findInLeaf(const Leaf& leaf, uint32_t hash, const char* fileName) {
+    for (size_t i = 0; i < leaf.entries.size(); ++i) {
+        if (leaf.entries[i].hash == hash && std::strcmp(leaf.entries[i].fileName, fileName) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+DirectoryEntry DirectoryStore::toDirectoryEntry(const DiskEntry& diskEntry) {
+    DirectoryEntry entry = {};
+    entry.inodeId = diskEntry.inodeId;
+    std::memcpy(entry.fileName, diskEntry.fileName, sizeof(entry.fileName));
+    return entry;
+}
@@ -0,0 +1,129 @@
+#ifndef DIRECTORYSTORE_H
+#define DIRECTORYSTORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "BlockMap.h"
+
+struct DirectoryEntry;
+
+// Cookie returned by readdir once a directory has been read to the end
+constexpr uint64_t READDIR_END = UINT64_MAX;
+
+// On-disk directory format. A small directory is a single linear block of entries.
+// Once that block overflows the directory becomes a hashed B+tree (like ext4 htree):
+// logical block 0 is the root index, index blocks map name-hash ranges to child
+// blocks, and leaf blocks hold the entries. Lookups read one block per tree level.
+class DirectoryStore {
+public:
+    // Constructor
+    DirectoryStore(DiskManager& diskManager, FreeBlockManager& freeBlockManager);
+
+    // Find an entry by name
+    bool lookup(const Inode& directory, const std::string& fileName, DirectoryEntry& entry);
+
+    // Add an entry; the directory inode is updated and must be saved by the caller
+    void insert(Inode& directory, const DirectoryEntry& entry);
+
+    // Remove an entry by name; returns false if it does not exist
+    bool remove(Inode& directory, const std::string& fileName);
+
+    // Visit every entry in hash order
+    void forEach(const Inode& directory, const std::function<void(const DirectoryEntry&)>& visit);
+
+    // Append up to maxEntries entries in hash order, starting at a cookie (0 = beginning).
+    // Returns the cookie to continue from, or READDIR_END. A cookie names a position in hash
+    // order rather than a block, so it stays valid while entries are added and leaves split.
+    uint64_t readdir(const Inode& directory, uint64_t cookie, size_t maxEntries,
+                     std::vector<DirectoryEntry>& batch);
+
+    // Check whether the directory has no entries (leaves are never merged, so this reads them)
+    bool isEmpty(const Inode& directory);
+
+    // Free all blocks of the directory
+    void release(Inode& directory);
+
+    // Number of directory blocks read so far (for statistics)
+    size_t getBlocksRead() const;
+
+private:
+    // Entry as stored in a leaf block
+    struct DiskEntry {
+        uint32_t inodeId;
+        uint32_t hash;          // DirectoryIndex::hashName of fileName
+        char fileName[31];
+        uint8_t reserved;
+    };
+
+    struct IndexEntry {
+        uint32_t hash;          // Lowest name hash covered by the child
+        uint32_t block;         // Logical block of the child
+    };
+
+    struct Leaf {
+        std::vector<DiskEntry> entries;
+    };
+
+    struct Index {
+        uint16_t level;         // Height above the leaves (1 = children are leaves)
+        std::vector<IndexEntry> entries;
+    };
+
+    // Position in an index node visited on the way down to a leaf
+    struct PathStep {
+        uint32_t block;
+        Index node;
+        size_t childIndex;
+    };
+
+    DiskManager& diskManager;
+    BlockMap blockMap;
+    size_t blockSize;
+    size_t leafCapacity;        // Entries per leaf block
+    size_t indexCapacity;       // Child pointers per index block
+    std::atomic<size_t> blocksRead{0};
+
+    // Block I/O on logical directory blocks
+    std::vector<char> readDirectoryBlock(const Inode& directory, uint32_t logicalBlock);
+    void writeDirectoryBlock(const Inode& directory, uint32_t logicalBlock, const std::vector<char>& data);
+    uint32_t appendBlock(Inode& directory);
+
+    // Block encoding
+    Leaf readLeaf(const Inode& directory, uint32_t logicalBlock);
+    void writeLeaf(const Inode& directory, uint32_t logicalBlock, const Leaf& leaf);
+    Index readIndex(const Inode& directory, uint32_t logicalBlock);
+    void writeIndex(const Inode& directory, uint32_t logicalBlock, const Index& index);
+
+    // Descend from the root index to the leaf covering a hash
+    uint32_t findLeaf(const Inode& directory, uint32_t hash, std::vector<PathStep>* path);
+
+    // Turn a full single-block directory into a one-leaf tree
+    void convertToTree(Inode& directory);
+
+    // Split a full leaf and link the new half into its parent
+    void splitLeaf(Inode& directory, std::vector<PathStep>& path, uint32_t leafBlock,
+                   Leaf& leaf, const DiskEntry& entry);
+
+    // Insert a child pointer into the index node at the given depth, splitting upwards as needed
+    void insertIndexEntry(Inode& directory, std::vector<PathStep>& path, size_t depth, IndexEntry entry);
+
+    // Visit the entries below an index node in hash order
+    void forEachBelow(const Inode& directory, uint32_t logicalBlock, uint16_t level,
+                      const std::function<void(const DirectoryEntry&)>& visit);
+
+    // Lowest hash of the leaf after the one at the end of a path (false if it was the last leaf)
+    static bool nextLeafHash(const std::vector<PathStep>& path, uint32_t& hash);
+
+    // Check whether any leaf below an index node holds an entry
+    bool hasEntriesBelow(const Inode& directory, uint32_t logicalBlock, uint16_t level);
+
+    static int findInLeaf(const Leaf& leaf, uint32_t hash, const char* fileName);
+    static DirectoryEntry toDirectoryEntry(const DiskEntry& diskEntry);
+};
+
+#endif // DIRECTORYSTORE_H
@@ -1,53 +1,75 @@
 #include "DiskManager.h"
 #include "DirectoryManager.h"
 #include "InodeManager.h"
-#include <iostream>
+#include "Journal.h"
+#include "SegmentManager.h"
+#include "SnapshotManager.h"
+#include "Crc32c.h"
+#include "Logger.h"
+#include <algorithm>
 #include <cstring> // For memset
-
-DiskManager::DiskManager(const std::string& diskFileName, size_t diskSize, size_t blockSize)
-    : diskFileName(diskFileName), diskSize(diskSize), blockSize(blockSize) {
+#include <ctime>
+#include <memory>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+DiskManager::DiskManager(const std::string& diskFileName, size_t diskSize, size_t blockSize, WriteMode writeMode,
+                         bool blockChecksums)
+    : diskFileName(diskFileName), diskSize(diskSize), blockSize(blockSize), writeMode(writeMode),
+      blockChecksums(blockChecksums) {
     if (blockSize == 0 || diskSize % blockSize != 0) {
         throw std::invalid_argument("Disk size must be a multiple of block size.");
     }
+    if (blockChecksums && writeMode == WriteMode::LogStructured) {
+        throw std::invalid_argument("Block checksums need in-place mode (segments carry their own).");
+    }
     totalBlocks = diskSize / blockSize;
+    if (blockChecksums) {
+        checksumLayout = computeLayout();
+        checksums.assign(totalBlocks, 0);
+        dirtyChecksumBlocks.assign(checksumLayout.checksumBlocks, false);
+    }
     openDiskFile();
 }
 
 DiskManager::~DiskManager() {
-    if (diskFile.is_open()) {
-        diskFile.close();
+    if (diskFile >= 0) {
+        ::close(diskFile);
     }
 }
 
 void DiskManager::openDiskFile() {
-    diskFile.open(diskFileName, std::ios::in | std::ios::out | std::ios::binary);
-
-    // If the file does not exist, create it
-    if (!diskFile.is_open()) {
-        diskFile.clear();
-        diskFile.open(diskFileName, std::ios::out | std::ios::binary);
-        diskFile.close();
-        diskFile.open(diskFileName, std::ios::in | std::ios::out | std::ios::binary);
+    // Create the file if it does not exist
+    diskFile = ::open(diskFileName.c_str(), O_RDWR | O_CREAT, 0644);
+    if (diskFile < 0) {
+        throw std::runtime_error("Cannot open disk file: " + diskFileName);
     }
 
     // Resize the file to the disk size if needed
-    diskFile.seekp(0, std::ios::end);
-    if (diskFile.tellp() < static_cast<std::streampos>(diskSize)) {
-        diskFile.seekp(0, std::ios::beg);
+    struct stat status;
+    if (::fstat(diskFile, &status) == 0 && status.st_size < static_cast<off_t>(diskSize)) {
         std::vector<char> zeroBlock(blockSize, 0);
         for (size_t i = 0; i < totalBlocks; ++i) {
-            diskFile.write(zeroBlock.data(), blockSize);
+            if (::pwrite(diskFile, zeroBlock.data(), blockSize, static_cast<off_t>(i * blockSize)) < 0) {
+                throw std::runtime_error("Cannot write disk file: " + diskFileName);
+            }
         }
     }
-    diskFile.seekp(0, std::ios::beg);
 }
 
 void DiskManager::formatDisk() {
-    // Constants for reserved blocks
     const size_t SUPERBLOCK_BLOCK = 0;
-    const size_t FREE_BLOCK_VECTOR_BLOCK = 1;
-    const size_t INODE_TABLE_START_BLOCK = 2;
-    const size_t INODE_TABLE_BLOCKS = 1; // Number of blocks reserved for the inode table
+    Superblock layout = computeLayout();
+
+    // Start a fresh checksum table; blocks not written below keep no checksum
+    if (blockChecksums) {
+        std::lock_guard<std::mutex> lock(checksumMutex);
+        for (uint32_t& checksum : checksums) {
+            std::atomic_ref<uint32_t>(checksum).store(0, std::memory_order_relaxed);
+        }
+        std::fill(dirtyChecksumBlocks.begin(), dirtyChecksumBlocks.end(), true);
+    }
 
     // Initialize the superblock
     std::vector<char> superblock(blockSize, 0);
@@ -55,102 +77,510 @@ void DiskManager::formatDisk() {
     // Write the magic number ("LLFS")
     std::memcpy(superblock.data(), "LLFS", 4);
 
-    // Write the total number of blocks (use fixed-size type for consistency)
-    uint32_t fixedTotalBlocks = static_cast<uint32_t>(totalBlocks);
-    std::memcpy(superblock.data() + 4, &fixedTotalBlocks, sizeof(fixedTotalBlocks));
-
-    // Write the number of inodes (use fixed-size type for consistency)
-    uint32_t numberOfInodes = fixedTotalBlocks / 8; // Example: 1/8th of total blocks for inodes
-    std::memcpy(superblock.data() + 8, &numberOfInodes, sizeof(numberOfInodes));
+    // Write the layout (use fixed-size types for consistency)
+    std::memcpy(superblock.data() + 4, &layout, sizeof(layout));
 
     // Write the superblock to block 0
     writeBlock(SUPERBLOCK_BLOCK, superblock);
 
+    // In LFS mode the metadata below is appended to the log, starting from an empty checkpoint
+    std::unique_ptr<SegmentManager> log;
+    if (writeMode == WriteMode::LogStructured) {
+        SegmentManager::formatRegion(*this, layout);
+        log = std::make_unique<SegmentManager>(*this, layout);
+        log->recover();
+        setSegmentManager(log.get());
+    }
+
     // Initialize the free block vector
-    std::vector<char> freeBlockVector(blockSize, 0xFF); // Mark all blocks as free initially
+    std::vector<char> freeBlockVector(layout.freeBlockVectorBlocks * blockSize, 0);
+
+    // Mark data blocks as free; reserved blocks (superblock, free block vector, inode table) stay allocated
+    for (size_t i = layout.dataStart; i < layout.volumeBlocks; ++i) {
+        freeBlockVector[i / 8] |= (1 << (i % 8)); // Same bit order as FreeBlockManager
+    }
+
+    // Write the free block vector
+    for (size_t i = 0; i < layout.freeBlockVectorBlocks; ++i) {
+        std::vector<char> block(freeBlockVector.begin() + i * blockSize,
+                                freeBlockVector.begin() + (i + 1) * blockSize);
+        writeBlock(layout.freeBlockVectorStart + i, block);
+    }
 
-    // Mark reserved blocks (superblock, free block vector, inode table) as allocated
-    for (size_t i = 0; i < INODE_TABLE_START_BLOCK + INODE_TABLE_BLOCKS; ++i) {
-        size_t byteIndex = i / 8;           // Byte in the free block vector
-        size_t bitIndex = i % 8;            // Bit in the byte
-        freeBlockVector[byteIndex] &= ~(1 << (7 - bitIndex)); // Set the bit to 0 (allocated)
+    // Clear the inode table so stale inodes from a previous format are not picked up
+    // (blocks never written to the log read as zeros already)
+    std::vector<char> inodeTableBlock(blockSize, 0);
+    for (size_t i = 1; i < layout.inodeTableBlocks && !log; ++i) {
+        writeBlock(layout.inodeTableStart + i, inodeTableBlock);
     }
 
-    // Write the free block vector to block 1
-    writeBlock(FREE_BLOCK_VECTOR_BLOCK, freeBlockVector);
+    // Start with an empty journal and no snapshots
+    if (!log) {
+        Journal::formatRegion(*this, layout);
+        SnapshotManager::formatRegion(*this, layout);
+    }
 
     // Initialize the root directory inode (inode 0)
     Inode rootInode = {};
     rootInode.fileType = 2; // Directory type
     rootInode.fileSize = 0; // Initially empty
     std::memset(rootInode.directBlocks, 0, sizeof(rootInode.directBlocks));
+    rootInode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
 
     // Write the root inode to the inode table
-    std::vector<char> inodeTableBlock(blockSize, 0);
     std::memcpy(inodeTableBlock.data(), &rootInode, sizeof(Inode));
-    writeBlock(INODE_TABLE_START_BLOCK, inodeTableBlock);
+    writeBlock(layout.inodeTableStart, inodeTableBlock);
 
-    // Debug output to verify
-    std::cout << "Superblock written with:\n";
-    std::cout << "  Magic number: LLFS\n";
-    std::cout << "  Total blocks: " << fixedTotalBlocks << "\n";
-    std::cout << "  Number of inodes: " << numberOfInodes << "\n";
-    std::cout << "Free block vector initialized.\n";
-    std::cout << "Root directory initialized with inode 0.\n";
+    if (log) {
+        log->checkpoint();
+        setSegmentManager(nullptr);
+    }
+
+    if (log) {
+        LLFS_LOG_INFO("DiskManager", "Disk formatted (LFS): magic=LLFS totalBlocks=", layout.totalBlocks,
+                      " volumeBlocks=", layout.volumeBlocks, " inodes=", layout.numberOfInodes,
+                      " checkpoint=", layout.checkpointStart, "-", layout.checkpointStart + layout.checkpointBlocks - 1,
+                      " segments=", layout.segmentCount, "x", layout.segmentBlocks, " rootInode=0");
+        return;
+    }
+    flushChecksums();
+    LLFS_LOG_INFO("DiskManager", "Disk formatted: magic=LLFS totalBlocks=", layout.totalBlocks,
+                  " inodes=", layout.numberOfInodes, " inodeTable=", layout.inodeTableStart, "-",
+                  layout.inodeTableStart + layout.inodeTableBlocks - 1, " journal=", layout.journalStart, "-",
+                  layout.journalStart + layout.journalBlocks - 1, " checksumBlocks=", layout.checksumBlocks,
+                  " dataStart=", layout.dataStart, " rootInode=0");
 }
 
+// Compute the on-disk layout for this disk
+Superblock DiskManager::computeLayout() const {
+    Superblock layout = {};
+    layout.totalBlocks = static_cast<uint32_t>(totalBlocks);
+    layout.writeMode = static_cast<uint32_t>(writeMode);
+    layout.volumeBlocks = layout.totalBlocks;
+
+    if (writeMode == WriteMode::LogStructured) {
+        // Segments of up to 1 MB, at least 32 of them so the log has room to move
+        layout.segmentBlocks = static_cast<uint32_t>(std::clamp<size_t>(totalBlocks / 32, 16,
+                                                                         std::max<size_t>(16, (1 << 20) / blockSize)));
+        layout.checkpointStart = 1;
+        // Two alternating checkpoint slots, sized for the most segments the disk could hold
+        layout.checkpointBlocks = static_cast<uint32_t>(
+            2 * SegmentManager::checkpointRegionBlocks(totalBlocks, totalBlocks / layout.segmentBlocks, blockSize));
+        layout.segmentStart = layout.checkpointStart + layout.checkpointBlocks;
+        layout.segmentCount = static_cast<uint32_t>((totalBlocks - std::min<size_t>(totalBlocks, layout.segmentStart)) /
+                                                    layout.segmentBlocks);
+        if (layout.segmentCount < 4) {
+            throw std::invalid_argument("Disk is too small for log-structured mode.");
+        }
 
+        // Block numbers are translated to log positions. Only 3/4 of the log can be live so
+        // there are always segments to fill; the address map goes into the log too.
+        size_t slots = SegmentManager::slotsPerSegment(layout.segmentBlocks, blockSize);
+        size_t mapBlocks = (totalBlocks * sizeof(uint32_t) + blockSize - 1) / blockSize;
+        layout.volumeBlocks = static_cast<uint32_t>(layout.segmentCount * slots * 3 / 4 - mapBlocks);
+    }
+    // Block pointers are 16 bits: a larger disk leaves the blocks no inode could address unused
+    layout.volumeBlocks = std::min<uint32_t>(layout.volumeBlocks, MAX_VOLUME_BLOCKS);
+    layout.numberOfInodes = layout.volumeBlocks / 8; // Example: 1/8th of total blocks for inodes
+
+    // Free block vector: one bit per block, starting at block 1
+    layout.freeBlockVectorStart = 1;
+    layout.freeBlockVectorBlocks = static_cast<uint32_t>((layout.volumeBlocks + blockSize * 8 - 1) / (blockSize * 8));
+
+    // Snapshot table: one block, in-place mode only
+    layout.inodeTableStart = layout.freeBlockVectorStart + layout.freeBlockVectorBlocks;
+    if (writeMode == WriteMode::InPlace) {
+        layout.snapshotTableStart = layout.inodeTableStart;
+        layout.snapshotTableBlocks = 1;
+        layout.inodeTableStart += layout.snapshotTableBlocks;
+    }
+
+    // Inode table: inodes never straddle a block boundary
+    size_t inodesPerBlock = blockSize / sizeof(Inode);
+    layout.inodeTableBlocks = static_cast<uint32_t>((layout.numberOfInodes + inodesPerBlock - 1) / inodesPerBlock);
 
+    // Journal: a header block plus a circular log, 1/16th of the volume (LFS mode needs none)
+    layout.journalStart = layout.inodeTableStart + layout.inodeTableBlocks;
+    layout.journalBlocks = writeMode == WriteMode::InPlace ? std::max<uint32_t>(layout.volumeBlocks / 16, 16) : 0;
 
+    // Block checksums: four bytes per block, after the journal
+    if (blockChecksums) {
+        layout.checksumStart = layout.journalStart + layout.journalBlocks;
+        layout.checksumBlocks = static_cast<uint32_t>((totalBlocks * sizeof(uint32_t) + blockSize - 1) / blockSize);
+    }
 
+    layout.dataStart = layout.journalStart + layout.journalBlocks + layout.checksumBlocks;
+    if (layout.dataStart >= layout.volumeBlocks) {
+        throw std::invalid_argument("Disk is too small for the file system metadata.");
+    }
+    return layout;
+}
+
+// Write data to a specific block (file data: goes straight to its home location)
 void DiskManager::writeBlock(size_t blockNumber, const std::vector<char>& data) {
+    if (segmentManager && blockNumber != 0) {
+        segmentManager->writeBlock(blockNumber, data);
+        return;
+    }
+    if (journal) {
+        journal->forget(blockNumber); // A freed metadata block may be reused for data
+    }
+    recordChecksums(blockNumber, data);
+    writeBlocks(blockNumber, data);
+}
+
+// Write a metadata block; with a journal attached the write joins the running transaction
+void DiskManager::writeMetadataBlock(size_t blockNumber, const std::vector<char>& data) {
+    if (segmentManager && blockNumber != 0) {
+        segmentManager->writeBlock(blockNumber, data);
+        return;
+    }
+    recordChecksums(blockNumber, data);
+    if (!journal) {
+        writeBlocks(blockNumber, data);
+        return;
+    }
     if (blockNumber >= totalBlocks) {
         throw std::out_of_range("Block number out of range.");
     }
     if (data.size() != blockSize) {
         throw std::invalid_argument("Data size must match block size.");
     }
+    if (snapshotManager) {
+        // Copied out now, while the allocator is current: the home write may be a replay at
+        // the next mount, before the free block vector is read
+        snapshotManager->preserveBlocks(blockNumber, 1);
+    }
+    journal->logBlock(blockNumber, data);
+}
 
-    diskFile.seekp(blockNumber * blockSize, std::ios::beg);
-    diskFile.write(data.data(), blockSize);
-    diskFile.flush();
+// Write consecutive blocks with one write, bypassing the journal and the segment log
+void DiskManager::writeBlocks(size_t firstBlock, const std::vector<char>& data) {
+    if (data.empty() || data.size() % blockSize != 0) {
+        throw std::invalid_argument("Data size must match block size.");
+    }
+    if (firstBlock + data.size() / blockSize > totalBlocks) {
+        throw std::out_of_range("Block number out of range.");
+    }
+
+    if (snapshotView) {
+        throw std::runtime_error("Snapshots are read-only.");
+    }
+    if (snapshotManager) {
+        snapshotManager->preserveBlocks(firstBlock, data.size() / blockSize);
+    }
+
+    if (::pwrite(diskFile, data.data(), data.size(), static_cast<off_t>(firstBlock * blockSize)) !=
+        static_cast<ssize_t>(data.size())) {
+        throw std::runtime_error("Write failed: block " + std::to_string(firstBlock));
+    }
+    ++writeCount;
 }
 
+// Read data from a specific block (sees journaled blocks not yet written home)
 std::vector<char> DiskManager::readBlock(size_t blockNumber) {
     if (blockNumber >= totalBlocks) {
         throw std::out_of_range("Block number out of range.");
     }
 
     std::vector<char> data(blockSize);
-    diskFile.seekg(blockNumber * blockSize, std::ios::beg);
-    diskFile.read(data.data(), blockSize);
+    if (segmentManager && blockNumber != 0) {
+        segmentManager->readBlock(blockNumber, data);
+        return data;
+    }
+    if (journal && journal->readBlock(blockNumber, data)) {
+        return data;
+    }
+    readAt(blockNumber, data);
+
+    if (!matchesChecksum(blockNumber, data)) {
+        ++checksumErrors;
+        LLFS_LOG_ERROR("DiskManager", "Checksum mismatch: block=", blockNumber);
+        throw std::runtime_error("Checksum mismatch: block " + std::to_string(blockNumber));
+    }
+    return data;
+}
+
+// Read a file data block without taking a lock (data blocks never go through the journal)
+std::vector<char> DiskManager::readDataBlock(size_t blockNumber) {
+    if (segmentManager || blockNumber == 0 || blockNumber >= totalBlocks) {
+        return readBlock(blockNumber);
+    }
+    std::vector<char> data(blockSize);
+    readAt(blockNumber, data);
+    checkDataBlock(blockNumber, data);
+    return data;
+}
 
+// Check a file data block read straight from the disk file against its checksum
+void DiskManager::checkDataBlock(size_t blockNumber, const std::vector<char>& data) {
+    if (!matchesChecksum(blockNumber, data)) {
+        ++checksumErrors;
+        LLFS_LOG_ERROR("DiskManager", "Checksum mismatch: block=", blockNumber);
+        throw std::runtime_error("Checksum mismatch: block " + std::to_string(blockNumber));
+    }
+}
+
+// Read consecutive blocks with one read, bypassing the journal and the segment log
+std::vector<char> DiskManager::readBlocks(size_t firstBlock, size_t count) {
+    if (count == 0 || firstBlock + count > totalBlocks) {
+        throw std::out_of_range("Block number out of range.");
+    }
+
+    std::vector<char> data(count * blockSize);
+    readAt(firstBlock, data);
     return data;
 }
 
+// Make the writes so far durable (fdatasync on the disk file; writes are unbuffered)
+void DiskManager::sync() {
+    if (::fdatasync(diskFile) != 0) {
+        throw std::runtime_error("Sync failed: " + diskFileName);
+    }
+}
 
+// Helper function to fill a buffer from the disk file at a block (zeros past its end)
+void DiskManager::readAt(size_t firstBlock, std::vector<char>& data) {
+    if (!snapshotView) {
+        readFromFile(firstBlock, data.data(), data.size());
+        return;
+    }
+    for (size_t i = 0; i < data.size() / blockSize; ++i) {
+        size_t blockNumber = firstBlock + i;
+        size_t location = snapshotView->locateBlock(snapshotId, blockNumber);
+        readFromFile(location, data.data() + i * blockSize, blockSize);
+        if (location == blockNumber) {
+            // A copy is made before the block is overwritten: if one appeared meanwhile, the
+            // contents read may be newer than the snapshot
+            location = snapshotView->locateBlock(snapshotId, blockNumber);
+            if (location != blockNumber) {
+                readFromFile(location, data.data() + i * blockSize, blockSize);
+            }
+        }
+    }
+}
+
+// Helper function to fill length bytes from the disk file at a block (zeros past its end)
+void DiskManager::readFromFile(size_t firstBlock, char* buffer, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t got = ::pread(diskFile, buffer + done, length - done,
+                              static_cast<off_t>(firstBlock * blockSize + done));
+        if (got < 0) {
+            throw std::runtime_error("Read failed: block " + std::to_string(firstBlock));
+        }
+        if (got == 0) {
+            std::fill(buffer + done, buffer + length, 0);
+            break;
+        }
+        done += static_cast<size_t>(got);
+    }
+}
+
+// Read a block and check it against its checksum without throwing
+bool DiskManager::verifyBlock(size_t blockNumber) {
+    if (blockNumber >= totalBlocks) {
+        throw std::out_of_range("Block number out of range.");
+    }
+    std::vector<char> data(blockSize);
+    if (!blockChecksums || (journal && journal->readBlock(blockNumber, data))) {
+        readBlock(blockNumber); // Nothing to compare, or the current image is in memory
+        return true;
+    }
+    data = readBlocks(blockNumber, 1);
+    if (!matchesChecksum(blockNumber, data)) {
+        ++checksumErrors;
+        return false;
+    }
+    return true;
+}
+
+// Write the changed parts of the checksum table through the journal
+void DiskManager::flushChecksums() {
+    if (!blockChecksums) {
+        return;
+    }
+    const size_t perBlock = blockSize / sizeof(uint32_t);
+    std::vector<std::pair<size_t, std::vector<char>>> blocks;
+    {
+        std::lock_guard<std::mutex> lock(checksumMutex);
+        for (size_t i = 0; i < dirtyChecksumBlocks.size(); ++i) {
+            if (!dirtyChecksumBlocks[i]) continue;
+            dirtyChecksumBlocks[i] = false;
+            std::vector<char> block(blockSize, 0);
+            size_t count = std::min(perBlock, checksums.size() - i * perBlock);
+            std::memcpy(block.data(), checksums.data() + i * perBlock, count * sizeof(uint32_t));
+            blocks.emplace_back(checksumLayout.checksumStart + i, std::move(block));
+        }
+    }
+    for (const auto& [blockNumber, block] : blocks) {
+        writeMetadataBlock(blockNumber, block);
+    }
+}
+
+// Load the checksum table from disk (after journal recovery)
+void DiskManager::loadChecksums() {
+    if (!blockChecksums) {
+        return;
+    }
+    std::vector<char> table = readBlocks(checksumLayout.checksumStart, checksumLayout.checksumBlocks);
+    std::lock_guard<std::mutex> lock(checksumMutex);
+    for (size_t i = 0; i < checksums.size(); ++i) {
+        uint32_t checksum;
+        std::memcpy(&checksum, table.data() + i * sizeof(uint32_t), sizeof(checksum));
+        std::atomic_ref<uint32_t>(checksums[i]).store(checksum, std::memory_order_relaxed);
+    }
+    std::fill(dirtyChecksumBlocks.begin(), dirtyChecksumBlocks.end(), false);
+    LLFS_LOG_DEBUG("DiskManager", "Checksum table loaded: blocks=", checksumLayout.checksumBlocks);
+}
+
+// Check whether blocks are checksummed
+bool DiskManager::hasBlockChecksums() const {
+    return blockChecksums;
+}
+
+// Number of reads that failed their checksum
+size_t DiskManager::getChecksumErrors() const {
+    return checksumErrors;
+}
+
+// Check whether a block has a checksum
+bool DiskManager::isChecksummed(size_t blockNumber) const {
+    const Superblock& l = checksumLayout;
+    return blockChecksums && blockNumber != 0 && blockNumber < totalBlocks &&
+           (blockNumber < l.journalStart || blockNumber >= l.journalStart + l.journalBlocks) &&
+           (blockNumber < l.checksumStart || blockNumber >= l.checksumStart + l.checksumBlocks);
+}
+
+// Compare a block read from disk with its recorded checksum
+bool DiskManager::matchesChecksum(size_t blockNumber, const std::vector<char>& data) {
+    if (!isChecksummed(blockNumber)) {
+        return true;
+    }
+    uint32_t expected = std::atomic_ref<uint32_t>(checksums[blockNumber]).load(std::memory_order_relaxed);
+    return expected == 0 || blockChecksum(data.data(), data.size()) == expected;
+}
+
+// Record the checksums of blocks about to be written
+void DiskManager::recordChecksums(size_t firstBlock, const std::vector<char>& data) {
+    if (!blockChecksums || data.size() % blockSize != 0) {
+        return; // The write itself rejects bad sizes
+    }
+    size_t count = std::min(data.size() / blockSize, totalBlocks - std::min(firstBlock, totalBlocks));
+    std::vector<uint32_t> sums(count);
+    for (size_t i = 0; i < count; ++i) {
+        sums[i] = blockChecksum(data.data() + i * blockSize, blockSize);
+    }
+
+    std::lock_guard<std::mutex> lock(checksumMutex);
+    for (size_t i = 0; i < count; ++i) {
+        size_t blockNumber = firstBlock + i;
+        if (isChecksummed(blockNumber) && checksums[blockNumber] != sums[i]) {
+            std::atomic_ref<uint32_t>(checksums[blockNumber]).store(sums[i], std::memory_order_relaxed);
+            dirtyChecksumBlocks[blockNumber * sizeof(uint32_t) / blockSize] = true;
+        }
+    }
+}
+
+// Checksum a block's contents (never 0, which means none recorded)
+uint32_t DiskManager::blockChecksum(const char* data, size_t length) {
+    uint32_t crc = Crc32c::compute(0, data, length);
+    return crc == 0 ? 1 : crc;
+}
+
+// Attach a journal for metadata writes (null to detach)
+void DiskManager::setJournal(Journal* journal) {
+    this->journal = journal;
+}
+
+// Attach a segment log: every block but the superblock is then read and written through it
+void DiskManager::setSegmentManager(SegmentManager* segmentManager) {
+    this->segmentManager = segmentManager;
+}
+
+// Attach the snapshots: a block they still need is copied out before it is first overwritten
+void DiskManager::setSnapshotManager(SnapshotManager* snapshotManager) {
+    this->snapshotManager = snapshotManager;
+}
+
+// Read every block as a snapshot saw it; writes then throw (null to detach)
+void DiskManager::setSnapshotView(SnapshotManager* snapshots, uint32_t snapshotId) {
+    snapshotView = snapshots;
+    this->snapshotId = snapshotId;
+}
+
+// Number of write calls that reached the disk file (for statistics)
+size_t DiskManager::getWriteCount() const {
+    return writeCount;
+}
 
 size_t DiskManager::getTotalBlocks() const {
     return totalBlocks;
 }
 
-void DiskManager::readSuperblock() {
+size_t DiskManager::getBlockSize() const {
+    return blockSize;
+}
+
+const std::string& DiskManager::getDiskFileName() const {
+    return diskFileName;
+}
+
+// Get the write mode used for formatting
+WriteMode DiskManager::getWriteMode() const {
+    return writeMode;
+}
+
+// Read and validate the superblock
+Superblock DiskManager::loadSuperblock() {
     std::vector<char> superblock = readBlock(0);
 
-    char magicNumber[5] = {0};
-    std::memcpy(magicNumber, superblock.data(), 4);
-    if (std::string(magicNumber) != "LLFS") {
+    if (std::memcmp(superblock.data(), "LLFS", 4) != 0) {
         throw std::runtime_error("Invalid file system format.");
     }
 
-    size_t totalBlocks = 0;
-    std::memcpy(&totalBlocks, superblock.data() + 4, sizeof(totalBlocks));
+    Superblock layout = {};
+    std::memcpy(&layout, superblock.data() + 4, sizeof(layout));
+    if (layout.totalBlocks != totalBlocks) {
+        throw std::runtime_error("Invalid superblock: Total blocks mismatch.");
+    }
+    if (layout.writeMode != static_cast<uint32_t>(writeMode)) {
+        throw std::runtime_error("Invalid superblock: Write mode mismatch.");
+    }
+    if ((layout.checksumBlocks != 0) != blockChecksums) {
+        throw std::runtime_error("Invalid superblock: Checksum mode mismatch.");
+    }
+    if (layout.checksumBlocks != 0 &&
+        (layout.checksumStart < layout.journalStart + layout.journalBlocks ||
+         layout.checksumStart + layout.checksumBlocks > layout.dataStart ||
+         static_cast<size_t>(layout.checksumBlocks) * blockSize < totalBlocks * sizeof(uint32_t))) {
+        throw std::runtime_error("Invalid superblock: Unsupported layout, please reformat.");
+    }
+    if (layout.inodeTableStart == 0 || layout.dataStart <= layout.inodeTableStart ||
+        layout.volumeBlocks > layout.totalBlocks || layout.dataStart >= layout.volumeBlocks ||
+        layout.journalStart < layout.inodeTableStart + layout.inodeTableBlocks ||
+        layout.journalStart + layout.journalBlocks > layout.dataStart) {
+        throw std::runtime_error("Invalid superblock: Unsupported layout, please reformat.");
+    }
+    if (writeMode == WriteMode::InPlace &&
+        (layout.snapshotTableBlocks != 1 ||
+         layout.snapshotTableStart < layout.freeBlockVectorStart + layout.freeBlockVectorBlocks ||
+         layout.snapshotTableStart + layout.snapshotTableBlocks > layout.inodeTableStart)) {
+        throw std::runtime_error("Invalid superblock: Unsupported layout, please reformat.");
+    }
+    if (writeMode == WriteMode::InPlace ? layout.journalBlocks < 3
+                                        : layout.segmentBlocks == 0 || layout.checkpointStart == 0 ||
+                                          layout.segmentStart < layout.checkpointStart + layout.checkpointBlocks ||
+                                          layout.segmentStart + layout.segmentCount * layout.segmentBlocks > totalBlocks) {
+        throw std::runtime_error("Invalid superblock: Unsupported layout, please reformat.");
+    }
+    return layout;
+}
 
-    size_t numberOfInodes = 0;
-    std::memcpy(&numberOfInodes, superblock.data() + 8, sizeof(numberOfInodes));
+void DiskManager::readSuperblock() {
+    Superblock layout = loadSuperblock();
 
-    std::cout << "Superblock Info:" << std::endl;
-    std::cout << "  Magic Number: " << magicNumber << std::endl;
-    std::cout << "  Total Blocks: " << totalBlocks << std::endl;
-    std::cout << "  Number of Inodes: " << numberOfInodes << std::endl;
+    LLFS_LOG_INFO("DiskManager", "Superblock: magic=LLFS totalBlocks=", layout.totalBlocks,
+                  " inodes=", layout.numberOfInodes, " inodeTableStart=", layout.inodeTableStart,
+                  " journalStart=", layout.journalStart, " dataStart=", layout.dataStart);
 }
@@ -3,13 +3,54 @@
 
 #include <string>
 #include <vector>
-#include <fstream>
+#include <atomic>
+#include <mutex>
 #include <stdexcept>
+#include <cstdint>
+
+// How blocks reach the disk, chosen at format time
+enum class WriteMode : uint32_t {
+    InPlace = 0,        // Blocks live at fixed locations; metadata goes through the journal
+    LogStructured = 1   // Every block write is appended to a segment (LFS mode)
+};
+
+// On-disk layout recorded in block 0
+struct Superblock {
+    uint32_t totalBlocks;           // Total number of blocks on the disk
+    uint32_t numberOfInodes;        // Number of inodes in the inode table
+    uint32_t freeBlockVectorStart;  // First block of the free block vector
+    uint32_t freeBlockVectorBlocks; // Number of blocks used by the free block vector
+    uint32_t inodeTableStart;       // First block of the inode table
+    uint32_t inodeTableBlocks;      // Number of blocks used by the inode table
+    uint32_t dataStart;             // First block available for file data
+    uint32_t journalStart;          // First block of the metadata journal
+    uint32_t journalBlocks;         // Number of blocks used by the journal (header + ring)
+    uint32_t writeMode;             // WriteMode
+    uint32_t volumeBlocks;          // Block numbers the file system uses (below totalBlocks in LFS mode)
+    uint32_t checkpointStart;       // First block of the checkpoint region (LFS mode)
+    uint32_t checkpointBlocks;      // Number of blocks used by the checkpoint region
+    uint32_t segmentStart;          // First block of the first segment (LFS mode)
+    uint32_t segmentBlocks;         // Blocks per segment
+    uint32_t segmentCount;          // Number of segments
+    uint32_t checksumStart;         // First block of the block checksum table (0 = no checksums)
+    uint32_t checksumBlocks;        // Number of blocks used by the checksum table
+    uint32_t snapshotTableStart;    // Block listing the snapshots (in-place mode)
+    uint32_t snapshotTableBlocks;   // Number of blocks used by the snapshot table
+};
+
+class Journal;
+class SegmentManager;
+class SnapshotManager;
 
 class DiskManager {
 public:
-    // Constructor to initialize the disk manager
-    DiskManager(const std::string& diskFileName, size_t diskSize, size_t blockSize = 512);
+    // Most block numbers a volume uses: inodes hold 16-bit block pointers
+    static constexpr uint32_t MAX_VOLUME_BLOCKS = UINT16_MAX + 1;
+
+    // Constructor to initialize the disk manager; with blockChecksums (in-place mode only) a
+    // CRC32C of every block is kept in a table on disk and checked when the block is read
+    DiskManager(const std::string& diskFileName, size_t diskSize, size_t blockSize = 512,
+                WriteMode writeMode = WriteMode::InPlace, bool blockChecksums = false);
 
     // Destructor to close the file
     ~DiskManager();
@@ -17,15 +58,87 @@ public:
     // Format the disk (initialize metadata)
     void formatDisk();
 
-    // Write data to a specific block
+    // Write data to a specific block (file data: goes straight to its home location)
     void writeBlock(size_t blockNumber, const std::vector<char>& data);
 
-    // Read data from a specific block
+    // Write a metadata block (bitmap, inode table, directory, indirect); with a journal
+    // attached the write joins the running transaction instead of going to disk
+    void writeMetadataBlock(size_t blockNumber, const std::vector<char>& data);
+
+    // Write consecutive blocks with one write, bypassing the journal and the segment log
+    void writeBlocks(size_t firstBlock, const std::vector<char>& data);
+
+    // Read data from a specific block (sees journaled blocks not yet written home); throws if
+    // the block fails its checksum
     std::vector<char> readBlock(size_t blockNumber);
 
+    // Read a file data block without taking a lock: data blocks never go through the journal,
+    // so they are read from their home location (through the segment log in LFS mode); throws
+    // if the block fails its checksum
+    std::vector<char> readDataBlock(size_t blockNumber);
+
+    // Check a file data block read straight from the disk file (by an asynchronous reader)
+    // against its checksum; throws like readDataBlock
+    void checkDataBlock(size_t blockNumber, const std::vector<char>& data);
+
+    // Read consecutive blocks with one read, bypassing the journal and the segment log
+    std::vector<char> readBlocks(size_t firstBlock, size_t count);
+
+    // Make the writes so far durable (fdatasync on the disk file; writes are unbuffered)
+    void sync();
+
+    // Read a block and check it against its checksum without throwing (true when checksums are
+    // off or none was recorded)
+    bool verifyBlock(size_t blockNumber);
+
+    // Write the changed parts of the checksum table (through the journal, so the table commits
+    // with the blocks it describes)
+    void flushChecksums();
+
+    // Load the checksum table from disk (after journal recovery)
+    void loadChecksums();
+
+    // Check whether blocks are checksummed
+    bool hasBlockChecksums() const;
+
+    // Number of reads that failed their checksum
+    size_t getChecksumErrors() const;
+
+    // Attach a journal for metadata writes (null to detach)
+    void setJournal(Journal* journal);
+
+    // Attach a segment log: every block but the superblock is then read and written through
+    // it (null to detach)
+    void setSegmentManager(SegmentManager* segmentManager);
+
+    // Attach the snapshots: a block they still need is copied out before it is first
+    // overwritten (null to detach)
+    void setSnapshotManager(SnapshotManager* snapshotManager);
+
+    // Read every block as a snapshot saw it; writes then throw (null to detach)
+    void setSnapshotView(SnapshotManager* snapshots, uint32_t snapshotId);
+
+    // Number of write calls that reached the disk file (for statistics)
+    size_t getWriteCount() const;
+
     // Get the total number of blocks on the disk
     size_t getTotalBlocks() const;
 
+    // Get the block size in bytes
+    size_t getBlockSize() const;
+
+    // Get the name of the disk file
+    const std::string& getDiskFileName() const;
+
+    // Get the write mode used for formatting
+    WriteMode getWriteMode() const;
+
+    // Compute the on-disk layout for this disk
+    Superblock computeLayout() const;
+
+    // Read and validate the superblock
+    Superblock loadSuperblock();
+
     void readSuperblock();
 
 private:
@@ -33,10 +146,45 @@ private:
     size_t diskSize;            // Total size of the disk in bytes
     size_t blockSize;           // Block size in bytes
     size_t totalBlocks;         // Total number of blocks on the disk
-    std::fstream diskFile;      // File stream for disk operations
+    WriteMode writeMode;        // How blocks reach the disk
+    int diskFile = -1;          // Descriptor of the disk file; positioned reads and writes need no lock
+    Journal* journal = nullptr; // Metadata journal (null when writes go straight to disk)
+    SegmentManager* segmentManager = nullptr; // Segment log (LFS mode)
+    SnapshotManager* snapshotManager = nullptr; // Preserves blocks for snapshots
+    SnapshotManager* snapshotView = nullptr;  // Set when reading a snapshot
+    uint32_t snapshotId = 0;                  // ... and which one
+    std::atomic<size_t> writeCount{0}; // Write calls that reached the disk file
+
+    // Block checksums: CRC32C per block (0 = none recorded yet), covering every block but the
+    // superblock, the journal and the table itself
+    bool blockChecksums;
+    Superblock checksumLayout = {};           // Where the table and the journal are
+    std::vector<uint32_t> checksums;          // Read without the lock through std::atomic_ref
+    std::vector<bool> dirtyChecksumBlocks;    // Table blocks changed since the last flush
+    std::mutex checksumMutex;                 // Serializes changes to the table
+    std::atomic<size_t> checksumErrors{0};
 
     // Helper function to open the disk file
     void openDiskFile();
+
+    // Helper function to fill a buffer from the disk file at a block (zeros past its end);
+    // a snapshot view reads each block where the snapshot keeps it
+    void readAt(size_t firstBlock, std::vector<char>& data);
+
+    // Helper function to fill length bytes from the disk file at a block
+    void readFromFile(size_t firstBlock, char* buffer, size_t length);
+
+    // Check whether a block has a checksum
+    bool isChecksummed(size_t blockNumber) const;
+
+    // Compare a block read from disk with its recorded checksum
+    bool matchesChecksum(size_t blockNumber, const std::vector<char>& data);
+
+    // Record the checksums of blocks about to be written
+    void recordChecksums(size_t firstBlock, const std::vector<char>& data);
+
+    // Checksum a block's contents (never 0, which means none recorded)
+    static uint32_t blockChecksum(const char* data, size_t length);
 };
 
 #endif // DISKMANAGER_H
@@ -0,0 +1,116 @@
+#include "EpochManager.h"
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <utility>
+
+// Enter the current epoch, waiting for a slot if every one is taken
+EpochManager::Guard EpochManager::enter() {
+    for (;;) {
+        if (std::optional<Guard> guard = tryEnter()) {
+            return std::move(*guard);
+        }
+        std::this_thread::yield();
+    }
+}
+
+// Enter the current epoch if a slot is free: claim one, starting from one picked by thread so
+// that readers on different threads write different cache lines
+std::optional<EpochManager::Guard> EpochManager::tryEnter() {
+    thread_local const size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+    for (size_t i = 0; i < SLOTS; ++i) {
+        Slot& slot = slots[(start + i) % SLOTS];
+        uint64_t expected = 0;
+        if (slot.epoch.load(std::memory_order_relaxed) == 0 &&
+            slot.epoch.compare_exchange_strong(expected, globalEpoch.load())) {
+            return Guard(&slot.epoch);
+        }
+    }
+    return std::nullopt;
+}
+
+// Run a callback once every reader that entered an epoch up to now has left
+void EpochManager::retire(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    // Readers entering from now on get a later epoch, so they cannot see what was unpublished
+    retired.push_back({globalEpoch.fetch_add(1), std::move(callback)});
+}
+
+// Run the callbacks whose grace period is over
+size_t EpochManager::reclaim() {
+    uint64_t oldest = oldestActive();
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        auto end = std::find_if(retired.begin(), retired.end(),
+                                [oldest](const Retired& entry) { return entry.epoch >= oldest; });
+        ready.assign(std::make_move_iterator(retired.begin()), std::make_move_iterator(end));
+        retired.erase(retired.begin(), end);
+        reclaimed += ready.size();
+    }
+    for (Retired& entry : ready) {
+        entry.callback();
+    }
+    return ready.size();
+}
+
+// Wait until every callback retired so far has run
+void EpochManager::synchronize() {
+    uint64_t target = globalEpoch.load();
+    for (;;) {
+        reclaim();
+        {
+            std::lock_guard<std::mutex> lock(retiredMutex);
+            if (retired.empty() || retired.front().epoch >= target) {
+                return;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+size_t EpochManager::getPending() const {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    return retired.size();
+}
+
+size_t EpochManager::getReclaimed() const {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    return reclaimed;
+}
+
+// Helper function to get the oldest epoch a reader is in (UINT64_MAX if none)
+uint64_t EpochManager::oldestActive() const {
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (const Slot& slot : slots) {
+        uint64_t epoch = slot.epoch.load();
+        if (epoch != 0) {
+            oldest = std::min(oldest, epoch);
+        }
+    }
+    return oldest;
+}
+
+// Guard
+
+EpochManager::Guard::Guard(std::atomic<uint64_t>* slot) : slot(slot) {}
+
+EpochManager::Guard::Guard(Guard&& other) noexcept : slot(other.slot) {
+    other.slot = nullptr;
+}
+
+EpochManager::Guard& EpochManager::Guard::operator=(Guard&& other) noexcept {
+    if (this != &other) {
+        if (slot) {
+            slot->store(0, std::memory_order_release);
+        }
+        slot = std::exchange(other.slot, nullptr);
+    }
+    return *this;
+}
+
+EpochManager::Guard::~Guard() {
+    if (slot) {
+        slot->store(0, std::memory_order_release);
+    }
+}
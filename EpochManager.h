@@ -0,0 +1,78 @@
+#ifndef EPOCHMANAGER_H
+#define EPOCHMANAGER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Epoch-based reclamation for lock-free readers. A reader enters the current epoch for the
+// length of its read, writing only a slot of its own; a writer that unpublishes something a
+// reader may still be using retires it with a callback, which runs once every reader that
+// could have seen it has left (a grace period). Readers never wait for writers.
+class EpochManager {
+public:
+    // Reader slots (one cache line each); readers beyond this wait for a free slot
+    static constexpr size_t SLOTS = 128;
+
+    // A reader inside an epoch; leaves it when destroyed
+    class Guard {
+    public:
+        Guard(Guard&& other) noexcept;
+        Guard& operator=(Guard&& other) noexcept;
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard();
+
+    private:
+        friend class EpochManager;
+        explicit Guard(std::atomic<uint64_t>* slot);
+
+        std::atomic<uint64_t>* slot;
+    };
+
+    // Enter the current epoch
+    Guard enter();
+
+    // Enter the current epoch if a slot is free (a reader that cannot wait, as a coroutine on a
+    // thread whose other readers hold every slot)
+    std::optional<Guard> tryEnter();
+
+    // Run a callback once every reader that entered an epoch up to now has left
+    void retire(std::function<void()> callback);
+
+    // Run the callbacks whose grace period is over; returns how many ran
+    size_t reclaim();
+
+    // Wait until every callback retired so far has run
+    void synchronize();
+
+    // Statistics
+    size_t getPending() const;
+    size_t getReclaimed() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0}; // Epoch of the reader holding the slot (0 = free)
+    };
+
+    struct Retired {
+        uint64_t epoch;                 // Readers at or before this epoch may still see it
+        std::function<void()> callback;
+    };
+
+    std::atomic<uint64_t> globalEpoch{1};
+    std::array<Slot, SLOTS> slots;
+    mutable std::mutex retiredMutex;    // Guards the two below
+    std::vector<Retired> retired;       // Oldest first
+    size_t reclaimed = 0;
+
+    // Helper function to get the oldest epoch a reader is in (UINT64_MAX if none)
+    uint64_t oldestActive() const;
+};
+
+#endif // EPOCHMANAGER_H
@@ -0,0 +1,210 @@
+#include "EventLoop.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <utility>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Constructor
+EventLoop::EventLoop(size_t workerThreads, unsigned ringEntries) : ring(ringEntries) {
+    wakeFd = ::eventfd(0, EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        throw std::runtime_error("Failed to create the event loop's eventfd.");
+    }
+    for (size_t i = 0; i < std::max<size_t>(workerThreads, 1); ++i) {
+        workers.emplace_back(&EventLoop::workerLoop, this);
+    }
+    LLFS_LOG_DEBUG("EventLoop", "Event loop started: workers=", workers.size(), " ioRing=", usesIoRing());
+}
+
+// Destructor
+EventLoop::~EventLoop() {
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    ::close(wakeFd);
+}
+
+// Start a task on the next turn of the loop
+void EventLoop::spawn(Task<void> task) {
+    ++activeTasks;
+    ready.push_back(drive(std::move(task)).handle);
+}
+
+// Run until every spawned task has finished
+void EventLoop::run() {
+    for (;;) {
+        while (!ready.empty()) {
+            std::coroutine_handle<> handle = ready.front();
+            ready.pop_front();
+            handle.resume();
+        }
+        if (activeTasks == 0) {
+            break;
+        }
+        waitForEvents();
+    }
+    if (error) {
+        std::rethrow_exception(std::exchange(error, nullptr));
+    }
+}
+
+// Resume a coroutine on the next turn of the loop
+void EventLoop::schedule(std::coroutine_handle<> handle) {
+    ready.push_back(handle);
+}
+
+// Issue a batch of reads at once
+EventLoop::ReadAwaiter EventLoop::read(std::vector<Read>& reads) {
+    return ReadAwaiter{*this, reads};
+}
+
+bool EventLoop::usesIoRing() const {
+    return ring.isAvailable();
+}
+
+size_t EventLoop::getReadsIssued() const {
+    return readsIssued;
+}
+
+size_t EventLoop::getWorkItems() const {
+    return workItems;
+}
+
+// ReadAwaiter
+
+void EventLoop::ReadAwaiter::await_suspend(std::coroutine_handle<> awaiting) {
+    handle = awaiting;
+    loop.issueReads(*this);
+}
+
+// Helper function to drive a spawned task and count it while it runs
+EventLoop::Detached EventLoop::drive(Task<void> task) {
+    try {
+        co_await std::move(task);
+    } catch (...) {
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+    --activeTasks;
+}
+
+// Helper function to queue a function for the worker threads
+void EventLoop::startWork(std::function<void()> function) {
+    ++workItems;
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        work.push_back(std::move(function));
+    }
+    workReady.notify_one();
+}
+
+// Helper function to resume a coroutine on the loop thread (from any thread)
+void EventLoop::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        posted.push_back(handle);
+    }
+    uint64_t one = 1;
+    while (::write(wakeFd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+// Helper function to hand reads to the ring, or to the worker threads without one
+void EventLoop::issueReads(ReadAwaiter& batch) {
+    batch.remaining = batch.reads.size();
+    readsIssued += batch.reads.size();
+    if (!ring.isAvailable()) {
+        startWork([this, &batch] {
+            for (Read& read : batch.reads) {
+                ssize_t done = ::pread(read.fd, read.buffer, read.length, static_cast<off_t>(read.offset));
+                read.result = done < 0 ? -errno : static_cast<int>(done);
+            }
+            post(batch.handle);
+        });
+        return;
+    }
+    for (Read& read : batch.reads) {
+        read.batch = &batch;
+        waitingReads.push_back(&read);
+    }
+    fillRing();
+}
+
+// Helper function to move waiting reads into the ring while it has room (one entry stays free
+// for the read of the eventfd)
+void EventLoop::fillRing() {
+    while (!waitingReads.empty() && readsInFlight + 1 < ring.getCapacity()) {
+        Read& read = *waitingReads.front();
+        if (!ring.prepareRead(read.fd, read.buffer, static_cast<unsigned>(read.length), read.offset,
+                              reinterpret_cast<uint64_t>(&read))) {
+            break;
+        }
+        waitingReads.pop_front();
+        ++readsInFlight;
+    }
+}
+
+// Helper function to record a completed read, resuming its batch when it is the last
+void EventLoop::completeRead(Read& read, int result) {
+    --readsInFlight;
+    read.result = result;
+    if (--read.batch->remaining == 0) {
+        ready.push_back(read.batch->handle);
+    }
+}
+
+// Helper function to block until a read completes or a worker posts a completion
+void EventLoop::waitForEvents() {
+    if (ring.isAvailable()) {
+        fillRing();
+        if (!wakeArmed) {
+            // The eventfd is read through the ring too, so one wait covers both
+            wakeArmed = ring.prepareRead(wakeFd, &wakeCount, sizeof(wakeCount), UINT64_MAX, 0);
+        }
+        ring.submitAndWait(1);
+        ring.reap([this](uint64_t userData, int result) {
+            if (userData == 0) {
+                wakeArmed = false;
+            } else {
+                completeRead(*reinterpret_cast<Read*>(userData), result);
+            }
+        });
+    } else {
+        uint64_t count = 0;
+        while (::read(wakeFd, &count, sizeof(count)) < 0 && errno == EINTR) {
+        }
+    }
+
+    std::vector<std::coroutine_handle<>> completed;
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        completed.swap(posted);
+    }
+    ready.insert(ready.end(), completed.begin(), completed.end());
+}
+
+// Helper function to run on a worker thread
+void EventLoop::workerLoop() {
+    for (;;) {
+        std::function<void()> function;
+        {
+            std::unique_lock<std::mutex> lock(workMutex);
+            workReady.wait(lock, [this] { return stopping || !work.empty(); });
+            if (stopping && work.empty()) {
+                return;
+            }
+            function = std::move(work.front());
+            work.pop_front();
+        }
+        function();
+    }
+}
@@ -0,0 +1,207 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include "IoRing.h"
+#include "Task.h"
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Runs coroutines on the thread that calls run(). A coroutine suspends on reads, which go to an
+// io_uring (or, without one, to the worker threads), and on blocking work handed to the worker
+// threads; it is resumed on the loop thread once they complete, so thousands of requests can be
+// in flight without a thread each.
+class EventLoop {
+public:
+    struct ReadAwaiter;
+
+    // One read of a batch
+    struct Read {
+        int fd = -1;
+        char* buffer = nullptr;
+        size_t length = 0;
+        uint64_t offset = 0;
+        int result = 0;                 // Bytes read, or -errno
+        ReadAwaiter* batch = nullptr;   // Set when issued
+    };
+
+    // Suspends a coroutine until every read of a batch has completed
+    struct ReadAwaiter {
+        EventLoop& loop;
+        std::vector<Read>& reads;
+        size_t remaining = 0;
+        std::coroutine_handle<> handle = nullptr;
+
+        bool await_ready() const noexcept { return reads.empty(); }
+        void await_suspend(std::coroutine_handle<> awaiting);
+        void await_resume() const noexcept {}
+    };
+
+    // Suspends a coroutine while a function runs on a worker thread; resumes with its result
+    template <typename Function, typename Result>
+    struct WorkAwaiter {
+        EventLoop& loop;
+        Function function;
+        std::optional<std::conditional_t<std::is_void_v<Result>, bool, Result>> value;
+        std::exception_ptr error;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> awaiting) {
+            loop.startWork([this, awaiting] {
+                try {
+                    if constexpr (std::is_void_v<Result>) {
+                        function();
+                        value = true;
+                    } else {
+                        value = function();
+                    }
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                loop.post(awaiting);
+            });
+        }
+
+        Result await_resume() {
+            if (error) std::rethrow_exception(error);
+            if constexpr (!std::is_void_v<Result>) return std::move(*value);
+        }
+    };
+
+    // Constructor; ringEntries = 0 reads on the worker threads instead of an io_uring
+    explicit EventLoop(size_t workerThreads = 4, unsigned ringEntries = 256);
+
+    // Destructor (tasks still suspended are abandoned)
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Start a task on the next turn of the loop; run() returns once it has finished
+    void spawn(Task<void> task);
+
+    // Run until every spawned task has finished; rethrows the first exception one let escape
+    void run();
+
+    // Run a task (and anything it spawns) to completion and return its result
+    template <typename T>
+    T run(Task<T> task);
+
+    // Resume a coroutine on the next turn of the loop (from the loop thread)
+    void schedule(std::coroutine_handle<> handle);
+
+    // Issue a batch of reads at once; awaiting it resumes once all have completed
+    ReadAwaiter read(std::vector<Read>& reads);
+
+    // Run a function on a worker thread; awaiting it resumes with its result (or exception)
+    template <typename Function>
+    auto offload(Function function);
+
+    // Check whether reads go through an io_uring
+    bool usesIoRing() const;
+
+    // Statistics
+    size_t getReadsIssued() const;
+    size_t getWorkItems() const;
+
+private:
+    // Fire-and-forget coroutine driving a spawned task
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() noexcept {
+                return {std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    IoRing ring;
+    std::deque<std::coroutine_handle<>> ready;  // Loop thread only
+    std::deque<Read*> waitingReads;             // Issued while the ring was full
+    size_t readsInFlight = 0;
+    size_t activeTasks = 0;
+    std::exception_ptr error;                   // First exception a spawned task let escape
+    size_t readsIssued = 0;
+    size_t workItems = 0;
+
+    // Completions from the worker threads, and the eventfd that wakes the loop for them
+    int wakeFd = -1;
+    uint64_t wakeCount = 0;                     // Target of the ring's read of wakeFd
+    bool wakeArmed = false;
+    std::mutex postedMutex;
+    std::vector<std::coroutine_handle<>> posted;
+
+    // Worker threads
+    std::mutex workMutex;
+    std::condition_variable workReady;
+    std::deque<std::function<void()>> work;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    // Helper function to drive a spawned task and count it while it runs
+    Detached drive(Task<void> task);
+
+    // Helper function to store a task's result
+    template <typename T>
+    static Task<void> storeResult(Task<T> task, std::optional<T>& result);
+
+    // Helper function to queue a function for the worker threads
+    void startWork(std::function<void()> function);
+
+    // Helper function to resume a coroutine on the loop thread (from any thread)
+    void post(std::coroutine_handle<> handle);
+
+    // Helper function to hand reads to the ring, or to the worker threads without one
+    void issueReads(ReadAwaiter& batch);
+
+    // Helper function to move waiting reads into the ring while it has room
+    void fillRing();
+
+    // Helper function to record a completed read, resuming its batch when it is the last
+    void completeRead(Read& read, int result);
+
+    // Helper function to block until a read completes or a worker posts a completion
+    void waitForEvents();
+
+    // Helper function to run on a worker thread
+    void workerLoop();
+};
+
+template <typename T>
+T EventLoop::run(Task<T> task) {
+    if constexpr (std::is_void_v<T>) {
+        spawn(std::move(task));
+        run();
+    } else {
+        std::optional<T> result;
+        spawn(storeResult(std::move(task), result));
+        run();
+        return std::move(*result);
+    }
+}
+
+template <typename Function>
+auto EventLoop::offload(Function function) {
+    return WorkAwaiter<Function, std::invoke_result_t<Function&>>{*this, std::move(function), {}, {}};
+}
+
+template <typename T>
+Task<void> EventLoop::storeResult(Task<T> task, std::optional<T>& result) {
+    result = co_await std::move(task);
+}
+
+#endif // EVENTLOOP_H
@@ -0,0 +1,215 @@
+#include "FragmentStore.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Constructor
+FragmentStore::FragmentStore(DiskManager& diskManager, FreeBlockManager& freeBlockManager, size_t cacheCapacity)
+    : diskManager(diskManager),
+      freeBlockManager(freeBlockManager),
+      blockSize(diskManager.getBlockSize()),
+      cacheCapacity(std::max<size_t>(1, cacheCapacity)) {} // A fragment is written through the cache
+
+// Largest file that is packed (half a block)
+size_t FragmentStore::getMaxFragmentSize() const {
+    return blockSize / 2;
+}
+
+// Store a fragment in a free slot of the right size
+Fragment FragmentStore::store(const char* data, size_t size) {
+    if (size == 0 || size > getMaxFragmentSize()) {
+        throw std::invalid_argument("Invalid fragment size.");
+    }
+    const size_t slotSize = slotSizeFor(size);
+    const uint8_t full = static_cast<uint8_t>((1u << (blockSize / slotSize)) - 1);
+    std::lock_guard<std::mutex> lock(mutex);
+    std::set<uint32_t>& partial = partialBlocks[slotSize];
+
+    // The lowest pack block with a free slot, so small files written together stay together
+    Fragment fragment;
+    bool fresh = partial.empty();
+    std::vector<char>* contents;
+    if (fresh) {
+        fragment.block = static_cast<uint32_t>(freeBlockManager.allocateBlock());
+        contents = &cacheBlock(fragment.block, std::vector<char>(blockSize, 0));
+    } else {
+        fragment.block = *partial.begin();
+        contents = &loadBlock(fragment.block);
+    }
+    PackBlock& pack = packBlocks[fragment.block];
+    pack.slotSize = slotSize;
+    while (pack.used & (1u << fragment.slot)) {
+        ++fragment.slot;
+    }
+
+    char* slot = contents->data() + fragment.slot * slotSize;
+    std::memcpy(slot, data, size);
+    std::memset(slot + size, 0, slotSize - size);
+    try {
+        diskManager.writeBlock(fragment.block, *contents);
+    } catch (...) {
+        uncacheBlock(fragment.block); // It may not match the disk any more
+        if (fresh) {
+            packBlocks.erase(fragment.block);
+            freeBlockManager.freeBlock(fragment.block);
+        }
+        throw;
+    }
+
+    // A new pack block comes with the first fragment's reference
+    if (!fresh) {
+        freeBlockManager.addReference(fragment.block);
+    }
+    pack.used |= static_cast<uint8_t>(1u << fragment.slot);
+    ++fragments;
+    if (pack.used == full) {
+        partial.erase(fragment.block);
+    } else {
+        partial.insert(fragment.block);
+    }
+    return fragment;
+}
+
+// Read a fragment of size bytes
+std::vector<char> FragmentStore::read(const Fragment& fragment, size_t size) {
+    if (size == 0 || size > getMaxFragmentSize()) {
+        throw std::invalid_argument("Invalid fragment size.");
+    }
+    const size_t slotSize = slotSizeFor(size);
+    if ((fragment.slot + 1) * slotSize > blockSize) {
+        throw std::out_of_range("Fragment slot out of range.");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::vector<char>& contents = loadBlock(fragment.block);
+    auto first = contents.begin() + fragment.slot * slotSize;
+    return std::vector<char>(first, first + size);
+}
+
+// Free a fragment; its slot is reused after releaseHeldSlots
+void FragmentStore::release(const Fragment& fragment) {
+    std::lock_guard<std::mutex> lock(mutex);
+    heldSlots.push_back(fragment);
+}
+
+// Make the slots freed so far reusable, freeing the pack blocks left empty
+void FragmentStore::releaseHeldSlots() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Fragment& fragment : heldSlots) {
+        auto it = packBlocks.find(fragment.block);
+        uint8_t bit = static_cast<uint8_t>(1u << fragment.slot);
+        if (it == packBlocks.end() || !(it->second.used & bit)) {
+            continue; // Not recorded (a damaged inode): nothing to free
+        }
+        it->second.used &= static_cast<uint8_t>(~bit);
+        --fragments;
+        freeBlockManager.freeBlock(fragment.block); // Drops the fragment's reference
+        std::set<uint32_t>& partial = partialBlocks[it->second.slotSize];
+        if (it->second.used == 0) {
+            partial.erase(fragment.block);
+            uncacheBlock(fragment.block);
+            packBlocks.erase(it);
+        } else {
+            partial.insert(fragment.block);
+        }
+    }
+    heldSlots.clear();
+}
+
+// Record a fragment found in an inode
+void FragmentStore::addFragment(const Fragment& fragment, size_t size) {
+    if (size == 0 || size > getMaxFragmentSize()) {
+        return;
+    }
+    const size_t slotSize = slotSizeFor(size);
+    const uint8_t full = static_cast<uint8_t>((1u << (blockSize / slotSize)) - 1);
+    uint8_t bit = static_cast<uint8_t>(1u << fragment.slot);
+    if ((fragment.slot + 1) * slotSize > blockSize) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    PackBlock& pack = packBlocks[fragment.block];
+    if (pack.used != 0 && (pack.slotSize != slotSize || (pack.used & bit))) {
+        return; // Clashes with another fragment: the inode is damaged and fsck reports it
+    }
+    pack.slotSize = slotSize;
+    pack.used |= bit;
+    ++fragments;
+    if (pack.used == full) {
+        partialBlocks[slotSize].erase(fragment.block);
+    } else {
+        partialBlocks[slotSize].insert(fragment.block);
+    }
+}
+
+// Forget every fragment and the cache
+void FragmentStore::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    packBlocks.clear();
+    partialBlocks.clear();
+    heldSlots.clear();
+    fragments = 0;
+    lru.clear();
+    cached.clear();
+}
+
+size_t FragmentStore::getFragments() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fragments;
+}
+
+size_t FragmentStore::getPackBlocks() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return packBlocks.size();
+}
+
+size_t FragmentStore::getCacheHits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cacheHits;
+}
+
+size_t FragmentStore::getCacheMisses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cacheMisses;
+}
+
+// Helper function to get the slot size for a fragment of size bytes
+size_t FragmentStore::slotSizeFor(size_t size) const {
+    size_t slotSize = blockSize / 8;
+    while (slotSize < size) {
+        slotSize *= 2;
+    }
+    return slotSize;
+}
+
+// Helper function to get a pack block's contents through the cache
+std::vector<char>& FragmentStore::loadBlock(uint32_t blockNumber) {
+    auto it = cached.find(blockNumber);
+    if (it != cached.end()) {
+        ++cacheHits;
+        lru.splice(lru.begin(), lru, it->second);
+        return it->second->second;
+    }
+    ++cacheMisses;
+    return cacheBlock(blockNumber, diskManager.readBlock(blockNumber));
+}
+
+// Helper function to put a pack block's contents in the cache
+std::vector<char>& FragmentStore::cacheBlock(uint32_t blockNumber, std::vector<char> contents) {
+    uncacheBlock(blockNumber);
+    if (cached.size() >= cacheCapacity) {
+        cached.erase(lru.back().first);
+        lru.pop_back();
+    }
+    lru.emplace_front(blockNumber, std::move(contents));
+    cached[blockNumber] = lru.begin();
+    return lru.front().second;
+}
+
+// Helper function to drop a pack block from the cache
+void FragmentStore::uncacheBlock(uint32_t blockNumber) {
+    auto it = cached.find(blockNumber);
+    if (it != cached.end()) {
+        lru.erase(it->second);
+        cached.erase(it);
+    }
+}
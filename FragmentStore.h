@@ -0,0 +1,103 @@
+#ifndef FRAGMENTSTORE_H
+#define FRAGMENTSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "DiskManager.h"
+#include "FreeBlockManager.h"
+
+// Where a small file is stored: a slot of a shared pack block
+struct Fragment {
+    uint32_t block = 0;
+    uint32_t slot = 0;
+};
+
+// Tail packing for small files: a file of at most half a block is stored as a fragment in a
+// slot of a pack block shared with other small files, instead of taking a block of its own.
+// Slots come in three sizes (1/8, 1/4 and 1/2 of a block); a pack block holds slots of one
+// size, and a fragment takes the smallest size it fits in, so the size follows from the file
+// size. Each fragment holds one reference to its pack block in the FreeBlockManager, so the
+// block is freed with its last fragment and fsck sees an ordinary shared data block.
+//
+// The slots in use are not stored on disk: LLFS rebuilds them from the inodes at mount. A
+// fragment is written by rewriting its pack block in place, under the store's mutex, and a
+// freed slot is not reused before releaseHeldSlots (at the next commit), so a crash never finds
+// a committed fragment overwritten. Pack blocks are cached whole with LRU eviction, so small
+// files packed together are read from the disk once. Safe to use from several threads.
+class FragmentStore {
+public:
+    // Constructor; cacheCapacity is counted in pack blocks
+    FragmentStore(DiskManager& diskManager, FreeBlockManager& freeBlockManager, size_t cacheCapacity = 64);
+
+    // Largest file that is packed (half a block)
+    size_t getMaxFragmentSize() const;
+
+    // Store size bytes (1 to getMaxFragmentSize()) in a free slot of the right size, allocating
+    // a pack block if none has one
+    Fragment store(const char* data, size_t size);
+
+    // Read a fragment of size bytes
+    std::vector<char> read(const Fragment& fragment, size_t size);
+
+    // Free a fragment; its slot is reused after releaseHeldSlots
+    void release(const Fragment& fragment);
+
+    // Make the slots freed so far reusable, freeing the pack blocks left empty (once the inodes
+    // that used them no longer do on disk, or are about to stop in the same commit)
+    void releaseHeldSlots();
+
+    // Record a fragment found in an inode (when rebuilding after a mount)
+    void addFragment(const Fragment& fragment, size_t size);
+
+    // Forget every fragment and the cache (before a format or a mount)
+    void clear();
+
+    // Statistics
+    size_t getFragments() const;
+    size_t getPackBlocks() const;
+    size_t getCacheHits() const;
+    size_t getCacheMisses() const;
+
+private:
+    struct PackBlock {
+        size_t slotSize = 0;
+        uint8_t used = 0;           // Slots in use or held, one bit each
+    };
+
+    DiskManager& diskManager;
+    FreeBlockManager& freeBlockManager;
+    size_t blockSize;
+    size_t cacheCapacity;
+
+    mutable std::mutex mutex;       // Guards everything below
+    std::unordered_map<uint32_t, PackBlock> packBlocks;
+    std::unordered_map<size_t, std::set<uint32_t>> partialBlocks; // Slot size -> blocks with a free slot
+    std::vector<Fragment> heldSlots;
+    size_t fragments = 0;
+    size_t cacheHits = 0;
+    size_t cacheMisses = 0;
+
+    std::list<std::pair<uint32_t, std::vector<char>>> lru; // Most recently used first
+    std::unordered_map<uint32_t, std::list<std::pair<uint32_t, std::vector<char>>>::iterator> cached;
+
+    // Helper function to get the slot size for a fragment of size bytes
+    size_t slotSizeFor(size_t size) const;
+
+    // Helper function to get a pack block's contents through the cache (mutex held)
+    std::vector<char>& loadBlock(uint32_t blockNumber);
+
+    // Helper function to put a pack block's contents in the cache (mutex held)
+    std::vector<char>& cacheBlock(uint32_t blockNumber, std::vector<char> contents);
+
+    // Helper function to drop a pack block from the cache (mutex held)
+    void uncacheBlock(uint32_t blockNumber);
+};
+
+#endif // FRAGMENTSTORE_H
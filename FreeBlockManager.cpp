@@ -1,40 +1,119 @@
 #include "FreeBlockManager.h"
+#include <algorithm>
+#include <bit>
+#include <utility>
 
 // Constructor
-FreeBlockManager::FreeBlockManager(size_t totalBlocks)
-    : totalBlocks(totalBlocks), bitmap((totalBlocks + 7) / 8, 0xFF) {
-    // Mark blocks 0 through 9 as reserved (not free)
-    for (size_t i = 0; i < 10; ++i) {
+FreeBlockManager::FreeBlockManager(size_t totalBlocks, size_t reservedBlocks)
+    : totalBlocks(totalBlocks), bitmap((totalBlocks + 7) / 8, 0xFF), pinned(bitmap.size(), 0),
+      groups((totalBlocks + GROUP_BLOCKS - 1) / GROUP_BLOCKS) {
+    if (reservedBlocks > totalBlocks) {
+        throw std::invalid_argument("Reserved blocks exceed total blocks.");
+    }
+    // Mark the reserved metadata blocks as not free
+    for (size_t i = 0; i < reservedBlocks; ++i) {
         bitmap[i / 8] &= ~(1 << (i % 8));
     }
+    for (size_t group = 0; group < groups.size(); ++group) {
+        groups[group].freeBlocks = countFree(group);
+    }
 }
 
-// Allocate the next free block
+// Allocate the first free block, skipping groups other threads are allocating from
 int FreeBlockManager::allocateBlock() {
-    for (size_t i = 0; i < totalBlocks; ++i) {
-        if (isBlockFree(i)) {
-            bitmap[i / 8] &= ~(1 << (i % 8)); // Mark block as allocated
-            return static_cast<int>(i);
+    return takeBlock(false);
+}
+
+// Drop one reference to a block; it is only freed once its last reference goes
+bool FreeBlockManager::freeBlock(size_t blockNumber) {
+    checkBlockNumber(blockNumber);
+    std::unique_lock<std::mutex> references(referenceMutex);
+    auto shared = extraReferences.find(static_cast<uint32_t>(blockNumber));
+    if (shared != extraReferences.end()) {
+        --sharedReferences;
+        if (--shared->second == 0) {
+            extraReferences.erase(shared);
         }
+        return false;
     }
-    throw std::runtime_error("No free blocks available.");
+    bool held = holding;
+    if (held) {
+        heldBlocks.push_back(static_cast<uint32_t>(blockNumber));
+    }
+    references.unlock();
+    if (!held) {
+        markFree(blockNumber);
+    }
+    if (freeHook) { // Outside the group lock: the hook may take locks of its own
+        freeHook(blockNumber);
+    }
+    return true;
 }
 
-// Free a specific block
-void FreeBlockManager::freeBlock(size_t blockNumber) {
-    checkBlockNumber(blockNumber);
-    bitmap[blockNumber / 8] |= (1 << (blockNumber % 8)); // Mark block as free
+// Add a reference to an allocated block
+void FreeBlockManager::addReference(size_t blockNumber) {
+    if (isBlockFree(blockNumber)) {
+        throw std::runtime_error("Cannot share a free block.");
+    }
+    std::lock_guard<std::mutex> lock(referenceMutex);
+    ++extraReferences[static_cast<uint32_t>(blockNumber)];
+    ++sharedReferences;
+}
+
+// Get the number of references to a block (0 if it is free)
+uint32_t FreeBlockManager::getReferenceCount(size_t blockNumber) const {
+    if (isBlockFree(blockNumber)) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(referenceMutex);
+    auto shared = extraReferences.find(static_cast<uint32_t>(blockNumber));
+    return shared == extraReferences.end() ? 1 : shared->second + 1;
+}
+
+// Set the number of references to an allocated block
+void FreeBlockManager::setReferenceCount(size_t blockNumber, uint32_t count) {
+    if (count == 0 || isBlockFree(blockNumber)) {
+        throw std::invalid_argument("Reference counts are only kept for allocated blocks.");
+    }
+    std::lock_guard<std::mutex> lock(referenceMutex);
+    uint32_t& extra = extraReferences[static_cast<uint32_t>(blockNumber)];
+    sharedReferences = sharedReferences - extra + (count - 1);
+    extra = count - 1;
+    if (extra == 0) {
+        extraReferences.erase(static_cast<uint32_t>(blockNumber));
+    }
+}
+
+// Forget every shared reference
+void FreeBlockManager::clearReferences() {
+    std::lock_guard<std::mutex> lock(referenceMutex);
+    extraReferences.clear();
+    sharedReferences = 0;
+}
+
+// Get the number of references beyond the first, over all blocks
+size_t FreeBlockManager::getSharedReferences() const {
+    std::lock_guard<std::mutex> lock(referenceMutex);
+    return sharedReferences;
 }
 
 // Check if a block is free
 bool FreeBlockManager::isBlockFree(size_t blockNumber) const {
     checkBlockNumber(blockNumber);
+    std::lock_guard<std::mutex> lock(groups[blockNumber / GROUP_BLOCKS].mutex);
     return (bitmap[blockNumber / 8] & (1 << (blockNumber % 8))) != 0;
 }
 
 // Get the free block vector as raw data
 std::vector<uint8_t> FreeBlockManager::getFreeBlockVector() const {
-    return bitmap;
+    std::vector<uint8_t> data(bitmap.size());
+    for (size_t group = 0; group < groups.size(); ++group) {
+        std::lock_guard<std::mutex> lock(groups[group].mutex);
+        size_t first = group * GROUP_BLOCKS / 8;
+        size_t last = std::min(bitmap.size(), first + GROUP_BLOCKS / 8);
+        std::copy(bitmap.begin() + first, bitmap.begin() + last, data.begin() + first);
+    }
+    return data;
 }
 
 // Load the free block vector from raw data
@@ -42,7 +121,95 @@ void FreeBlockManager::loadFreeBlockVector(const std::vector<uint8_t>& data) {
     if (data.size() != bitmap.size()) {
         throw std::invalid_argument("Invalid free block vector size.");
     }
-    bitmap = data;
+    for (size_t group = 0; group < groups.size(); ++group) {
+        std::lock_guard<std::mutex> lock(groups[group].mutex);
+        size_t first = group * GROUP_BLOCKS / 8;
+        size_t last = std::min(bitmap.size(), first + GROUP_BLOCKS / 8);
+        std::copy(data.begin() + first, data.begin() + last, bitmap.begin() + first);
+        groups[group].freeBlocks = countFree(group);
+    }
+    clearReferences(); // Counts are rebuilt from the inodes that point at the blocks
+}
+
+// Keep the blocks freed from now on allocated until releaseHeldBlocks
+void FreeBlockManager::holdFreedBlocks() {
+    std::lock_guard<std::mutex> lock(referenceMutex);
+    holding = true;
+}
+
+// Free the held blocks and stop holding
+void FreeBlockManager::releaseHeldBlocks() {
+    std::vector<uint32_t> blocks;
+    {
+        std::lock_guard<std::mutex> lock(referenceMutex);
+        holding = false;
+        blocks.swap(heldBlocks);
+    }
+    releaseBlocks(blocks);
+}
+
+// Take the blocks held so far off the held list, still allocated, and keep holding
+std::vector<uint32_t> FreeBlockManager::takeHeldBlocks() {
+    std::lock_guard<std::mutex> lock(referenceMutex);
+    return std::exchange(heldBlocks, {});
+}
+
+// Free blocks taken with takeHeldBlocks
+void FreeBlockManager::releaseBlocks(const std::vector<uint32_t>& blocks) {
+    for (uint32_t block : blocks) {
+        markFree(block);
+    }
+}
+
+// Get the number of blocks held
+size_t FreeBlockManager::getHeldBlocks() const {
+    std::lock_guard<std::mutex> lock(referenceMutex);
+    return heldBlocks.size();
+}
+
+// Replace the pinned blocks (one bit per block, set = pinned)
+void FreeBlockManager::setPinnedBlocks(const std::vector<uint8_t>& pins) {
+    if (pins.size() != pinned.size()) {
+        throw std::invalid_argument("Invalid pinned block vector size.");
+    }
+    for (size_t group = 0; group < groups.size(); ++group) {
+        std::lock_guard<std::mutex> lock(groups[group].mutex);
+        size_t first = group * GROUP_BLOCKS / 8;
+        size_t last = std::min(pinned.size(), first + GROUP_BLOCKS / 8);
+        std::copy(pins.begin() + first, pins.begin() + last, pinned.begin() + first);
+        groups[group].freeBlocks = countFree(group);
+    }
+}
+
+// Pin a free block and return it; the block stays free in the bitmap
+int FreeBlockManager::pinFreeBlock() {
+    return takeBlock(true);
+}
+
+// Check if a block is pinned
+bool FreeBlockManager::isBlockPinned(size_t blockNumber) const {
+    checkBlockNumber(blockNumber);
+    std::lock_guard<std::mutex> lock(groups[blockNumber / GROUP_BLOCKS].mutex);
+    return (pinned[blockNumber / 8] & (1 << (blockNumber % 8))) != 0;
+}
+
+// Get the number of pinned blocks
+size_t FreeBlockManager::getPinnedBlocks() const {
+    size_t count = 0;
+    for (size_t group = 0; group < groups.size(); ++group) {
+        std::lock_guard<std::mutex> lock(groups[group].mutex);
+        size_t first = group * GROUP_BLOCKS / 8;
+        size_t last = std::min(pinned.size(), first + GROUP_BLOCKS / 8);
+        for (size_t byte = first; byte < last; ++byte) {
+            count += std::popcount(pinned[byte]);
+        }
+    }
+    return count;
+}
+
+// Called with every block freeBlock frees
+void FreeBlockManager::setFreeHook(std::function<void(size_t)> hook) {
+    freeHook = std::move(hook);
 }
 
 // Helper function to check bounds
@@ -51,3 +218,70 @@ void FreeBlockManager::checkBlockNumber(size_t blockNumber) const {
         throw std::out_of_range("Block number out of range.");
     }
 }
+
+// Helper function to set a block's bit in the bitmap
+void FreeBlockManager::markFree(size_t blockNumber) {
+    Group& group = groups[blockNumber / GROUP_BLOCKS];
+    std::lock_guard<std::mutex> lock(group.mutex);
+    if (!(bitmap[blockNumber / 8] & (1 << (blockNumber % 8)))) {
+        bitmap[blockNumber / 8] |= (1 << (blockNumber % 8)); // Mark block as free
+        if (!(pinned[blockNumber / 8] & (1 << (blockNumber % 8)))) {
+            ++group.freeBlocks;
+        }
+    }
+}
+
+// Helper function to take the first free block, skipping groups other threads are using
+int FreeBlockManager::takeBlock(bool pin) {
+    // A busy group is only waited for once every other group turned out to be full
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t group = 0; group < groups.size(); ++group) {
+            if (groups[group].freeBlocks.load(std::memory_order_relaxed) == 0) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(groups[group].mutex, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                if (pass == 0) continue;
+                lock.lock();
+            }
+            int block = allocateInGroup(group, pin);
+            if (block >= 0) {
+                return block;
+            }
+        }
+    }
+    throw std::runtime_error("No free blocks available.");
+}
+
+// Helper function to take the first free block of a group (group lock held; -1 if full)
+int FreeBlockManager::allocateInGroup(size_t group, bool pin) {
+    size_t first = group * GROUP_BLOCKS / 8;
+    size_t last = std::min(bitmap.size(), first + GROUP_BLOCKS / 8);
+    for (size_t byte = first; byte < last; ++byte) {
+        uint8_t available = bitmap[byte] & ~pinned[byte];
+        if (available == 0) {
+            continue; // Eight allocated or pinned blocks
+        }
+        size_t block = byte * 8 + std::countr_zero(available);
+        if (block >= totalBlocks) {
+            break; // Padding bits of the last byte
+        }
+        if (pin) {
+            pinned[byte] |= (1 << (block % 8));
+        } else {
+            bitmap[byte] &= ~(1 << (block % 8)); // Mark block as allocated
+        }
+        --groups[group].freeBlocks;
+        return static_cast<int>(block);
+    }
+    return -1;
+}
+
+// Helper function to count the free, unpinned blocks of a group (group lock held)
+uint32_t FreeBlockManager::countFree(size_t group) const {
+    uint32_t count = 0;
+    for (size_t block = group * GROUP_BLOCKS; block < std::min(totalBlocks, (group + 1) * GROUP_BLOCKS); ++block) {
+        count += ((bitmap[block / 8] & ~pinned[block / 8]) >> (block % 8)) & 1;
+    }
+    return count;
+}
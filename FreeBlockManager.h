@@ -4,17 +4,43 @@
 #include <vector>
 #include <stdexcept>
 #include <cstdint>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 
+// Block allocator over the free block vector. The bitmap is split into groups with a lock each;
+// an allocation takes the first free block in the first group no other thread holds, so
+// concurrent writers allocate from different groups. Safe to use from several threads.
 class FreeBlockManager {
 public:
-    // Constructor
-    FreeBlockManager(size_t totalBlocks);
+    // Blocks per allocation group (the bitmap bytes of a group share a lock)
+    static constexpr size_t GROUP_BLOCKS = 512;
 
-    // Allocate the next free block
+    // Constructor; blocks below reservedBlocks hold metadata and are never handed out
+    FreeBlockManager(size_t totalBlocks, size_t reservedBlocks = 10);
+
+    // Allocate the first free block, skipping groups other threads are allocating from
     int allocateBlock();
 
-    // Free a specific block
-    void freeBlock(size_t blockNumber);
+    // Drop one reference to a block; it is only freed once its last reference goes. Returns
+    // whether it was freed
+    bool freeBlock(size_t blockNumber);
+
+    // Add a reference to an allocated block (deduplicated blocks are shared by several files)
+    void addReference(size_t blockNumber);
+
+    // Get the number of references to a block (0 if it is free)
+    uint32_t getReferenceCount(size_t blockNumber) const;
+
+    // Set the number of references to an allocated block (rebuilt from the inodes at mount)
+    void setReferenceCount(size_t blockNumber, uint32_t count);
+
+    // Forget every shared reference (each allocated block is back to one)
+    void clearReferences();
+
+    // Get the number of references beyond the first, over all blocks
+    size_t getSharedReferences() const;
 
     // Check if a block is free
     bool isBlockFree(size_t blockNumber) const;
@@ -25,12 +51,75 @@ public:
     // Load the free block vector from raw data (for restoring from disk)
     void loadFreeBlockVector(const std::vector<uint8_t>& data);
 
+    // Keep the blocks freed from now on allocated until releaseHeldBlocks, so they are not
+    // reused while the state on disk may still point at them (freeBlock still reports them
+    // freed and calls the free hook)
+    void holdFreedBlocks();
+
+    // Free the held blocks and stop holding
+    void releaseHeldBlocks();
+
+    // Take the blocks held so far off the held list, still allocated, and keep holding: they
+    // are freed with releaseBlocks once the state that stopped using them is durable
+    std::vector<uint32_t> takeHeldBlocks();
+
+    // Free blocks taken with takeHeldBlocks
+    void releaseBlocks(const std::vector<uint32_t>& blocks);
+
+    // Get the number of blocks held
+    size_t getHeldBlocks() const;
+
+    // Replace the pinned blocks (one bit per block, set = pinned): pinned blocks are never
+    // handed out, even once freed, because a snapshot still uses them
+    void setPinnedBlocks(const std::vector<uint8_t>& pins);
+
+    // Pin a free block and return it; the block stays free in the bitmap (a snapshot keeps its
+    // own copies of blocks there)
+    int pinFreeBlock();
+
+    // Check if a block is pinned
+    bool isBlockPinned(size_t blockNumber) const;
+
+    // Get the number of pinned blocks
+    size_t getPinnedBlocks() const;
+
+    // Called with every block freeBlock frees (LFS mode drops the block from the log, dedup
+    // mode from the fingerprint index)
+    void setFreeHook(std::function<void(size_t)> hook);
+
 private:
+    struct Group {
+        std::mutex mutex;                   // Guards the group's bytes of the bitmap
+        std::atomic<uint32_t> freeBlocks{0}; // Free and not pinned; read without the lock to skip
+                                             // full groups
+    };
+
     size_t totalBlocks;           // Total number of blocks in the system
     std::vector<uint8_t> bitmap;  // Bitmap for free/allocated blocks
+    std::vector<uint8_t> pinned;  // Blocks kept for snapshots (guarded by the group locks)
+    mutable std::vector<Group> groups;
+    std::function<void(size_t)> freeHook;
+    mutable std::mutex referenceMutex;                      // Guards the four below
+    std::unordered_map<uint32_t, uint32_t> extraReferences; // References beyond the first, shared blocks only
+    size_t sharedReferences = 0;                            // Sum of extraReferences
+    bool holding = false;                                   // Freed blocks go to heldBlocks
+    std::vector<uint32_t> heldBlocks;
 
     // Helper function to check bounds
     void checkBlockNumber(size_t blockNumber) const;
+
+    // Helper function to set a block's bit in the bitmap
+    void markFree(size_t blockNumber);
+
+    // Helper function to take the first free block, skipping groups other threads are using
+    int takeBlock(bool pin);
+
+    // Helper function to take the first free block of a group (group lock held; -1 if full);
+    // with pin, the block stays free in the bitmap and is pinned instead
+    int allocateInGroup(size_t group, bool pin = false);
+
+    // Helper function to count the free, unpinned blocks of a group (group lock held)
+    uint32_t countFree(size_t group) const;
 };
 
 #endif // FREEBLOCKMANAGER_H
@@ -0,0 +1,286 @@
+#include "InodeCache.h"
+#include "InodeManager.h"
+#include "DiskManager.h"
+#include <algorithm>
+#include <cstring> // For memcpy
+
+struct InodeCache::Entry {
+    size_t inodeId;
+    Inode inode;
+    uint32_t refCount = 0;                 // Number of live handles
+    bool dirty = false;                    // Modified since it was last written back
+    bool inLru = false;                    // Whether lruPosition is valid
+    std::list<Entry*>::iterator lruPosition;
+};
+
+// Constructor
+InodeCache::InodeCache(DiskManager* diskManager, size_t inodeTableStart, size_t totalInodes, size_t capacity)
+    : diskManager(diskManager), inodeTableStart(inodeTableStart), totalInodes(totalInodes),
+      capacity(capacity), inodesPerBlock(0) {
+    if (diskManager) {
+        inodesPerBlock = diskManager->getBlockSize() / sizeof(Inode);
+        if (inodesPerBlock == 0) {
+            throw std::invalid_argument("Block size is too small to hold an inode.");
+        }
+    }
+}
+
+InodeCache::~InodeCache() = default;
+
+// Get a handle to an inode, loading it from the inode table on a miss
+InodeHandle InodeCache::acquire(size_t inodeId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry* entry = obtain(inodeId, true);
+    InodeHandle handle(this, entry);
+    evict();
+    return handle;
+}
+
+// Replace the contents of an inode and mark it dirty
+void InodeCache::store(size_t inodeId, const Inode& inode) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry* entry = obtain(inodeId, false);
+    entry->inode = inode;
+    entry->dirty = true;
+
+    // A memory-only cache has nothing to write back to, so only unused inodes are clean
+    if (!diskManager && inode.fileType == 0) {
+        entry->dirty = false;
+    }
+
+    if (entry->refCount == 0) {
+        makeEvictable(entry);
+    }
+    evict();
+}
+
+// Get a copy of an inode, loading it from the inode table on a miss
+Inode InodeCache::get(size_t inodeId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry* entry = obtain(inodeId, true);
+    Inode inode = entry->inode;
+    if (entry->refCount == 0) {
+        makeEvictable(entry);
+    }
+    evict();
+    return inode;
+}
+
+// Read an inode without making it resident
+Inode InodeCache::peek(size_t inodeId) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(inodeId);
+    if (it != entries.end()) {
+        return it->second->inode;
+    }
+    Inode inode = {};
+    readInode(inodeId, inode);
+    return inode;
+}
+
+// Write all dirty inodes back to the inode table
+void InodeCache::flush() {
+    if (!diskManager) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Entry*> dirtyEntries;
+    for (auto& [id, entry] : entries) {
+        if (entry->dirty) {
+            dirtyEntries.push_back(entry.get());
+        }
+    }
+    writeBack(dirtyEntries);
+
+    // Everything is clean now, so unreferenced entries can be evicted again
+    evict();
+}
+
+// Drop every resident inode without writing it back
+void InodeCache::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& [id, entry] : entries) {
+        if (entry->refCount != 0) {
+            throw std::runtime_error("Cannot invalidate the inode cache while handles are held.");
+        }
+    }
+    lru.clear();
+    entries.clear();
+}
+
+size_t InodeCache::getResidentCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t InodeCache::getCapacity() const {
+    return capacity;
+}
+
+size_t InodeCache::getHits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+size_t InodeCache::getMisses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+// Find a resident entry or bring it in (reading the table only when load is set)
+InodeCache::Entry* InodeCache::obtain(size_t inodeId, bool load) {
+    auto it = entries.find(inodeId);
+    if (it != entries.end()) {
+        ++hits;
+        Entry* entry = it->second.get();
+        if (entry->inLru) {
+            // Refresh its position; the caller decides whether it stays evictable
+            lru.erase(entry->lruPosition);
+            entry->inLru = false;
+        }
+        return entry;
+    }
+
+    ++misses;
+    auto entry = std::make_unique<Entry>();
+    entry->inodeId = inodeId;
+    entry->inode = {};
+    if (load) {
+        readInode(inodeId, entry->inode);
+    }
+
+    Entry* raw = entry.get();
+    entries.emplace(inodeId, std::move(entry));
+    return raw;
+}
+
+// Drop a reference taken by a handle; eviction is left to the next acquire or store
+// so that releasing a handle never performs I/O
+void InodeCache::release(Entry* entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--entry->refCount == 0) {
+        makeEvictable(entry);
+    }
+}
+
+// Put an unreferenced entry at the back of the LRU list if it may be evicted
+void InodeCache::makeEvictable(Entry* entry) {
+    if (entry->inLru) {
+        lru.erase(entry->lruPosition);
+        entry->inLru = false;
+    }
+    // Without a backing table, dirty inodes have to stay resident
+    if (entry->dirty && !diskManager) {
+        return;
+    }
+    entry->lruPosition = lru.insert(lru.end(), entry);
+    entry->inLru = true;
+}
+
+// Evict unreferenced entries until the cache is within capacity
+void InodeCache::evict() {
+    if (entries.size() <= capacity) {
+        return;
+    }
+
+    // Pick victims from the cold end of the LRU list
+    std::vector<Entry*> victims;
+    std::vector<Entry*> dirtyVictims;
+    size_t excess = entries.size() - capacity;
+    for (auto it = lru.begin(); it != lru.end() && victims.size() < excess; ++it) {
+        victims.push_back(*it);
+        if ((*it)->dirty) {
+            dirtyVictims.push_back(*it);
+        }
+    }
+
+    // Dirty victims are written back in one batch before they are dropped
+    writeBack(dirtyVictims);
+
+    for (Entry* victim : victims) {
+        lru.erase(victim->lruPosition);
+        entries.erase(victim->inodeId);
+    }
+}
+
+// Read one inode from the on-disk table
+void InodeCache::readInode(size_t inodeId, Inode& inode) const {
+    if (!diskManager) {
+        inode = {};
+        return;
+    }
+    std::vector<char> block = diskManager->readBlock(inodeTableStart + inodeId / inodesPerBlock);
+    std::memcpy(&inode, block.data() + (inodeId % inodesPerBlock) * sizeof(Inode), sizeof(Inode));
+}
+
+// Write the given entries back, one read-modify-write per inode table block
+void InodeCache::writeBack(std::vector<Entry*>& dirtyEntries) {
+    if (!diskManager || dirtyEntries.empty()) {
+        return;
+    }
+
+    std::sort(dirtyEntries.begin(), dirtyEntries.end(),
+              [](const Entry* a, const Entry* b) { return a->inodeId < b->inodeId; });
+
+    size_t i = 0;
+    while (i < dirtyEntries.size()) {
+        size_t tableBlock = dirtyEntries[i]->inodeId / inodesPerBlock;
+        std::vector<char> block = diskManager->readBlock(inodeTableStart + tableBlock);
+
+        for (; i < dirtyEntries.size() && dirtyEntries[i]->inodeId / inodesPerBlock == tableBlock; ++i) {
+            Entry* entry = dirtyEntries[i];
+            std::memcpy(block.data() + (entry->inodeId % inodesPerBlock) * sizeof(Inode),
+                        &entry->inode, sizeof(Inode));
+            entry->dirty = false;
+        }
+
+        diskManager->writeMetadataBlock(inodeTableStart + tableBlock, block);
+    }
+}
+
+// InodeHandle
+
+// Called by the cache with its mutex held
+InodeHandle::InodeHandle(InodeCache* cache, InodeCache::Entry* entry)
+    : cache(cache), entry(entry) {
+    ++entry->refCount;
+}
+
+InodeHandle::InodeHandle(const InodeHandle& other)
+    : cache(other.cache), entry(other.entry) {
+    if (entry) {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        ++entry->refCount;
+    }
+}
+
+InodeHandle::InodeHandle(InodeHandle&& other) noexcept
+    : cache(other.cache), entry(other.entry) {
+    other.cache = nullptr;
+    other.entry = nullptr;
+}
+
+InodeHandle& InodeHandle::operator=(InodeHandle other) noexcept {
+    std::swap(cache, other.cache);
+    std::swap(entry, other.entry);
+    return *this;
+}
+
+InodeHandle::~InodeHandle() {
+    if (entry) {
+        cache->release(entry);
+    }
+}
+
+const Inode& InodeHandle::operator*() const {
+    return entry->inode;
+}
+
+const Inode* InodeHandle::operator->() const {
+    return &entry->inode;
+}
+
+size_t InodeHandle::getId() const {
+    return entry->inodeId;
+}
@@ -0,0 +1,117 @@
+#ifndef INODECACHE_H
+#define INODECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct Inode;
+class DiskManager;
+class InodeHandle;
+
+class InodeCache {
+public:
+    // Constructor; without a disk manager the cache has no backing inode table and
+    // keeps modified inodes resident
+    InodeCache(DiskManager* diskManager, size_t inodeTableStart, size_t totalInodes, size_t capacity);
+
+    // Destructor; outstanding handles must be released before the cache is destroyed
+    ~InodeCache();
+
+    // Get a handle to an inode, loading it from the inode table on a miss
+    InodeHandle acquire(size_t inodeId);
+
+    // Replace the contents of an inode and mark it dirty
+    void store(size_t inodeId, const Inode& inode);
+
+    // Get a copy of an inode, loading it from the inode table on a miss
+    Inode get(size_t inodeId);
+
+    // Read an inode without making it resident
+    Inode peek(size_t inodeId) const;
+
+    // Write all dirty inodes back to the inode table
+    void flush();
+
+    // Drop every resident inode without writing it back (after the table was rewritten on disk)
+    void invalidate();
+
+    // Number of inodes currently held in memory
+    size_t getResidentCount() const;
+
+    // Maximum number of unreferenced inodes kept in memory
+    size_t getCapacity() const;
+
+    // Lookup statistics
+    size_t getHits() const;
+    size_t getMisses() const;
+
+private:
+    friend class InodeHandle;
+    struct Entry;
+
+    DiskManager* diskManager;   // Backing store (null for memory-only caches)
+    size_t inodeTableStart;     // First block of the on-disk inode table
+    size_t totalInodes;         // Number of inodes in the table
+    size_t capacity;            // Resident inode limit
+    size_t inodesPerBlock;      // Inodes stored in each inode table block
+    size_t hits = 0;
+    size_t misses = 0;
+    mutable std::mutex mutex;   // Guards the entries, the LRU list, reference counts and statistics;
+                                // a handle reads its inode without it, so handles are only used
+                                // while the inode cannot change (LLFS holds the inode's lock, or
+                                // the namespace lock exclusively); other readers copy with get()
+
+    std::unordered_map<size_t, std::unique_ptr<Entry>> entries; // Resident inodes by ID
+    std::list<Entry*> lru;      // Unreferenced entries, least recently used first
+
+    // Find a resident entry or bring it in (reading the table only when load is set)
+    Entry* obtain(size_t inodeId, bool load);
+
+    // Drop a reference taken by a handle
+    void release(Entry* entry);
+
+    // Put an unreferenced entry at the back of the LRU list if it may be evicted
+    void makeEvictable(Entry* entry);
+
+    // Evict unreferenced entries until the cache is within capacity
+    void evict();
+
+    // Read one inode from the on-disk table
+    void readInode(size_t inodeId, Inode& inode) const;
+
+    // Write the given entries back, one read-modify-write per inode table block
+    void writeBack(std::vector<Entry*>& dirtyEntries);
+};
+
+// Reference-counted handle to a cached inode; the inode stays resident while any handle exists
+class InodeHandle {
+public:
+    InodeHandle() = default;
+    InodeHandle(const InodeHandle& other);
+    InodeHandle(InodeHandle&& other) noexcept;
+    InodeHandle& operator=(InodeHandle other) noexcept;
+    ~InodeHandle();
+
+    // Access the cached inode (read-only; use InodeManager::updateInode to modify)
+    const Inode& operator*() const;
+    const Inode* operator->() const;
+
+    // Inode ID this handle refers to
+    size_t getId() const;
+
+    explicit operator bool() const { return entry != nullptr; }
+
+private:
+    friend class InodeCache;
+    InodeHandle(InodeCache* cache, InodeCache::Entry* entry);
+
+    InodeCache* cache = nullptr;
+    InodeCache::Entry* entry = nullptr;
+};
+
+#endif // INODECACHE_H
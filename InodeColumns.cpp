@@ -0,0 +1,52 @@
+#include "InodeColumns.h"
+#include "InodeManager.h"
+
+// Constructor; every inode starts unused
+InodeColumns::InodeColumns(size_t totalInodes)
+    : fileSizes(totalInodes, 0), fileTypes(totalInodes, 0), modificationTimes(totalInodes, 0) {}
+
+// Record the new contents of an inode
+void InodeColumns::update(size_t inodeId, const Inode& inode) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    uint32_t id = static_cast<uint32_t>(inodeId);
+    if (fileTypes[inodeId] != 0) {
+        byModificationTime.erase({modificationTimes[inodeId], id});
+    }
+
+    fileSizes[inodeId] = inode.fileSize;
+    fileTypes[inodeId] = inode.fileType;
+    modificationTimes[inodeId] = inode.modificationTime;
+
+    if (inode.fileType != 0) {
+        byModificationTime.insert({inode.modificationTime, id});
+    }
+}
+
+// Append the inodes modified at or after a time, oldest first
+void InodeColumns::modifiedSince(uint32_t time, std::vector<uint32_t>& inodeIds) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    for (auto it = byModificationTime.lower_bound({time, 0}); it != byModificationTime.end(); ++it) {
+        inodeIds.push_back(it->second);
+    }
+}
+
+// Hold off updates while a scan reads the columns
+std::shared_lock<std::shared_mutex> InodeColumns::lockShared() const {
+    return std::shared_lock<std::shared_mutex>(mutex);
+}
+
+size_t InodeColumns::size() const {
+    return fileTypes.size();
+}
+
+const uint32_t* InodeColumns::getFileSizes() const {
+    return fileSizes.data();
+}
+
+const uint8_t* InodeColumns::getFileTypes() const {
+    return fileTypes.data();
+}
+
+const uint32_t* InodeColumns::getModificationTimes() const {
+    return modificationTimes.data();
+}
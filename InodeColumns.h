@@ -0,0 +1,46 @@
+#ifndef INODECOLUMNS_H
+#define INODECOLUMNS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+struct Inode;
+
+// Column-oriented copy of the query-relevant inode fields (size, type, modification time),
+// kept in step with every inode update so metadata queries never touch the inode cache.
+// Also keeps allocated inodes ordered by modification time for "changed since" queries.
+// The columns are sized for the whole inode table, unused inodes included (9 bytes each), so
+// scans need no indirection.
+class InodeColumns {
+public:
+    // Constructor; every inode starts unused
+    explicit InodeColumns(size_t totalInodes);
+
+    // Record the new contents of an inode
+    void update(size_t inodeId, const Inode& inode);
+
+    // Append the inodes modified at or after a time, oldest first
+    void modifiedSince(uint32_t time, std::vector<uint32_t>& inodeIds) const;
+
+    // Hold off updates while a scan reads the columns
+    std::shared_lock<std::shared_mutex> lockShared() const;
+
+    // Column access for scans (hold lockShared while reading them)
+    size_t size() const;
+    const uint32_t* getFileSizes() const;
+    const uint8_t* getFileTypes() const;
+    const uint32_t* getModificationTimes() const;
+
+private:
+    std::vector<uint32_t> fileSizes;
+    std::vector<uint8_t> fileTypes;                       // 0 = unused
+    std::vector<uint32_t> modificationTimes;
+    std::set<std::pair<uint32_t, uint32_t>> byModificationTime; // (time, inode) of allocated inodes
+    mutable std::shared_mutex mutex; // Updates of different inodes may come from several threads
+};
+
+#endif // INODECOLUMNS_H
@@ -1,13 +1,23 @@
 #include "InodeManager.h"
-#include <iostream>
+#include "DiskManager.h"
+#include <algorithm>
+#include <cstring> // For memcpy
+#include "Logger.h"
 
-// Constructor
+// Constructor for an in-memory inode table
 InodeManager::InodeManager(size_t totalInodes)
-    : totalInodes(totalInodes), inodeBitmap(totalInodes, false), inodeTable(totalInodes) {
-    // Initialize all inodes as unused (type = 0)
-    for (auto& inode : inodeTable) {
-        inode.fileType = 0; // Mark as unused
-    }
+    : totalInodes(totalInodes), diskManager(nullptr), inodeTableStart(0),
+      inodeBitmap(totalInodes, false), inodeCache(nullptr, 0, totalInodes, totalInodes), columns(totalInodes) {
+    // All inodes start unused (type = 0); they are materialized on first access
+}
+
+// Constructor for an inode table stored on disk
+InodeManager::InodeManager(DiskManager& diskManager, size_t totalInodes, size_t inodeTableStart,
+                           size_t cacheCapacity)
+    : totalInodes(totalInodes), diskManager(&diskManager), inodeTableStart(inodeTableStart),
+      inodeBitmap(totalInodes, false),
+      inodeCache(&diskManager, inodeTableStart, totalInodes, cacheCapacity), columns(totalInodes) {
+    // Inodes are loaded on demand; call scanInodeTable() to pick up existing allocations
 }
 
 // Allocate an inode
@@ -15,13 +25,39 @@ int InodeManager::allocateInode() {
     for (size_t i = 0; i < totalInodes; ++i) {
         if (!inodeBitmap[i]) {
             inodeBitmap[i] = true; // Mark inode as allocated
-            inodeTable[i].fileType = 1; // Default to file type
+            Inode inode = {};
+            inode.fileType = 1; // Default to file type
+            inodeCache.store(i, inode);
+            columns.update(i, inode);
             return static_cast<int>(i); // Return inode ID
         }
     }
     throw std::runtime_error("No free inodes available.");
 }
 
+// Allocate count inodes with one scan of the bitmap
+std::vector<uint32_t> InodeManager::allocateInodes(size_t count) {
+    std::vector<uint32_t> inodeIds;
+    inodeIds.reserve(count);
+    for (size_t i = 0; i < totalInodes && inodeIds.size() < count; ++i) {
+        if (!inodeBitmap[i]) {
+            inodeIds.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    if (inodeIds.size() < count) {
+        throw std::runtime_error("No free inodes available.");
+    }
+
+    Inode inode = {};
+    inode.fileType = 1; // Default to file type
+    for (uint32_t inodeId : inodeIds) {
+        inodeBitmap[inodeId] = true;
+        inodeCache.store(inodeId, inode);
+        columns.update(inodeId, inode);
+    }
+    return inodeIds;
+}
+
 // Free an inode
 void InodeManager::freeInode(size_t inodeId) {
     checkInodeId(inodeId);
@@ -29,17 +65,32 @@ void InodeManager::freeInode(size_t inodeId) {
         throw std::runtime_error("Inode is already free.");
     }
     inodeBitmap[inodeId] = false;       // Mark as free
-    inodeTable[inodeId] = Inode();      // Reset inode data
-    inodeTable[inodeId].fileType = 0;   // Explicitly mark as unused
+    inodeCache.store(inodeId, Inode()); // Reset inode data (type 0 = unused)
+    columns.update(inodeId, Inode());
+}
+
+// Check whether an inode is allocated
+bool InodeManager::isAllocated(size_t inodeId) const {
+    checkInodeId(inodeId);
+    return inodeBitmap[inodeId];
+}
+
+// Get a handle to inode metadata without copying it
+InodeHandle InodeManager::acquireInode(size_t inodeId) {
+    checkInodeId(inodeId);
+    if (!inodeBitmap[inodeId]) {
+        throw std::runtime_error("Inode is not allocated.");
+    }
+    return inodeCache.acquire(inodeId);
 }
 
-// Get inode metadata
+// Get a copy of inode metadata
 Inode InodeManager::getInode(size_t inodeId) const {
     checkInodeId(inodeId);
     if (!inodeBitmap[inodeId]) {
         throw std::runtime_error("Inode is not allocated.");
     }
-    return inodeTable[inodeId];
+    return inodeCache.get(inodeId);
 }
 
 // Update inode metadata
@@ -48,14 +99,16 @@ void InodeManager::updateInode(size_t inodeId, const Inode& inode) {
     if (!inodeBitmap[inodeId]) {
         throw std::runtime_error("Inode is not allocated.");
     }
-    inodeTable[inodeId] = inode;
+    inodeCache.store(inodeId, inode);
+    columns.update(inodeId, inode);
 }
 
 // Save inode table to raw data
 std::vector<uint8_t> InodeManager::saveInodeTable() const {
     std::vector<uint8_t> data(totalInodes * sizeof(Inode));
     uint8_t* rawPtr = data.data();
-    for (const auto& inode : inodeTable) {
+    for (size_t i = 0; i < totalInodes; ++i) {
+        Inode inode = inodeCache.peek(i);
         std::memcpy(rawPtr, &inode, sizeof(Inode));
         rawPtr += sizeof(Inode);
     }
@@ -68,16 +121,45 @@ void InodeManager::loadInodeTable(const std::vector<uint8_t>& data) {
         throw std::invalid_argument("Invalid inode table size.");
     }
     const uint8_t* rawPtr = data.data();
-    for (auto& inode : inodeTable) {
+    for (size_t i = 0; i < totalInodes; ++i) {
+        Inode inode;
         std::memcpy(&inode, rawPtr, sizeof(Inode));
         rawPtr += sizeof(Inode);
+
+        // Update inodeBitmap based on file types
+        inodeBitmap[i] = inode.fileType != 0;
+        inodeCache.store(i, inode);
+        columns.update(i, inode);
     }
-    // Update inodeBitmap based on file types
-    for (size_t i = 0; i < totalInodes; ++i) {
-        inodeBitmap[i] = inodeTable[i].fileType != 0;
+}
+
+// Rebuild the allocation bitmap by streaming the on-disk inode table
+void InodeManager::scanInodeTable() {
+    if (!diskManager) {
+        return;
+    }
+
+    // The table on disk is authoritative; anything cached from before is stale
+    inodeCache.invalidate();
+
+    // Only the bitmap and query columns are kept; inodes themselves stay on disk until accessed
+    size_t inodesPerBlock = diskManager->getBlockSize() / sizeof(Inode);
+    for (size_t first = 0; first < totalInodes; first += inodesPerBlock) {
+        std::vector<char> block = diskManager->readBlock(inodeTableStart + first / inodesPerBlock);
+        for (size_t i = first; i < std::min(first + inodesPerBlock, totalInodes); ++i) {
+            Inode inode;
+            std::memcpy(&inode, block.data() + (i - first) * sizeof(Inode), sizeof(Inode));
+            inodeBitmap[i] = inode.fileType != 0;
+            columns.update(i, inode);
+        }
     }
 }
 
+// Write dirty inodes back to the on-disk inode table
+void InodeManager::flush() {
+    inodeCache.flush();
+}
+
 // Helper function to check inode ID bounds
 void InodeManager::checkInodeId(size_t inodeId) const {
     if (inodeId >= totalInodes) {
@@ -90,6 +172,16 @@ size_t InodeManager::getTotalInodes() const {
     return totalInodes;
 }
 
+// Get the inode cache (for statistics)
+const InodeCache& InodeManager::getCache() const {
+    return inodeCache;
+}
+
+// Get the column copy of inode sizes, types and times (for metadata queries)
+const InodeColumns& InodeManager::getColumns() const {
+    return columns;
+}
+
 void InodeManager::initializeRootInode() {
     if (!inodeBitmap[0]) {
         // Mark inode 0 as allocated
@@ -101,7 +193,8 @@ void InodeManager::initializeRootInode() {
         rootInode.fileSize = 0;
         std::fill(std::begin(rootInode.directBlocks), std::end(rootInode.directBlocks), 0);
 
-        inodeTable[0] = rootInode; // Save the root inode
-        std::cout << "Root inode initialized in InodeManager.\n";
+        inodeCache.store(0, rootInode); // Save the root inode
+        columns.update(0, rootInode);
+        LLFS_LOG_INFO("InodeManager", "Root inode initialized");
     }
 }
@@ -5,26 +5,53 @@
 #include <cstdint>
 #include <stdexcept>
 
+#include "InodeCache.h"
+#include "InodeColumns.h"
+
+class DiskManager;
+
+// Inode flags
+constexpr uint8_t INODE_FLAG_HTREE = 0x01; // Directory blocks form a hashed B+tree
+constexpr uint8_t INODE_FLAG_COMPRESSED = 0x02; // File data is stored in compressed clusters
+constexpr uint8_t INODE_FLAG_PACKED = 0x04; // A small file in a slot of the pack block directBlocks[0]
+constexpr uint8_t INODE_SLOT_SHIFT = 4;     // ... the slot, in the flag bits from here up
+
 struct Inode {
     uint32_t fileSize;          // File size in bytes
     uint8_t fileType;           // 0 = unused, 1 = file, 2 = directory
+    uint8_t flags;              // INODE_FLAG_* bits
     uint16_t directBlocks[10];  // Direct block pointers
     uint16_t singleIndirect;    // Single indirect block pointer
     uint16_t doubleIndirect;    // Double indirect block pointer
+    uint32_t modificationTime;  // Last data or entry change, seconds since the epoch
 };
 
 class InodeManager {
 public:
-    // Constructor
+    // Constructor for an in-memory inode table
     InodeManager(size_t totalInodes);
 
+    // Constructor for an inode table stored on disk; at most cacheCapacity unreferenced
+    // inodes are kept in memory
+    InodeManager(DiskManager& diskManager, size_t totalInodes, size_t inodeTableStart,
+                 size_t cacheCapacity = 1024);
+
     // Allocate an inode
     int allocateInode();
 
+    // Allocate count inodes with one scan of the bitmap; allocates none if there are too few
+    std::vector<uint32_t> allocateInodes(size_t count);
+
     // Free an inode
     void freeInode(size_t inodeId);
 
-    // Get inode metadata
+    // Check whether an inode is allocated
+    bool isAllocated(size_t inodeId) const;
+
+    // Get a handle to inode metadata without copying it (only while the inode cannot change)
+    InodeHandle acquireInode(size_t inodeId);
+
+    // Get a copy of inode metadata
     Inode getInode(size_t inodeId) const;
 
     // Update inode metadata
@@ -36,15 +63,30 @@ public:
     // Load inode table from raw data (for restoring from disk)
     void loadInodeTable(const std::vector<uint8_t>& data);
 
+    // Rebuild the allocation bitmap by streaming the on-disk inode table (discards cached inodes)
+    void scanInodeTable();
+
+    // Write dirty inodes back to the on-disk inode table
+    void flush();
+
     // Get the total number of inodes
     size_t getTotalInodes() const;
 
+    // Get the inode cache (for statistics)
+    const InodeCache& getCache() const;
+
+    // Get the column copy of inode sizes, types and times (for metadata queries)
+    const InodeColumns& getColumns() const;
+
     void initializeRootInode();
 
 private:
     size_t totalInodes;            // Total number of inodes
+    DiskManager* diskManager;      // Disk holding the inode table (null when in memory)
+    size_t inodeTableStart;        // First block of the on-disk inode table
     std::vector<bool> inodeBitmap; // Bitmap for inode allocation
-    std::vector<Inode> inodeTable; // Array of inodes
+    mutable InodeCache inodeCache; // Resident working set of inodes
+    InodeColumns columns;          // Query columns, updated with every inode change
 
     // Helper function to check inode ID bounds
     void checkInodeId(size_t inodeId) const;
@@ -0,0 +1,137 @@
+#include "IoRing.h"
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring> // For memset
+#include <stdexcept>
+#include <string>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Set up a ring for up to entries reads in flight
+IoRing::IoRing(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    long fd = ::syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        LLFS_LOG_WARN("IoRing", "io_uring unavailable: errno=", errno);
+        return;
+    }
+    ringFd = static_cast<int>(fd);
+
+    // Map the rings (one mapping for both on kernels that allow it) and the submission entries
+    ringBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    completionBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMapping = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMapping) {
+        ringBytes = completionBytes = std::max(ringBytes, completionBytes);
+    }
+    ringMemory = ::mmap(nullptr, ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                        IORING_OFF_SQ_RING);
+    completionMemory = singleMapping ? ringMemory
+                                     : ::mmap(nullptr, completionBytes, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    entryBytes = params.sq_entries * sizeof(io_uring_sqe);
+    entryMemory = ::mmap(nullptr, entryBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                         IORING_OFF_SQES);
+    if (ringMemory == MAP_FAILED || completionMemory == MAP_FAILED || entryMemory == MAP_FAILED) {
+        LLFS_LOG_WARN("IoRing", "io_uring rings could not be mapped: errno=", errno);
+        release();
+        return;
+    }
+
+    char* sq = static_cast<char*>(ringMemory);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(completionMemory);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqEntries = cq + params.cq_off.cqes;
+    capacity = params.sq_entries;
+    LLFS_LOG_DEBUG("IoRing", "io_uring set up: entries=", capacity, " completions=", params.cq_entries);
+}
+
+// Destructor
+IoRing::~IoRing() {
+    release();
+}
+
+bool IoRing::isAvailable() const {
+    return ringFd >= 0;
+}
+
+unsigned IoRing::getCapacity() const {
+    return capacity;
+}
+
+// Queue a read; false if the submission ring is full
+bool IoRing::prepareRead(int fd, void* buffer, unsigned length, uint64_t offset, uint64_t userData) {
+    unsigned tail = *sqTail; // Only this side moves the tail
+    unsigned head = std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire);
+    if (tail - head >= capacity) {
+        return false;
+    }
+    unsigned index = tail & sqMask;
+    io_uring_sqe* entry = static_cast<io_uring_sqe*>(entryMemory) + index;
+    std::memset(entry, 0, sizeof(*entry));
+    entry->opcode = IORING_OP_READ;
+    entry->fd = fd;
+    entry->addr = reinterpret_cast<uint64_t>(buffer);
+    entry->len = length;
+    entry->off = offset;
+    entry->user_data = userData;
+    sqArray[index] = index;
+    std::atomic_ref<unsigned>(*sqTail).store(tail + 1, std::memory_order_release);
+    ++toSubmit;
+    return true;
+}
+
+// Submit the queued reads and wait until at least waitFor have completed
+void IoRing::submitAndWait(unsigned waitFor) {
+    for (;;) {
+        long submitted = ::syscall(__NR_io_uring_enter, ringFd, toSubmit, waitFor,
+                                   waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (submitted >= 0) {
+            toSubmit -= static_cast<unsigned>(submitted);
+            return;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            throw std::runtime_error("io_uring_enter failed: errno " + std::to_string(errno));
+        }
+    }
+}
+
+// Helper function to unmap the rings and close the ring
+void IoRing::release() {
+    if (ringFd < 0) {
+        return;
+    }
+    if (entryMemory && entryMemory != MAP_FAILED) ::munmap(entryMemory, entryBytes);
+    if (completionMemory && completionMemory != MAP_FAILED && completionMemory != ringMemory) {
+        ::munmap(completionMemory, completionBytes);
+    }
+    if (ringMemory && ringMemory != MAP_FAILED) ::munmap(ringMemory, ringBytes);
+    ::close(ringFd);
+    ringFd = -1;
+}
+
+// Pass every completed read to the handler
+size_t IoRing::reap(const std::function<void(uint64_t, int)>& handler) {
+    unsigned head = *cqHead; // Only this side moves the head
+    unsigned tail = std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire);
+    size_t count = 0;
+    for (; head != tail; ++head, ++count) {
+        const io_uring_cqe& completion = static_cast<const io_uring_cqe*>(cqEntries)[head & cqMask];
+        uint64_t userData = completion.user_data;
+        int result = completion.res;
+        std::atomic_ref<unsigned>(*cqHead).store(head + 1, std::memory_order_release);
+        handler(userData, result);
+    }
+    return count;
+}
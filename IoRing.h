@@ -0,0 +1,68 @@
+#ifndef IORING_H
+#define IORING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// A Linux io_uring used through its system calls: reads are queued in the submission ring,
+// handed to the kernel in one call, and their results collected from the completion ring
+// without further calls. Kernels (or sandboxes) without io_uring leave it unavailable.
+class IoRing {
+public:
+    // Set up a ring for up to entries reads in flight
+    explicit IoRing(unsigned entries);
+
+    // Destructor
+    ~IoRing();
+
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    // Check whether the kernel set the ring up
+    bool isAvailable() const;
+
+    // Get how many reads may be in flight at once
+    unsigned getCapacity() const;
+
+    // Queue a read of length bytes at offset into buffer; userData comes back with its result.
+    // False if the submission ring is full
+    bool prepareRead(int fd, void* buffer, unsigned length, uint64_t offset, uint64_t userData);
+
+    // Submit the queued reads and wait until at least waitFor have completed
+    void submitAndWait(unsigned waitFor);
+
+    // Pass every completed read to handler(userData, result) (result: bytes read or -errno);
+    // returns how many there were
+    size_t reap(const std::function<void(uint64_t, int)>& handler);
+
+private:
+    int ringFd = -1;
+    unsigned capacity = 0;
+    unsigned toSubmit = 0;           // Queued since the last submit
+
+    // Mappings of the rings and the submission entries
+    void* ringMemory = nullptr;
+    size_t ringBytes = 0;
+    void* completionMemory = nullptr; // Same as ringMemory on kernels with one mapping
+    size_t completionBytes = 0;
+    void* entryMemory = nullptr;
+    size_t entryBytes = 0;
+
+    // Submission ring
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned* sqArray = nullptr;
+
+    // Completion ring
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    void* cqEntries = nullptr;
+
+    // Helper function to unmap the rings and close the ring
+    void release();
+};
+
+#endif // IORING_H
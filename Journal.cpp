@@ -0,0 +1,356 @@
+#include "Journal.h"
+#include "Crc32c.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstring> // For memcpy
+
+namespace {
+constexpr uint32_t HEADER_MAGIC = 0x484A4C4C;     // "LLJH"
+constexpr uint32_t DESCRIPTOR_MAGIC = 0x444A4C4C; // "LLJD"
+constexpr uint32_t COMMIT_MAGIC = 0x434A4C4C;     // "LLJC"
+constexpr uint32_t CHECKSUM_SEED = 2166136261u;    // Starting CRC32C value
+}
+
+// Constructor; call recover() (or format the disk) before use
+Journal::Journal(DiskManager& diskManager, const Superblock& layout)
+    : diskManager(diskManager), blockSize(diskManager.getBlockSize()), journalStart(layout.journalStart),
+      ringBlocks(layout.journalBlocks - 1),
+      targetsPerDescriptor((diskManager.getBlockSize() - sizeof(Descriptor)) / sizeof(uint32_t)) {
+    if (layout.journalBlocks < 3) {
+        throw std::invalid_argument("Journal region is too small.");
+    }
+}
+
+// Write an empty journal: the header and a cleared ring (during formatting)
+void Journal::formatRegion(DiskManager& diskManager, const Superblock& layout) {
+    // The whole ring is cleared: the sequence starts again at 1, so any transaction a previous
+    // file system left behind would otherwise be replayed into the new one once the new
+    // journal's sequence caught up with it
+    const size_t chunkBlocks = 64;
+    std::vector<char> zeros(chunkBlocks * diskManager.getBlockSize(), 0);
+    for (size_t offset = 1; offset < layout.journalBlocks; offset += chunkBlocks) {
+        size_t count = std::min(chunkBlocks, layout.journalBlocks - offset);
+        zeros.resize(count * diskManager.getBlockSize());
+        diskManager.writeBlocks(layout.journalStart + offset, zeros);
+    }
+
+    std::vector<char> headerBlock(diskManager.getBlockSize(), 0);
+    Header header = {HEADER_MAGIC, 0, 1};
+    std::memcpy(headerBlock.data(), &header, sizeof(header));
+    diskManager.writeBlocks(layout.journalStart, headerBlock);
+}
+
+// Replay committed transactions to their home locations and start an empty journal
+size_t Journal::recover() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return !busy; });
+    running.clear();
+    committing.clear();
+    committed.clear();
+    busy = true;
+    lock.unlock(); // Reads below go through DiskManager, which consults readBlock()
+
+    Header header;
+    std::vector<char> headerBlock = diskManager.readBlock(journalStart);
+    std::memcpy(&header, headerBlock.data(), sizeof(header));
+    if (header.magic != HEADER_MAGIC || header.tailOffset >= ringBlocks) {
+        lock.lock();
+        busy = false;
+        idle.notify_all();
+        throw std::runtime_error("Invalid journal header.");
+    }
+
+    uint64_t sequence = header.tailSequence;
+    size_t offset = header.tailOffset;
+    size_t replayed = 0;
+    while (true) {
+        // Collect one transaction: descriptors with their block images, then the commit record
+        Blocks blocks;
+        std::vector<uint32_t> targets;
+        uint32_t hash = CHECKSUM_SEED;
+        size_t length = 0;
+        bool complete = false;
+        while (length < ringBlocks) {
+            std::vector<char> block = diskManager.readBlock(ringBlock(offset + length));
+            uint32_t magic;
+            std::memcpy(&magic, block.data(), sizeof(magic));
+
+            if (magic == DESCRIPTOR_MAGIC) {
+                Descriptor descriptor;
+                std::memcpy(&descriptor, block.data(), sizeof(descriptor));
+                if (descriptor.sequence != sequence || descriptor.count > targetsPerDescriptor ||
+                    length + 1 + descriptor.count >= ringBlocks) {
+                    break;
+                }
+                targets.resize(descriptor.count);
+                std::memcpy(targets.data(), block.data() + sizeof(descriptor), descriptor.count * sizeof(uint32_t));
+                hash = checksum(hash, reinterpret_cast<const char*>(targets.data()), targets.size() * sizeof(uint32_t));
+                for (uint32_t i = 0; i < descriptor.count; ++i) {
+                    std::vector<char> image = diskManager.readBlock(ringBlock(offset + length + 1 + i));
+                    hash = checksum(hash, image.data(), image.size());
+                    if (targets[i] >= diskManager.getTotalBlocks()) {
+                        break;
+                    }
+                    blocks[targets[i]] = std::move(image);
+                }
+                length += 1 + descriptor.count;
+            } else if (magic == COMMIT_MAGIC) {
+                CommitRecord record;
+                std::memcpy(&record, block.data(), sizeof(record));
+                complete = record.sequence == sequence && record.blockCount == blocks.size() &&
+                           record.checksum == hash;
+                length += 1;
+                break;
+            } else {
+                break;
+            }
+        }
+        if (!complete) {
+            break; // Torn or never written: everything from here on is discarded
+        }
+
+        for (const auto& [blockNumber, data] : blocks) {
+            diskManager.writeBlocks(blockNumber, data);
+        }
+        ++replayed;
+        ++sequence;
+        offset = (offset + length) % ringBlocks;
+    }
+    diskManager.sync();
+    writeHeader(offset, sequence);
+
+    // The journal is now empty
+    lock.lock();
+    tailSequence = sequence;
+    tailOffset = offset;
+    headOffset = offset;
+    usedBlocks = 0;
+    runningSequence = sequence;
+    durableSequence = sequence - 1;
+    busy = false;
+    idle.notify_all();
+
+    if (replayed > 0) {
+        LLFS_LOG_INFO("Journal", "Replayed transactions: count=", replayed, " nextSequence=", sequence);
+    }
+    return replayed;
+}
+
+// Add a metadata block to the running transaction
+void Journal::logBlock(size_t blockNumber, const std::vector<char>& data) {
+    std::lock_guard<std::mutex> lock(mutex);
+    running[blockNumber] = data;
+}
+
+// Get the newest journaled contents of a block (false if the block is not journaled)
+bool Journal::readBlock(size_t blockNumber, std::vector<char>& data) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Blocks* blocks : {&running, &committing, &committed}) {
+        auto it = blocks->find(blockNumber);
+        if (it != blocks->end()) {
+            data = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Drop a block that is about to be overwritten in place
+void Journal::forget(size_t blockNumber) {
+    std::unique_lock<std::mutex> lock(mutex);
+    running.erase(blockNumber);
+    if (committing.count(blockNumber) == 0 && committed.count(blockNumber) == 0) {
+        return;
+    }
+
+    // An older version is in the journal; write everything home and empty the journal
+    // so a replay cannot overwrite the new contents
+    idle.wait(lock, [this]() { return !busy; });
+    if (committed.count(blockNumber) != 0) {
+        busy = true;
+        writeCheckpoint(lock);
+        busy = false;
+        idle.notify_all();
+    }
+}
+
+// Make every block logged before this call durable
+void Journal::commit() {
+    std::unique_lock<std::mutex> lock(mutex);
+    ++commitRequests;
+
+    // Everything logged so far belongs to the running transaction (or the one being written)
+    uint64_t target = running.empty() ? runningSequence - 1 : runningSequence;
+    while (durableSequence < target) {
+        if (busy) {
+            // Another caller is writing; our blocks go out with the next group
+            idle.wait(lock);
+            continue;
+        }
+
+        // Lead this group: take every block logged so far
+        busy = true;
+        uint64_t sequence = runningSequence++;
+        committing.swap(running);
+        size_t needed = transactionSize(committing.size());
+        if (needed > ringBlocks) {
+            // Give the blocks back; newer versions logged meanwhile win
+            committing.merge(running);
+            running.swap(committing);
+            committing.clear();
+            --runningSequence;
+            busy = false;
+            idle.notify_all();
+            throw std::runtime_error("Transaction is too large for the journal.");
+        }
+        if (needed > ringBlocks - usedBlocks) {
+            writeCheckpoint(lock);
+        }
+
+        lock.unlock();
+        writeTransaction(sequence, committing);
+        lock.lock();
+
+        // Newer committed versions replace older ones awaiting checkpoint
+        for (auto& [blockNumber, data] : committing) {
+            committed[blockNumber] = std::move(data);
+        }
+        journaledBlocks += committing.size();
+        committing.clear();
+        headOffset = (headOffset + needed) % ringBlocks;
+        usedBlocks += needed;
+        durableSequence = sequence;
+        ++commits;
+        busy = false;
+        idle.notify_all();
+    }
+}
+
+// Write committed blocks to their home locations and empty the journal
+void Journal::checkpoint() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return !busy; });
+    busy = true;
+    writeCheckpoint(lock);
+    busy = false;
+    idle.notify_all();
+}
+
+// Blocks in the running transaction
+size_t Journal::getPendingBlocks() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return running.size();
+}
+
+// Blocks available for transactions
+size_t Journal::getCapacity() const {
+    return ringBlocks;
+}
+
+size_t Journal::getCommitRequests() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return commitRequests;
+}
+
+size_t Journal::getCommits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return commits;
+}
+
+size_t Journal::getJournaledBlocks() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return journaledBlocks;
+}
+
+size_t Journal::getCheckpoints() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return checkpoints;
+}
+
+// Ring blocks needed for a transaction of n block images
+size_t Journal::transactionSize(size_t blockCount) const {
+    size_t descriptors = std::max<size_t>(1, (blockCount + targetsPerDescriptor - 1) / targetsPerDescriptor);
+    return descriptors + blockCount + 1;
+}
+
+// Write a transaction at headOffset (lock not held; busy is set)
+void Journal::writeTransaction(uint64_t sequence, const Blocks& blocks) {
+    // Ordered mode: the file data written in place is durable before metadata pointing at it
+    diskManager.sync();
+
+    // Lay the whole transaction out in memory so it goes to disk as one sequential write
+    std::vector<char> log(transactionSize(blocks.size()) * blockSize, 0);
+    size_t position = 0;
+    uint32_t hash = CHECKSUM_SEED;
+
+    auto it = blocks.begin();
+    do {
+        size_t count = std::min(targetsPerDescriptor, static_cast<size_t>(std::distance(it, blocks.end())));
+        Descriptor descriptor = {DESCRIPTOR_MAGIC, static_cast<uint32_t>(count), sequence};
+        char* descriptorBlock = log.data() + position * blockSize;
+        std::memcpy(descriptorBlock, &descriptor, sizeof(descriptor));
+        ++position;
+
+        std::vector<uint32_t> targets;
+        for (size_t i = 0; i < count; ++i, ++it) {
+            targets.push_back(static_cast<uint32_t>(it->first));
+            std::memcpy(log.data() + position * blockSize, it->second.data(), blockSize);
+            ++position;
+        }
+        std::memcpy(descriptorBlock + sizeof(descriptor), targets.data(), targets.size() * sizeof(uint32_t));
+        hash = checksum(hash, reinterpret_cast<const char*>(targets.data()), targets.size() * sizeof(uint32_t));
+        hash = checksum(hash, descriptorBlock + blockSize, count * blockSize);
+    } while (it != blocks.end());
+
+    CommitRecord record = {COMMIT_MAGIC, static_cast<uint32_t>(blocks.size()), sequence, hash};
+    std::memcpy(log.data() + position * blockSize, &record, sizeof(record));
+
+    // One write, or two when the transaction wraps around the end of the ring
+    size_t total = log.size() / blockSize;
+    size_t first = std::min(total, ringBlocks - headOffset);
+    diskManager.writeBlocks(ringBlock(headOffset), std::vector<char>(log.begin(), log.begin() + first * blockSize));
+    if (first < total) {
+        diskManager.writeBlocks(ringBlock(0), std::vector<char>(log.begin() + first * blockSize, log.end()));
+    }
+    diskManager.sync();
+}
+
+// Write committed blocks home and reset the tail (lock held on entry and exit; busy is set)
+void Journal::writeCheckpoint(std::unique_lock<std::mutex>& lock) {
+    if (usedBlocks == 0) {
+        return;
+    }
+
+    // Readers keep seeing the committed blocks until they are home
+    lock.unlock();
+    for (const auto& [blockNumber, data] : committed) {
+        diskManager.writeBlocks(blockNumber, data);
+    }
+    diskManager.sync();
+    writeHeader(headOffset, durableSequence + 1);
+    lock.lock();
+
+    committed.clear();
+    tailOffset = headOffset;
+    tailSequence = durableSequence + 1;
+    usedBlocks = 0;
+    ++checkpoints;
+}
+
+// Write the header block
+void Journal::writeHeader(size_t offset, uint64_t sequence) {
+    std::vector<char> block(blockSize, 0);
+    Header header = {HEADER_MAGIC, static_cast<uint32_t>(offset), sequence};
+    std::memcpy(block.data(), &header, sizeof(header));
+    diskManager.writeBlocks(journalStart, block);
+    diskManager.sync();
+}
+
+// Physical block of a ring position
+size_t Journal::ringBlock(size_t offset) const {
+    return journalStart + 1 + offset % ringBlocks;
+}
+
+uint32_t Journal::checksum(uint32_t hash, const char* data, size_t length) {
+    return Crc32c::compute(hash, data, length);
+}
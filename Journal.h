@@ -0,0 +1,129 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "DiskManager.h"
+
+// Write-ahead journal for metadata blocks (like ext3/JBD in ordered mode). Metadata writes
+// collect in the running transaction and are visible to reads at once. commit() writes the
+// whole transaction - descriptor, block images and a checksummed commit record - into a
+// circular region with one sequential write; blocks reach their home locations later, at a
+// checkpoint. After a crash, recover() replays every complete transaction in order.
+//
+// Group commit: callers of commit() that arrive while another commit is being written wait
+// for it and are then covered together by the next write, so N concurrent operations cost
+// one journal flush instead of N.
+class Journal {
+public:
+    // Constructor; call recover() (or format the disk) before use
+    Journal(DiskManager& diskManager, const Superblock& layout);
+
+    // Write an empty journal: the header and a cleared ring (during formatting)
+    static void formatRegion(DiskManager& diskManager, const Superblock& layout);
+
+    // Replay committed transactions to their home locations and start an empty journal;
+    // returns the number of transactions replayed. Uncommitted changes are discarded.
+    size_t recover();
+
+    // Add a metadata block to the running transaction
+    void logBlock(size_t blockNumber, const std::vector<char>& data);
+
+    // Get the newest journaled contents of a block (false if the block is not journaled)
+    bool readBlock(size_t blockNumber, std::vector<char>& data) const;
+
+    // Drop a block that is about to be overwritten in place (a freed metadata block reused
+    // for file data), so neither a checkpoint nor a replay can bring the old contents back
+    void forget(size_t blockNumber);
+
+    // Make every block logged before this call durable
+    void commit();
+
+    // Write committed blocks to their home locations and empty the journal
+    void checkpoint();
+
+    // Blocks in the running transaction
+    size_t getPendingBlocks() const;
+
+    // Blocks available for transactions
+    size_t getCapacity() const;
+
+    // Statistics
+    size_t getCommitRequests() const;   // Calls to commit()
+    size_t getCommits() const;          // Transactions written
+    size_t getJournaledBlocks() const;  // Block images written to the journal
+    size_t getCheckpoints() const;
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t tailOffset;            // Ring position of the oldest live transaction
+        uint64_t tailSequence;          // Sequence number of that transaction
+    };
+
+    struct Descriptor {
+        uint32_t magic;
+        uint32_t count;                 // Block images that follow (targets follow this struct)
+        uint64_t sequence;
+    };
+
+    struct CommitRecord {
+        uint32_t magic;
+        uint32_t blockCount;            // Block images in the whole transaction
+        uint64_t sequence;
+        uint32_t checksum;              // Over targets and block images
+    };
+
+    using Blocks = std::map<size_t, std::vector<char>>; // Block number -> contents
+
+    DiskManager& diskManager;
+    size_t blockSize;
+    size_t journalStart;                // Header block; the ring follows it
+    size_t ringBlocks;
+    size_t targetsPerDescriptor;
+
+    mutable std::mutex mutex;
+    std::condition_variable idle;       // A commit or checkpoint finished
+    bool busy = false;                  // A commit or checkpoint is writing
+
+    Blocks running;                     // Logged, not committed
+    Blocks committing;                  // Being written to the journal
+    Blocks committed;                   // Durable in the journal, not yet home
+
+    uint64_t runningSequence = 1;       // Sequence the running transaction will get
+    uint64_t durableSequence = 0;       // Last committed sequence
+    uint64_t tailSequence = 1;
+    size_t tailOffset = 0;
+    size_t headOffset = 0;              // Where the next transaction goes
+    size_t usedBlocks = 0;              // Ring blocks holding live transactions
+
+    size_t commitRequests = 0;
+    size_t commits = 0;
+    size_t journaledBlocks = 0;
+    size_t checkpoints = 0;
+
+    // Ring blocks needed for a transaction of n block images
+    size_t transactionSize(size_t blockCount) const;
+
+    // Write a transaction at headOffset (lock not held; busy is set)
+    void writeTransaction(uint64_t sequence, const Blocks& blocks);
+
+    // Write committed blocks home and reset the tail (lock held on entry and exit; busy is set)
+    void writeCheckpoint(std::unique_lock<std::mutex>& lock);
+
+    // Write the header block
+    void writeHeader(size_t offset, uint64_t sequence);
+
+    // Physical block of a ring position
+    size_t ringBlock(size_t offset) const;
+
+    // CRC32C over a byte range, continuing from hash
+    static uint32_t checksum(uint32_t hash, const char* data, size_t length);
+};
+
+#endif // JOURNAL_H
@@ -1,124 +1,1308 @@
 #include "LLFS.h"
+#include "CrashRecovery.h"
+#include "Logger.h"
+#include "Lz4.h"
+#include "ZeroDetector.h"
+#include <algorithm>
 #include <cstring> // For memcpy
+#include <ctime>
+#include <utility> // For exchange
 
 // Constructor
-LLFS::LLFS(const std::string& diskName, size_t diskSize, size_t blockSize)
-    : diskManager(diskName, diskSize, blockSize),
-      freeBlockManager(diskSize / blockSize),
-      inodeManager(diskSize / (blockSize * 8)), // Example: 1 inode per 8 blocks
-      blockSize(blockSize) {}
+LLFS::LLFS(const std::string& diskName, size_t diskSize, size_t blockSize, WriteMode writeMode, bool blockChecksums)
+    : diskManager(diskName, diskSize, blockSize, writeMode, blockChecksums),
+      layout(diskManager.computeLayout()),
+      freeBlockManager(layout.volumeBlocks, layout.dataStart),
+      inodeManager(diskManager, layout.numberOfInodes, layout.inodeTableStart), // Example: 1 inode per 8 blocks
+      directoryManager(diskManager, freeBlockManager, inodeManager),
+      blockMap(diskManager, freeBlockManager),
+      fragments(diskManager, freeBlockManager),
+      blockSize(blockSize),
+      publishedInodes(std::make_unique<std::atomic<const Inode*>[]>(layout.numberOfInodes)) {
+    if (writeMode == WriteMode::LogStructured) {
+        segmentManager = std::make_unique<SegmentManager>(diskManager, layout);
+        diskManager.setSegmentManager(segmentManager.get());
+    } else {
+        journal = std::make_unique<Journal>(diskManager, layout);
+        diskManager.setJournal(journal.get());
+        snapshots = std::make_unique<SnapshotManager>(diskManager, freeBlockManager, layout);
+        diskManager.setSnapshotManager(snapshots.get());
+    }
+    attachFreeHook();
+    freeBlockManager.holdFreedBlocks(); // Freed blocks wait for the commit that frees them
+}
+
+// Destructor
+LLFS::~LLFS() {
+    if (snapshotSource) {
+        snapshotSource->detachView(snapshotId);
+    }
+    for (size_t i = 0; i < layout.numberOfInodes; ++i) {
+        delete publishedInodes[i].load();
+    }
+}
 
 // Format the file system
 void LLFS::formatFileSystem() {
-    // Format the disk
+    checkWritable();
+    stopScrubber(); // Its cursor is meaningless after the format
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (snapshots) {
+        snapshots->clear(); // Before anything changes: throws if a snapshot is mounted
+    }
+    NamespaceChange change(namespaceSequence);
+    scrubber.reset();
+    clusterCache.clear();
+    fragments.clear();
+    epochs.synchronize(); // Nothing freed before the format may be freed after it
+    unpublishInodes();
+    transactionOpen = false;
+    freeBlockManager.takeHeldBlocks(); // The free block vector is reloaded below
+    if (segmentManager) {
+        segmentManager->stopCleaner(); // Nothing may move blocks while the log is rewritten
+    }
+
+    // Format the disk (straight to disk: nothing journaled before this may survive)
+    diskManager.setJournal(nullptr);
+    diskManager.setSegmentManager(nullptr);
     diskManager.formatDisk();
+    if (segmentManager) {
+        diskManager.setSegmentManager(segmentManager.get());
+        segmentManager->recover();
+    } else {
+        diskManager.setJournal(journal.get());
+        journal->recover();
+    }
+
+    // Start from the freshly written metadata
+    freeBlockManager.loadFreeBlockVector(FreeBlockManager(layout.volumeBlocks, layout.dataStart).getFreeBlockVector());
+    if (dedupIndex) {
+        dedupIndex->clear();
+    }
+    inodeManager.scanInodeTable();
 
     // Initialize the root directory
     directoryManager.createRootDirectory(0);
 }
 
+// Load an existing file system from disk (runs crash recovery)
+void LLFS::mount() {
+    checkWritable();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    NamespaceChange change(namespaceSequence);
+    clusterCache.clear();
+    fragments.clear();
+    epochs.synchronize();
+    unpublishInodes();
+    transactionOpen = false; // Abandoned: recovery reads the disk back without it
+    freeBlockManager.takeHeldBlocks(); // Likewise the free block vector
+    if (snapshots) {
+        snapshots->load(); // First: the blocks the journal replays are copied out too
+    }
+    CrashRecovery recovery(diskManager, freeBlockManager, inodeManager, directoryManager, journal.get(),
+                           segmentManager.get());
+    recovery.recover();
+    indexFragments();
+    if (dedupIndex) {
+        dedupIndex->clear();
+        indexFileBlocks();
+    }
+}
+
+// Commit, then run a full consistency check (with repair, the fixes are committed too)
+ConsistencyReport LLFS::checkConsistency(bool repair, size_t threadCount) {
+    if (repair) {
+        checkWritable();
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    NamespaceChange change(namespaceSequence); // A repair may move anything
+    if (!readOnly) {
+        commitTransaction();
+    }
+    CrashRecovery recovery(diskManager, freeBlockManager, inodeManager, directoryManager, journal.get(),
+                           segmentManager.get(), threadCount);
+    ConsistencyReport report = recovery.check(repair);
+    if (report.repaired) {
+        unpublishInodes();
+        fragments.clear();
+        indexFragments();
+        commitTransaction();
+    }
+    return report;
+}
+
 // Create a file
 void LLFS::createFile(const std::string& fileName) {
+    checkWritable();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    NamespaceChange change(namespaceSequence);
+    std::string parent, name;
+    DirectoryManager::splitPath(fileName, parent, name);
+
     // Allocate an inode for the file
     int inodeId = inodeManager.allocateInode();
 
-    // Initialize the inode
-    Inode inode = {};
-    inode.fileType = 1; // File type
-    inodeManager.updateInode(inodeId, inode);
+    try {
+        // Initialize the inode
+        Inode inode = {};
+        inode.fileType = 1; // File type
+        inode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
+        inodeManager.updateInode(inodeId, inode);
 
-    // Add the file to the root directory
-    DirectoryEntry entry = {static_cast<uint8_t>(inodeId), ""};
-    std::strncpy(entry.fileName, fileName.c_str(), sizeof(entry.fileName) - 1);
-    directoryManager.addEntry("/", entry);
+        // Add the file to its parent directory
+        DirectoryEntry entry = {static_cast<uint32_t>(inodeId), ""};
+        std::strncpy(entry.fileName, name.c_str(), sizeof(entry.fileName) - 1);
+        directoryManager.addEntry(parent, entry);
+    } catch (...) {
+        inodeManager.freeInode(inodeId);
+        throw;
+    }
+    commitIfNeeded();
+}
+
+// Create many files at once
+void LLFS::createFiles(const std::vector<std::string>& fileNames) {
+    checkWritable();
+    if (fileNames.empty()) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    NamespaceChange change(namespaceSequence);
+
+    std::vector<uint32_t> inodeIds = inodeManager.allocateInodes(fileNames.size());
+    try {
+        Inode inode = {};
+        inode.fileType = 1; // File type
+        inode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
+        for (uint32_t inodeId : inodeIds) {
+            inodeManager.updateInode(inodeId, inode);
+        }
+        directoryManager.addEntries(fileNames, inodeIds);
+    } catch (...) {
+        for (uint32_t inodeId : inodeIds) {
+            inodeManager.freeInode(inodeId);
+        }
+        throw;
+    }
+    // The inode table and directories of a whole volume fit in the journal (1/16 of the disk)
+    if (!transactionOpen) {
+        commitTransaction();
+    }
+    LLFS_LOG_DEBUG("LLFS", "Created files: count=", fileNames.size());
 }
 
 // Write data to a file
 void LLFS::writeFile(const std::string& fileName, const std::vector<char>& data) {
-    // Find the file in the root directory
-    DirectoryEntry entry = directoryManager.getEntry("/", fileName);
-    Inode inode = inodeManager.getInode(entry.inodeId);
+    checkWritable();
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    // Find the file
+    uint32_t inodeId = resolveFile(fileName);
+    std::unique_lock<std::shared_mutex> fileLock(inodeLock(inodeId));
+    Inode inode = *inodeManager.acquireInode(inodeId);
 
-    // Allocate blocks for the file
-    size_t dataSize = data.size();
-    size_t numBlocks = (dataSize + blockSize - 1) / blockSize; // Round up
+    // Check the size before any of the old contents is let go
+    const bool packed = !compression && packing && !data.empty() && data.size() <= fragments.getMaxFragmentSize() &&
+                        !ZeroDetector::isZero(data.data(), data.size());
+    const size_t numBlocks = (data.size() + blockSize - 1) / blockSize; // Round up
+    if (compression) {
+        checkClusterLimit(data.size());
+    } else if (!packed && numBlocks > 10) {
+        throw std::runtime_error("File size exceeds direct block limit.");
+    }
 
-    for (size_t i = 0; i < numBlocks; ++i) {
-        size_t blockNumber = freeBlockManager.allocateBlock();
+    std::vector<uint32_t> oldBlocks; // Plain blocks, freed once no lock-free reader can see them
+    Fragment oldFragment = takeFragment(inode);
 
-        // Write a block of data
-        size_t offset = i * blockSize;
-        size_t chunkSize = std::min(blockSize, dataSize - offset);
-        std::vector<char> blockData(data.begin() + offset, data.begin() + offset + chunkSize);
-        blockData.resize(blockSize, 0); // Pad with zeros
-        diskManager.writeBlock(blockNumber, blockData);
-
-        // Update inode
-        if (i < 10) {
-            inode.directBlocks[i] = blockNumber;
-        } else {
-            throw std::runtime_error("File size exceeds direct block limit.");
+    // Compressed contents are replaced as a whole
+    if (compression || (inode.flags & INODE_FLAG_COMPRESSED)) {
+        if (!(inode.flags & INODE_FLAG_COMPRESSED)) {
+            for (uint16_t& block : inode.directBlocks) {
+                if (block != 0) oldBlocks.push_back(std::exchange(block, 0));
+            }
+        }
+        blockMap.release(inode);
+        clusterCache.invalidate(inodeId);
+        inode.flags &= ~INODE_FLAG_COMPRESSED;
+    }
+    if (compression) {
+        writeClusters(inode, data);
+    } else if (packed) {
+        for (uint16_t& block : inode.directBlocks) {
+            if (block != 0) oldBlocks.push_back(std::exchange(block, 0));
+        }
+        packFile(inode, data);
+    } else {
+        // Allocate blocks for the file
+        size_t dataSize = data.size();
+
+        // The old blocks go once the new ones are written (shared ones just lose a reference)
+        for (uint16_t& block : inode.directBlocks) {
+            if (block != 0) oldBlocks.push_back(std::exchange(block, 0));
+        }
+        try {
+            for (size_t i = 0; i < numBlocks; ++i) {
+                // Write a block of data
+                size_t offset = i * blockSize;
+                size_t chunkSize = std::min(blockSize, dataSize - offset);
+                std::vector<char> blockData(data.begin() + offset, data.begin() + offset + chunkSize);
+                blockData.resize(blockSize, 0); // Pad with zeros
+
+                // Update inode; blocks of zeros are left as holes
+                if (!ZeroDetector::isZero(blockData.data(), blockData.size())) {
+                    inode.directBlocks[i] = static_cast<uint16_t>(storeBlock(blockData));
+                }
+            }
+        } catch (...) {
+            // The disk filled up: give back the blocks stored so far, the file keeps its old ones
+            for (uint16_t block : inode.directBlocks) {
+                if (block != 0) releaseBlock(block);
+            }
+            throw;
         }
     }
 
-    inode.fileSize = dataSize;
-    inodeManager.updateInode(entry.inodeId, inode);
+    inode.fileSize = data.size();
+    inode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
+    inodeManager.updateInode(inodeId, inode);
+    publishInode(inodeId, inode);
+    retireBlocks(std::move(oldBlocks));
+    if (oldFragment.block != 0) {
+        fragments.release(oldFragment);
+    }
+    fileLock.unlock();
+    lock.unlock();
+    epochs.reclaim();
+    commitIfNeededUnlocked();
 }
 
 // Read data from a file
 std::vector<char> LLFS::readFile(const std::string& fileName) {
-    // Find the file in the root directory
-    DirectoryEntry entry = directoryManager.getEntry("/", fileName);
-    Inode inode = inodeManager.getInode(entry.inodeId);
+    std::vector<char> data;
+    if (readPublished(fileName, data)) {
+        return data;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    ++lockedReads;
+    // Find the file
+    uint32_t inodeId = resolveFile(fileName);
+    std::shared_lock<std::shared_mutex> fileLock(inodeLock(inodeId));
+    InodeHandle inode = inodeManager.acquireInode(inodeId);
+    if (inode->flags & INODE_FLAG_COMPRESSED) {
+        return readClusters(inodeId, *inode);
+    }
+    if (inode->flags & INODE_FLAG_PACKED) {
+        return fragments.read(fragmentOf(*inode), inode->fileSize);
+    }
+    if (lockFreeReads.load(std::memory_order_relaxed)) {
+        publishInode(inodeId, *inode); // Later reads skip the locks
+    }
 
     // Read data from the file's blocks
-    std::vector<char> data(inode.fileSize);
+    data.assign(inode->fileSize, 0);
     size_t bytesRead = 0;
 
-    for (size_t i = 0; i < 10 && bytesRead < inode.fileSize; ++i) {
-        size_t blockNumber = inode.directBlocks[i];
-        if (blockNumber == 0) break;
-
-        std::vector<char> blockData = diskManager.readBlock(blockNumber);
-
-        size_t chunkSize = std::min(blockSize, inode.fileSize - bytesRead);
-        std::copy(blockData.begin(), blockData.begin() + chunkSize, data.begin() + bytesRead);
+    for (size_t i = 0; i < 10 && bytesRead < inode->fileSize; ++i) {
+        size_t blockNumber = inode->directBlocks[i];
+        size_t chunkSize = std::min<size_t>(blockSize, inode->fileSize - bytesRead);
+        if (blockNumber != 0) { // Holes are already zeros
+            std::vector<char> blockData = diskManager.readBlock(blockNumber);
+            std::copy(blockData.begin(), blockData.begin() + chunkSize, data.begin() + bytesRead);
+        }
         bytesRead += chunkSize;
     }
 
     return data;
 }
 
+// Resolve a file and publish its inode, so later reads of it take no lock
+uint32_t LLFS::openFile(const std::string& fileName) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint32_t inodeId = resolveFile(fileName);
+    std::shared_lock<std::shared_mutex> fileLock(inodeLock(inodeId));
+    if (lockFreeReads.load(std::memory_order_relaxed)) {
+        publishInode(inodeId, inodeManager.getInode(inodeId));
+    }
+    return inodeId;
+}
+
+// Begin a lock-free read of a file from its published inode
+bool LLFS::beginLockFreeRead(const std::string& fileName, LockFreeRead& read, bool waitForSlot) {
+    if (!lockFreeReads.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    read.guard = waitForSlot ? std::optional<EpochManager::Guard>(epochs.enter()) : epochs.tryEnter();
+    if (!read.guard) {
+        return false;
+    }
+    read.sequence = namespaceSequence.load(std::memory_order_acquire);
+    uint32_t inodeId = 0;
+    const Inode* inode = nullptr;
+    if (!(read.sequence & 1) && directoryManager.resolveCached(fileName, inodeId) &&
+        inodeId < layout.numberOfInodes) {
+        inode = publishedInodes[inodeId].load();
+    }
+    if (!inode) {
+        read.guard.reset();
+        return false;
+    }
+    read.fileSize = inode->fileSize;
+    std::copy(std::begin(inode->directBlocks), std::end(inode->directBlocks), read.blocks.begin());
+    return true;
+}
+
+// Check a block of a lock-free read against its checksum
+void LLFS::checkLockFreeBlock(uint16_t blockNumber, const std::vector<char>& data) {
+    diskManager.checkDataBlock(blockNumber, data);
+}
+
+// End a lock-free read; false if the namespace changed meanwhile
+bool LLFS::endLockFreeRead(LockFreeRead& read) {
+    bool unchanged = read.guard && namespaceSequence.load() == read.sequence;
+    read.guard.reset();
+    return unchanged;
+}
+
 // Delete a file
 void LLFS::deleteFile(const std::string& fileName) {
-    // Find the file in the root directory
-    DirectoryEntry entry = directoryManager.getEntry("/", fileName);
-    Inode inode = inodeManager.getInode(entry.inodeId);
+    checkWritable();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    NamespaceChange change(namespaceSequence);
+    // Find the file
+    uint32_t inodeId = resolveFile(fileName);
+    publishInode(inodeId, Inode{}); // Unpublish it first: readers may still hold its blocks
+    {
+        InodeHandle inode = inodeManager.acquireInode(inodeId);
 
-    // Free allocated blocks
-    for (size_t i = 0; i < 10; ++i) {
-        if (inode.directBlocks[i] != 0) {
-            freeBlockManager.freeBlock(inode.directBlocks[i]);
+        // Free allocated blocks
+        if (inode->flags & INODE_FLAG_COMPRESSED) {
+            Inode released = *inode;
+            blockMap.release(released);
+            clusterCache.invalidate(inodeId);
+        } else if (inode->flags & INODE_FLAG_PACKED) {
+            fragments.release(fragmentOf(*inode));
+        } else {
+            std::vector<uint32_t> blocks;
+            for (uint16_t block : inode->directBlocks) {
+                if (block != 0) blocks.push_back(block);
+            }
+            retireBlocks(std::move(blocks));
         }
     }
 
     // Free the inode
-    inodeManager.freeInode(entry.inodeId);
+    inodeManager.freeInode(inodeId);
+
+    // Remove the file from its parent directory
+    std::string parent, name;
+    DirectoryManager::splitPath(fileName, parent, name);
+    directoryManager.removeEntry(parent, name);
+    epochs.reclaim();
+    commitIfNeeded();
+}
+
+// Delete many files at once
+void LLFS::deleteFiles(const std::vector<std::string>& fileNames) {
+    checkWritable();
+    if (fileNames.empty()) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    NamespaceChange change(namespaceSequence);
+
+    // Find every file and unlink them all before anything is freed
+    std::vector<uint32_t> inodeIds = directoryManager.lookupEntries(fileNames);
+    for (size_t i = 0; i < fileNames.size(); ++i) {
+        if (inodeIds[i] == DirectoryManager::NO_ENTRY) {
+            throw std::runtime_error("Path does not exist: " + fileNames[i]);
+        }
+        if (inodeManager.acquireInode(inodeIds[i])->fileType != 1) {
+            throw std::runtime_error("Not a file: " + fileNames[i]);
+        }
+    }
+    directoryManager.removeEntries(fileNames);
+
+    std::vector<uint32_t> blocks;
+    for (uint32_t inodeId : inodeIds) {
+        publishInode(inodeId, Inode{}); // Unpublish it first: readers may still hold its blocks
+        Inode inode = *inodeManager.acquireInode(inodeId);
+        if (inode.flags & INODE_FLAG_COMPRESSED) {
+            blockMap.release(inode);
+            clusterCache.invalidate(inodeId);
+        } else if (inode.flags & INODE_FLAG_PACKED) {
+            fragments.release(fragmentOf(inode));
+        } else {
+            for (uint16_t block : inode.directBlocks) {
+                if (block != 0) blocks.push_back(block);
+            }
+        }
+        inodeManager.freeInode(inodeId);
+    }
+    retireBlocks(std::move(blocks));
+    epochs.reclaim();
+    if (!transactionOpen) {
+        commitTransaction();
+    }
+    LLFS_LOG_DEBUG("LLFS", "Deleted files: count=", fileNames.size());
+}
+
+// Get the metadata of many paths, resolving each parent directory once
+std::vector<FileStat> LLFS::statFiles(const std::vector<std::string>& paths) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<uint32_t> inodeIds = directoryManager.lookupEntries(paths);
+
+    // Visit the inodes in table order, so each block of the table is loaded once
+    std::vector<size_t> order(paths.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return inodeIds[a] < inodeIds[b]; });
+
+    std::vector<FileStat> stats(paths.size());
+    for (size_t i : order) {
+        if (inodeIds[i] == DirectoryManager::NO_ENTRY) {
+            break; // Missing paths sort last
+        }
+        std::shared_lock<std::shared_mutex> fileLock(inodeLock(inodeIds[i]));
+        InodeHandle inode = inodeManager.acquireInode(inodeIds[i]);
+        stats[i].inodeId = inodeIds[i];
+        stats[i].fileType = inode->fileType;
+        stats[i].fileSize = inode->fileSize;
+        stats[i].modificationTime = inode->modificationTime;
+    }
+    return stats;
+}
+
+// Free the blocks behind a byte range, which reads back as zeros
+void LLFS::punchHole(const std::string& fileName, size_t offset, size_t length) {
+    checkWritable();
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint32_t inodeId = resolveFile(fileName);
+    std::unique_lock<std::shared_mutex> fileLock(inodeLock(inodeId));
+    Inode inode = *inodeManager.acquireInode(inodeId);
+    if (offset >= inode.fileSize || length == 0) {
+        return;
+    }
+    size_t end = offset + std::min<size_t>(length, inode.fileSize - offset);
+    std::vector<uint32_t> oldBlocks;
+
+    if (inode.flags & INODE_FLAG_COMPRESSED) {
+        // Clusters inside the range are dropped; the ones it cuts are zeroed and stored again
+        clusterCache.invalidate(inodeId);
+        for (size_t cluster = offset / CLUSTER_SIZE; cluster * CLUSTER_SIZE < end; ++cluster) {
+            size_t start = cluster * CLUSTER_SIZE;
+            size_t rawSize = std::min<size_t>(CLUSTER_SIZE, inode.fileSize - start);
+            size_t from = std::max(offset, start) - start;
+            size_t to = std::min(end, start + rawSize) - start;
+            if (from == 0 && to == rawSize) {
+                releaseCluster(inode, cluster);
+                continue;
+            }
+            std::vector<char> contents = readCluster(inode, cluster, rawSize);
+            std::fill(contents.begin() + from, contents.begin() + to, 0);
+            releaseCluster(inode, cluster);
+            writeCluster(inode, cluster, contents.data(), rawSize);
+        }
+    } else if (inode.flags & INODE_FLAG_PACKED) {
+        // A fragment is stored again with the range zeroed
+        std::vector<char> contents = fragments.read(fragmentOf(inode), inode.fileSize);
+        std::fill(contents.begin() + offset, contents.begin() + end, 0);
+        Fragment oldFragment = takeFragment(inode);
+        if (!ZeroDetector::isZero(contents.data(), contents.size())) {
+            packFile(inode, contents);
+        }
+        fragments.release(oldFragment);
+    } else {
+        // Same for blocks; a cut block gets a new copy, as it may be shared with other files
+        for (size_t i = offset / blockSize; i * blockSize < end; ++i) {
+            uint16_t oldBlock = inode.directBlocks[i];
+            if (oldBlock == 0) continue;
+            size_t start = i * blockSize;
+            size_t from = std::max(offset, start) - start;
+            size_t to = std::min(end, start + blockSize) - start;
+            inode.directBlocks[i] = 0;
+            if (from != 0 || (to != blockSize && start + to < inode.fileSize)) {
+                std::vector<char> blockData = diskManager.readBlock(oldBlock);
+                std::fill(blockData.begin() + from, blockData.begin() + to, 0);
+                if (!ZeroDetector::isZero(blockData.data(), blockData.size())) {
+                    inode.directBlocks[i] = static_cast<uint16_t>(storeBlock(blockData));
+                }
+            }
+            oldBlocks.push_back(oldBlock);
+        }
+    }
 
-    // Remove the file from the directory
-    directoryManager.removeEntry("/", fileName);
+    inode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
+    inodeManager.updateInode(inodeId, inode);
+    publishInode(inodeId, inode);
+    retireBlocks(std::move(oldBlocks));
+    fileLock.unlock();
+    lock.unlock();
+    epochs.reclaim();
+    commitIfNeededUnlocked();
+}
+
+// Create a file sharing another file's data blocks
+void LLFS::cloneFile(const std::string& sourceName, const std::string& cloneName) {
+    checkWritable();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    NamespaceChange change(namespaceSequence);
+    uint32_t sourceId = resolveFile(sourceName);
+    Inode source = *inodeManager.acquireInode(sourceId);
+    std::string parent, name;
+    DirectoryManager::splitPath(cloneName, parent, name);
+
+    int inodeId = inodeManager.allocateInode();
+    Inode inode = {};
+    inode.fileType = 1; // File type
+    inode.fileSize = source.fileSize;
+    inode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
+    try {
+        // Indirect blocks are updated in place, so a compressed file gets its own clusters
+        if (source.flags & INODE_FLAG_COMPRESSED) {
+            writeClusters(inode, readClusters(sourceId, source));
+        } else if (source.flags & INODE_FLAG_PACKED) {
+            packFile(inode, fragments.read(fragmentOf(source), source.fileSize)); // Slots are not shared
+        } else {
+            std::copy(std::begin(source.directBlocks), std::end(source.directBlocks), inode.directBlocks);
+        }
+        inodeManager.updateInode(inodeId, inode);
+
+        // Add the clone to its parent directory
+        DirectoryEntry entry = {static_cast<uint32_t>(inodeId), ""};
+        std::strncpy(entry.fileName, name.c_str(), sizeof(entry.fileName) - 1);
+        directoryManager.addEntry(parent, entry);
+    } catch (...) {
+        if (source.flags & INODE_FLAG_COMPRESSED) {
+            blockMap.release(inode);
+        } else if (inode.flags & INODE_FLAG_PACKED) {
+            fragments.release(fragmentOf(inode));
+        }
+        inodeManager.freeInode(inodeId);
+        throw;
+    }
+
+    // Plain blocks are never written in place, so sharing them is enough
+    if (!(inode.flags & (INODE_FLAG_COMPRESSED | INODE_FLAG_PACKED))) {
+        std::lock_guard<std::recursive_mutex> dedupLock(dedupMutex);
+        for (uint16_t block : inode.directBlocks) {
+            if (block != 0) freeBlockManager.addReference(block);
+        }
+    }
+    LLFS_LOG_DEBUG("LLFS", "Cloned file: source=", sourceName, " clone=", cloneName);
+    commitIfNeeded();
 }
 
 // Create a directory
 void LLFS::createDirectory(const std::string& dirName) {
-    throw std::runtime_error("Directory creation is not implemented.");
+    checkWritable();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    NamespaceChange change(namespaceSequence);
+    // Allocate an inode for the directory
+    int inodeId = inodeManager.allocateInode();
+
+    try {
+        Inode inode = {};
+        inode.fileType = 2; // Directory type
+        inode.modificationTime = static_cast<uint32_t>(std::time(nullptr));
+        inodeManager.updateInode(inodeId, inode);
+
+        // Link it into its parent directory
+        directoryManager.createDirectory(dirName, static_cast<uint32_t>(inodeId));
+    } catch (...) {
+        inodeManager.freeInode(inodeId);
+        throw;
+    }
+    commitIfNeeded();
 }
 
 // Delete a directory
 void LLFS::deleteDirectory(const std::string& dirName) {
-    throw std::runtime_error("Directory deletion is not implemented.");
+    checkWritable();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    NamespaceChange change(namespaceSequence);
+    // Unlinks the directory and frees its blocks; it must be empty
+    uint32_t inodeId = directoryManager.removeDirectory(dirName);
+    inodeManager.freeInode(inodeId);
+    commitIfNeeded();
 }
 
 std::vector<DirectoryEntry> LLFS::listDirectory(const std::string& path) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
     return directoryManager.listEntries(path);
 }
+
+// Append up to maxEntries directory entries starting at a cookie (0 = beginning)
+uint64_t LLFS::readDirectory(const std::string& path, uint64_t cookie, size_t maxEntries,
+                             std::vector<DirectoryEntry>& batch) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return directoryManager.readDirectory(path, cookie, maxEntries, batch);
+}
+
+// Begin a transaction that lasts until the next commit
+void LLFS::beginTransaction() {
+    checkWritable();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (transactionOpen) {
+        throw std::runtime_error("A transaction is already open.");
+    }
+    transactionOpen = true;
+    LLFS_LOG_DEBUG("LLFS", "Transaction begun");
+}
+
+// Make all metadata changes so far durable with one journal write (a commit mark in the log in
+// LFS mode, plus a checkpoint once the checkpoint interval has passed), ending any transaction
+void LLFS::commit() {
+    checkWritable();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    commitTransaction();
+}
+
+// Commit, then write journaled metadata to its home locations (checkpoint in LFS mode)
+void LLFS::sync() {
+    checkWritable();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    commitTransaction();
+    if (journal) {
+        journal->checkpoint();
+    } else if (segmentManager) {
+        segmentManager->checkpoint();
+    }
+}
+
+// Take a copy-on-write snapshot of the whole file system
+void LLFS::snapshot(const std::string& name) {
+    checkWritable();
+    if (!snapshots) {
+        throw std::runtime_error("Snapshots need in-place mode.");
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (transactionOpen) {
+        throw std::runtime_error("Cannot take a snapshot inside a transaction.");
+    }
+    commitTransaction();
+    journal->checkpoint(); // A snapshot reads home locations only
+    snapshots->create(name, freeBlockManager.getFreeBlockVector());
+}
+
+// Delete a snapshot, freeing the blocks only it kept
+void LLFS::deleteSnapshot(const std::string& name) {
+    checkWritable();
+    if (!snapshots) {
+        throw std::runtime_error("Snapshots need in-place mode.");
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex); // No block is written while the pins change
+    snapshots->remove(name);
+}
+
+// List the snapshots, oldest first
+std::vector<SnapshotInfo> LLFS::listSnapshots() const {
+    return snapshots ? snapshots->list() : std::vector<SnapshotInfo>();
+}
+
+// Mount a snapshot read-only next to this file system, which must outlive it
+std::unique_ptr<LLFS> LLFS::mountSnapshot(const std::string& name) {
+    checkWritable();
+    if (!snapshots) {
+        throw std::runtime_error("Snapshots need in-place mode.");
+    }
+    auto view = std::make_unique<LLFS>(diskManager.getDiskFileName(), diskManager.getTotalBlocks() * blockSize,
+                                       blockSize, WriteMode::InPlace, diskManager.hasBlockChecksums());
+    view->mountView(*snapshots, name);
+    return view;
+}
+
+// Helper function to make all metadata changes durable (namespace lock held exclusively)
+void LLFS::commitTransaction() {
+    epochs.synchronize(); // Blocks retired so far are free in the bitmap written below
+    transactionOpen = false;
+    fragments.releaseHeldSlots(); // Slots, likewise, are reused only after a commit
+    inodeManager.flush();
+
+    // Freed blocks are held until the inodes that stopped using them are durable: reused
+    // before, new data could land in a block the committed metadata still points at. They are
+    // free in the bitmap written with those inodes, and can be allocated once it commits
+    std::vector<uint32_t> freed = freeBlockManager.takeHeldBlocks();
+    std::vector<uint8_t> bitmap = freeBlockManager.getFreeBlockVector();
+    for (uint32_t block : freed) {
+        bitmap[block / 8] |= static_cast<uint8_t>(1 << (block % 8));
+    }
+    for (size_t i = 0; i < layout.freeBlockVectorBlocks; ++i) {
+        std::vector<char> block(blockSize, 0);
+        size_t offset = i * blockSize;
+        size_t chunkSize = std::min(blockSize, bitmap.size() - std::min(offset, bitmap.size()));
+        std::copy(bitmap.begin() + offset, bitmap.begin() + offset + chunkSize, block.begin());
+        diskManager.writeMetadataBlock(layout.freeBlockVectorStart + i, block);
+    }
+    if (segmentManager) {
+        segmentManager->commit();
+        if (segmentManager->needsCheckpoint()) {
+            segmentManager->checkpoint();
+        }
+    } else {
+        diskManager.flushChecksums(); // The table commits with the blocks it describes
+        journal->commit();
+    }
+    freeBlockManager.releaseBlocks(freed);
+}
+
+// Clean segments in a low-priority background thread (LFS mode only; 0 = default watermarks)
+void LLFS::startCleaner(size_t lowWatermark, size_t highWatermark) {
+    if (!segmentManager) {
+        throw std::runtime_error("No segment log in in-place mode.");
+    }
+    segmentManager->startCleaner(lowWatermark, highWatermark);
+}
+
+// Stop the background segment cleaner
+void LLFS::stopCleaner() {
+    if (segmentManager) {
+        segmentManager->stopCleaner();
+    }
+}
+
+// Scrub the mounted file system in a background thread, reading at most blocksPerSecond blocks
+// per second; resumes from the cursor a previous scrubber saved
+void LLFS::startScrubber(size_t blocksPerSecond) {
+    checkWritable();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (!scrubber) {
+        scrubber = std::make_unique<Scrubber>(diskManager, inodeManager, freeBlockManager, segmentManager.get(),
+                                              layout, mutex);
+    }
+    scrubber->start(blocksPerSecond);
+}
+
+// Stop the background scrubber and save its cursor (must not be called with the lock held)
+void LLFS::stopScrubber() {
+    if (scrubber) {
+        scrubber->stop();
+    }
+}
+
+// Get the scrubber's progress and findings (empty if it never ran)
+ScrubStats LLFS::getScrubStats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return scrubber ? scrubber->getStats() : ScrubStats();
+}
+
+// Get the inode manager (for statistics)
+const InodeManager& LLFS::getInodeManager() const {
+    return inodeManager;
+}
+
+// Find the inodes matching a metadata query, in inode order
+std::vector<uint32_t> LLFS::findInodes(const InodeQuery& query) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return MetadataQuery(inodeManager.getColumns()).find(query);
+}
+
+// Find the inodes modified at or after a time (seconds since the epoch), oldest first
+std::vector<uint32_t> LLFS::findModifiedSince(uint32_t time) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return MetadataQuery(inodeManager.getColumns()).modifiedSince(time);
+}
+
+// Get the directory manager (for statistics)
+const DirectoryManager& LLFS::getDirectoryManager() const {
+    return directoryManager;
+}
+
+// Get the metadata journal (for statistics; in-place mode only)
+const Journal& LLFS::getJournal() const {
+    if (!journal) {
+        throw std::runtime_error("No journal in log-structured mode.");
+    }
+    return *journal;
+}
+
+// Get the segment log (for statistics; LFS mode only)
+const SegmentManager& LLFS::getSegmentManager() const {
+    if (!segmentManager) {
+        throw std::runtime_error("No segment log in in-place mode.");
+    }
+    return *segmentManager;
+}
+
+// Get the disk manager (for statistics)
+const DiskManager& LLFS::getDiskManager() const {
+    return diskManager;
+}
+
+// Get the snapshots (for statistics; in-place mode only)
+const SnapshotManager& LLFS::getSnapshotManager() const {
+    if (!snapshots) {
+        throw std::runtime_error("No snapshots in log-structured mode.");
+    }
+    return *snapshots;
+}
+
+// Helper function to map a path to a regular file inode
+uint32_t LLFS::resolveFile(const std::string& path) {
+    uint32_t inodeId = directoryManager.resolvePath(path);
+    if (inodeManager.getInode(inodeId).fileType != 1) { // A copy: the inode's lock is not held yet
+        throw std::runtime_error("Not a file: " + path);
+    }
+    return inodeId;
+}
+
+// Helper function to get the lock guarding an inode's data
+std::shared_mutex& LLFS::inodeLock(uint32_t inodeId) const {
+    return inodeLocks[inodeId % INODE_LOCK_STRIPES];
+}
+
+// Helper function to drop a file's reference to a plain data block
+void LLFS::releaseBlock(uint32_t blockNumber) {
+    std::lock_guard<std::recursive_mutex> lock(dedupMutex);
+    freeBlockManager.freeBlock(blockNumber);
+}
+
+// Helper function to drop the references once no lock-free reader can be reading the blocks
+void LLFS::retireBlocks(std::vector<uint32_t> blockNumbers) {
+    if (blockNumbers.empty()) return;
+    epochs.retire([this, blocks = std::move(blockNumbers)] {
+        for (uint32_t block : blocks) {
+            releaseBlock(block);
+        }
+    });
+}
+
+// Helper function to read a file from its published inode without taking a lock
+bool LLFS::readPublished(const std::string& fileName, std::vector<char>& data) {
+    LockFreeRead read;
+    if (!beginLockFreeRead(fileName, read)) {
+        return false;
+    }
+
+    // Published blocks are never written again, and not freed before the read ends
+    data.assign(read.fileSize, 0);
+    try {
+        for (size_t i = 0, offset = 0; i < 10 && offset < data.size(); ++i, offset += blockSize) {
+            if (read.blocks[i] != 0) { // Holes are already zeros
+                std::vector<char> blockData = diskManager.readDataBlock(read.blocks[i]);
+                std::copy_n(blockData.begin(), std::min(blockSize, data.size() - offset), data.begin() + offset);
+            }
+        }
+    } catch (const std::exception&) {
+        if (!endLockFreeRead(read)) {
+            return false; // The file went (and maybe the whole file system) while it was read
+        }
+        throw;
+    }
+    return endLockFreeRead(read);
+}
+
+// Helper function to publish an inode for lock-free readers (the inode lock held)
+void LLFS::publishInode(uint32_t inodeId, const Inode& inode) {
+    const Inode* published = nullptr;
+    if (!segmentManager && inode.fileType == 1 && !(inode.flags & (INODE_FLAG_COMPRESSED | INODE_FLAG_PACKED))) {
+        published = new Inode(inode); // The log moves blocks, compressed files are read whole and
+                                      // pack blocks are written in place
+    }
+    const Inode* previous = publishedInodes[inodeId].exchange(published);
+    if (previous) {
+        epochs.retire([old = std::shared_ptr<const Inode>(previous)] {}); // Deleted with the callback
+    }
+}
+
+// Helper function to unpublish every inode (namespace lock held exclusively)
+void LLFS::unpublishInodes() {
+    for (size_t i = 0; i < layout.numberOfInodes; ++i) {
+        publishInode(static_cast<uint32_t>(i), Inode{});
+    }
+}
+
+// Serve reads of published inodes without locks
+void LLFS::setLockFreeReads(bool enabled) {
+    lockFreeReads = enabled && !readOnly; // Lock-free readers read home locations
+}
+
+// Get how reads were served
+ReadPathStats LLFS::getReadPathStats() const {
+    ReadPathStats stats;
+    stats.lockedReads = lockedReads.load();
+    stats.retiredPending = epochs.getPending();
+    stats.retiredReclaimed = epochs.getReclaimed();
+    return stats;
+}
+
+// Compress files written from now on
+void LLFS::setCompression(bool enabled) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    compression = enabled;
+}
+
+// Get the compression savings so far
+CompressionStats LLFS::getCompressionStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return compressionStats;
+}
+
+// Deduplicate file blocks written from now on
+void LLFS::setDeduplication(bool enabled) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (!enabled) {
+        dedupIndex.reset();
+        return;
+    }
+    if (!dedupIndex) {
+        dedupIndex = std::make_unique<DedupIndex>(layout.volumeBlocks);
+        indexFileBlocks();
+    }
+}
+
+// Get the deduplication savings and the current dedup ratio
+DedupStats LLFS::getDedupStats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    DedupStats stats;
+    {
+        std::lock_guard<std::recursive_mutex> dedupLock(dedupMutex);
+        stats = dedupStats;
+        if (dedupIndex) {
+            stats.indexEntries = dedupIndex->getSize();
+            stats.indexMemoryBytes = dedupIndex->getMemoryUsage();
+        }
+    }
+    std::vector<bool> seen(layout.volumeBlocks, false);
+    for (size_t inodeId = 0; inodeId < inodeManager.getTotalInodes(); ++inodeId) {
+        if (!inodeManager.isAllocated(inodeId)) continue;
+        Inode inode = inodeManager.getInode(inodeId);
+        if (inode.fileType != 1 || (inode.flags & (INODE_FLAG_COMPRESSED | INODE_FLAG_PACKED))) continue;
+        for (uint16_t block : inode.directBlocks) {
+            if (block == 0 || block >= seen.size()) continue;
+            ++stats.logicalBlocks;
+            if (!seen[block]) {
+                seen[block] = true;
+                ++stats.physicalBlocks;
+            }
+        }
+    }
+    return stats;
+}
+
+// Logical over physical blocks (1 when nothing is shared)
+double DedupStats::ratio() const {
+    return physicalBlocks == 0 ? 1.0 : double(logicalBlocks) / physicalBlocks;
+}
+
+// Pack small files written from now on into shared blocks
+void LLFS::setPacking(bool enabled) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    packing = enabled;
+}
+
+// Get how many small files are packed, in how many blocks
+PackingStats LLFS::getPackingStats() const {
+    PackingStats stats;
+    stats.filesPacked = fragments.getFragments();
+    stats.packBlocks = fragments.getPackBlocks();
+    stats.cacheHits = fragments.getCacheHits();
+    stats.cacheMisses = fragments.getCacheMisses();
+    return stats;
+}
+
+// Packed files per pack block
+double PackingStats::filesPerBlock() const {
+    return packBlocks == 0 ? 0.0 : double(filesPacked) / packBlocks;
+}
+
+// Get the cache of decompressed clusters (for statistics)
+const ClusterCache& LLFS::getClusterCache() const {
+    return clusterCache;
+}
+
+// Helper function to store one block of plain file data, sharing an identical block when deduplicating
+uint32_t LLFS::storeBlock(const std::vector<char>& blockData) {
+    DedupIndex::Fingerprint fingerprint;
+    if (dedupIndex) {
+        fingerprint = DedupIndex::fingerprint(blockData.data(), blockData.size());
+        std::lock_guard<std::recursive_mutex> lock(dedupMutex);
+        ++dedupStats.blocksWritten;
+        uint32_t stored = dedupIndex->find(fingerprint);
+        if (stored != 0) {
+            freeBlockManager.addReference(stored);
+            ++dedupStats.blocksDeduplicated;
+            return stored;
+        }
+    }
+
+    // Allocated and written without the lock; a writer that stored the same block meanwhile
+    // keeps its copy in the index
+    uint32_t blockNumber = static_cast<uint32_t>(freeBlockManager.allocateBlock());
+    if (blockNumber > UINT16_MAX) { // Only on volumes formatted before the layout capped them
+        releaseBlock(blockNumber);
+        throw std::runtime_error("Block number does not fit in a block pointer.");
+    }
+    diskManager.writeBlock(blockNumber, blockData);
+    if (dedupIndex) {
+        std::lock_guard<std::recursive_mutex> lock(dedupMutex);
+        if (dedupIndex->find(fingerprint) == 0) {
+            dedupIndex->insert(fingerprint, blockNumber);
+        }
+    }
+    return blockNumber;
+}
+
+// Helper function to fingerprint the blocks of the plain files already written
+void LLFS::indexFileBlocks() {
+    size_t indexed = 0;
+    for (size_t inodeId = 0; inodeId < inodeManager.getTotalInodes(); ++inodeId) {
+        if (!inodeManager.isAllocated(inodeId)) continue;
+        Inode inode = inodeManager.getInode(inodeId);
+        if (inode.fileType != 1 || (inode.flags & (INODE_FLAG_COMPRESSED | INODE_FLAG_PACKED))) continue;
+        for (uint16_t block : inode.directBlocks) {
+            if (block == 0) continue;
+            std::vector<char> blockData;
+            try {
+                blockData = diskManager.readBlock(block);
+            } catch (const std::exception&) {
+                continue; // Damaged blocks are left to the scrubber, and never shared
+            }
+            DedupIndex::Fingerprint fingerprint = DedupIndex::fingerprint(blockData.data(), blockData.size());
+            if (dedupIndex->find(fingerprint) == 0) {
+                dedupIndex->insert(fingerprint, block);
+                ++indexed;
+            }
+        }
+    }
+    LLFS_LOG_INFO("LLFS", "Deduplication index built: blocks=", indexed);
+}
+
+// Helper function to store a small file's data as a fragment and point the inode at it
+void LLFS::packFile(Inode& inode, const std::vector<char>& data) {
+    Fragment fragment = fragments.store(data.data(), data.size());
+    if (fragment.block > UINT16_MAX) { // Only on volumes formatted before the layout capped them
+        fragments.release(fragment);
+        throw std::runtime_error("Block number does not fit in a block pointer.");
+    }
+    inode.directBlocks[0] = static_cast<uint16_t>(fragment.block);
+    inode.flags |= static_cast<uint8_t>(INODE_FLAG_PACKED | (fragment.slot << INODE_SLOT_SHIFT));
+}
+
+// Helper function to get where a packed file's data is
+Fragment LLFS::fragmentOf(const Inode& inode) {
+    return Fragment{inode.directBlocks[0], static_cast<uint32_t>(inode.flags >> INODE_SLOT_SHIFT)};
+}
+
+// Helper function to take a packed file's fragment out of its inode
+Fragment LLFS::takeFragment(Inode& inode) {
+    if (!(inode.flags & INODE_FLAG_PACKED)) {
+        return Fragment{};
+    }
+    Fragment fragment = fragmentOf(inode);
+    inode.directBlocks[0] = 0;
+    inode.flags &= static_cast<uint8_t>(~(INODE_FLAG_PACKED | (0xFF << INODE_SLOT_SHIFT)));
+    return fragment;
+}
+
+// Helper function to record the fragments of the packed files on disk
+void LLFS::indexFragments() {
+    for (size_t inodeId = 0; inodeId < inodeManager.getTotalInodes(); ++inodeId) {
+        if (!inodeManager.isAllocated(inodeId)) continue;
+        Inode inode = inodeManager.getInode(inodeId);
+        if (inode.fileType == 1 && (inode.flags & INODE_FLAG_PACKED)) {
+            fragments.addFragment(fragmentOf(inode), inode.fileSize);
+        }
+    }
+    LLFS_LOG_INFO("LLFS", "Packed files indexed: files=", fragments.getFragments(),
+                  " packBlocks=", fragments.getPackBlocks());
+}
+
+// Helper function to check that a file of size bytes fits in compressed clusters
+void LLFS::checkClusterLimit(size_t size) const {
+    const size_t clusters = (size + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+    if (clusters * clusterSlots() > blockMap.getMaxBlocks()) {
+        throw std::runtime_error("File size exceeds the maximum file size.");
+    }
+}
+
+// Helper function to write a file's data as compressed clusters
+void LLFS::writeClusters(Inode& inode, const std::vector<char>& data) {
+    checkClusterLimit(data.size());
+    const size_t clusters = (data.size() + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+    for (size_t cluster = 0; cluster < clusters; ++cluster) {
+        size_t offset = cluster * CLUSTER_SIZE;
+        writeCluster(inode, cluster, data.data() + offset, std::min(CLUSTER_SIZE, data.size() - offset));
+    }
+    inode.flags |= INODE_FLAG_COMPRESSED;
+}
+
+// Helper function to store one cluster of rawSize bytes (nothing if it is all zeros)
+void LLFS::writeCluster(Inode& inode, size_t cluster, const char* raw, size_t rawSize) {
+    auto blocksFor = [this](size_t storedSize) {
+        return (sizeof(ClusterHeader) + storedSize + blockSize - 1) / blockSize;
+    };
+    if (ZeroDetector::isZero(raw, rawSize)) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        compressionStats.bytesWritten += rawSize;
+        ++compressionStats.clustersSkipped; // An unmapped cluster reads back as zeros
+        return;
+    }
+
+    // Keep the cluster raw unless compressing it saves at least a block
+    std::vector<char> compressed = Lz4::compress(raw, rawSize);
+    ClusterHeader header = {static_cast<uint32_t>(compressed.size()), CLUSTER_LZ4};
+    const char* payload = compressed.data();
+    if (blocksFor(compressed.size()) >= blocksFor(rawSize)) {
+        header = {static_cast<uint32_t>(rawSize), CLUSTER_RAW};
+        payload = raw;
+    }
+
+    size_t blocks = blocksFor(header.storedSize);
+    std::vector<char> stored(blocks * blockSize, 0);
+    std::memcpy(stored.data(), &header, sizeof(header));
+    std::memcpy(stored.data() + sizeof(header), payload, header.storedSize);
+    for (size_t i = 0; i < blocks; ++i) {
+        uint32_t blockNumber = blockMap.map(inode, cluster * clusterSlots() + i);
+        diskManager.writeBlock(blockNumber, std::vector<char>(stored.begin() + i * blockSize,
+                                                              stored.begin() + (i + 1) * blockSize));
+    }
+    std::lock_guard<std::mutex> lock(statsMutex);
+    compressionStats.bytesWritten += rawSize;
+    ++(header.codec == CLUSTER_RAW ? compressionStats.clustersStoredRaw : compressionStats.clustersCompressed);
+    compressionStats.bytesStored += stored.size();
+}
+
+// Helper function to free the blocks of one cluster, leaving a hole
+void LLFS::releaseCluster(Inode& inode, size_t cluster) {
+    const size_t first = cluster * clusterSlots();
+    std::vector<uint32_t> blocks = blockMap.lookupRange(inode, first, clusterSlots());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (blocks[i] != 0) {
+            blockMap.unmap(inode, first + i);
+        }
+    }
+}
+
+// Helper function to read a compressed file through the cluster cache
+std::vector<char> LLFS::readClusters(uint32_t inodeId, const Inode& inode) {
+    std::vector<char> data(inode.fileSize);
+    for (size_t cluster = 0, offset = 0; offset < data.size(); ++cluster, offset += CLUSTER_SIZE) {
+        size_t rawSize = std::min(CLUSTER_SIZE, data.size() - offset);
+        auto cached = clusterCache.lookup(inodeId, static_cast<uint32_t>(cluster));
+        if (cached && cached->size() == rawSize) {
+            std::memcpy(data.data() + offset, cached->data(), rawSize);
+            continue;
+        }
+        std::vector<char> contents = readCluster(inode, cluster, rawSize);
+        std::memcpy(data.data() + offset, contents.data(), rawSize);
+        clusterCache.insert(inodeId, static_cast<uint32_t>(cluster), std::move(contents));
+    }
+    return data;
+}
+
+// Helper function to read and decompress one cluster of rawSize bytes
+std::vector<char> LLFS::readCluster(const Inode& inode, size_t cluster, size_t rawSize) {
+    const size_t first = cluster * clusterSlots();
+    uint32_t headBlock = blockMap.lookup(inode, first);
+    if (headBlock == 0) {
+        return std::vector<char>(rawSize, 0); // A hole
+    }
+    std::vector<char> stored = diskManager.readBlock(headBlock);
+    ClusterHeader header;
+    std::memcpy(&header, stored.data(), sizeof(header));
+    size_t blocks = (sizeof(header) + header.storedSize + blockSize - 1) / blockSize;
+    if (header.codec > CLUSTER_LZ4 || blocks > clusterSlots() ||
+        (header.codec == CLUSTER_RAW && header.storedSize != rawSize)) {
+        throw std::runtime_error("Corrupt compressed file: bad header in cluster " + std::to_string(cluster) + ".");
+    }
+
+    // The rest of the cluster, one indirect block read for all its pointers
+    for (uint32_t blockNumber : blockMap.lookupRange(inode, first + 1, blocks - 1)) {
+        if (blockNumber == 0) {
+            throw std::runtime_error("Corrupt compressed file: cluster " + std::to_string(cluster) + " is short.");
+        }
+        std::vector<char> block = diskManager.readBlock(blockNumber);
+        stored.insert(stored.end(), block.begin(), block.end());
+    }
+
+    std::vector<char> contents(rawSize);
+    const char* payload = stored.data() + sizeof(header);
+    if (header.codec == CLUSTER_RAW) {
+        std::memcpy(contents.data(), payload, rawSize);
+    } else if (Lz4::decompress(payload, header.storedSize, contents.data(), rawSize) != rawSize) {
+        throw std::runtime_error("Corrupt compressed file: cluster " + std::to_string(cluster) + " is short.");
+    }
+    return contents;
+}
+
+// Helper function to get the logical blocks reserved for each cluster (a raw cluster plus its header)
+size_t LLFS::clusterSlots() const {
+    return (CLUSTER_SIZE + sizeof(ClusterHeader) + blockSize - 1) / blockSize;
+}
+
+// Helper function to check whether the running transaction holds a quarter of the journal, or
+// the log needs a checkpoint
+bool LLFS::commitDue() const {
+    if (journal) {
+        return journal->getPendingBlocks() * 4 >= journal->getCapacity();
+    }
+    return segmentManager && segmentManager->needsCheckpoint();
+}
+
+// Helper function to commit if it is due and no transaction is open (namespace lock held
+// exclusively)
+void LLFS::commitIfNeeded() {
+    if (!transactionOpen && commitDue()) {
+        commitTransaction();
+    }
+}
+
+// Helper function to commit if it is due, after an operation released its shared locks (another
+// thread may have committed in between, so it is checked again)
+void LLFS::commitIfNeededUnlocked() {
+    if (!transactionOpen && commitDue()) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        commitIfNeeded();
+    }
+}
+
+// Helper function to mount a snapshot of another file system read-only
+void LLFS::mountView(SnapshotManager& source, const std::string& name) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    snapshotId = source.attachView(name);
+    snapshotSource = &source;
+    readOnly = true;
+    lockFreeReads = false;
+
+    // Nothing is replayed: a snapshot is taken right after a checkpoint
+    diskManager.setJournal(nullptr);
+    diskManager.setSnapshotManager(nullptr);
+    diskManager.setSnapshotView(&source, snapshotId);
+    snapshots.reset();
+    CrashRecovery recovery(diskManager, freeBlockManager, inodeManager, directoryManager, nullptr, nullptr);
+    recovery.recover();
+    indexFragments();
+    LLFS_LOG_INFO("LLFS", "Snapshot mounted: name=", name);
+}
+
+// Helper function to throw if the file system is a mounted snapshot
+void LLFS::checkWritable() const {
+    if (readOnly) {
+        throw std::runtime_error("Snapshots are read-only.");
+    }
+}
+
+// NamespaceChange
+
+LLFS::NamespaceChange::NamespaceChange(std::atomic<uint64_t>& sequence) : sequence(sequence) {
+    sequence.fetch_add(1); // Odd: readers go through the locks
+}
+
+LLFS::NamespaceChange::~NamespaceChange() {
+    sequence.fetch_add(1, std::memory_order_release);
+}
+
+// Helper function to drop freed blocks from the log, so the segment usage stays accurate, and
+// from the fingerprint index
+void LLFS::attachFreeHook() {
+    freeBlockManager.setFreeHook([this](size_t blockNumber) {
+        if (segmentManager) {
+            segmentManager->discardBlock(blockNumber);
+        }
+        std::lock_guard<std::recursive_mutex> lock(dedupMutex);
+        if (dedupIndex) {
+            dedupIndex->remove(static_cast<uint32_t>(blockNumber));
+        }
+    });
+}
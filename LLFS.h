@@ -5,44 +5,442 @@
 #include "FreeBlockManager.h"
 #include "InodeManager.h"
 #include "DirectoryManager.h"
+#include "Journal.h"
+#include "SegmentManager.h"
+#include "SnapshotManager.h"
+#include "CrashRecovery.h"
+#include "Scrubber.h"
+#include "BlockMap.h"
+#include "ClusterCache.h"
+#include "FragmentStore.h"
+#include "DedupIndex.h"
+#include "EpochManager.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include "MetadataQuery.h"
 #include <string>
 #include <vector>
 
+// What compression has saved (files written while it was on)
+struct CompressionStats {
+    size_t clustersCompressed = 0;  // Clusters stored compressed
+    size_t clustersStoredRaw = 0;   // Clusters that would not have saved a block
+    size_t clustersSkipped = 0;     // All-zero clusters left as holes
+    size_t bytesWritten = 0;        // File bytes written
+    size_t bytesStored = 0;         // Bytes of the blocks holding them
+};
+
+// What deduplication has saved: write counters since it was turned on, and the sharing of the
+// plain file data currently stored
+struct DedupStats {
+    size_t blocksWritten = 0;       // File blocks written while it was on
+    size_t blocksDeduplicated = 0;  // ... that were already stored and only gained a reference
+    size_t logicalBlocks = 0;       // Plain file data blocks the inodes point at
+    size_t physicalBlocks = 0;      // Distinct blocks holding them
+    size_t indexEntries = 0;        // Fingerprints in the index
+    size_t indexMemoryBytes = 0;    // Memory of the index (fixed by the volume size)
+
+    // Logical over physical blocks (1 when nothing is shared)
+    double ratio() const;
+};
+
+// How small files are packed
+struct PackingStats {
+    size_t filesPacked = 0;         // Files stored as fragments
+    size_t packBlocks = 0;          // Blocks holding them
+    size_t cacheHits = 0;           // Fragment reads served from a cached pack block
+    size_t cacheMisses = 0;         // ... and those that read it from the disk
+
+    // Packed files per pack block
+    double filesPerBlock() const;
+};
+
+// How reads were served, and what waits for lock-free readers to move on
+struct ReadPathStats {
+    size_t lockedReads = 0;         // Reads that took the locks (the rest read a published inode)
+    size_t retiredPending = 0;      // Old inodes and freed blocks waiting for a grace period
+    size_t retiredReclaimed = 0;    // ... and reclaimed after one
+};
+
+// Metadata of one path, from statFiles
+struct FileStat {
+    uint32_t inodeId = 0;
+    uint8_t fileType = 0;           // 0 = does not exist, 1 = file, 2 = directory
+    uint32_t fileSize = 0;
+    uint32_t modificationTime = 0;
+};
+
+// A lock-free read in progress: the blocks of a file's published inode, which are not reused
+// while it is open
+struct LockFreeRead {
+    std::optional<EpochManager::Guard> guard;
+    uint64_t sequence = 0;          // Namespace sequence when it began
+    size_t fileSize = 0;
+    std::array<uint16_t, 10> blocks{}; // 0 = hole
+};
+
+// The file system. Safe to use from several threads: operations on different files run in
+// parallel, as do reads of the same file; creates, deletes and commits run alone.
 class LLFS {
 public:
-    // Constructor
-    LLFS(const std::string& diskName, size_t diskSize, size_t blockSize = 512);
+    // Compressed files are split into clusters of this many bytes, compressed one by one
+    static constexpr size_t CLUSTER_SIZE = 64 * 1024;
+
+    // Constructor; LFS mode (WriteMode::LogStructured) appends every write to segments;
+    // blockChecksums (in-place mode) verifies a CRC32C of every block on read
+    LLFS(const std::string& diskName, size_t diskSize, size_t blockSize = 512,
+         WriteMode writeMode = WriteMode::InPlace, bool blockChecksums = false);
+
+    // Destructor
+    ~LLFS();
 
     // Format the file system
     void formatFileSystem();
 
-    // Create a file
+    // Load an existing file system from disk (runs crash recovery)
+    void mount();
+
+    // Commit, then run a full consistency check across threadCount threads (0 = one per core);
+    // with repair, the fixes are committed too
+    ConsistencyReport checkConsistency(bool repair = true, size_t threadCount = 0);
+
+    // Create a file (paths may name nested directories, e.g. "/docs/notes")
     void createFile(const std::string& fileName);
 
+    // Create many files at once: every name is checked first and nothing is created if one
+    // fails. Inodes are allocated in bulk, each directory is updated once, and the batch is
+    // durable on return with one journal write (inside a transaction, it commits with it)
+    void createFiles(const std::vector<std::string>& fileNames);
+
     // Write data to a file
     void writeFile(const std::string& fileName, const std::vector<char>& data);
 
-    // Read data from a file
+    // Read data from a file; plain files in in-place mode are read without taking a lock once
+    // their inode is published (by the first read or a write)
     std::vector<char> readFile(const std::string& fileName);
 
+    // Resolve a file and publish its inode, so later reads of it take no lock; returns its inode
+    uint32_t openFile(const std::string& fileName);
+
+    // Begin a lock-free read of a file: fills in its blocks, to be read straight from the disk
+    // file and checked with DiskManager::checkDataBlock. False if the file must be read with
+    // readFile, or, without waitForSlot, if every epoch slot is taken
+    bool beginLockFreeRead(const std::string& fileName, LockFreeRead& read, bool waitForSlot = true);
+
+    // Check a block of a lock-free read against its checksum; throws if it fails
+    void checkLockFreeBlock(uint16_t blockNumber, const std::vector<char>& data);
+
+    // End a lock-free read; false if the namespace changed meanwhile and the data must be read
+    // again with readFile
+    bool endLockFreeRead(LockFreeRead& read);
+
     // Delete a file
     void deleteFile(const std::string& fileName);
 
+    // Delete many files at once: all must exist and nothing is deleted if one does not. Each
+    // directory is updated once, and the batch is durable on return with one journal write
+    // (inside a transaction, it commits with it)
+    void deleteFiles(const std::vector<std::string>& fileNames);
+
+    // Get the metadata of many paths, resolving each parent directory once; paths that do not
+    // exist come back with fileType 0 (a missing parent directory throws)
+    std::vector<FileStat> statFiles(const std::vector<std::string>& paths);
+
+    // Free the blocks behind length bytes from offset, which read back as zeros (the file size
+    // does not change); blocks only partly inside the range are zeroed in a new copy
+    void punchHole(const std::string& fileName, size_t offset, size_t length);
+
+    // Create a file holding the same data as another without copying it: the clone shares the
+    // source's blocks, which gain a reference each, so it takes the same time however large the
+    // file is. Writes to either file go to new blocks (compressed files are copied instead)
+    void cloneFile(const std::string& sourceName, const std::string& cloneName);
+
     // Create a directory
     void createDirectory(const std::string& dirName);
 
-    // Delete a directory
+    // Delete an empty directory
     void deleteDirectory(const std::string& dirName);
 
     std::vector<DirectoryEntry> listDirectory(const std::string &path);
 
+    // Append up to maxEntries directory entries starting at a cookie (0 = beginning); returns
+    // the cookie for the next batch, or READDIR_END
+    uint64_t readDirectory(const std::string& path, uint64_t cookie, size_t maxEntries,
+                           std::vector<DirectoryEntry>& batch);
+
+    // Find the inodes matching a metadata query, in inode order
+    std::vector<uint32_t> findInodes(const InodeQuery& query) const;
+
+    // Find the inodes modified at or after a time (seconds since the epoch), oldest first
+    std::vector<uint32_t> findModifiedSince(uint32_t time) const;
+
+    // Begin a transaction: the creates, writes and deletes until the next commit (from every
+    // thread) form one atomic unit. Nothing is committed before then and blocks freed meanwhile
+    // are not reused, so after a crash either all of it is on disk or none of it. It must fit in
+    // the free space
+    void beginTransaction();
+
+    // Make all metadata changes so far durable with one journal write (a commit mark in the
+    // log in LFS mode), ending any transaction; outside a transaction, operations call this
+    // themselves once enough metadata has piled up
+    void commit();
+
+    // Commit, then write journaled metadata to its home locations (a checkpoint in LFS mode)
+    void sync();
+
+    // Take a copy-on-write snapshot of the whole file system (in-place mode, outside a
+    // transaction). It commits and checkpoints, then pins the blocks in use without copying
+    // any, so it takes the same time however much data there is. Until the snapshot is
+    // deleted its blocks are not reused, and metadata blocks are copied out before they are
+    // first overwritten
+    void snapshot(const std::string& name);
+
+    // Delete a snapshot, freeing the blocks only it kept
+    void deleteSnapshot(const std::string& name);
+
+    // List the snapshots, oldest first
+    std::vector<SnapshotInfo> listSnapshots() const;
+
+    // Mount a snapshot read-only next to this file system, which must outlive it: it can be read
+    // and listed, and anything that would change it throws
+    std::unique_ptr<LLFS> mountSnapshot(const std::string& name);
+
+    // Clean segments in a low-priority background thread (LFS mode only; 0 = default
+    // watermarks); writers still clean inline when the log runs out of clean segments
+    void startCleaner(size_t lowWatermark = 0, size_t highWatermark = 0);
+
+    // Stop the background segment cleaner
+    void stopCleaner();
+
+    // Scrub the mounted file system in a background thread, reading at most blocksPerSecond
+    // blocks per second; resumes from the cursor a previous scrubber saved
+    void startScrubber(size_t blocksPerSecond);
+
+    // Stop the background scrubber and save its cursor
+    void stopScrubber();
+
+    // Get the scrubber's progress and findings (empty if it never ran)
+    ScrubStats getScrubStats() const;
+
+    // Compress files written from now on (files already written keep their format): each
+    // cluster is stored with LZ4 in as few blocks as it needs, and read back through the
+    // cluster cache
+    void setCompression(bool enabled);
+
+    // Get the compression savings so far
+    CompressionStats getCompressionStats() const;
+
+    // Deduplicate file blocks written from now on: a block whose SHA-256 fingerprint is already
+    // in the index only gains a reference to the stored copy. Turning it on indexes the blocks
+    // of the files already written; compressed files are not deduplicated
+    void setDeduplication(bool enabled);
+
+    // Get the deduplication savings and the current dedup ratio
+    DedupStats getDedupStats() const;
+
+    // Pack files written from now on that fit in half a block (and are not compressed) into
+    // slots of shared pack blocks, several per block; files already written keep their format.
+    // Pack blocks are cached, so small files written together are read together
+    void setPacking(bool enabled);
+
+    // Get how many small files are packed, in how many blocks
+    PackingStats getPackingStats() const;
+
+    // Serve reads of published inodes without locks (on by default)
+    void setLockFreeReads(bool enabled);
+
+    // Get how reads were served
+    ReadPathStats getReadPathStats() const;
+
+    // Get the cache of decompressed clusters (for statistics)
+    const ClusterCache& getClusterCache() const;
+
+    // Get the inode manager (for statistics)
+    const InodeManager& getInodeManager() const;
+
+    // Get the directory manager (for statistics)
+    const DirectoryManager& getDirectoryManager() const;
+
+    // Get the metadata journal (for statistics; in-place mode only)
+    const Journal& getJournal() const;
+
+    // Get the segment log (for statistics; LFS mode only)
+    const SegmentManager& getSegmentManager() const;
+
+    // Get the disk manager (for statistics)
+    const DiskManager& getDiskManager() const;
+
+    // Get the snapshots (for statistics; in-place mode only)
+    const SnapshotManager& getSnapshotManager() const;
+
 private:
     DiskManager diskManager;
+    Superblock layout;
+    std::unique_ptr<Journal> journal;               // In-place mode
+    std::unique_ptr<SegmentManager> segmentManager; // LFS mode
+    std::unique_ptr<SnapshotManager> snapshots;     // In-place mode, except in a snapshot
     FreeBlockManager freeBlockManager;
     InodeManager inodeManager;
     DirectoryManager directoryManager;
+    BlockMap blockMap;              // File blocks of compressed files
+    FragmentStore fragments;        // Packed small files
+    bool packing = false;
 
     size_t blockSize;
+
+    // Compression: a cluster occupies a fixed run of logical blocks, starting with a header and
+    // followed by unmapped blocks where it shrank
+    struct ClusterHeader {
+        uint32_t storedSize;        // Bytes after the header
+        uint32_t codec;             // CLUSTER_RAW or CLUSTER_LZ4
+    };
+    static constexpr uint32_t CLUSTER_RAW = 0;
+    static constexpr uint32_t CLUSTER_LZ4 = 1;
+    bool compression = false;
+    CompressionStats compressionStats;
+    ClusterCache clusterCache;
+
+    // Deduplication
+    std::unique_ptr<DedupIndex> dedupIndex; // Set while deduplication is on
+    DedupStats dedupStats;                  // Write counters
+
+    // Locking: the namespace lock is held shared by operations on existing files (reads, writes,
+    // lookups) and exclusively by those that change directories or allocate inodes, by commits
+    // (so a transaction never splits an operation) and by the scrubber. File data has a
+    // reader/writer lock per inode, striped over a fixed table; an operation holds at most one.
+    // Directory changes are not sharded: changes in unrelated directories still run one at a
+    // time. They allocate from the unlocked inode bitmap, move the namespace sequence that
+    // lock-free readers validate against (which assumes one change at a time), and rewrite
+    // directory blocks that lookups scan under the shared lock alone. Sharding them would put a
+    // per-directory lock on every path component of every lookup
+    static constexpr size_t INODE_LOCK_STRIPES = 64;
+    mutable std::shared_mutex mutex;
+    mutable std::array<std::shared_mutex, INODE_LOCK_STRIPES> inodeLocks;
+    mutable std::recursive_mutex dedupMutex; // Guards dedupIndex and dedupStats; held while plain
+                                             // blocks are freed
+    mutable std::mutex statsMutex;           // Guards compressionStats
+
+    // Lock-free reads: a reader resolves the path through the dentry cache and reads the
+    // published copy of the inode inside an epoch. Writers never overwrite file blocks in place;
+    // they publish the new inode and retire the old one and the blocks they freed, which are
+    // reclaimed after a grace period (commits wait for it, so the bitmap on disk never lists a
+    // block a reader might still use). Namespace changes make the sequence odd while they run;
+    // a reader that sees it change falls back to the locked path
+    EpochManager epochs;
+    std::unique_ptr<std::atomic<const Inode*>[]> publishedInodes; // Null: read under the locks
+    std::atomic<uint64_t> namespaceSequence{0};
+    std::atomic<bool> lockFreeReads{true};
+    std::atomic<size_t> lockedReads{0};
+
+    std::atomic<bool> transactionOpen{false}; // Between beginTransaction and commit (changed under
+                                              // the namespace lock)
+
+    // Marks a namespace change for lock-free readers while it lives (namespace lock held)
+    struct NamespaceChange {
+        explicit NamespaceChange(std::atomic<uint64_t>& sequence);
+        ~NamespaceChange();
+        std::atomic<uint64_t>& sequence;
+    };
+
+    std::unique_ptr<Scrubber> scrubber;      // Created by startScrubber; destroyed first
+
+    // A mounted snapshot reads through the snapshots of the file system it came from
+    bool readOnly = false;
+    SnapshotManager* snapshotSource = nullptr;
+    uint32_t snapshotId = 0;
+
+    // Helper function to mount a snapshot of another file system read-only
+    void mountView(SnapshotManager& source, const std::string& name);
+
+    // Helper function to throw if the file system is a mounted snapshot
+    void checkWritable() const;
+
+    // Helper function to map a path to a regular file inode
+    uint32_t resolveFile(const std::string& path);
+
+    // Helper function to get the lock guarding an inode's data
+    std::shared_mutex& inodeLock(uint32_t inodeId) const;
+
+    // Helper function to drop a file's reference to a plain data block (a shared block must not
+    // gain a reference while its last one goes)
+    void releaseBlock(uint32_t blockNumber);
+
+    // Helper function to drop the references once no lock-free reader can be reading the blocks
+    void retireBlocks(std::vector<uint32_t> blockNumbers);
+
+    // Helper function to read a file from its published inode without taking a lock; false if
+    // it has none or the namespace changed meanwhile
+    bool readPublished(const std::string& fileName, std::vector<char>& data);
+
+    // Helper function to publish an inode for lock-free readers (only plain files in in-place
+    // mode; anything else unpublishes it)
+    void publishInode(uint32_t inodeId, const Inode& inode);
+
+    // Helper function to unpublish every inode (after the inode table was reloaded or repaired)
+    void unpublishInodes();
+
+    // Helper function to store one block of plain file data, sharing an identical block when
+    // deduplicating
+    uint32_t storeBlock(const std::vector<char>& blockData);
+
+    // Helper function to fingerprint the blocks of the plain files already written
+    void indexFileBlocks();
+
+    // Helper function to store a small file's data as a fragment and point the inode at it
+    void packFile(Inode& inode, const std::vector<char>& data);
+
+    // Helper function to get where a packed file's data is
+    static Fragment fragmentOf(const Inode& inode);
+
+    // Helper function to take a packed file's fragment out of its inode, to be released once
+    // the new contents are stored (block 0 if the file is not packed)
+    static Fragment takeFragment(Inode& inode);
+
+    // Helper function to record the fragments of the packed files on disk (after a mount)
+    void indexFragments();
+
+    // Helper function to check that a file of size bytes fits in compressed clusters
+    void checkClusterLimit(size_t size) const;
+
+    // Helper function to write a file's data as compressed clusters
+    void writeClusters(Inode& inode, const std::vector<char>& data);
+
+    // Helper function to store one cluster of rawSize bytes (nothing if it is all zeros)
+    void writeCluster(Inode& inode, size_t cluster, const char* raw, size_t rawSize);
+
+    // Helper function to free the blocks of one cluster, leaving a hole
+    void releaseCluster(Inode& inode, size_t cluster);
+
+    // Helper function to read a compressed file through the cluster cache
+    std::vector<char> readClusters(uint32_t inodeId, const Inode& inode);
+
+    // Helper function to read and decompress one cluster of rawSize bytes
+    std::vector<char> readCluster(const Inode& inode, size_t cluster, size_t rawSize);
+
+    // Helper function to get the logical blocks reserved for each cluster
+    size_t clusterSlots() const;
+
+    // Helper function to make all metadata changes durable (namespace lock held exclusively)
+    void commitTransaction();
+
+    // Helper function to check whether the running transaction holds a quarter of the journal,
+    // or the log needs a checkpoint
+    bool commitDue() const;
+
+    // Helper function to commit if it is due and no transaction is open (namespace lock held
+    // exclusively)
+    void commitIfNeeded();
+
+    // Helper function to commit if it is due, after an operation released its shared locks
+    void commitIfNeededUnlocked();
+
+    // Helper function to drop freed blocks from the log, so the segment usage stays accurate, and
+    // from the fingerprint index
+    void attachFreeHook();
 };
 
 #endif // LLFS_H
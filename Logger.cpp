@@ -0,0 +1,203 @@
+#include "Logger.h"
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Initial runtime level: LLFS_LOG_LEVEL from the environment, else Info
+uint8_t initialLevel() {
+    const char* name = std::getenv("LLFS_LOG_LEVEL");
+    return static_cast<uint8_t>(name ? Logger::parseLevel(name) : LogLevel::Info);
+}
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Trace: return "TRACE";
+    case LogLevel::Debug: return "DEBUG";
+    case LogLevel::Info:  return "INFO";
+    case LogLevel::Warn:  return "WARN";
+    case LogLevel::Error: return "ERROR";
+    default:              return "OFF";
+    }
+}
+
+} // namespace
+
+std::atomic<uint8_t> Logger::currentLevel{initialLevel()};
+
+struct Logger::State {
+    std::mutex mutex;
+    std::condition_variable ready;    // Records were queued or the worker should stop
+    std::condition_variable drained;  // The ring buffer became empty
+    std::ostream* output = &std::cout;
+
+    // Ring buffer (only used in async mode)
+    std::vector<Record> ring;
+    size_t head = 0;                  // Oldest queued record
+    size_t count = 0;                 // Queued records
+    bool async = false;
+    bool stopping = false;
+    bool writing = false;             // The worker holds records it has not written yet
+    size_t dropped = 0;
+    std::thread worker;
+
+    // Stop the worker after it has written everything queued
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!async) {
+                return;
+            }
+            stopping = true;
+        }
+        ready.notify_all();
+        worker.join();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        async = false;
+        stopping = false;
+        ring.clear();
+        ring.shrink_to_fit();
+    }
+
+    ~State() {
+        stop();
+    }
+};
+
+Logger::State& Logger::state() {
+    static State instance;
+    return instance;
+}
+
+// Runtime level (initially from the LLFS_LOG_LEVEL environment variable, else Info)
+void Logger::setLevel(LogLevel level) {
+    currentLevel.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::getLevel() {
+    return static_cast<LogLevel>(currentLevel.load(std::memory_order_relaxed));
+}
+
+// Parse a level name ("trace", "debug", "info", "warn", "error", "off")
+LogLevel Logger::parseLevel(std::string_view name) {
+    if (name == "trace") return LogLevel::Trace;
+    if (name == "debug") return LogLevel::Debug;
+    if (name == "info") return LogLevel::Info;
+    if (name == "warn") return LogLevel::Warn;
+    if (name == "error") return LogLevel::Error;
+    if (name == "off") return LogLevel::Off;
+    throw std::invalid_argument("Unknown log level: " + std::string(name));
+}
+
+// Stream that receives log lines (std::cout by default)
+void Logger::setOutput(std::ostream& output) {
+    flush();
+    std::lock_guard<std::mutex> lock(state().mutex);
+    state().output = &output;
+}
+
+// Hand records to a background thread through a ring buffer of the given capacity
+void Logger::startAsync(size_t capacity) {
+    if (capacity == 0) {
+        throw std::invalid_argument("Log ring buffer capacity must be positive.");
+    }
+
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.async) {
+        return;
+    }
+    s.ring.assign(capacity, Record{});
+    s.head = 0;
+    s.count = 0;
+    s.async = true;
+    s.worker = std::thread([&s]() {
+        // Write records in small batches so the lock is not held during I/O
+        constexpr size_t BATCH = 64;
+        std::vector<Record> batch;
+        batch.reserve(BATCH);
+
+        std::unique_lock<std::mutex> lock(s.mutex);
+        while (true) {
+            s.ready.wait(lock, [&s]() { return s.count > 0 || s.stopping; });
+            if (s.count == 0) {
+                break; // Stopping and fully drained
+            }
+
+            batch.clear();
+            while (s.count > 0 && batch.size() < BATCH) {
+                batch.push_back(s.ring[s.head]);
+                s.head = (s.head + 1) % s.ring.size();
+                --s.count;
+            }
+            s.writing = true;
+            std::ostream* output = s.output;
+
+            lock.unlock();
+            for (const auto& record : batch) {
+                emit(*output, record);
+            }
+            lock.lock();
+
+            s.writing = false;
+            if (s.count == 0) {
+                output->flush();
+                s.drained.notify_all();
+            }
+        }
+        s.drained.notify_all();
+    });
+}
+
+// Drain the ring buffer and return to writing synchronously
+void Logger::stopAsync() {
+    state().stop();
+}
+
+// Wait until every queued record has been written
+void Logger::flush() {
+    State& s = state();
+    std::unique_lock<std::mutex> lock(s.mutex);
+    if (s.async) {
+        s.drained.wait(lock, [&s]() { return s.count == 0 && !s.writing; });
+    }
+    s.output->flush();
+}
+
+// Number of records dropped because the ring buffer was full
+size_t Logger::getDroppedCount() {
+    std::lock_guard<std::mutex> lock(state().mutex);
+    return state().dropped;
+}
+
+// Write a record or queue it for the background thread
+void Logger::submit(const Record& record) {
+    State& s = state();
+    std::unique_lock<std::mutex> lock(s.mutex);
+    if (!s.async) {
+        emit(*s.output, record);
+        return;
+    }
+
+    if (s.count == s.ring.size()) {
+        ++s.dropped;
+        return;
+    }
+    s.ring[(s.head + s.count) % s.ring.size()] = record;
+    ++s.count;
+    lock.unlock();
+    s.ready.notify_one();
+}
+
+// Write one record to the output stream
+void Logger::emit(std::ostream& output, const Record& record) {
+    output << '[' << levelName(record.level) << "] " << record.component << ": ";
+    output.write(record.text, static_cast<std::streamsize>(record.length));
+    output << '\n';
+}
@@ -0,0 +1,151 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+enum class LogLevel : uint8_t {
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off
+};
+
+// Messages below this level are compiled out entirely (0 = Trace ... 5 = Off)
+#ifndef LLFS_LOG_COMPILE_LEVEL
+#define LLFS_LOG_COMPILE_LEVEL 0
+#endif
+
+// Whether a level is compiled in; spelled out for the default so no always-true comparison
+// is left for -Wtype-limits to flag
+#if LLFS_LOG_COMPILE_LEVEL == 0
+#define LLFS_LOG_COMPILED_IN(level) true
+#else
+#define LLFS_LOG_COMPILED_IN(level) (static_cast<int>(level) >= LLFS_LOG_COMPILE_LEVEL)
+#endif
+
+// Log a message built from the remaining arguments. The arguments are neither evaluated nor
+// formatted unless the level is compiled in and enabled at runtime, so a disabled log
+// statement costs one relaxed atomic load.
+#define LLFS_LOG(level, component, ...)                                           \
+    do {                                                                          \
+        if constexpr (LLFS_LOG_COMPILED_IN(level)) {                              \
+            if (Logger::isEnabled(level)) {                                       \
+                Logger::write(level, component, __VA_ARGS__);                     \
+            }                                                                     \
+        }                                                                         \
+    } while (0)
+
+#define LLFS_LOG_TRACE(component, ...) LLFS_LOG(LogLevel::Trace, component, __VA_ARGS__)
+#define LLFS_LOG_DEBUG(component, ...) LLFS_LOG(LogLevel::Debug, component, __VA_ARGS__)
+#define LLFS_LOG_INFO(component, ...) LLFS_LOG(LogLevel::Info, component, __VA_ARGS__)
+#define LLFS_LOG_WARN(component, ...) LLFS_LOG(LogLevel::Warn, component, __VA_ARGS__)
+#define LLFS_LOG_ERROR(component, ...) LLFS_LOG(LogLevel::Error, component, __VA_ARGS__)
+
+// Process-wide logger. Each message is one line, "[LEVEL] Component: text", formatted into a
+// fixed-size record without heap allocation. Records go straight to the output stream, or,
+// after startAsync(), into a ring buffer drained by a background thread; when the ring is
+// full new records are dropped and counted rather than blocking the caller.
+class Logger {
+public:
+    // Longest message text; longer messages are truncated
+    static constexpr size_t MAX_MESSAGE = 200;
+
+    // Runtime level (initially from the LLFS_LOG_LEVEL environment variable, else Info)
+    static void setLevel(LogLevel level);
+    static LogLevel getLevel();
+
+    // Check whether a level is enabled at runtime
+    static bool isEnabled(LogLevel level) {
+        return static_cast<uint8_t>(level) >= currentLevel.load(std::memory_order_relaxed);
+    }
+
+    // Parse a level name ("trace", "debug", "info", "warn", "error", "off")
+    static LogLevel parseLevel(std::string_view name);
+
+    // Stream that receives log lines (std::cout by default)
+    static void setOutput(std::ostream& output);
+
+    // Hand records to a background thread through a ring buffer of the given capacity
+    static void startAsync(size_t capacity = 4096);
+
+    // Drain the ring buffer and return to writing synchronously
+    static void stopAsync();
+
+    // Wait until every queued record has been written
+    static void flush();
+
+    // Number of records dropped because the ring buffer was full
+    static size_t getDroppedCount();
+
+    // Format and emit a message (use the LLFS_LOG_* macros instead)
+    template <typename... Args>
+    static void write(LogLevel level, const char* component, const Args&... args) {
+        Record record;
+        record.level = level;
+        record.component = component;
+        record.length = 0;
+        (append(record, args), ...);
+        submit(record);
+    }
+
+private:
+    struct Record {
+        LogLevel level;
+        const char* component;  // String literal naming the module
+        size_t length;
+        char text[MAX_MESSAGE];
+    };
+
+    static std::atomic<uint8_t> currentLevel;
+
+    static void append(Record& record, std::string_view text) {
+        size_t count = std::min(text.size(), MAX_MESSAGE - record.length);
+        std::memcpy(record.text + record.length, text.data(), count);
+        record.length += count;
+    }
+
+    static void append(Record& record, const char* text) {
+        append(record, std::string_view(text));
+    }
+
+    static void append(Record& record, const std::string& text) {
+        append(record, std::string_view(text));
+    }
+
+    static void append(Record& record, char c) {
+        append(record, std::string_view(&c, 1));
+    }
+
+    static void append(Record& record, bool value) {
+        append(record, value ? std::string_view("true") : std::string_view("false"));
+    }
+
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    static void append(Record& record, T value) {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        append(record, std::string_view(buffer, result.ptr - buffer));
+    }
+
+    // Write a record or queue it for the background thread
+    static void submit(const Record& record);
+
+    // Write one record to the output stream
+    static void emit(std::ostream& output, const Record& record);
+
+    struct State;
+    static State& state();
+};
+
+#endif // LOGGER_H
@@ -0,0 +1,177 @@
+#include "Lz4.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LAST_LITERALS = 5;     // The last bytes of a block are always literals
+constexpr size_t MATCH_LIMIT = 12;      // No match starts closer than this to the end
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_BITS = 12;
+
+uint32_t read32(const char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Write a length beyond its token nibble: a run of 255s and the remainder
+void writeLength(std::vector<char>& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+// Write one sequence: literals, then a match (none for the last sequence)
+void writeSequence(std::vector<char>& out, const char* literals, size_t literalLength, size_t offset,
+                   size_t matchLength) {
+    size_t matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+    out.push_back(static_cast<char>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)));
+    if (literalLength >= 15) {
+        writeLength(out, literalLength - 15);
+    }
+    out.insert(out.end(), literals, literals + literalLength);
+    if (matchLength == 0) {
+        return;
+    }
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (matchCode >= 15) {
+        writeLength(out, matchCode - 15);
+    }
+}
+
+// Read a length continuation; throws past the end of the input
+size_t readLength(const char* data, size_t length, size_t& position) {
+    size_t total = 0;
+    uint8_t byte;
+    do {
+        if (position >= length) {
+            throw std::runtime_error("Corrupt compressed data: truncated length.");
+        }
+        byte = static_cast<uint8_t>(data[position++]);
+        total += byte;
+    } while (byte == 255);
+    return total;
+}
+} // namespace
+
+// Compress length bytes
+std::vector<char> Lz4::compress(const char* data, size_t length) {
+    std::vector<char> out;
+    out.reserve(maxCompressedSize(length));
+    size_t anchor = 0;
+
+    if (length > MATCH_LIMIT) {
+        std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0); // Position + 1 of the last sequence per hash
+        const size_t limit = length - MATCH_LIMIT;
+        const size_t matchEnd = length - LAST_LITERALS;
+        size_t position = 0;
+        while (position < limit) {
+            uint32_t sequence = read32(data + position);
+            uint32_t& slot = table[hashSequence(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(position + 1);
+            if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || read32(data + candidate - 1) != sequence) {
+                position += 1 + ((position - anchor) >> 6); // Skip faster through incompressible data
+                continue;
+            }
+
+            // Extend the match backwards over the pending literals, then forwards
+            size_t match = candidate - 1;
+            while (position > anchor && match > 0 && data[position - 1] == data[match - 1]) {
+                --position;
+                --match;
+            }
+            size_t matchLength = MIN_MATCH;
+            while (position + matchLength + 8 <= matchEnd) {
+                uint64_t a, b;
+                std::memcpy(&a, data + match + matchLength, 8);
+                std::memcpy(&b, data + position + matchLength, 8);
+                if (a != b) {
+                    matchLength += std::countr_zero(a ^ b) / 8;
+                    break;
+                }
+                matchLength += 8;
+            }
+            while (position + matchLength < matchEnd && data[match + matchLength] == data[position + matchLength]) {
+                ++matchLength;
+            }
+
+            writeSequence(out, data + anchor, position - anchor, position - match, matchLength);
+            position += matchLength;
+            anchor = position;
+            if (position - 2 < limit) {
+                table[hashSequence(read32(data + position - 2))] = static_cast<uint32_t>(position - 1);
+            }
+        }
+    }
+    writeSequence(out, data + anchor, length - anchor, 0, 0);
+    return out;
+}
+
+// Decompress into at most capacity bytes; returns the bytes produced
+size_t Lz4::decompress(const char* data, size_t length, char* output, size_t capacity) {
+    size_t in = 0;
+    size_t out = 0;
+    while (true) {
+        if (in >= length) {
+            throw std::runtime_error("Corrupt compressed data: missing sequence.");
+        }
+        uint8_t token = static_cast<uint8_t>(data[in++]);
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            literalLength += readLength(data, length, in);
+        }
+        if (literalLength > length - in || literalLength > capacity - out) {
+            throw std::runtime_error("Corrupt compressed data: literals out of bounds.");
+        }
+        std::memcpy(output + out, data + in, literalLength);
+        in += literalLength;
+        out += literalLength;
+        if (in == length) {
+            return out; // The last sequence has no match
+        }
+
+        if (length - in < 2) {
+            throw std::runtime_error("Corrupt compressed data: truncated offset.");
+        }
+        size_t offset = static_cast<uint8_t>(data[in]) | (static_cast<size_t>(static_cast<uint8_t>(data[in + 1])) << 8);
+        in += 2;
+        size_t matchLength = token & 0x0F;
+        if (matchLength == 15) {
+            matchLength += readLength(data, length, in);
+        }
+        matchLength += MIN_MATCH;
+        if (offset == 0 || offset > out || matchLength > capacity - out) {
+            throw std::runtime_error("Corrupt compressed data: match out of bounds.");
+        }
+
+        // Overlapping matches repeat the bytes just written, so they are copied forwards
+        char* target = output + out;
+        const char* source = target - offset;
+        if (offset >= matchLength) {
+            std::memcpy(target, source, matchLength);
+        } else {
+            for (size_t i = 0; i < matchLength; ++i) {
+                target[i] = source[i];
+            }
+        }
+        out += matchLength;
+    }
+}
+
+// Largest compressed size of length bytes
+size_t Lz4::maxCompressedSize(size_t length) {
+    return length + length / 255 + 16;
+}
@@ -0,0 +1,24 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <cstddef>
+#include <vector>
+
+// Self-contained codec for the LZ4 block format: a greedy single-pass matcher over a hash
+// table of 4-byte sequences, and a decoder that checks every length and offset against its
+// buffers so damaged input throws instead of reading or writing out of bounds. Used for the
+// clusters of compressed files.
+class Lz4 {
+public:
+    // Compress length bytes (the result may be larger for incompressible input)
+    static std::vector<char> compress(const char* data, size_t length);
+
+    // Decompress into at most capacity bytes; returns the bytes produced and throws
+    // std::runtime_error on malformed input
+    static size_t decompress(const char* data, size_t length, char* output, size_t capacity);
+
+    // Largest compressed size of length bytes
+    static size_t maxCompressedSize(size_t length);
+};
+
+#endif // LZ4_H
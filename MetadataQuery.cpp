@@ -0,0 +1,124 @@
+#include "MetadataQuery.h"
+#include <algorithm>
+#include <bit>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LLFS_QUERY_SSE2 1
+#endif
+
+// Constructor; threadCount 0 picks one thread per core
+MetadataQuery::MetadataQuery(const InodeColumns& columns, size_t threadCount)
+    : columns(columns), threadCount(threadCount) {
+    if (this->threadCount == 0) {
+        this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+// Find the inodes matching a query, in inode order
+std::vector<uint32_t> MetadataQuery::find(const InodeQuery& query) const {
+    auto lock = columns.lockShared();
+    size_t total = columns.size();
+    size_t chunkCount = (total + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    size_t workers = std::min(threadCount, chunkCount);
+
+    std::vector<uint32_t> matches;
+    if (workers <= 1) {
+        scanRange(query, 0, total, matches);
+        return matches;
+    }
+
+    // Each chunk collects its own matches; concatenating them in chunk order keeps inode order
+    std::vector<std::vector<uint32_t>> chunkMatches(chunkCount);
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (size_t worker = 0; worker < workers; ++worker) {
+        threads.emplace_back([&, worker]() {
+            for (size_t chunk = worker; chunk < chunkCount; chunk += workers) {
+                size_t begin = chunk * CHUNK_SIZE;
+                scanRange(query, begin, std::min(begin + CHUNK_SIZE, total), chunkMatches[chunk]);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    size_t matchCount = 0;
+    for (const auto& chunk : chunkMatches) {
+        matchCount += chunk.size();
+    }
+    matches.reserve(matchCount);
+    for (const auto& chunk : chunkMatches) {
+        matches.insert(matches.end(), chunk.begin(), chunk.end());
+    }
+    return matches;
+}
+
+// Find the inodes modified at or after a time, oldest first (uses the time index)
+std::vector<uint32_t> MetadataQuery::modifiedSince(uint32_t time) const {
+    std::vector<uint32_t> matches;
+    columns.modifiedSince(time, matches);
+    return matches;
+}
+
+// Scan inodes [begin, end) and append matches
+void MetadataQuery::scanRange(const InodeQuery& query, size_t begin, size_t end,
+                              std::vector<uint32_t>& matches) const {
+    const uint32_t* sizes = columns.getFileSizes();
+    const uint8_t* types = columns.getFileTypes();
+    const uint32_t* times = columns.getModificationTimes();
+
+    size_t i = begin;
+#ifdef LLFS_QUERY_SSE2
+    // SSE2 only has signed 32-bit compares; flipping the sign bit makes them unsigned
+    const __m128i bias = _mm_set1_epi32(INT32_MIN);
+    const __m128i minSize = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(query.minSize)), bias);
+    const __m128i maxSize = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(query.maxSize)), bias);
+    const __m128i minTime = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(query.modifiedAfter)), bias);
+    const __m128i maxTime = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(query.modifiedBefore)), bias);
+    const __m128i type = _mm_set1_epi8(static_cast<char>(query.fileType));
+
+    // Bit k of a mask is set if inode k of the group of four is outside [low, high]
+    auto outside = [&](const uint32_t* column, __m128i low, __m128i high) {
+        __m128i value = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(column)), bias);
+        __m128i out = _mm_or_si128(_mm_cmpgt_epi32(low, value), _mm_cmpgt_epi32(value, high));
+        return static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(out)));
+    };
+
+    for (; i + 16 <= end; i += 16) {
+        // Type: an exact match, or any allocated inode when no type is given
+        __m128i typeBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(types + i));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(typeBytes, type)));
+        if (query.fileType == 0) {
+            mask ^= 0xFFFF;
+        }
+        if (mask == 0) {
+            continue;
+        }
+
+        uint32_t rejected = 0;
+        for (int group = 0; group < 4; ++group) {
+            size_t first = i + group * 4;
+            rejected |= (outside(sizes + first, minSize, maxSize) |
+                         outside(times + first, minTime, maxTime)) << (group * 4);
+        }
+        mask &= ~rejected;
+
+        while (mask != 0) {
+            matches.push_back(static_cast<uint32_t>(i + std::countr_zero(mask)));
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // Remaining inodes (or all of them without SSE2)
+    for (; i < end; ++i) {
+        bool typeMatches = query.fileType == 0 ? types[i] != 0 : types[i] == query.fileType;
+        if (typeMatches && sizes[i] >= query.minSize && sizes[i] <= query.maxSize &&
+            times[i] >= query.modifiedAfter && times[i] <= query.modifiedBefore) {
+            matches.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
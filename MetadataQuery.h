@@ -0,0 +1,45 @@
+#ifndef METADATAQUERY_H
+#define METADATAQUERY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "InodeColumns.h"
+
+// Conditions an inode must meet; the defaults match every allocated inode
+struct InodeQuery {
+    uint8_t fileType = 0;                   // 1 = file, 2 = directory, 0 = any
+    uint32_t minSize = 0;                   // Inclusive
+    uint32_t maxSize = UINT32_MAX;          // Inclusive
+    uint32_t modifiedAfter = 0;             // Inclusive, seconds since the epoch
+    uint32_t modifiedBefore = UINT32_MAX;   // Inclusive, seconds since the epoch
+};
+
+// Answers metadata questions ("files over 1 MB", "changed since 02:00") from InodeColumns.
+// Predicates are evaluated 16 inodes at a time with SSE2 where available, and large tables
+// are split into chunks scanned by separate threads. A scan holds the columns' shared lock
+// throughout, so inode updates wait for it to finish.
+class MetadataQuery {
+public:
+    // Constructor; threadCount 0 picks one thread per core
+    explicit MetadataQuery(const InodeColumns& columns, size_t threadCount = 0);
+
+    // Find the inodes matching a query, in inode order
+    std::vector<uint32_t> find(const InodeQuery& query) const;
+
+    // Find the inodes modified at or after a time, oldest first (uses the time index)
+    std::vector<uint32_t> modifiedSince(uint32_t time) const;
+
+    // Inodes per chunk when scanning in parallel
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+private:
+    const InodeColumns& columns;
+    size_t threadCount;
+
+    // Scan inodes [begin, end) and append matches
+    void scanRange(const InodeQuery& query, size_t begin, size_t end, std::vector<uint32_t>& matches) const;
+};
+
+#endif // METADATAQUERY_H
@@ -0,0 +1,223 @@
+#include "Scrubber.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "Logger.h"
+
+// Constructor; fileSystemLock is held exclusively while file system state is read
+Scrubber::Scrubber(DiskManager& diskManager, InodeManager& inodeManager, FreeBlockManager& freeBlockManager,
+                   SegmentManager* segmentManager, const Superblock& layout, std::shared_mutex& fileSystemLock)
+    : diskManager(diskManager), inodeManager(inodeManager), freeBlockManager(freeBlockManager),
+      segmentManager(segmentManager), layout(layout), fileSystemLock(fileSystemLock),
+      segmentStates(segmentManager ? layout.segmentCount : 0, 0) {
+    if (diskManager.getBlockSize() < 4 + sizeof(Superblock) + sizeof(CursorRecord)) {
+        throw std::invalid_argument("Block size too small for the scrub cursor.");
+    }
+    loadCursor();
+}
+
+// Destructor; stops the thread and saves the cursor
+Scrubber::~Scrubber() {
+    stop();
+}
+
+// Scrub in a background thread, reading at most blocksPerSecond blocks per second
+void Scrubber::start(size_t blocksPerSecond) {
+    if (blocksPerSecond == 0) {
+        throw std::invalid_argument("The scrubber needs an I/O budget.");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    this->blocksPerSecond = blocksPerSecond;
+    if (worker.joinable()) {
+        return; // Already running; the new budget applies from the next tick
+    }
+    stopping = false;
+    stats.running = true;
+    worker = std::thread(&Scrubber::run, this);
+    LLFS_LOG_INFO("Scrubber", "Scrubber started: cursor=", stats.cursor, " blocksPerSecond=", blocksPerSecond);
+}
+
+// Stop the background thread and save the cursor
+void Scrubber::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!worker.joinable()) {
+            return;
+        }
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.running = false;
+    writeCursor();
+    LLFS_LOG_INFO("Scrubber", "Scrubber stopped: cursor=", stats.cursor, " blocksScrubbed=", stats.blocksScrubbed);
+}
+
+// Scrub inodes from the cursor until about maxBlocks blocks were read
+size_t Scrubber::scrubNext(size_t maxBlocks) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t totalInodes = inodeManager.getTotalInodes();
+    size_t blocksRead = 0;
+
+    // Free inodes cost no I/O, but visiting them is not free either
+    size_t visited = 0;
+    while (blocksRead < maxBlocks && visited < totalInodes) {
+        if (stats.cursor >= totalInodes) {
+            stats.cursor = 0;
+            ++stats.passesCompleted;
+            std::fill(segmentStates.begin(), segmentStates.end(), 0);
+            writeCursor();
+            LLFS_LOG_INFO("Scrubber", "Scrub pass completed: passes=", stats.passesCompleted,
+                          " checksumErrors=", stats.checksumErrors, " bitmapErrors=", stats.bitmapErrors);
+        }
+        size_t inodeId = stats.cursor++;
+        ++visited;
+        if (!inodeManager.isAllocated(inodeId)) {
+            continue;
+        }
+
+        blocksRead += scrubInode(inodeManager.getInode(inodeId));
+        ++stats.inodesScrubbed;
+        if (++unsavedInodes >= SAVE_INTERVAL) {
+            writeCursor();
+        }
+    }
+    stats.blocksScrubbed += blocksRead;
+    return blocksRead;
+}
+
+// Write the cursor to the superblock block
+void Scrubber::saveCursor() {
+    std::lock_guard<std::mutex> lock(mutex);
+    writeCursor();
+}
+
+// Progress and findings so far
+ScrubStats Scrubber::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+// Background loop: scrub a tick's budget, then wait for the next tick
+void Scrubber::run() {
+    using namespace std::chrono;
+    long credit = 0; // Blocks one inode read beyond the budget are paid back in later ticks
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        auto nextTick = steady_clock::now() + milliseconds(1000 / TICKS_PER_SECOND);
+        long budget = static_cast<long>(std::max<size_t>(1, blocksPerSecond / TICKS_PER_SECOND));
+        credit = std::min(credit + budget, budget);
+        lock.unlock();
+        if (credit > 0) {
+            std::lock_guard<std::shared_mutex> fileSystem(fileSystemLock);
+            credit -= static_cast<long>(scrubNext(static_cast<size_t>(credit)));
+        }
+        lock.lock();
+        wake.wait_until(lock, nextTick, [this]() { return stopping; });
+    }
+}
+
+// Check one inode's blocks; returns the blocks read
+size_t Scrubber::scrubInode(const Inode& inode) {
+    size_t blocksRead = 0;
+    for (uint16_t pointer : inode.directBlocks) {
+        if (pointer != 0) {
+            blocksRead += scrubBlock(pointer);
+        }
+    }
+    if (inode.singleIndirect != 0) {
+        blocksRead += scrubIndirect(inode.singleIndirect, 1);
+    }
+    if (inode.doubleIndirect != 0) {
+        blocksRead += scrubIndirect(inode.doubleIndirect, 2);
+    }
+    return blocksRead;
+}
+
+// Check one block pointer: range, free block vector, contents; returns the blocks read
+size_t Scrubber::scrubBlock(uint32_t blockNumber) {
+    if (blockNumber < layout.dataStart || blockNumber >= layout.volumeBlocks) {
+        ++stats.invalidPointers;
+        LLFS_LOG_WARN("Scrubber", "Invalid block pointer: block=", blockNumber);
+        return 0;
+    }
+    if (freeBlockManager.isBlockFree(blockNumber)) {
+        ++stats.bitmapErrors;
+        LLFS_LOG_WARN("Scrubber", "Block in use but marked free: block=", blockNumber);
+    }
+
+    // In LFS mode a block is checked through its segment's summary checksum, once per pass
+    if (segmentManager) {
+        uint32_t physicalBlock = segmentManager->locateBlock(blockNumber);
+        if (physicalBlock == 0) {
+            return 0; // Never written: reads as zeros
+        }
+        size_t segment = (physicalBlock - layout.segmentStart) / layout.segmentBlocks;
+        size_t blocksRead = 0;
+        if (segmentStates[segment] == 0) {
+            segmentStates[segment] = segmentManager->verifySegment(segment) ? 1 : 2;
+            blocksRead = layout.segmentBlocks;
+        }
+        if (segmentStates[segment] == 2) {
+            ++stats.checksumErrors;
+            LLFS_LOG_WARN("Scrubber", "Checksum mismatch: block=", blockNumber, " segment=", segment);
+        }
+        return blocksRead;
+    }
+
+    try {
+        if (!diskManager.verifyBlock(blockNumber)) {
+            ++stats.checksumErrors;
+            LLFS_LOG_WARN("Scrubber", "Checksum mismatch: block=", blockNumber);
+        }
+    } catch (const std::exception& e) {
+        ++stats.readErrors;
+        LLFS_LOG_WARN("Scrubber", "Read failed: block=", blockNumber, " error=", e.what());
+    }
+    return 1;
+}
+
+// Check an indirect block and everything below it; returns the blocks read
+size_t Scrubber::scrubIndirect(uint16_t indirectBlock, int depth) {
+    size_t blocksRead = scrubBlock(indirectBlock);
+    if (indirectBlock < layout.dataStart || indirectBlock >= layout.volumeBlocks) {
+        return blocksRead;
+    }
+
+    std::vector<char> block;
+    try {
+        block = diskManager.readBlock(indirectBlock);
+    } catch (const std::exception&) {
+        return blocksRead; // Already counted above; the pointers in it cannot be trusted
+    }
+    for (size_t i = 0; i < block.size() / sizeof(uint16_t); ++i) {
+        uint16_t pointer;
+        std::memcpy(&pointer, block.data() + i * sizeof(uint16_t), sizeof(pointer));
+        if (pointer == 0) continue;
+        blocksRead += depth > 1 ? scrubIndirect(pointer, depth - 1) : scrubBlock(pointer);
+    }
+    return blocksRead;
+}
+
+// Read the cursor saved by an earlier scrubber
+void Scrubber::loadCursor() {
+    std::vector<char> superblock = diskManager.readBlock(0);
+    CursorRecord record;
+    std::memcpy(&record, superblock.data() + superblock.size() - sizeof(record), sizeof(record));
+    if (record.magic == CURSOR_MAGIC && record.cursor < inodeManager.getTotalInodes()) {
+        stats.cursor = record.cursor;
+        stats.passesCompleted = record.passesCompleted;
+    }
+}
+
+// Write the cursor to the superblock block (mutex held)
+void Scrubber::writeCursor() {
+    // Block 0 is written in place in both modes; the layout before the record is left as it is
+    std::vector<char> superblock = diskManager.readBlock(0);
+    CursorRecord record = {CURSOR_MAGIC, stats.cursor, stats.passesCompleted};
+    std::memcpy(superblock.data() + superblock.size() - sizeof(record), &record, sizeof(record));
+    diskManager.writeBlock(0, superblock);
+    unsavedInodes = 0;
+}
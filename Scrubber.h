@@ -0,0 +1,109 @@
+#ifndef SCRUBBER_H
+#define SCRUBBER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "DiskManager.h"
+#include "FreeBlockManager.h"
+#include "InodeManager.h"
+#include "SegmentManager.h"
+
+// Progress and findings of the scrubber
+struct ScrubStats {
+    uint32_t cursor = 0;            // Next inode to scrub
+    uint64_t passesCompleted = 0;   // Full walks of the inode table, across restarts
+    size_t inodesScrubbed = 0;      // Since this scrubber was created
+    size_t blocksScrubbed = 0;      // Blocks read (a whole segment per segment in LFS mode)
+    size_t checksumErrors = 0;      // Blocks whose contents failed verification
+    size_t bitmapErrors = 0;        // Blocks an inode uses but the free block vector calls free
+    size_t invalidPointers = 0;     // Pointers outside the data blocks
+    size_t readErrors = 0;
+    bool running = false;
+};
+
+// Online scrubber: walks the allocated inodes while the file system is mounted, reads every
+// block they point at and checks it against the free block vector and its checksum (the
+// segment summary in LFS mode). The background thread reads at most blocksPerSecond blocks,
+// a tick's worth at a time, and holds the file system lock only while scrubbing. The cursor
+// is saved in the superblock block now and then, so a restarted scrubber resumes where the
+// last one stopped.
+class Scrubber {
+public:
+    // Constructor; fileSystemLock is held exclusively while file system state is read
+    Scrubber(DiskManager& diskManager, InodeManager& inodeManager, FreeBlockManager& freeBlockManager,
+             SegmentManager* segmentManager, const Superblock& layout, std::shared_mutex& fileSystemLock);
+
+    // Destructor; stops the thread and saves the cursor
+    ~Scrubber();
+
+    // Scrub in a background thread, reading at most blocksPerSecond blocks per second
+    void start(size_t blocksPerSecond);
+
+    // Stop the background thread and save the cursor
+    void stop();
+
+    // Scrub inodes from the cursor until about maxBlocks blocks were read; returns the blocks
+    // read. The caller must hold the file system lock.
+    size_t scrubNext(size_t maxBlocks);
+
+    // Write the cursor to the superblock block
+    void saveCursor();
+
+    // Progress and findings so far
+    ScrubStats getStats() const;
+
+private:
+    // Stored at the end of the superblock block, after the layout
+    struct CursorRecord {
+        uint32_t magic;
+        uint32_t cursor;
+        uint64_t passesCompleted;
+    };
+
+    static constexpr uint32_t CURSOR_MAGIC = 0x53435242; // "SCRB"
+    static constexpr size_t SAVE_INTERVAL = 256;          // Inodes scrubbed between cursor saves
+    static constexpr int TICKS_PER_SECOND = 10;
+
+    DiskManager& diskManager;
+    InodeManager& inodeManager;
+    FreeBlockManager& freeBlockManager;
+    SegmentManager* segmentManager;
+    Superblock layout;
+    std::shared_mutex& fileSystemLock;
+
+    mutable std::mutex mutex;       // Guards stats and the thread state
+    ScrubStats stats;
+    size_t unsavedInodes = 0;
+    std::vector<uint8_t> segmentStates; // Per segment in the current pass: 0 = unchecked, 1 = good, 2 = bad (LFS mode)
+
+    std::thread worker;
+    std::condition_variable wake;
+    bool stopping = false;
+    size_t blocksPerSecond = 0;
+
+    // Background loop: scrub a tick's budget, then wait for the next tick
+    void run();
+
+    // Check one inode's blocks; returns the blocks read
+    size_t scrubInode(const Inode& inode);
+
+    // Check one block pointer: range, free block vector, contents; returns the blocks read
+    size_t scrubBlock(uint32_t blockNumber);
+
+    // Check an indirect block and everything below it; returns the blocks read
+    size_t scrubIndirect(uint16_t indirectBlock, int depth);
+
+    // Read the cursor saved by an earlier scrubber
+    void loadCursor();
+
+    // Write the cursor to the superblock block (mutex held)
+    void writeCursor();
+};
+
+#endif // SCRUBBER_H
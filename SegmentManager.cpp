@@ -0,0 +1,923 @@
+#include "SegmentManager.h"
+#include "Crc32c.h"
+#include "InodeManager.h"
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring> // For memcpy
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr uint32_t SUMMARY_MAGIC = 0x534C4C4C;    // "LLLS"
+constexpr uint32_t CHECKPOINT_MAGIC = 0x434C4C4C; // "LLLC"
+constexpr uint32_t CHECKSUM_SEED = 2166136261u;    // Starting CRC32C value
+
+// Lower the calling thread's priority so cleaning yields to foreground work
+void lowerThreadPriority() {
+#ifdef __linux__
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+}
+}
+
+// Constructor; call recover() (or format the disk) before use
+SegmentManager::SegmentManager(DiskManager& diskManager, const Superblock& layout)
+    : diskManager(diskManager), blockSize(diskManager.getBlockSize()), volumeBlocks(layout.volumeBlocks),
+      inodeTableStart(layout.inodeTableStart), inodesPerBlock(diskManager.getBlockSize() / sizeof(Inode)),
+      checkpointStart(layout.checkpointStart), checkpointSlotBlocks(layout.checkpointBlocks / 2),
+      segmentStart(layout.segmentStart), segmentBlocks(layout.segmentBlocks), segmentCount(layout.segmentCount),
+      slots(slotsPerSegment(layout.segmentBlocks, diskManager.getBlockSize())),
+      entriesPerMapBlock(diskManager.getBlockSize() / sizeof(uint32_t)) {
+    if (layout.writeMode != static_cast<uint32_t>(WriteMode::LogStructured) || segmentCount < 4 || slots == 0) {
+        throw std::invalid_argument("Layout has no segments.");
+    }
+    if (checkpointSlotBlocks < checkpointRegionBlocks(volumeBlocks, segmentCount, blockSize)) {
+        throw std::invalid_argument("Checkpoint region is too small.");
+    }
+    summaryBlocks = segmentBlocks - slots;
+    checkpointInterval = std::max<size_t>(2, segmentCount / 8);
+    lowWatermark = std::max<size_t>(RESERVED_SEGMENTS + 3, segmentCount / 8);
+    highWatermark = std::max<size_t>(lowWatermark + 1, segmentCount / 4);
+
+    size_t mapBlockCount = (volumeBlocks + entriesPerMapBlock - 1) / entriesPerMapBlock;
+    addressMap.assign(volumeBlocks, 0);
+    mapLocations.assign(mapBlockCount, 0);
+    dirtyMapBlocks.assign(mapBlockCount, false);
+    liveBlocks.assign(segmentCount, 0);
+    modifiedAt.assign(segmentCount, 0);
+    checkpointLiveBlocks.assign(segmentCount, 0);
+    writtenSinceCheckpoint.assign(segmentCount, false);
+    discardPending.assign(volumeBlocks, false);
+    for (Head* head : {&userHead, &cleanerHead}) {
+        head->buffer.assign(segmentBlocks * blockSize, 0);
+        head->tags.assign(slots, 0);
+    }
+}
+
+// Destructor; stops the cleaner
+SegmentManager::~SegmentManager() {
+    stopCleaner();
+}
+
+// Write an empty checkpoint (during formatting)
+void SegmentManager::formatRegion(DiskManager& diskManager, const Superblock& layout) {
+    size_t blockSize = diskManager.getBlockSize();
+    size_t entriesPerMapBlock = blockSize / sizeof(uint32_t);
+    size_t slotBlocks = layout.checkpointBlocks / 2;
+    CheckpointHeader header = {};
+    header.magic = CHECKPOINT_MAGIC;
+    header.mapBlocks = static_cast<uint32_t>((layout.volumeBlocks + entriesPerMapBlock - 1) / entriesPerMapBlock);
+    header.sequence = 1;
+    header.headSegment = layout.segmentCount - 1; // The first segment opened is segment 0
+    header.segmentCount = layout.segmentCount;
+
+    // Checkpoint n goes into slot n % 2; slot 0 stays empty (invalid) until the next one
+    std::vector<char> region(layout.checkpointBlocks * blockSize, 0);
+    char* slot = region.data() + (header.sequence % 2) * slotBlocks * blockSize;
+    std::memcpy(slot, &header, sizeof(header));
+    header.checksum = checksum(CHECKSUM_SEED, slot, slotBlocks * blockSize);
+    std::memcpy(slot, &header, sizeof(header));
+    diskManager.writeBlocks(layout.checkpointStart, region);
+}
+
+// Block slots in a segment after its summary
+size_t SegmentManager::slotsPerSegment(size_t segmentBlocks, size_t blockSize) {
+    // Each slot costs a block plus its tag in the summary
+    size_t bytes = segmentBlocks * blockSize - sizeof(SummaryHeader);
+    size_t slots = bytes / (blockSize + sizeof(uint32_t));
+    size_t summaryBlocks = (sizeof(SummaryHeader) + slots * sizeof(uint32_t) + blockSize - 1) / blockSize;
+    return std::min(slots, segmentBlocks - std::min(segmentBlocks, summaryBlocks));
+}
+
+// Blocks needed by one checkpoint slot for a volume of the given size (the region holds two)
+size_t SegmentManager::checkpointRegionBlocks(size_t volumeBlocks, size_t segmentCount, size_t blockSize) {
+    size_t entriesPerMapBlock = blockSize / sizeof(uint32_t);
+    size_t mapBlocks = (volumeBlocks + entriesPerMapBlock - 1) / entriesPerMapBlock;
+    size_t bytes = sizeof(CheckpointHeader) + mapBlocks * sizeof(uint32_t) + segmentCount * sizeof(uint32_t);
+    return (bytes + blockSize - 1) / blockSize;
+}
+
+// Load the newest valid checkpoint and roll forward to the last commit
+size_t SegmentManager::recover() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // The slot with the highest checkpoint number wins; a torn slot fails its checksum
+    CheckpointHeader header = {};
+    std::vector<char> region;
+    for (size_t slot = 0; slot < 2; ++slot) {
+        CheckpointHeader candidate;
+        std::vector<char> candidateRegion;
+        if (readCheckpoint(slot, candidate, candidateRegion) && candidate.sequence > header.sequence) {
+            header = candidate;
+            region = std::move(candidateRegion);
+        }
+    }
+    if (region.empty()) {
+        throw std::runtime_error("Invalid checkpoint region: No valid checkpoint.");
+    }
+    std::memcpy(mapLocations.data(), region.data() + sizeof(header), mapLocations.size() * sizeof(uint32_t));
+    std::memcpy(modifiedAt.data(), region.data() + sizeof(header) + mapLocations.size() * sizeof(uint32_t),
+                segmentCount * sizeof(uint32_t));
+
+    // Read the address map back and rebuild the segment usage from it
+    std::fill(liveBlocks.begin(), liveBlocks.end(), 0);
+    for (size_t i = 0; i < mapLocations.size(); ++i) {
+        size_t first = i * entriesPerMapBlock;
+        size_t count = std::min(entriesPerMapBlock, volumeBlocks - first);
+        if (mapLocations[i] == 0) {
+            std::fill_n(addressMap.begin() + first, count, 0);
+            continue;
+        }
+        if (!isSlot(mapLocations[i])) {
+            throw std::runtime_error("Invalid checkpoint region: Map block outside the log.");
+        }
+        ++liveBlocks[segmentOf(mapLocations[i])];
+        std::vector<char> block = diskManager.readBlocks(mapLocations[i], 1);
+        std::memcpy(addressMap.data() + first, block.data(), count * sizeof(uint32_t));
+    }
+    for (uint32_t physicalBlock : addressMap) {
+        if (physicalBlock == 0) continue;
+        if (!isSlot(physicalBlock)) {
+            throw std::runtime_error("Invalid checkpoint region: Block outside the log.");
+        }
+        ++liveBlocks[segmentOf(physicalBlock)];
+    }
+    checkpointLiveBlocks = liveBlocks;
+    std::fill(dirtyMapBlocks.begin(), dirtyMapBlocks.end(), false);
+    std::fill(writtenSinceCheckpoint.begin(), writtenSinceCheckpoint.end(), false);
+    std::fill(discardPending.begin(), discardPending.end(), false);
+    pendingDiscards.clear();
+
+    // Every segment opened since the checkpoint was opened once, so this stays ahead of them
+    sequence = header.segmentSequence + segmentCount;
+    checkpointSequence = header.sequence;
+    clock = header.clock;
+    for (Head* head : {&userHead, &cleanerHead}) {
+        head->open = false;
+        head->summaryDirty = false;
+        head->segment = header.headSegment;
+        head->nextSlot = 0;
+    }
+
+    size_t rolledForward = rollForward(header);
+
+    // Start a new chain from a checkpoint of the recovered state, so later commits are reachable
+    // (part of mounting, so not counted)
+    writeCheckpoint();
+    --checkpoints;
+
+    LLFS_LOG_INFO("SegmentManager", "Checkpoint loaded: checkpoint=", checkpointSequence - 1,
+                  " rolledForward=", rolledForward, " segments=", segmentCount, " cleanSegments=", countClean());
+    return rolledForward;
+}
+
+// Append a block to the log
+void SegmentManager::writeBlock(size_t blockNumber, const std::vector<char>& data) {
+    if (blockNumber == 0 || blockNumber >= volumeBlocks) {
+        throw std::out_of_range("Block number out of range.");
+    }
+    if (data.size() != blockSize) {
+        throw std::invalid_argument("Data size must match block size.");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t physicalBlock = append(userHead, static_cast<uint32_t>(blockNumber), data.data(), clock + 1);
+    discardPending[blockNumber] = false; // The new copy replaces the discard
+    ++clock;
+    ++userBlocksWritten;
+    retire(addressMap[blockNumber]);
+    addressMap[blockNumber] = physicalBlock;
+    dirtyMapBlocks[blockNumber / entriesPerMapBlock] = true;
+}
+
+// Read the newest copy of a block (zeros if it was never written)
+void SegmentManager::readBlock(size_t blockNumber, std::vector<char>& data) {
+    if (blockNumber >= volumeBlocks) {
+        throw std::out_of_range("Block number out of range.");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t physicalBlock = addressMap[blockNumber];
+    data.resize(blockSize);
+    if (physicalBlock == 0) {
+        std::fill(data.begin(), data.end(), 0);
+        return;
+    }
+
+    // Open segments are kept in memory until they are full
+    for (const Head* head : {&userHead, &cleanerHead}) {
+        if (head->open && segmentOf(physicalBlock) == head->segment) {
+            size_t offset = (physicalBlock - segmentStart - head->segment * segmentBlocks) * blockSize;
+            std::copy_n(head->buffer.begin() + offset, blockSize, data.begin());
+            return;
+        }
+    }
+    data = diskManager.readBlocks(physicalBlock, 1);
+}
+
+// Forget a freed block so its copy no longer counts as live data
+void SegmentManager::discardBlock(size_t blockNumber) {
+    if (blockNumber >= volumeBlocks) {
+        throw std::out_of_range("Block number out of range.");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (addressMap[blockNumber] != 0) {
+        retire(addressMap[blockNumber]);
+        addressMap[blockNumber] = 0;
+        dirtyMapBlocks[blockNumber / entriesPerMapBlock] = true;
+
+        // Logged at the next commit, so the roll-forward drops the block too
+        if (!discardPending[blockNumber]) {
+            discardPending[blockNumber] = true;
+            pendingDiscards.push_back(static_cast<uint32_t>(blockNumber));
+        }
+    }
+}
+
+// Write the blocks appended to the open segments so far
+void SegmentManager::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    flushHead(userHead);
+    flushHead(cleanerHead);
+}
+
+// Make every block written (and discarded) so far durable: recovery rolls forward to here
+void SegmentManager::commit() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Discards go into the log as lists of block numbers
+    size_t perBlock = blockSize / sizeof(uint32_t) - 1;
+    std::vector<uint32_t> list(blockSize / sizeof(uint32_t));
+    for (size_t i = 0; i < pendingDiscards.size();) {
+        uint32_t count = 0;
+        for (; i < pendingDiscards.size() && count < perBlock; ++i) {
+            if (discardPending[pendingDiscards[i]]) {
+                discardPending[pendingDiscards[i]] = false;
+                list[1 + count++] = pendingDiscards[i];
+            }
+        }
+        if (count > 0) {
+            list[0] = count;
+            retire(append(userHead, DISCARD_TAG, reinterpret_cast<const char*>(list.data()), clock));
+        }
+    }
+    pendingDiscards.clear();
+
+    if (userHead.open) {
+        userHead.committedSlots = userHead.nextSlot;
+        userHead.summaryDirty = true;
+        flushHead(userHead);
+        diskManager.sync();
+    }
+    ++commits;
+}
+
+// Flush, append the changed map blocks and write the next checkpoint slot
+void SegmentManager::checkpoint() {
+    std::lock_guard<std::mutex> lock(mutex);
+    writeCheckpoint();
+}
+
+// Checkpoint once this many segments have been filled since the last one
+void SegmentManager::setCheckpointInterval(size_t segments) {
+    std::lock_guard<std::mutex> lock(mutex);
+    checkpointInterval = std::max<size_t>(1, segments);
+}
+
+// Clean victims until this many segments are clean or only wait for a checkpoint
+size_t SegmentManager::clean(size_t targetSegments) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cleanUntil(targetSegments == 0 ? highWatermark : targetSegments);
+}
+
+// Check whether the checkpoint interval has passed, or a checkpoint would let cleaned
+// segments be reused while clean ones run low
+bool SegmentManager::needsCheckpoint() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (segmentsSinceCheckpoint >= checkpointInterval) {
+        return true;
+    }
+    size_t waiting = countWaiting();
+    return waiting > 0 && (countClean() <= lowWatermark || waiting >= lowWatermark);
+}
+
+// Clean in a low-priority background thread whenever fewer than highWatermark segments are clean
+void SegmentManager::startCleaner(size_t lowWatermark, size_t highWatermark) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cleaner.joinable()) {
+        return;
+    }
+    if (lowWatermark != 0) {
+        this->lowWatermark = std::max(lowWatermark, RESERVED_SEGMENTS + 1);
+    }
+    if (highWatermark != 0) {
+        this->highWatermark = std::max(highWatermark, this->lowWatermark + 1);
+    }
+    cleanerStopping = false;
+    cleaner = std::thread(&SegmentManager::runCleaner, this);
+}
+
+// Stop the background cleaner
+void SegmentManager::stopCleaner() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!cleaner.joinable()) {
+            return;
+        }
+        cleanerStopping = true;
+    }
+    cleanerWake.notify_all();
+    cleaner.join();
+}
+
+// Physical block holding the newest copy of a block (0 if it was never written)
+uint32_t SegmentManager::locateBlock(size_t blockNumber) const {
+    if (blockNumber >= volumeBlocks) {
+        throw std::out_of_range("Block number out of range.");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    return addressMap[blockNumber];
+}
+
+// Check a segment's contents on disk against its summary checksum
+bool SegmentManager::verifySegment(size_t segment) {
+    if (segment >= segmentCount) {
+        throw std::out_of_range("Segment out of range.");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (isOpen(segment)) {
+        return true;
+    }
+
+    std::vector<char> contents = diskManager.readBlocks(segmentStart + segment * segmentBlocks, segmentBlocks);
+    SummaryHeader summary;
+    std::memcpy(&summary, contents.data(), sizeof(summary));
+    if (summary.magic != SUMMARY_MAGIC || summary.blockCount > slots) {
+        return false;
+    }
+    SummaryHeader unsummed = summary;
+    unsummed.checksum = 0;
+    std::memcpy(contents.data(), &unsummed, sizeof(unsummed));
+    return checksum(CHECKSUM_SEED, contents.data(), (summaryBlocks + summary.blockCount) * blockSize) ==
+           summary.checksum;
+}
+
+// Physical block holding the newest copy of an inode (the inode map)
+uint32_t SegmentManager::locateInode(size_t inodeId) const {
+    return locateBlock(inodeTableStart + inodeId / inodesPerBlock);
+}
+
+SegmentManager::SegmentUsage SegmentManager::getUsage(size_t segment) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return SegmentUsage{liveBlocks.at(segment), modifiedAt.at(segment), isClean(segment)};
+}
+
+size_t SegmentManager::getSegmentCount() const {
+    return segmentCount;
+}
+
+size_t SegmentManager::getSlotsPerSegment() const {
+    return slots;
+}
+
+size_t SegmentManager::getLiveBlocks(size_t segment) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return liveBlocks.at(segment);
+}
+
+// Segments that can be filled again
+size_t SegmentManager::getCleanSegments() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return countClean();
+}
+
+size_t SegmentManager::getSegmentWrites() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return segmentWrites;
+}
+
+size_t SegmentManager::getBlocksWritten() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return blocksWritten;
+}
+
+size_t SegmentManager::getUserBlocksWritten() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return userBlocksWritten;
+}
+
+size_t SegmentManager::getCommits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return commits;
+}
+
+size_t SegmentManager::getCheckpoints() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return checkpoints;
+}
+
+size_t SegmentManager::getCheckpointInterval() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return checkpointInterval;
+}
+
+size_t SegmentManager::getSegmentsCleaned() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return segmentsCleaned;
+}
+
+size_t SegmentManager::getBlocksMoved() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return blocksMoved;
+}
+
+double SegmentManager::getCleaningSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cleaningSeconds;
+}
+
+// Blocks appended per block written by the file system
+double SegmentManager::getWriteAmplification() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return userBlocksWritten == 0 ? 1.0 : static_cast<double>(blocksWritten) / userBlocksWritten;
+}
+
+// Sprite LFS write cost: blocks read and written per block of space the cleaner reclaimed
+double SegmentManager::getCleaningCost() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t blocksRead = segmentsCleaned * segmentBlocks;
+    size_t reclaimed = segmentsCleaned * slots - blocksMoved;
+    if (reclaimed == 0) {
+        return 1.0;
+    }
+    return static_cast<double>(blocksRead + blocksMoved + reclaimed) / reclaimed;
+}
+
+// Append a block to a head, opening a new segment when it is full
+uint32_t SegmentManager::append(Head& head, uint32_t tag, const char* data, uint32_t blockModifiedAt) {
+    if (!head.open || head.nextSlot == slots) {
+        openSegment(head);
+    }
+
+    std::memcpy(head.buffer.data() + (summaryBlocks + head.nextSlot) * blockSize, data, blockSize);
+    head.tags[head.nextSlot] = tag;
+    head.modifiedAt = std::max(head.modifiedAt, blockModifiedAt);
+    uint32_t physicalBlock = static_cast<uint32_t>(segmentStart + head.segment * segmentBlocks + summaryBlocks +
+                                                   head.nextSlot);
+    ++head.nextSlot;
+    ++liveBlocks[head.segment];
+    modifiedAt[head.segment] = head.modifiedAt;
+    ++blocksWritten;
+    return physicalBlock;
+}
+
+// Start filling the next clean segment
+void SegmentManager::openSegment(Head& head) {
+    if (&head == &userHead && !checkpointing) {
+        if (countClean() <= lowWatermark) {
+            cleanUntil(highWatermark); // The background cleaner is behind (or not running)
+        }
+        if (countClean() < highWatermark) {
+            cleanerWake.notify_one();
+        }
+
+        // The last clean segments are kept for checkpoints. If the file system has not
+        // checkpointed in time, checkpoint here: the map is still a state the disk could have
+        // been left in by a crash, which mounting has to handle anyway.
+        if (countClean() <= RESERVED_SEGMENTS && countWaiting() > 0) {
+            LLFS_LOG_WARN("SegmentManager", "Out of clean segments; checkpointing to reuse cleaned ones");
+            writeCheckpoint();
+            if (head.open && head.nextSlot < slots) {
+                return; // The checkpoint opened a segment for its map blocks
+            }
+        }
+        if (countClean() <= RESERVED_SEGMENTS) {
+            throw std::runtime_error("Log is full: no clean segments.");
+        }
+    }
+
+    // Search onwards from the head's last segment so the log sweeps the disk sequentially
+    for (size_t i = 1; i <= segmentCount; ++i) {
+        size_t segment = (head.segment + i) % segmentCount;
+        if (!isClean(segment)) {
+            continue;
+        }
+
+        // A full segment goes to disk with one write, linked to its successor for the roll-forward
+        if (head.open) {
+            head.nextSegment = static_cast<uint32_t>(segment);
+            head.summaryDirty = true;
+            flushHead(head);
+        }
+
+        head.open = true;
+        head.summaryDirty = false;
+        head.segment = segment;
+        head.nextSlot = 0;
+        head.flushedSlots = 0;
+        head.committedSlots = 0;
+        head.nextSegment = NO_SEGMENT;
+        head.sequence = ++sequence;
+        head.modifiedAt = 0;
+        std::fill(head.buffer.begin(), head.buffer.end(), 0);
+        std::fill(head.tags.begin(), head.tags.end(), 0);
+        writtenSinceCheckpoint[segment] = true;
+        if (&head == &userHead) {
+            ++segmentsSinceCheckpoint;
+        }
+        LLFS_LOG_DEBUG("SegmentManager", "Opened segment ", segment, " sequence=", sequence,
+                       &head == &cleanerHead ? " (cleaner)" : "");
+        return;
+    }
+    throw std::runtime_error("Log is full: no clean segments.");
+}
+
+// Write a head's unwritten slots and its summary
+void SegmentManager::flushHead(Head& head) {
+    if (!head.open || (head.nextSlot == head.flushedSlots && !head.summaryDirty)) {
+        return;
+    }
+
+    // The summary covers every slot written so far, so a later partial write replaces it
+    SummaryHeader header = {};
+    header.magic = SUMMARY_MAGIC;
+    header.blockCount = static_cast<uint32_t>(head.nextSlot);
+    header.sequence = head.sequence;
+    header.modifiedAt = head.modifiedAt;
+    header.committedSlots = static_cast<uint32_t>(head.committedSlots);
+    header.nextSegment = head.nextSegment;
+    header.flags = &head == &cleanerHead ? CLEANER_SEGMENT : 0;
+    std::memcpy(head.buffer.data(), &header, sizeof(header));
+    std::memcpy(head.buffer.data() + sizeof(header), head.tags.data(), slots * sizeof(uint32_t));
+    header.checksum = checksum(CHECKSUM_SEED, head.buffer.data(), (summaryBlocks + head.nextSlot) * blockSize);
+    std::memcpy(head.buffer.data(), &header, sizeof(header));
+
+    size_t first = segmentStart + head.segment * segmentBlocks;
+    auto slot = [&](size_t index) { return head.buffer.begin() + (summaryBlocks + index) * blockSize; };
+    if (head.flushedSlots == 0) {
+        // Summary and blocks in one sequential write
+        diskManager.writeBlocks(first, std::vector<char>(head.buffer.begin(), slot(head.nextSlot)));
+    } else {
+        // New blocks first: the summary vouches for them
+        if (head.nextSlot > head.flushedSlots) {
+            diskManager.writeBlocks(first + summaryBlocks + head.flushedSlots,
+                                    std::vector<char>(slot(head.flushedSlots), slot(head.nextSlot)));
+        }
+        diskManager.writeBlocks(first, std::vector<char>(head.buffer.begin(), slot(0)));
+    }
+    head.flushedSlots = head.nextSlot;
+    head.summaryDirty = false;
+    ++segmentWrites;
+}
+
+// Flush, append the changed map blocks and write the next checkpoint slot
+void SegmentManager::writeCheckpoint() {
+    // Map blocks are not in the address map themselves, so writing them changes nothing else;
+    // they may go into the reserved segments. The user head must be open: the roll-forward
+    // starts from it.
+    checkpointing = true;
+    try {
+        if (!userHead.open) {
+            openSegment(userHead);
+        }
+        std::vector<char> block(blockSize);
+        for (size_t i = 0; i < mapLocations.size(); ++i) {
+            if (!dirtyMapBlocks[i]) continue;
+            size_t first = i * entriesPerMapBlock;
+            size_t count = std::min(entriesPerMapBlock, volumeBlocks - first);
+            std::fill(block.begin(), block.end(), 0);
+            std::memcpy(block.data(), addressMap.data() + first, count * sizeof(uint32_t));
+
+            uint32_t physicalBlock = append(userHead, MAP_BLOCK_TAG | static_cast<uint32_t>(i), block.data(), clock);
+            retire(mapLocations[i]);
+            mapLocations[i] = physicalBlock;
+            dirtyMapBlocks[i] = false;
+        }
+    } catch (...) {
+        checkpointing = false;
+        throw;
+    }
+    checkpointing = false;
+    userHead.summaryDirty = true; // The roll-forward checks the head's sequence on disk
+    flushHead(userHead);
+    flushHead(cleanerHead);
+    diskManager.sync();
+
+    // The log is on disk; now overwrite the older checkpoint slot
+    CheckpointHeader header = {};
+    header.magic = CHECKPOINT_MAGIC;
+    header.mapBlocks = static_cast<uint32_t>(mapLocations.size());
+    header.sequence = checkpointSequence + 1;
+    header.segmentSequence = sequence;
+    header.headSequence = userHead.sequence;
+    header.headSegment = static_cast<uint32_t>(userHead.segment);
+    header.headSlot = static_cast<uint32_t>(userHead.nextSlot);
+    header.segmentCount = static_cast<uint32_t>(segmentCount);
+    header.clock = clock;
+    std::vector<char> region(checkpointSlotBlocks * blockSize, 0);
+    std::memcpy(region.data(), &header, sizeof(header));
+    std::memcpy(region.data() + sizeof(header), mapLocations.data(), mapLocations.size() * sizeof(uint32_t));
+    std::memcpy(region.data() + sizeof(header) + mapLocations.size() * sizeof(uint32_t), modifiedAt.data(),
+                segmentCount * sizeof(uint32_t));
+    header.checksum = checksum(CHECKSUM_SEED, region.data(), region.size());
+    std::memcpy(region.data(), &header, sizeof(header));
+    diskManager.writeBlocks(checkpointStart + (header.sequence % 2) * checkpointSlotBlocks, region);
+    diskManager.sync();
+    checkpointSequence = header.sequence;
+
+    // Segments emptied since the last checkpoint can now be reused; the open ones will be
+    // needed by the next roll-forward
+    checkpointLiveBlocks = liveBlocks;
+    std::fill(writtenSinceCheckpoint.begin(), writtenSinceCheckpoint.end(), false);
+    for (const Head* head : {&userHead, &cleanerHead}) {
+        if (head->open) {
+            writtenSinceCheckpoint[head->segment] = true;
+        }
+    }
+    std::fill(discardPending.begin(), discardPending.end(), false);
+    pendingDiscards.clear();
+    segmentsSinceCheckpoint = 0;
+    ++checkpoints;
+}
+
+// Read and verify a checkpoint slot (false if it is torn or was never written)
+bool SegmentManager::readCheckpoint(size_t slot, CheckpointHeader& header, std::vector<char>& region) const {
+    region = diskManager.readBlocks(checkpointStart + slot * checkpointSlotBlocks, checkpointSlotBlocks);
+    std::memcpy(&header, region.data(), sizeof(header));
+    if (header.magic != CHECKPOINT_MAGIC || header.mapBlocks != mapLocations.size() ||
+        header.segmentCount != segmentCount || header.headSegment >= segmentCount || header.headSlot > slots) {
+        return false;
+    }
+    CheckpointHeader unsummed = header;
+    unsummed.checksum = 0;
+    std::vector<char> copy = region;
+    std::memcpy(copy.data(), &unsummed, sizeof(unsummed));
+    return checksum(CHECKSUM_SEED, copy.data(), copy.size()) == header.checksum;
+}
+
+// Apply committed user segments written after a checkpoint; returns the blocks applied
+size_t SegmentManager::rollForward(const CheckpointHeader& checkpoint) {
+    if (checkpoint.headSequence == 0) {
+        return 0; // Freshly formatted
+    }
+
+    // Follow the links from the checkpoint's head segment while the summaries check out
+    struct Step {
+        size_t segment;
+        size_t firstSlot;               // Slots before this were in the checkpoint
+        SummaryHeader summary;
+        std::vector<char> contents;
+    };
+    std::vector<Step> chain;
+    size_t segment = checkpoint.headSegment;
+    size_t firstSlot = checkpoint.headSlot;
+    uint64_t previousSequence = 0;
+    while (chain.size() < segmentCount) {
+        std::vector<char> contents = diskManager.readBlocks(segmentStart + segment * segmentBlocks, segmentBlocks);
+        SummaryHeader summary;
+        std::memcpy(&summary, contents.data(), sizeof(summary));
+        bool linked = chain.empty() ? summary.sequence == checkpoint.headSequence
+                                    : summary.sequence > previousSequence;
+        if (summary.magic != SUMMARY_MAGIC || !linked || (summary.flags & CLEANER_SEGMENT) ||
+            summary.blockCount > slots || summary.blockCount < firstSlot) {
+            break;
+        }
+        SummaryHeader unsummed = summary;
+        unsummed.checksum = 0;
+        std::memcpy(contents.data(), &unsummed, sizeof(unsummed));
+        if (checksum(CHECKSUM_SEED, contents.data(), (summaryBlocks + summary.blockCount) * blockSize) !=
+            summary.checksum) {
+            break; // Torn write
+        }
+        chain.push_back(Step{segment, firstSlot, summary, std::move(contents)});
+        previousSequence = summary.sequence;
+        sequence = std::max(sequence, summary.sequence);
+        if (summary.blockCount < slots || summary.nextSegment >= segmentCount) {
+            break;
+        }
+        segment = summary.nextSegment;
+        firstSlot = 0;
+    }
+
+    // A commit covers everything appended before it, in earlier segments too
+    size_t lastCommit = chain.size();
+    for (size_t i = 0; i < chain.size(); ++i) {
+        if (chain[i].summary.committedSlots > chain[i].firstSlot) {
+            lastCommit = i;
+        }
+    }
+
+    size_t applied = 0;
+    for (size_t i = 0; i < chain.size(); ++i) {
+        const Step& step = chain[i];
+        writtenSinceCheckpoint[step.segment] = true; // Until the recovery checkpoint
+        modifiedAt[step.segment] = std::max(modifiedAt[step.segment], step.summary.modifiedAt);
+        clock = std::max(clock, step.summary.modifiedAt);
+        if (lastCommit == chain.size() || i > lastCommit) {
+            continue;
+        }
+
+        size_t end = i == lastCommit ? step.summary.committedSlots : step.summary.blockCount;
+        const char* tags = step.contents.data() + sizeof(SummaryHeader);
+        size_t first = segmentStart + step.segment * segmentBlocks + summaryBlocks;
+        for (size_t slot = step.firstSlot; slot < end; ++slot) {
+            uint32_t tag;
+            std::memcpy(&tag, tags + slot * sizeof(uint32_t), sizeof(tag));
+            const char* data = step.contents.data() + (summaryBlocks + slot) * blockSize;
+            if (tag == DISCARD_TAG) {
+                uint32_t count;
+                std::memcpy(&count, data, sizeof(count));
+                for (uint32_t k = 0; k < count && k + 1 < blockSize / sizeof(uint32_t); ++k) {
+                    uint32_t blockNumber;
+                    std::memcpy(&blockNumber, data + (k + 1) * sizeof(uint32_t), sizeof(blockNumber));
+                    if (blockNumber < volumeBlocks && addressMap[blockNumber] != 0) {
+                        retire(addressMap[blockNumber]);
+                        addressMap[blockNumber] = 0;
+                        dirtyMapBlocks[blockNumber / entriesPerMapBlock] = true;
+                    }
+                }
+            } else if (tag < volumeBlocks) {
+                retire(addressMap[tag]);
+                addressMap[tag] = static_cast<uint32_t>(first + slot);
+                ++liveBlocks[step.segment];
+                dirtyMapBlocks[tag / entriesPerMapBlock] = true;
+                ++applied;
+            }
+            // Map blocks after the checkpoint belong to one that never finished
+        }
+    }
+    return applied;
+}
+
+// Clean victims until targetSegments are clean or waiting for a checkpoint
+size_t SegmentManager::cleanUntil(size_t targetSegments) {
+    size_t cleaned = 0;
+    while (countClean() + countWaiting() < targetSegments && cleanOne()) {
+        ++cleaned;
+    }
+    return cleaned;
+}
+
+// Copy the live blocks of the best cost-benefit victim; false if there is none
+bool SegmentManager::cleanOne() {
+    long victim = selectVictim();
+    if (victim < 0) {
+        return false;
+    }
+
+    // The live blocks must fit into what is left of the cleaner's segment and the clean ones,
+    // leaving the reserve and a segment for new writes. Only when cleaning is the sole way to
+    // gain space may the cleaner take that last segment too.
+    size_t clean = countClean();
+    size_t keep = RESERVED_SEGMENTS + 1;
+    size_t room = (cleanerHead.open ? slots - cleanerHead.nextSlot : 0) + (clean - std::min(clean, keep)) * slots;
+    if (liveBlocks[victim] > room && countWaiting() == 0 && clean >= keep) {
+        room += slots;
+    }
+    if (liveBlocks[victim] > room) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    // Read the whole segment with one read; the summary says what each slot holds
+    size_t first = segmentStart + victim * segmentBlocks;
+    std::vector<char> segment = diskManager.readBlocks(first, segmentBlocks);
+    SummaryHeader header;
+    std::memcpy(&header, segment.data(), sizeof(header));
+    if (header.magic != SUMMARY_MAGIC || header.blockCount > slots) {
+        LLFS_LOG_ERROR("SegmentManager", "Cannot clean segment ", victim, ": invalid summary");
+        return false;
+    }
+    std::vector<uint32_t> tags(header.blockCount);
+    std::memcpy(tags.data(), segment.data() + sizeof(header), tags.size() * sizeof(uint32_t));
+
+    // A slot is live if the map still points at it; moved blocks keep the victim's age
+    size_t moved = 0;
+    for (size_t slot = 0; slot < tags.size(); ++slot) {
+        uint32_t physicalBlock = static_cast<uint32_t>(first + summaryBlocks + slot);
+        const char* data = segment.data() + (summaryBlocks + slot) * blockSize;
+        uint32_t tag = tags[slot];
+        if (tag & MAP_BLOCK_TAG) {
+            size_t index = tag & ~MAP_BLOCK_TAG;
+            if (index < mapLocations.size() && mapLocations[index] == physicalBlock) {
+                mapLocations[index] = append(cleanerHead, tag, data, header.modifiedAt);
+                retire(physicalBlock);
+                ++moved;
+            }
+        } else if (tag < volumeBlocks && addressMap[tag] == physicalBlock) {
+            addressMap[tag] = append(cleanerHead, tag, data, header.modifiedAt);
+            dirtyMapBlocks[tag / entriesPerMapBlock] = true;
+            retire(physicalBlock);
+            ++moved;
+        }
+    }
+    if (liveBlocks[victim] != 0) {
+        LLFS_LOG_WARN("SegmentManager", "Segment ", victim, " still has ", liveBlocks[victim],
+                      " live blocks after cleaning");
+    }
+
+    ++segmentsCleaned;
+    blocksMoved += moved;
+    cleaningSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LLFS_LOG_DEBUG("SegmentManager", "Cleaned segment ", victim, ": moved=", moved, " age=",
+                   clock - header.modifiedAt);
+    return true;
+}
+
+// Segment with the best cost-benefit ratio among those with dead blocks (-1 if none)
+long SegmentManager::selectVictim() const {
+    long victim = -1;
+    double bestScore = 0;
+    for (size_t segment = 0; segment < segmentCount; ++segment) {
+        if (isOpen(segment) || liveBlocks[segment] == 0 || liveBlocks[segment] >= slots) {
+            continue; // Being filled, already empty, or nothing to gain
+        }
+
+        // Cleaning frees (1 - u) of a segment at the cost of reading it and writing u of it back;
+        // old data is likely to stay put, so its free space is worth more
+        double utilization = static_cast<double>(liveBlocks[segment]) / slots;
+        double age = static_cast<double>(clock - std::min(clock, modifiedAt[segment])) + 1;
+        double score = (1 - utilization) * age / (1 + utilization);
+        if (score > bestScore) {
+            bestScore = score;
+            victim = static_cast<long>(segment);
+        }
+    }
+    return victim;
+}
+
+bool SegmentManager::isOpen(size_t segment) const {
+    return (userHead.open && userHead.segment == segment) || (cleanerHead.open && cleanerHead.segment == segment);
+}
+
+// A segment is clean when nothing in the current map, the last checkpoint or its roll-forward
+// points into it
+bool SegmentManager::isClean(size_t segment) const {
+    return liveBlocks[segment] == 0 && checkpointLiveBlocks[segment] == 0 && !writtenSinceCheckpoint[segment] &&
+           !isOpen(segment);
+}
+
+size_t SegmentManager::countClean() const {
+    size_t clean = 0;
+    for (size_t segment = 0; segment < segmentCount; ++segment) {
+        clean += isClean(segment);
+    }
+    return clean;
+}
+
+// Empty, but the last checkpoint or its roll-forward still needs them
+size_t SegmentManager::countWaiting() const {
+    size_t waiting = 0;
+    for (size_t segment = 0; segment < segmentCount; ++segment) {
+        bool needed = checkpointLiveBlocks[segment] != 0 || writtenSinceCheckpoint[segment];
+        waiting += liveBlocks[segment] == 0 && needed && !isOpen(segment);
+    }
+    return waiting;
+}
+
+// Background cleaner loop
+void SegmentManager::runCleaner() {
+    lowerThreadPriority();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!cleanerStopping) {
+        if (countClean() + countWaiting() < highWatermark && cleanOne()) {
+            // One victim at a time, so writers get the lock in between
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+            continue;
+        }
+        cleanerWake.wait_for(lock, std::chrono::milliseconds(100));
+    }
+}
+
+// Drop a block's old copy from the segment usage
+void SegmentManager::retire(uint32_t physicalBlock) {
+    if (physicalBlock != 0) {
+        --liveBlocks[segmentOf(physicalBlock)];
+    }
+}
+
+// Segment holding a physical block
+size_t SegmentManager::segmentOf(uint32_t physicalBlock) const {
+    return (physicalBlock - segmentStart) / segmentBlocks;
+}
+
+// Check that a physical block is a slot of some segment
+bool SegmentManager::isSlot(uint32_t physicalBlock) const {
+    if (physicalBlock < segmentStart || physicalBlock >= segmentStart + segmentCount * segmentBlocks) {
+        return false;
+    }
+    return (physicalBlock - segmentStart) % segmentBlocks >= summaryBlocks;
+}
+
+uint32_t SegmentManager::checksum(uint32_t hash, const char* data, size_t length) {
+    return Crc32c::compute(hash, data, length);
+}
@@ -0,0 +1,292 @@
+#ifndef SEGMENTMANAGER_H
+#define SEGMENTMANAGER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DiskManager.h"
+
+// Log-structured block store for LFS mode (like Sprite LFS). Every block write - file data,
+// directories, indirect blocks, inodes, the free block vector - is appended to the current
+// segment in memory, and a segment goes to disk with one sequential write once it is full.
+// Nothing is updated in place.
+//
+// The address map translates the block numbers the rest of the file system uses into log
+// positions; its entries for inode table blocks form the inode map. A checkpoint appends the
+// changed parts of the map to the log and records where they are, with the segment usage
+// table, in one of two checkpoint slots after the superblock; the slots alternate, so a torn
+// checkpoint write leaves the previous one intact. Checkpoints are periodic: commit() only
+// writes the segment being filled with a commit mark in its summary, and summaries link each
+// segment to the next one. Mounting loads the newest valid checkpoint and rolls forward along
+// those links to the last commit, so it reads at most a checkpoint interval of segments.
+//
+// The segment usage table counts the live blocks of every segment and when its youngest block
+// was written. The cleaner picks victims by cost-benefit, (1 - u) * age / (1 + u), and copies
+// their live blocks into segments of their own, so cold data ends up together. Cleaned segments
+// are reused after the next checkpoint; the file system checkpoints when needsCheckpoint() says
+// so, and a writer that finds no clean segment left checkpoints itself.
+class SegmentManager {
+public:
+    // Segment usage table entry
+    struct SegmentUsage {
+        size_t liveBlocks;
+        uint32_t modifiedAt;            // Log clock when its youngest block was written
+        bool clean;                     // Can be filled again
+    };
+
+    // Constructor; call recover() (or format the disk) before use
+    SegmentManager(DiskManager& diskManager, const Superblock& layout);
+
+    // Destructor; stops the cleaner
+    ~SegmentManager();
+
+    // Write an empty checkpoint (during formatting)
+    static void formatRegion(DiskManager& diskManager, const Superblock& layout);
+
+    // Block slots in a segment after its summary
+    static size_t slotsPerSegment(size_t segmentBlocks, size_t blockSize);
+
+    // Blocks needed by one checkpoint slot for a volume of the given size (the region holds two)
+    static size_t checkpointRegionBlocks(size_t volumeBlocks, size_t segmentCount, size_t blockSize);
+
+    // Load the newest valid checkpoint and roll forward to the last commit; uncommitted writes
+    // are discarded. Returns the number of blocks rolled forward.
+    size_t recover();
+
+    // Append a block to the log
+    void writeBlock(size_t blockNumber, const std::vector<char>& data);
+
+    // Read the newest copy of a block (zeros if it was never written)
+    void readBlock(size_t blockNumber, std::vector<char>& data);
+
+    // Forget a freed block so its copy no longer counts as live data
+    void discardBlock(size_t blockNumber);
+
+    // Write the blocks appended to the open segments so far
+    void flush();
+
+    // Make every block written (and discarded) so far durable: recovery rolls forward to here
+    void commit();
+
+    // Flush, append the changed map blocks and write the next checkpoint slot
+    void checkpoint();
+
+    // Checkpoint once this many segments have been filled since the last one (bounds the
+    // roll-forward at mount)
+    void setCheckpointInterval(size_t segments);
+
+    // Clean victims until this many segments are clean or only wait for a checkpoint
+    // (0 = the high watermark); returns the number of segments cleaned
+    size_t clean(size_t targetSegments = 0);
+
+    // Check whether the checkpoint interval has passed, or a checkpoint would let cleaned
+    // segments be reused while clean ones run low
+    bool needsCheckpoint() const;
+
+    // Clean in a low-priority background thread whenever fewer than highWatermark segments are
+    // clean (0 = defaults); writers also clean inline once only lowWatermark are left
+    void startCleaner(size_t lowWatermark = 0, size_t highWatermark = 0);
+
+    // Stop the background cleaner
+    void stopCleaner();
+
+    // Physical block holding the newest copy of a block (0 if it was never written)
+    uint32_t locateBlock(size_t blockNumber) const;
+
+    // Physical block holding the newest copy of an inode (the inode map)
+    uint32_t locateInode(size_t inodeId) const;
+
+    // Check a segment's contents on disk against its summary checksum (open segments are
+    // held in memory and pass)
+    bool verifySegment(size_t segment);
+
+    // Segment usage
+    SegmentUsage getUsage(size_t segment) const;
+    size_t getSegmentCount() const;
+    size_t getSlotsPerSegment() const;
+    size_t getLiveBlocks(size_t segment) const;
+    size_t getCleanSegments() const;
+
+    // Statistics
+    size_t getSegmentWrites() const;    // Write calls for segments (full or partial)
+    size_t getBlocksWritten() const;    // Blocks appended to the log, for any reason
+    size_t getUserBlocksWritten() const; // Blocks appended by writeBlock
+    size_t getCommits() const;
+    size_t getCheckpoints() const;
+    size_t getCheckpointInterval() const;
+    size_t getSegmentsCleaned() const;
+    size_t getBlocksMoved() const;      // Live blocks copied by the cleaner
+    double getCleaningSeconds() const;  // Time spent cleaning
+
+    // Blocks appended per block written by the file system (1.0 = no cleaning or map overhead)
+    double getWriteAmplification() const;
+
+    // Sprite LFS write cost: blocks read and written per block of space the cleaner reclaimed,
+    // counting the new data that fills it (1.0 = nothing cleaned; 2 / (1 - u) for victims of
+    // utilization u)
+    double getCleaningCost() const;
+
+private:
+    // Stored in the first block(s) of a segment, followed by one tag per slot
+    struct SummaryHeader {
+        uint32_t magic;
+        uint32_t blockCount;            // Slots written so far
+        uint64_t sequence;              // Order in which segments were opened
+        uint32_t checksum;              // Over tags and block contents
+        uint32_t modifiedAt;            // Log clock when its youngest block was written
+        uint32_t committedSlots;        // Slots covered by the last commit in this segment
+        uint32_t nextSegment;           // Segment filled after this one (NO_SEGMENT until full)
+        uint32_t flags;                 // CLEANER_SEGMENT
+        uint32_t reserved;
+    };
+
+    // Stored at the start of each checkpoint slot, followed by the map block locations and
+    // the segment ages
+    struct CheckpointHeader {
+        uint32_t magic;
+        uint32_t mapBlocks;
+        uint64_t sequence;              // Checkpoint number; the newest valid slot wins
+        uint64_t segmentSequence;       // Last segment opened before the checkpoint
+        uint64_t headSequence;          // Sequence of the segment being filled (0 = none)
+        uint32_t headSegment;           // Segment being filled: roll-forward starts here
+        uint32_t headSlot;              // First slot written after the checkpoint
+        uint32_t segmentCount;
+        uint32_t clock;
+        uint32_t checksum;              // Over the whole slot
+        uint32_t reserved;
+    };
+
+    // A segment being filled: new writes, or blocks moved by the cleaner. A full segment stays
+    // open until the next append, which links it to its successor.
+    struct Head {
+        bool open = false;
+        bool summaryDirty = false;      // Summary changed since it was last written
+        size_t segment = 0;
+        size_t nextSlot = 0;
+        size_t flushedSlots = 0;        // Slots already on disk
+        size_t committedSlots = 0;
+        uint32_t nextSegment = 0;
+        uint64_t sequence = 0;
+        uint32_t modifiedAt = 0;
+        std::vector<char> buffer;       // Summary and slots
+        std::vector<uint32_t> tags;     // Block number (or map block tag) per slot
+    };
+
+    // Tag of a slot holding a map block rather than a file system block
+    static constexpr uint32_t MAP_BLOCK_TAG = 0x80000000;
+
+    // Tag of a slot listing blocks discarded before a commit
+    static constexpr uint32_t DISCARD_TAG = 0x40000000;
+
+    static constexpr uint32_t NO_SEGMENT = UINT32_MAX;
+    static constexpr uint32_t CLEANER_SEGMENT = 1;
+
+    // Clean segments kept back for checkpoints
+    static constexpr size_t RESERVED_SEGMENTS = 1;
+
+    DiskManager& diskManager;
+    size_t blockSize;
+    size_t volumeBlocks;
+    size_t inodeTableStart;
+    size_t inodesPerBlock;
+    size_t checkpointStart;
+    size_t checkpointSlotBlocks;        // Blocks per checkpoint slot
+    size_t segmentStart;
+    size_t segmentBlocks;
+    size_t segmentCount;
+    size_t summaryBlocks;               // Blocks at the start of each segment holding its summary
+    size_t slots;                       // Blocks per segment after the summary
+    size_t entriesPerMapBlock;
+
+    mutable std::mutex mutex;
+
+    std::vector<uint32_t> addressMap;   // Block number -> physical block (0 = never written)
+    std::vector<uint32_t> mapLocations; // Map block -> physical block (0 = never written)
+    std::vector<bool> dirtyMapBlocks;   // Changed since the last checkpoint
+    std::vector<uint32_t> liveBlocks;   // Segment usage: live blocks per segment
+    std::vector<uint32_t> modifiedAt;   // Segment usage: log clock of the youngest block
+    std::vector<uint32_t> checkpointLiveBlocks; // Live blocks per segment as of the last checkpoint
+    std::vector<bool> writtenSinceCheckpoint;   // Needed by the roll-forward until the next checkpoint
+    std::vector<uint32_t> pendingDiscards;      // Discarded since the last commit
+    std::vector<bool> discardPending;           // Per block: listed in pendingDiscards
+
+    Head userHead;                      // Blocks from writeBlock and checkpoints
+    Head cleanerHead;                   // Blocks moved by the cleaner
+    uint64_t sequence = 0;
+    uint64_t checkpointSequence = 0;
+    uint32_t clock = 0;                 // Advances with every block from writeBlock
+    size_t checkpointInterval;
+    size_t segmentsSinceCheckpoint = 0; // Segments the user head has opened
+    bool checkpointing = false;         // Map blocks may go into the reserved segments
+
+    size_t lowWatermark;
+    size_t highWatermark;
+    std::thread cleaner;
+    std::condition_variable cleanerWake;
+    bool cleanerStopping = false;
+
+    size_t segmentWrites = 0;
+    size_t blocksWritten = 0;
+    size_t userBlocksWritten = 0;
+    size_t commits = 0;
+    size_t checkpoints = 0;
+    size_t segmentsCleaned = 0;
+    size_t blocksMoved = 0;
+    double cleaningSeconds = 0;
+
+    // The helpers below expect the mutex to be held
+
+    // Append a block to a head, opening a new segment when it is full
+    uint32_t append(Head& head, uint32_t tag, const char* data, uint32_t blockModifiedAt);
+
+    // Start filling the next clean segment
+    void openSegment(Head& head);
+
+    // Write a head's unwritten slots and its summary
+    void flushHead(Head& head);
+
+    // Flush, append the changed map blocks and write the next checkpoint slot
+    void writeCheckpoint();
+
+    // Read and verify a checkpoint slot (false if it is torn or was never written)
+    bool readCheckpoint(size_t slot, CheckpointHeader& header, std::vector<char>& region) const;
+
+    // Apply committed user segments written after a checkpoint; returns the blocks applied
+    size_t rollForward(const CheckpointHeader& header);
+
+    // Clean victims until targetSegments are clean or waiting for a checkpoint
+    size_t cleanUntil(size_t targetSegments);
+
+    // Copy the live blocks of the best cost-benefit victim; false if there is none
+    bool cleanOne();
+
+    // Segment with the best cost-benefit ratio among those with dead blocks (-1 if none)
+    long selectVictim() const;
+
+    // Clean-segment bookkeeping
+    bool isOpen(size_t segment) const;
+    bool isClean(size_t segment) const;
+    size_t countClean() const;
+    size_t countWaiting() const;        // Empty, but the last checkpoint or its roll-forward still needs them
+
+    // Background cleaner loop
+    void runCleaner();
+
+    // Drop a block's old copy from the segment usage
+    void retire(uint32_t physicalBlock);
+
+    // Segment holding a physical block
+    size_t segmentOf(uint32_t physicalBlock) const;
+
+    // Check that a physical block is a slot of some segment
+    bool isSlot(uint32_t physicalBlock) const;
+
+    // CRC32C over a byte range, continuing from hash
+    static uint32_t checksum(uint32_t hash, const char* data, size_t length);
+};
+
+#endif // SEGMENTMANAGER_H
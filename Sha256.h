@@ -0,0 +1,18 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// SHA-256 (FIPS 180-4), the strong hash behind block deduplication: two blocks with the same
+// digest are treated as the same block without comparing their bytes.
+class Sha256 {
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+    // Hash length bytes in one go
+    static Digest hash(const void* data, size_t length);
+};
+
+#endif // SHA256_H
@@ -0,0 +1,368 @@
+#include "SnapshotManager.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstring> // For memcpy
+#include <ctime>
+#include <stdexcept>
+
+// Constructor
+SnapshotManager::SnapshotManager(DiskManager& diskManager, FreeBlockManager& freeBlockManager, const Superblock& layout)
+    : diskManager(diskManager), freeBlockManager(freeBlockManager), layout(layout),
+      blockSize(diskManager.getBlockSize()), shared((layout.volumeBlocks + 7) / 8, 0) {
+}
+
+// Write an empty snapshot table (during formatting)
+void SnapshotManager::formatRegion(DiskManager& diskManager, const Superblock& layout) {
+    std::vector<char> block(diskManager.getBlockSize(), 0);
+    TableHeader header = {TABLE_MAGIC, 0, 1};
+    std::memcpy(block.data(), &header, sizeof(header));
+    diskManager.writeBlocks(layout.snapshotTableStart, block);
+}
+
+// Read the snapshots from disk and pin their blocks
+void SnapshotManager::load() {
+    std::lock_guard<std::mutex> lock(mutex);
+    snapshots.clear();
+    nextId = 1;
+    copiedBlocks = 0;
+
+    std::vector<char> table = diskManager.readBlocks(layout.snapshotTableStart, 1);
+    TableHeader header;
+    std::memcpy(&header, table.data(), sizeof(header));
+    if (header.magic == TABLE_MAGIC) { // Anything else is an unformatted disk, which mount rejects
+        if (header.count > getCapacity()) {
+            throw std::runtime_error("Invalid snapshot table.");
+        }
+        nextId = header.nextId;
+        for (uint32_t i = 0; i < header.count; ++i) {
+            TableEntry entry;
+            std::memcpy(&entry, table.data() + sizeof(header) + i * sizeof(entry), sizeof(entry));
+            Snapshot snapshot;
+            snapshot.name.assign(entry.name, strnlen(entry.name, NAME_LENGTH - 1));
+            snapshot.id = entry.id;
+            snapshot.createdAt = entry.createdAt;
+            readExceptions(snapshot, entry.firstExceptionBlock);
+            snapshots.push_back(std::move(snapshot));
+        }
+    }
+    rebuildPins();
+    LLFS_LOG_INFO("SnapshotManager", "Snapshots loaded: count=", snapshots.size());
+}
+
+// Forget every snapshot and unpin its blocks
+void SnapshotManager::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!views.empty()) {
+        throw std::runtime_error("A snapshot is mounted.");
+    }
+    snapshots.clear();
+    nextId = 1;
+    rebuildPins();
+}
+
+// Take a snapshot of the blocks now in use
+void SnapshotManager::create(const std::string& name, const std::vector<uint8_t>& freeBlockVector) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (name.empty() || name.size() >= NAME_LENGTH) {
+        throw std::invalid_argument("Snapshot names must have 1 to " + std::to_string(NAME_LENGTH - 1) +
+                                    " characters.");
+    }
+    if (findSnapshot(name) != snapshots.size()) {
+        throw std::runtime_error("Snapshot already exists: " + name);
+    }
+    if (snapshots.size() >= getCapacity()) {
+        throw std::runtime_error("Snapshot table is full.");
+    }
+
+    // The exception chain starts empty; the table entry makes the snapshot exist
+    Snapshot snapshot;
+    snapshot.name = name;
+    snapshot.id = nextId++;
+    snapshot.createdAt = static_cast<uint32_t>(std::time(nullptr));
+    snapshot.exceptionBlocks.push_back(static_cast<uint32_t>(freeBlockManager.pinFreeBlock()));
+    snapshot.lastExceptionBlock.assign(blockSize, 0);
+    diskManager.writeBlocks(snapshot.exceptionBlocks[0], snapshot.lastExceptionBlock);
+    snapshots.push_back(std::move(snapshot));
+    writeTable();
+
+    markInUse(freeBlockVector);
+    applyPins();
+    active = true;
+    LLFS_LOG_INFO("SnapshotManager", "Snapshot created: name=", name, " id=", snapshots.back().id);
+}
+
+// Delete a snapshot; the copies an older snapshot also reads pass to that one
+void SnapshotManager::remove(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t index = findSnapshot(name);
+    if (index == snapshots.size()) {
+        throw std::runtime_error("Snapshot not found: " + name);
+    }
+    if (views.count(snapshots[index].id)) {
+        throw std::runtime_error("Snapshot is mounted: " + name);
+    }
+
+    // The older snapshot read these blocks through this one's exceptions where it has none of
+    // its own. Merged first: a crash before the table is written leaves duplicates, not holes
+    if (index > 0) {
+        Snapshot& older = snapshots[index - 1];
+        std::vector<std::pair<uint32_t, uint32_t>> moved(snapshots[index].exceptions.begin(),
+                                                         snapshots[index].exceptions.end());
+        std::sort(moved.begin(), moved.end());
+        for (const auto& [blockNumber, copy] : moved) {
+            if (!older.exceptions.count(blockNumber)) {
+                appendException(older, blockNumber, copy);
+            }
+        }
+    }
+    snapshots.erase(snapshots.begin() + static_cast<std::ptrdiff_t>(index));
+    writeTable();
+    rebuildPins(); // Blocks only the deleted snapshot needed are free again
+    LLFS_LOG_INFO("SnapshotManager", "Snapshot deleted: name=", name);
+}
+
+// List the snapshots, oldest first
+std::vector<SnapshotInfo> SnapshotManager::list() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<SnapshotInfo> result;
+    for (const Snapshot& snapshot : snapshots) {
+        result.push_back({snapshot.name, snapshot.createdAt, snapshot.exceptions.size()});
+    }
+    return result;
+}
+
+// Copy out the blocks of a range that the newest snapshot still reads from their home location
+void SnapshotManager::preserveBlocks(size_t firstBlock, size_t count) {
+    if (!active.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::vector<uint32_t> blocks;
+    for (size_t blockNumber = firstBlock; blockNumber < firstBlock + count; ++blockNumber) {
+        if (isShared(blockNumber)) {
+            blocks.push_back(static_cast<uint32_t>(blockNumber));
+        }
+    }
+    if (blocks.empty()) {
+        return; // Copies and exception blocks are never shared, so their writes end here
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Snapshot& newest = snapshots.back();
+    for (uint32_t blockNumber : blocks) {
+        if (newest.exceptions.count(blockNumber)) {
+            continue; // Copied since the newest snapshot was taken; older ones read it from there
+        }
+        // Copy, record, then let the write go ahead: a crash in between leaves an unused copy
+        uint32_t copy = static_cast<uint32_t>(freeBlockManager.pinFreeBlock());
+        diskManager.writeBlocks(copy, diskManager.readBlocks(blockNumber, 1));
+        appendException(newest, blockNumber, copy);
+        ++copiedBlocks;
+    }
+}
+
+// Get where a snapshot keeps a block
+size_t SnapshotManager::locateBlock(uint32_t snapshotId, size_t blockNumber) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto snapshot = std::find_if(snapshots.begin(), snapshots.end(),
+                                 [&](const Snapshot& s) { return s.id == snapshotId; });
+    if (snapshot == snapshots.end()) {
+        throw std::runtime_error("Snapshot not found: id " + std::to_string(snapshotId));
+    }
+    for (; snapshot != snapshots.end(); ++snapshot) {
+        auto exception = snapshot->exceptions.find(static_cast<uint32_t>(blockNumber));
+        if (exception != snapshot->exceptions.end()) {
+            return exception->second;
+        }
+    }
+    return blockNumber;
+}
+
+// Look up a snapshot to read from it
+uint32_t SnapshotManager::attachView(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t index = findSnapshot(name);
+    if (index == snapshots.size()) {
+        throw std::runtime_error("Snapshot not found: " + name);
+    }
+    ++views[snapshots[index].id];
+    return snapshots[index].id;
+}
+
+// Stop reading from a snapshot
+void SnapshotManager::detachView(uint32_t snapshotId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto view = views.find(snapshotId);
+    if (view != views.end() && --view->second == 0) {
+        views.erase(view);
+    }
+}
+
+// Get the number of blocks copied out since the snapshots were loaded
+size_t SnapshotManager::getCopiedBlocks() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return copiedBlocks;
+}
+
+// Get the number of blocks pinned for the snapshots
+size_t SnapshotManager::getPinnedBlocks() const {
+    return freeBlockManager.getPinnedBlocks();
+}
+
+// Get the most snapshots the table holds
+size_t SnapshotManager::getCapacity() const {
+    return (blockSize - sizeof(TableHeader)) / sizeof(TableEntry);
+}
+
+// Helper function to find a snapshot by name
+size_t SnapshotManager::findSnapshot(const std::string& name) const {
+    for (size_t i = 0; i < snapshots.size(); ++i) {
+        if (snapshots[i].name == name) {
+            return i;
+        }
+    }
+    return snapshots.size();
+}
+
+// Helper function to write the snapshot table (one block, so it changes at once)
+void SnapshotManager::writeTable() {
+    std::vector<char> table(blockSize, 0);
+    TableHeader header = {TABLE_MAGIC, static_cast<uint32_t>(snapshots.size()), nextId};
+    std::memcpy(table.data(), &header, sizeof(header));
+    for (size_t i = 0; i < snapshots.size(); ++i) {
+        TableEntry entry = {};
+        std::memcpy(entry.name, snapshots[i].name.data(), snapshots[i].name.size());
+        entry.id = snapshots[i].id;
+        entry.createdAt = snapshots[i].createdAt;
+        entry.firstExceptionBlock = snapshots[i].exceptionBlocks[0];
+        std::memcpy(table.data() + sizeof(header) + i * sizeof(entry), &entry, sizeof(entry));
+    }
+    diskManager.writeBlocks(layout.snapshotTableStart, table);
+}
+
+// Helper function to add an exception to a snapshot's chain on disk
+void SnapshotManager::appendException(Snapshot& snapshot, uint32_t blockNumber, uint32_t copy) {
+    const size_t perBlock = (blockSize - sizeof(ExceptionHeader)) / (2 * sizeof(uint32_t));
+    ExceptionHeader header;
+    std::memcpy(&header, snapshot.lastExceptionBlock.data(), sizeof(header));
+    const uint32_t pair[2] = {blockNumber, copy};
+
+    if (header.count < perBlock) {
+        std::memcpy(snapshot.lastExceptionBlock.data() + sizeof(header) + header.count * sizeof(pair), pair,
+                    sizeof(pair));
+        ++header.count;
+        std::memcpy(snapshot.lastExceptionBlock.data(), &header, sizeof(header));
+        diskManager.writeBlocks(snapshot.exceptionBlocks.back(), snapshot.lastExceptionBlock);
+    } else {
+        // The new block is written before the chain links to it
+        std::vector<char> block(blockSize, 0);
+        ExceptionHeader next = {0, 1};
+        std::memcpy(block.data(), &next, sizeof(next));
+        std::memcpy(block.data() + sizeof(next), pair, sizeof(pair));
+        uint32_t location = static_cast<uint32_t>(freeBlockManager.pinFreeBlock());
+        diskManager.writeBlocks(location, block);
+        header.next = location;
+        std::memcpy(snapshot.lastExceptionBlock.data(), &header, sizeof(header));
+        diskManager.writeBlocks(snapshot.exceptionBlocks.back(), snapshot.lastExceptionBlock);
+        snapshot.exceptionBlocks.push_back(location);
+        snapshot.lastExceptionBlock = std::move(block);
+    }
+    snapshot.exceptions[blockNumber] = copy;
+}
+
+// Helper function to read a snapshot's exception chain from disk
+void SnapshotManager::readExceptions(Snapshot& snapshot, uint32_t firstBlock) {
+    const size_t perBlock = (blockSize - sizeof(ExceptionHeader)) / (2 * sizeof(uint32_t));
+    for (uint32_t location = firstBlock; location != 0;) {
+        if (location < layout.dataStart || location >= layout.volumeBlocks ||
+            snapshot.exceptionBlocks.size() >= layout.volumeBlocks) {
+            throw std::runtime_error("Invalid snapshot exception chain: " + snapshot.name);
+        }
+        std::vector<char> block = diskManager.readBlocks(location, 1);
+        ExceptionHeader header;
+        std::memcpy(&header, block.data(), sizeof(header));
+        if (header.count > perBlock) {
+            throw std::runtime_error("Invalid snapshot exception chain: " + snapshot.name);
+        }
+        for (uint32_t i = 0; i < header.count; ++i) {
+            uint32_t pair[2];
+            std::memcpy(pair, block.data() + sizeof(header) + i * sizeof(pair), sizeof(pair));
+            if (pair[0] >= layout.volumeBlocks || pair[1] < layout.dataStart || pair[1] >= layout.volumeBlocks) {
+                throw std::runtime_error("Invalid snapshot exception chain: " + snapshot.name);
+            }
+            snapshot.exceptions[pair[0]] = pair[1];
+        }
+        snapshot.exceptionBlocks.push_back(location);
+        snapshot.lastExceptionBlock = std::move(block);
+        location = header.next;
+    }
+}
+
+// Helper function to read a block as the snapshot at an index saw it
+std::vector<char> SnapshotManager::readSnapshotBlock(size_t index, size_t blockNumber) {
+    for (size_t i = index; i < snapshots.size(); ++i) {
+        auto exception = snapshots[i].exceptions.find(static_cast<uint32_t>(blockNumber));
+        if (exception != snapshots[i].exceptions.end()) {
+            return diskManager.readBlocks(exception->second, 1);
+        }
+    }
+    return diskManager.readBlocks(blockNumber, 1);
+}
+
+// Helper function to mark the blocks a free block vector has in use, and every metadata block,
+// as shared
+void SnapshotManager::markInUse(const std::vector<uint8_t>& freeBlockVector) {
+    // Metadata lives below dataStart; the superblock, the journal and the snapshot table are
+    // written in place whatever the snapshots hold
+    for (size_t blockNumber = 1; blockNumber < layout.dataStart; ++blockNumber) {
+        bool journal = blockNumber >= layout.journalStart && blockNumber < layout.journalStart + layout.journalBlocks;
+        bool table = blockNumber >= layout.snapshotTableStart &&
+                     blockNumber < layout.snapshotTableStart + layout.snapshotTableBlocks;
+        if (!journal && !table) {
+            shared[blockNumber / 8] |= (1 << (blockNumber % 8));
+        }
+    }
+    for (size_t byte = layout.dataStart / 8; byte < shared.size(); ++byte) {
+        uint8_t inUse = static_cast<uint8_t>(~freeBlockVector[byte]);
+        if (byte == layout.dataStart / 8) {
+            inUse &= static_cast<uint8_t>(0xFF << (layout.dataStart % 8)); // Already marked above
+        }
+        shared[byte] |= inUse;
+    }
+}
+
+// Helper function to rebuild the shared blocks from the snapshots and pin them
+void SnapshotManager::rebuildPins() {
+    std::fill(shared.begin(), shared.end(), 0);
+    for (size_t i = 0; i < snapshots.size(); ++i) {
+        // The bitmap as the snapshot saw it
+        std::vector<uint8_t> freeBlockVector;
+        for (size_t block = 0; block < layout.freeBlockVectorBlocks; ++block) {
+            std::vector<char> data = readSnapshotBlock(i, layout.freeBlockVectorStart + block);
+            freeBlockVector.insert(freeBlockVector.end(), data.begin(), data.end());
+        }
+        freeBlockVector.resize(shared.size());
+        markInUse(freeBlockVector);
+    }
+    applyPins();
+    active = !snapshots.empty();
+}
+
+// Helper function to pin the shared blocks, the copies and the exception blocks
+void SnapshotManager::applyPins() {
+    std::vector<uint8_t> pins = shared;
+    auto pin = [&](uint32_t blockNumber) { pins[blockNumber / 8] |= (1 << (blockNumber % 8)); };
+    for (const Snapshot& snapshot : snapshots) {
+        for (uint32_t location : snapshot.exceptionBlocks) {
+            pin(location);
+        }
+        for (const auto& exception : snapshot.exceptions) {
+            pin(exception.second);
+        }
+    }
+    freeBlockManager.setPinnedBlocks(pins);
+}
+
+// Helper function to check whether a snapshot reads a block from its home location
+bool SnapshotManager::isShared(size_t blockNumber) const {
+    return blockNumber < layout.volumeBlocks && (shared[blockNumber / 8] & (1 << (blockNumber % 8)));
+}
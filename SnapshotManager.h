@@ -0,0 +1,160 @@
+#ifndef SNAPSHOTMANAGER_H
+#define SNAPSHOTMANAGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DiskManager.h"
+#include "FreeBlockManager.h"
+
+// A snapshot, as listed
+struct SnapshotInfo {
+    std::string name;
+    uint32_t createdAt = 0;         // Seconds since the epoch
+    size_t copiedBlocks = 0;        // Blocks copied out for it since it was taken
+};
+
+// Copy-on-write snapshots of the whole volume (in-place mode), kept at the block level like LVM
+// snapshots. Taking one copies nothing: the blocks in use are pinned, so the allocator does not
+// hand them out again while the snapshot lives. File data is never overwritten in place, so it
+// is shared with the live file system as it is. A metadata block (bitmap, inode table, checksum
+// table, directory and indirect blocks) is copied to a free block just before its first
+// overwrite, and the newest snapshot records the copy as an exception. A snapshot reads a block
+// from its own exceptions, else from those of the snapshots taken after it, oldest first, else
+// from its home location.
+//
+// On disk, the snapshot table block lists the snapshots, and each has a chain of exception
+// blocks (home block -> copy). Copies and exception blocks stay free in the bitmap but pinned,
+// so fsck sees nothing new.
+class SnapshotManager {
+public:
+    // Constructor; call load() (or format the disk) before use
+    SnapshotManager(DiskManager& diskManager, FreeBlockManager& freeBlockManager, const Superblock& layout);
+
+    // Write an empty snapshot table (during formatting)
+    static void formatRegion(DiskManager& diskManager, const Superblock& layout);
+
+    // Read the snapshots from disk and pin their blocks (before the journal is replayed, which
+    // finds the journaled blocks already copied out: they are copied as they are logged)
+    void load();
+
+    // Forget every snapshot and unpin its blocks (before the disk is formatted); throws if one
+    // is mounted
+    void clear();
+
+    // Take a snapshot of the blocks now in use. The free block vector must match the disk: every
+    // block the snapshot reads is at its home location
+    void create(const std::string& name, const std::vector<uint8_t>& freeBlockVector);
+
+    // Delete a snapshot; the copies an older snapshot also reads pass to that one
+    void remove(const std::string& name);
+
+    // List the snapshots, oldest first
+    std::vector<SnapshotInfo> list() const;
+
+    // Copy out the blocks of a range that the newest snapshot still reads from their home
+    // location (before they are written)
+    void preserveBlocks(size_t firstBlock, size_t count);
+
+    // Get where a snapshot keeps a block (the block itself if it was not overwritten since)
+    size_t locateBlock(uint32_t snapshotId, size_t blockNumber) const;
+
+    // Look up a snapshot to read from it; it cannot be deleted until detachView
+    uint32_t attachView(const std::string& name);
+
+    // Stop reading from a snapshot
+    void detachView(uint32_t snapshotId);
+
+    // Get the number of blocks copied out since the snapshots were loaded
+    size_t getCopiedBlocks() const;
+
+    // Get the number of blocks pinned for the snapshots
+    size_t getPinnedBlocks() const;
+
+    // Get the most snapshots the table holds
+    size_t getCapacity() const;
+
+private:
+    static constexpr uint32_t TABLE_MAGIC = 0x50414E53; // "SNAP"
+    static constexpr size_t NAME_LENGTH = 32;           // Including the terminating zero
+
+    struct TableHeader {
+        uint32_t magic;
+        uint32_t count;                 // Entries that follow
+        uint32_t nextId;
+    };
+
+    struct TableEntry {
+        char name[NAME_LENGTH];
+        uint32_t id;
+        uint32_t createdAt;
+        uint32_t firstExceptionBlock;
+        uint32_t reserved;
+    };
+
+    struct ExceptionHeader {
+        uint32_t next;                  // Next block of the chain (0 = last)
+        uint32_t count;                 // (home block, copy) pairs that follow
+    };
+
+    struct Snapshot {
+        std::string name;
+        uint32_t id = 0;
+        uint32_t createdAt = 0;
+        std::unordered_map<uint32_t, uint32_t> exceptions; // Home block -> copy
+        std::vector<uint32_t> exceptionBlocks;             // The chain on disk
+        std::vector<char> lastExceptionBlock;              // Contents of its last block
+    };
+
+    DiskManager& diskManager;
+    FreeBlockManager& freeBlockManager;
+    Superblock layout;
+    size_t blockSize;
+
+    mutable std::mutex mutex;           // Guards the members below but shared
+    std::vector<Snapshot> snapshots;    // Oldest first
+    uint32_t nextId = 1;
+    std::unordered_map<uint32_t, size_t> views; // Readers per snapshot
+    size_t copiedBlocks = 0;
+
+    // Blocks a snapshot reads from their home location until they are copied: the metadata
+    // blocks and the blocks in use when a snapshot was taken. It only changes while no block
+    // is written (the file system is locked exclusively), so writes check it without the mutex
+    std::vector<uint8_t> shared;
+    std::atomic<bool> active{false};    // There are snapshots
+
+    // Helper function to find a snapshot by name (snapshots.size() if there is none)
+    size_t findSnapshot(const std::string& name) const;
+
+    // Helper function to write the snapshot table (mutex held)
+    void writeTable();
+
+    // Helper function to add an exception to a snapshot's chain on disk (mutex held)
+    void appendException(Snapshot& snapshot, uint32_t blockNumber, uint32_t copy);
+
+    // Helper function to read a snapshot's exception chain from disk
+    void readExceptions(Snapshot& snapshot, uint32_t firstBlock);
+
+    // Helper function to read a block as the snapshot at an index saw it (mutex held)
+    std::vector<char> readSnapshotBlock(size_t index, size_t blockNumber);
+
+    // Helper function to mark the blocks a free block vector has in use, and every metadata
+    // block, as shared
+    void markInUse(const std::vector<uint8_t>& freeBlockVector);
+
+    // Helper function to rebuild the shared blocks from the snapshots and pin them, with the
+    // copies and exception blocks (mutex held)
+    void rebuildPins();
+
+    // Helper function to pin the shared blocks, the copies and the exception blocks (mutex held)
+    void applyPins();
+
+    // Helper function to check whether a snapshot reads a block from its home location
+    bool isShared(size_t blockNumber) const;
+};
+
+#endif // SNAPSHOTMANAGER_H
@@ -0,0 +1,169 @@
+#include "../AsyncLLFS.h"
+#include "../EventLoop.h"
+#include "../Task.h"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef TEST_BUILD
+// Contents of file i (not all zeros, different per file)
+static std::vector<char> contents(size_t size, int file) {
+    std::vector<char> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<char>('a' + (file + i / 512) % 26);
+    }
+    return data;
+}
+
+static Task<int> answer() {
+    co_return 42;
+}
+
+static Task<int> twice() {
+    int first = co_await answer();
+    int second = co_await answer();
+    co_return first + second;
+}
+
+static Task<void> fail() {
+    throw std::runtime_error("failed");
+    co_return;
+}
+
+// Read a file and check it, counting failures
+static Task<void> readAndCheck(AsyncLLFS& async, std::string name, std::vector<char> expected, int& failures) {
+    std::vector<char> data = co_await async.readFile(name);
+    if (data != expected) ++failures;
+}
+
+// Reads of 4 KB from a scratch file through the loop, in one batch
+static Task<void> readBatch(EventLoop& loop, int fd, std::vector<char>& buffer, std::vector<EventLoop::Read>& reads) {
+    for (size_t i = 0; i < 4; ++i) {
+        EventLoop::Read read;
+        read.fd = fd;
+        read.buffer = buffer.data() + i * 1024;
+        read.length = 1024;
+        read.offset = (3 - i) * 1024; // Reversed
+        reads.push_back(read);
+    }
+    co_await loop.read(reads);
+}
+
+// Everything the API offers, against one loop
+static void exercise(EventLoop& loop) {
+    const size_t diskSize = 2 * 1024 * 1024; // 2 MB disk, 512-byte blocks
+    const size_t blockSize = 512;
+
+    // Tasks: values, nesting and exceptions
+    assert(loop.run(twice()) == 84);
+    try {
+        loop.run(fail());
+        assert(false);
+    } catch (const std::runtime_error& e) {
+        assert(std::string(e.what()) == "failed");
+    }
+    int offloaded = loop.run([&]() -> Task<int> {
+        int value = co_await loop.offload([] { return 7; });
+        co_return value;
+    }());
+    assert(offloaded == 7);
+
+    // A batch of reads completes as a whole
+    {
+        std::vector<char> file(4096);
+        for (size_t i = 0; i < file.size(); ++i) file[i] = static_cast<char>(i / 1024 + '0');
+        FILE* scratch = std::fopen("async_scratch", "wb");
+        std::fwrite(file.data(), 1, file.size(), scratch);
+        std::fclose(scratch);
+        int fd = ::open("async_scratch", O_RDONLY);
+        std::vector<char> buffer(4096);
+        std::vector<EventLoop::Read> reads;
+        loop.run(readBatch(loop, fd, buffer, reads));
+        ::close(fd);
+        std::remove("async_scratch");
+        for (size_t i = 0; i < 4; ++i) {
+            assert(reads[i].result == 1024 && buffer[i * 1024] == static_cast<char>('3' - i));
+        }
+    }
+
+    // File operations
+    LLFS fs("vdisk", diskSize, blockSize, WriteMode::InPlace, true);
+    fs.formatFileSystem();
+    AsyncLLFS async(fs, loop);
+    const int files = 16;
+    loop.run([&]() -> Task<void> {
+        for (int i = 0; i < files; ++i) {
+            std::string name = "/file" + std::to_string(i);
+            co_await async.createFile(name);
+            co_await async.writeFile(name, contents(3 * blockSize + i * 100, i));
+        }
+        co_await async.createFile("/holes");
+        std::vector<char> holes(4 * blockSize, 0);
+        holes[3 * blockSize] = 'x';
+        co_await async.writeFile("/holes", holes);
+        std::vector<char> data = co_await async.readFile("/holes");
+        assert(data == holes);
+    }());
+
+    // Many concurrent reads on one thread: the writes published the inodes, so none takes a lock
+    int failures = 0;
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < files; ++i) {
+            loop.spawn(readAndCheck(async, "/file" + std::to_string(i), contents(3 * blockSize + i * 100, i), failures));
+        }
+    }
+    loop.run();
+    assert(failures == 0);
+    AsyncReadStats stats = async.getReadStats();
+    assert(stats.lockFreeReads == 50 * files + 1 && stats.offloadedReads == 0);
+    assert(stats.waitedForSlot > 0); // More reads than slots were in flight
+
+    // Errors come back through co_await; a deleted file is not read from its old inode
+    loop.run([&]() -> Task<void> {
+        co_await async.deleteFile("/file0");
+        try {
+            co_await async.readFile("/file0");
+            assert(false);
+        } catch (const std::runtime_error&) {}
+        try {
+            co_await async.open("/missing");
+            assert(false);
+        } catch (const std::runtime_error&) {}
+    }());
+
+    // Files without a published inode are read under the locks, on a worker thread
+    fs.sync();
+    fs.mount();
+    loop.run(readAndCheck(async, "/file1", contents(3 * blockSize + 100, 1), failures));
+    assert(failures == 0 && async.getReadStats().offloadedReads == 2);
+    loop.run([&]() -> Task<void> {
+        co_await async.open("/file2");
+        std::vector<char> data = co_await async.readFile("/file2");
+        assert(data == contents(3 * blockSize + 200, 2));
+    }());
+    assert(async.getReadStats().offloadedReads == 2);
+    assert(fs.checkConsistency(false).isConsistent());
+}
+
+int main() {
+    {
+        EventLoop loop;
+        std::cout << "Event loop with " << (loop.usesIoRing() ? "io_uring" : "worker thread") << " reads" << std::endl;
+        exercise(loop);
+        assert(loop.getReadsIssued() > 0 && loop.getWorkItems() > 0);
+    }
+    {
+        EventLoop loop(2, 0); // Reads on the worker threads
+        assert(!loop.usesIoRing());
+        exercise(loop);
+    }
+
+    std::cout << "All AsyncLLFS tests passed!" << std::endl;
+    return 0;
+}
+#endif
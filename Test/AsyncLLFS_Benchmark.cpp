@@ -0,0 +1,85 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../AsyncLLFS.h"
+#include "../EventLoop.h"
+#include "../LLFS.h"
+#include "../Task.h"
+
+// Seconds since start
+static double since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Read one file through the loop
+static Task<void> readOne(AsyncLLFS& async, std::string name, size_t& bytes) {
+    std::vector<char> data = co_await async.readFile(name);
+    bytes += data.size();
+}
+
+// Read the files with one thread per request, count at a time; returns reads/s
+static double threadRate(LLFS& fs, int inFlight, int files, int operations) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int done = 0; done < operations; done += inFlight) {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < inFlight && done + i < operations; ++i) {
+            threads.emplace_back([&, i] { fs.readFile("/file" + std::to_string((done + i) % files)); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    return operations / since(start);
+}
+
+// Read the files as coroutines on one thread, count in flight at a time; returns reads/s
+static double asyncRate(EventLoop& loop, AsyncLLFS& async, int inFlight, int files, int operations) {
+    size_t bytes = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int done = 0; done < operations; done += inFlight) {
+        for (int i = 0; i < inFlight && done + i < operations; ++i) {
+            loop.spawn(readOne(async, "/file" + std::to_string((done + i) % files), bytes));
+        }
+        loop.run();
+    }
+    return operations / since(start);
+}
+
+int main() {
+    const size_t diskSize = 32 * 1024 * 1024;
+    const size_t blockSize = 512;
+    const int files = 64;
+    const int operations = 20000;
+    const std::vector<char> data(10 * blockSize, 'r');
+
+    LLFS fs("vdisk_bench", diskSize, blockSize);
+    fs.formatFileSystem();
+    for (int i = 0; i < files; ++i) {
+        std::string name = "/file" + std::to_string(i);
+        fs.createFile(name);
+        fs.writeFile(name, data);
+    }
+    fs.sync();
+
+    EventLoop loop;
+    AsyncLLFS async(fs, loop);
+    std::cout << "Running async read benchmark (" << operations << " reads of 5 KB files, "
+              << (loop.usesIoRing() ? "io_uring" : "worker thread") << " reads)..." << std::endl;
+    for (int inFlight : {1, 16, 128, 1000}) {
+        double threads = threadRate(fs, inFlight, files, operations);
+        double coroutines = asyncRate(loop, async, inFlight, files, operations);
+        std::cout << inFlight << " in flight: " << threads / 1e3 << "k reads/s with a thread each, "
+                  << coroutines / 1e3 << "k reads/s as coroutines on one thread" << std::endl;
+    }
+    AsyncReadStats stats = async.getReadStats();
+    std::cout << "Async reads: " << stats.lockFreeReads << " lock-free, " << stats.offloadedReads
+              << " offloaded, " << stats.waitedForSlot << " waited for a slot" << std::endl;
+    return 0;
+}
+
+#endif // BENCHMARK_TEST
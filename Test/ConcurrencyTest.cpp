@@ -0,0 +1,194 @@
+#include "../FreeBlockManager.h"
+#include "../DentryCache.h"
+#include "../LLFS.h"
+#include <iostream>
+#include <atomic>
+#include <cassert>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef TEST_BUILD
+// Contents of a file for one thread and round (not all zeros, different per thread and round)
+static std::vector<char> contents(size_t size, int thread, int round) {
+    std::vector<char> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<char>('A' + (thread * 7 + round + i / 512) % 26);
+    }
+    return data;
+}
+
+// Run body(thread) on count threads and wait for them
+template <typename Body>
+static void runThreads(int count, Body body) {
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < count; ++thread) {
+        threads.emplace_back(body, thread);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Writers rewrite their own files while readers check a file nobody writes and a thread
+// creates files in a directory; every read must see a whole write
+static void exercise(LLFS& fs, size_t fileSize, bool sameContents) {
+    const int writers = 4;
+    const int rounds = 30;
+    const std::vector<char> shared = contents(fileSize, 99, 0);
+    fs.createFile("/shared");
+    fs.writeFile("/shared", shared);
+    fs.createDirectory("/new");
+    for (int thread = 0; thread < writers; ++thread) {
+        fs.createFile("/file" + std::to_string(thread));
+    }
+
+    std::atomic<int> failures{0};
+    runThreads(writers + 3, [&](int thread) {
+        try {
+            if (thread < writers) {
+                std::string name = "/file" + std::to_string(thread);
+                for (int round = 0; round < rounds; ++round) {
+                    std::vector<char> data = contents(fileSize, sameContents ? 0 : thread, round);
+                    fs.writeFile(name, data);
+                    if (fs.readFile(name) != data) ++failures;
+                }
+            } else if (thread < writers + 2) {
+                for (int round = 0; round < rounds * 2; ++round) {
+                    if (fs.readFile("/shared") != shared) ++failures;
+                }
+            } else {
+                for (int round = 0; round < rounds; ++round) {
+                    fs.createFile("/new/f" + std::to_string(round));
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Thread " << thread << ": " << e.what() << std::endl;
+            ++failures;
+        }
+    });
+    assert(failures == 0);
+    assert(fs.listDirectory("/new").size() == static_cast<size_t>(rounds));
+    for (int thread = 0; thread < writers; ++thread) {
+        std::vector<char> last = contents(fileSize, sameContents ? 0 : thread, rounds - 1);
+        assert(fs.readFile("/file" + std::to_string(thread)) == last);
+    }
+    assert(fs.checkConsistency(false).isConsistent());
+}
+
+int main() {
+    const size_t diskSize = 2 * 1024 * 1024; // 2 MB disk, 512-byte blocks
+    const size_t blockSize = 512;
+
+    // Allocator: threads never get the same block, and every block comes back
+    {
+        FreeBlockManager blocks(4096, 10);
+        std::vector<std::vector<int>> allocated(4);
+        runThreads(4, [&](int thread) {
+            for (int i = 0; i < 1000; ++i) {
+                allocated[thread].push_back(blocks.allocateBlock());
+            }
+        });
+        std::set<int> unique;
+        for (const auto& list : allocated) {
+            unique.insert(list.begin(), list.end());
+        }
+        assert(unique.size() == 4000 && *unique.begin() >= 10);
+        runThreads(4, [&](int thread) {
+            for (int block : allocated[thread]) {
+                blocks.freeBlock(block);
+            }
+        });
+        for (int i = 10; i < 4096; ++i) {
+            assert(blocks.isBlockFree(i));
+        }
+
+        // Single-threaded allocation is still first fit
+        assert(blocks.allocateBlock() == 10 && blocks.allocateBlock() == 11);
+    }
+
+    // Dentry cache: concurrent inserts and lookups across shards (room for all of them, so no
+    // thread evicts an entry another has just inserted)
+    {
+        DentryCache cache(16384);
+        runThreads(4, [&](int thread) {
+            for (uint32_t i = 0; i < 2000; ++i) {
+                std::string name = "n" + std::to_string(i);
+                cache.insert(thread, name, i);
+                uint32_t childId = 0;
+                assert(cache.lookup(thread, name, childId) == DentryCache::Result::Positive && childId == i);
+            }
+        });
+        assert(cache.getSize() <= cache.getCapacity());
+    }
+
+    // Plain files, in place
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        exercise(fs, 6 * blockSize, false);
+        fs.sync();
+    }
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.mount();
+        assert(fs.readFile("/file2") == contents(6 * blockSize, 2, 29));
+    }
+
+    // One file read, looked up and stat'ed while it is rewritten: each read sees a whole write
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        const size_t fileSize = 4 * blockSize;
+        const int rounds = 300;
+        fs.createFile("/hot");
+        fs.writeFile("/hot", contents(fileSize, 0, 0));
+        std::atomic<int> failures{0};
+        runThreads(3, [&](int thread) {
+            for (int round = 1; round < rounds; ++round) {
+                if (thread == 0) {
+                    fs.writeFile("/hot", contents(fileSize, 0, round));
+                } else if (thread == 1) {
+                    std::vector<char> data = fs.readFile("/hot");
+                    if (data.size() != fileSize || data != contents(fileSize, 0, data[0] - 'A')) ++failures;
+                } else {
+                    FileStat stat = fs.statFiles({"/hot"})[0];
+                    if (stat.fileType != 1 || stat.fileSize != fileSize) ++failures;
+                    fs.getDedupStats();
+                }
+            }
+        });
+        assert(failures == 0);
+    }
+
+    // Deduplicated writers storing the same blocks at the same time
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.setDeduplication(true);
+        exercise(fs, 6 * blockSize, true);
+        ConsistencyReport report = fs.checkConsistency(false);
+        assert(report.sharedBlocks >= 6);
+    }
+
+    // Compressed files
+    {
+        LLFS fs("vdisk", 4 * diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.setCompression(true);
+        exercise(fs, LLFS::CLUSTER_SIZE + 1000, false);
+    }
+
+    // Log-structured mode
+    {
+        LLFS fs("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        fs.formatFileSystem();
+        exercise(fs, 4 * blockSize, false);
+        fs.sync();
+    }
+
+    std::cout << "All Concurrency tests passed!" << std::endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,74 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../LLFS.h"
+
+// Seconds since start
+static double since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Run body(thread) on count threads; returns the seconds until the last one finished
+template <typename Body>
+static double timeThreads(int count, Body body) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < count; ++thread) {
+        threads.emplace_back(body, thread);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return since(start);
+}
+
+int main() {
+    const size_t diskSize = 32 * 1024 * 1024;
+    const size_t blockSize = 512;
+    const int files = 64;
+    const int operations = 40000; // Split over the threads
+    const std::vector<char> data(10 * blockSize, 'r');
+
+    LLFS fs("vdisk_bench", diskSize, blockSize);
+    fs.formatFileSystem();
+    for (int i = 0; i < files; ++i) {
+        std::string name = "/file" + std::to_string(i);
+        fs.createFile(name);
+        fs.writeFile(name, data);
+    }
+    fs.sync();
+
+    std::cout << "Running read scaling benchmark (" << operations << " reads of 5 KB files, "
+              << std::thread::hardware_concurrency() << " cores)..." << std::endl;
+    double single = 0;
+    for (int threadCount : {1, 2, 4, 8}) {
+        double seconds = timeThreads(threadCount, [&](int thread) {
+            for (int i = 0; i < operations / threadCount; ++i) {
+                fs.readFile("/file" + std::to_string((thread + i * threadCount) % files));
+            }
+        });
+        single = threadCount == 1 ? seconds : single;
+        std::cout << threadCount << " threads: " << operations / seconds / 1e3 << "k reads/s (speedup "
+                  << single / seconds << "x)" << std::endl;
+    }
+
+    std::cout << "Running write scaling benchmark (" << operations / 4 << " writes, each thread to its own files)..."
+              << std::endl;
+    for (int threadCount : {1, 2, 4, 8}) {
+        double seconds = timeThreads(threadCount, [&](int thread) {
+            for (int i = 0; i < operations / 4 / threadCount; ++i) {
+                fs.writeFile("/file" + std::to_string((thread + i * threadCount) % files), data);
+            }
+        });
+        single = threadCount == 1 ? seconds : single;
+        std::cout << threadCount << " threads: " << operations / 4 / seconds / 1e3 << "k writes/s (speedup "
+                  << single / seconds << "x)" << std::endl;
+    }
+    return 0;
+}
+
+#endif // BENCHMARK_TEST
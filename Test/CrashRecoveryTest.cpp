@@ -3,31 +3,144 @@
 #include "../InodeManager.h"
 #include "../DirectoryManager.h"
 #include "../CrashRecovery.h"
+#include "../LLFS.h"
 #include <iostream>
 #include <cassert>
+#include <cstring>
 
 #ifdef TEST_BUILD
 int main() {
     // Initialize components
     DiskManager diskManager("vdisk", 2 * 1024 * 1024); // 2 MB disk
-    FreeBlockManager freeBlockManager(diskManager.getTotalBlocks());
-    InodeManager inodeManager(512); // Example: 512 inodes
+    Superblock layout = diskManager.computeLayout();
+    FreeBlockManager freeBlockManager(diskManager.getTotalBlocks(), layout.dataStart);
+    InodeManager inodeManager(diskManager, layout.numberOfInodes, layout.inodeTableStart); // 512 inodes
     DirectoryManager directoryManager;
 
     // Format the disk and initialize components
     diskManager.formatDisk();
+    inodeManager.scanInodeTable();
     directoryManager.createRootDirectory(0);
 
     // Simulate file system usage
     freeBlockManager.allocateBlock();
     int inodeId = inodeManager.allocateInode();
-    DirectoryEntry entry = {static_cast<uint8_t>(inodeId), "file1.txt"};
+    DirectoryEntry entry = {static_cast<uint32_t>(inodeId), "file1.txt"};
     directoryManager.addEntry("/", entry);
 
     // Simulate crash and recovery
     CrashRecovery recovery(diskManager, freeBlockManager, inodeManager, directoryManager);
     recovery.recover();
 
+    // Full consistency check: a clean file system has nothing to report
+    const size_t diskSize = 2 * 1024 * 1024;
+    uint32_t dirId, aId, bId, cId, goneId;
+    Inode dir, a, b, c, gone;
+    {
+        LLFS fs("vdisk", diskSize);
+        fs.formatFileSystem();
+        fs.createDirectory("/dir");
+        fs.createFile("/dir/a");
+        fs.writeFile("/dir/a", std::vector<char>(1500, 'a'));
+        fs.createFile("/dir/b");
+        fs.writeFile("/dir/b", std::vector<char>(100, 'b'));
+        fs.createFile("/c");
+        fs.writeFile("/c", std::vector<char>(1000, 'c'));
+        fs.createFile("/gone");
+        fs.writeFile("/gone", std::vector<char>(10, 'g'));
+
+        ConsistencyReport report = fs.checkConsistency(false, 2);
+        assert(report.isConsistent());
+        assert(report.inodesChecked == 6);
+        assert(report.directoriesChecked == 2);
+        assert(report.blocksReferenced >= 3 + 1 + 2 + 1);
+
+        const DirectoryManager& directories = fs.getDirectoryManager();
+        dirId = directories.resolvePath("/dir");
+        aId = directories.resolvePath("/dir/a");
+        bId = directories.resolvePath("/dir/b");
+        cId = directories.resolvePath("/c");
+        goneId = directories.resolvePath("/gone");
+        dir = fs.getInodeManager().getInode(dirId);
+        a = fs.getInodeManager().getInode(aId);
+        b = fs.getInodeManager().getInode(bId);
+        c = fs.getInodeManager().getInode(cId);
+        gone = fs.getInodeManager().getInode(goneId);
+        fs.sync();
+    }
+
+    // Corrupt the disk behind the file system's back
+    uint32_t orphanId;
+    {
+        DiskManager disk("vdisk", diskSize);
+        Superblock diskLayout = disk.loadSuperblock();
+        size_t inodesPerBlock = disk.getBlockSize() / sizeof(Inode);
+        orphanId = diskLayout.numberOfInodes - 1;
+        auto writeInode = [&](uint32_t inodeId, const Inode& inode) {
+            size_t blockNumber = diskLayout.inodeTableStart + inodeId / inodesPerBlock;
+            std::vector<char> block = disk.readBlock(blockNumber);
+            std::memcpy(block.data() + (inodeId % inodesPerBlock) * sizeof(Inode), &inode, sizeof(Inode));
+            disk.writeBlock(blockNumber, block);
+        };
+
+        Inode shared = c;
+        shared.directBlocks[1] = dir.directBlocks[0]; // c's own second block leaks; file blocks may be shared
+        assert(dir.directBlocks[0] != 0);
+        writeInode(cId, shared);
+        writeInode(goneId, Inode()); // Its entry dangles and its block leaks
+        Inode orphan = {};
+        orphan.fileType = 1;
+        writeInode(orphanId, orphan);
+
+        // b's block marked free
+        std::vector<char> bitmap = disk.readBlock(diskLayout.freeBlockVectorStart);
+        bitmap[b.directBlocks[0] / 8] |= static_cast<char>(1 << (b.directBlocks[0] % 8));
+        disk.writeBlock(diskLayout.freeBlockVectorStart, bitmap);
+    }
+    {
+        LLFS fs("vdisk", diskSize);
+        fs.mount();
+        ConsistencyReport report = fs.checkConsistency(false, 4);
+        assert(!report.isConsistent() && !report.repaired);
+        assert(report.doublyReferencedBlocks == std::vector<uint32_t>{dir.directBlocks[0]});
+        assert(report.leakedBlocks == 2);
+        assert(report.unmarkedBlocks == 1);
+        assert(report.orphanInodes == std::vector<uint32_t>{orphanId});
+        assert(report.danglingEntries == 1);
+        assert(report.invalidPointers == 0 && report.damagedDirectories == 0);
+
+        // Repair: everything but the shared block, which needs a person to decide
+        report = fs.checkConsistency(true, 4);
+        assert(report.repaired);
+        assert(fs.listDirectory("/lost+found").size() == 1);
+        assert(std::strcmp(fs.listDirectory("/lost+found")[0].fileName, ("#" + std::to_string(orphanId)).c_str()) == 0);
+        assert(fs.listDirectory("/").size() == 3); // dir, c, lost+found
+        assert(fs.readFile("/dir/b") == std::vector<char>(100, 'b'));
+    }
+    {
+        LLFS fs("vdisk", diskSize);
+        fs.mount();
+        ConsistencyReport report = fs.checkConsistency(false, 1);
+        assert(report.leakedBlocks == 0 && report.unmarkedBlocks == 0 && report.danglingEntries == 0);
+        assert(report.orphanInodes.empty());
+        assert(report.doublyReferencedBlocks.size() == 1);
+        assert(report.inodesChecked == 7); // Root, dir, a, b, c, the orphan and lost+found
+    }
+
+    // LFS mode keeps its bitmap consistent too
+    {
+        LLFS fs("vdisk", diskSize, 512, WriteMode::LogStructured);
+        fs.formatFileSystem();
+        fs.createDirectory("/logged");
+        for (int i = 0; i < 20; ++i) {
+            std::string name = "/logged/file" + std::to_string(i);
+            fs.createFile(name);
+            fs.writeFile(name, std::vector<char>(700, 'l'));
+        }
+        fs.deleteFile("/logged/file3");
+        assert(fs.checkConsistency(false).isConsistent());
+    }
+
     std::cout << "Crash recovery test passed successfully." << std::endl;
     return 0;
 }
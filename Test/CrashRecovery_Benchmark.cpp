@@ -0,0 +1,45 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../LLFS.h"
+
+int main() {
+    const size_t diskSize = 32 * 1024 * 1024; // 64k blocks, the most 16-bit block pointers reach
+    const size_t directories = 64;
+    const size_t filesPerDirectory = 100;
+
+    std::cout << "Building the image..." << std::endl;
+    {
+        LLFS fs("vdisk_bench", diskSize);
+        fs.formatFileSystem();
+        std::vector<char> data(2048, 'f');
+        for (size_t d = 0; d < directories; ++d) {
+            std::string directory = "/dir" + std::to_string(d);
+            fs.createDirectory(directory);
+            for (size_t f = 0; f < filesPerDirectory; ++f) {
+                std::string name = directory + "/file" + std::to_string(f);
+                fs.createFile(name);
+                fs.writeFile(name, data);
+            }
+        }
+        fs.sync();
+    }
+
+    LLFS fs("vdisk_bench", diskSize);
+    fs.mount();
+    std::cout << "Running consistency check benchmark (" << std::thread::hardware_concurrency()
+              << " cores)..." << std::endl;
+    for (size_t threads : {1, 2, 4, 8}) {
+        ConsistencyReport report = fs.checkConsistency(false, threads);
+        assert(report.isConsistent());
+        std::cout << threads << " thread(s): " << report.inodesChecked << " inodes, " << report.blocksReferenced
+                  << " blocks checked in " << report.seconds << " seconds." << std::endl;
+    }
+    return 0;
+}
+
+#endif // BENCHMARK_TEST
@@ -0,0 +1,170 @@
+#include "../Crc32c.h"
+#include "../DiskManager.h"
+#include "../LLFS.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifdef TEST_BUILD
+// Wait until the scrubber has finished a pass (false on timeout)
+static bool waitForPass(LLFS& fs, uint64_t passes) {
+    for (int i = 0; i < 500; ++i) {
+        if (fs.getScrubStats().passesCompleted > passes) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+int main() {
+    const size_t diskSize = 2 * 1024 * 1024; // 2 MB disk, 512-byte blocks
+    const size_t blockSize = 512;
+
+    // Known values (RFC 3720, appendix B.4)
+    {
+        assert(Crc32c::compute(0, "123456789", 9) == 0xE3069283u);
+        assert(Crc32c::compute(0, "", 0) == 0);
+        std::vector<uint8_t> bytes(32, 0);
+        assert(Crc32c::computeSoftware(0, bytes.data(), bytes.size()) == 0x8A9136AAu);
+        assert(Crc32c::computeHardware(0, bytes.data(), bytes.size()) == 0x8A9136AAu);
+        std::fill(bytes.begin(), bytes.end(), 0xFF);
+        assert(Crc32c::compute(0, bytes.data(), bytes.size()) == 0x62A8AB43u);
+        for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i);
+        assert(Crc32c::compute(0, bytes.data(), bytes.size()) == 0x46DD794Eu);
+    }
+
+    // Both kernels agree at every length and alignment, and a CRC can be continued
+    {
+        std::vector<uint8_t> buffer(20000);
+        for (size_t i = 0; i < buffer.size(); ++i) buffer[i] = static_cast<uint8_t>(i * 131 + 7);
+        for (size_t length = 0; length < 8000; length += length < 64 ? 1 : 61) {
+            for (size_t offset = 0; offset < 8; ++offset) {
+                uint32_t software = Crc32c::computeSoftware(~0u, buffer.data() + offset, length);
+                assert(Crc32c::computeHardware(~0u, buffer.data() + offset, length) == software);
+                assert(Crc32c::compute(~0u, buffer.data() + offset, length) == software);
+            }
+            size_t half = length / 3;
+            uint32_t crc = Crc32c::compute(0, buffer.data(), half);
+            assert(Crc32c::compute(crc, buffer.data() + half, length - half) ==
+                   Crc32c::compute(0, buffer.data(), length));
+        }
+        std::cout << "CRC32C in hardware: " << (Crc32c::hasHardwareSupport() ? "yes" : "no") << std::endl;
+    }
+
+    // A block changed behind the disk manager's back fails its checksum
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::InPlace, true);
+        diskManager.formatDisk();
+        Superblock layout = diskManager.loadSuperblock();
+        assert(layout.checksumStart == layout.journalStart + layout.journalBlocks);
+        assert(layout.checksumBlocks * blockSize >= layout.totalBlocks * sizeof(uint32_t));
+        assert(layout.dataStart == layout.checksumStart + layout.checksumBlocks);
+
+        const size_t target = layout.dataStart + 5;
+        diskManager.writeBlocks(target + 1, std::vector<char>(blockSize, 'u')); // Never checksummed
+        diskManager.writeBlock(target, std::vector<char>(blockSize, 'a'));
+        assert(diskManager.readBlock(target) == std::vector<char>(blockSize, 'a'));
+        assert(diskManager.verifyBlock(target));
+        assert(diskManager.readBlock(target + 1) == std::vector<char>(blockSize, 'u'));
+
+        std::vector<char> damaged(blockSize, 'a');
+        damaged[100] = 'b';
+        diskManager.writeBlocks(target, damaged);
+        assert(!diskManager.verifyBlock(target));
+        bool threw = false;
+        try {
+            diskManager.readBlock(target);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+        assert(diskManager.getChecksumErrors() == 2);
+
+        // Rewriting the block records its new checksum
+        diskManager.writeBlock(target, damaged);
+        assert(diskManager.readBlock(target) == damaged);
+        assert(diskManager.getChecksumErrors() == 2);
+
+        // The superblock is not covered (the scrubber rewrites it)
+        assert(diskManager.verifyBlock(0));
+    }
+
+    // Checksums only work in in-place mode and must match the format
+    {
+        bool threw = false;
+        try {
+            DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured, true);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        threw = false;
+        try {
+            diskManager.loadSuperblock();
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    // The table commits with the journal: a remount without a checkpoint reads everything back
+    uint16_t dataBlock;
+    {
+        LLFS fs("vdisk", diskSize, blockSize, WriteMode::InPlace, true);
+        fs.formatFileSystem();
+        fs.createDirectory("/docs");
+        for (int i = 0; i < 20; ++i) {
+            std::string name = "/docs/file" + std::to_string(i);
+            fs.createFile(name);
+            fs.writeFile(name, std::vector<char>(1500, static_cast<char>('a' + i)));
+        }
+        fs.commit();
+        dataBlock = fs.getInodeManager().getInode(fs.getDirectoryManager().resolvePath("/docs/file3")).directBlocks[1];
+    }
+    {
+        LLFS fs("vdisk", diskSize, blockSize, WriteMode::InPlace, true);
+        fs.mount();
+        for (int i = 0; i < 20; ++i) {
+            assert(fs.readFile("/docs/file" + std::to_string(i)) ==
+                   std::vector<char>(1500, static_cast<char>('a' + i)));
+        }
+        assert(fs.getDiskManager().getChecksumErrors() == 0);
+        fs.sync();
+    }
+
+    // Damage on disk is caught on read and by the scrubber
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::InPlace, true);
+        std::vector<char> block = diskManager.readBlocks(dataBlock, 1);
+        block[7] ^= 0x10;
+        diskManager.writeBlocks(dataBlock, block);
+    }
+    {
+        LLFS fs("vdisk", diskSize, blockSize, WriteMode::InPlace, true);
+        fs.mount();
+        bool threw = false;
+        try {
+            fs.readFile("/docs/file3");
+        } catch (const std::runtime_error& e) {
+            threw = std::strstr(e.what(), "Checksum mismatch") != nullptr;
+        }
+        assert(threw);
+        assert(fs.readFile("/docs/file4") == std::vector<char>(1500, 'e'));
+
+        uint64_t passes = fs.getScrubStats().passesCompleted;
+        fs.startScrubber(100000);
+        assert(waitForPass(fs, passes));
+        fs.stopScrubber();
+        assert(fs.getScrubStats().checksumErrors >= 1); // Once per pass
+        assert(fs.getScrubStats().readErrors == 0);
+    }
+
+    std::cout << "All Crc32c tests passed!" << std::endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,65 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../Crc32c.h"
+#include "../LLFS.h"
+
+// Checksum throughput in GB/s over buffers of one size
+static double benchmarkKernel(uint32_t (*kernel)(uint32_t, const void*, size_t), size_t bufferSize) {
+    std::vector<char> buffer(bufferSize);
+    for (size_t i = 0; i < buffer.size(); ++i) buffer[i] = static_cast<char>(i * 31);
+    const size_t totalBytes = size_t(1) << 30;
+    volatile uint32_t sink = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    uint32_t crc = 0;
+    for (size_t done = 0; done < totalBytes; done += bufferSize) {
+        crc = kernel(crc, buffer.data(), buffer.size());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    sink = crc;
+    (void)sink;
+    return totalBytes / std::chrono::duration<double>(end - start).count() / 1e9;
+}
+
+// Seconds to write and read back files, with or without block checksums
+static double benchmarkFileSystem(bool blockChecksums) {
+    const size_t diskSize = 32 * 1024 * 1024;
+    LLFS fs("vdisk_bench", diskSize, 512, WriteMode::InPlace, blockChecksums);
+    fs.formatFileSystem();
+    std::vector<char> data(4096, 'c');
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        std::string name = "/file" + std::to_string(i);
+        fs.createFile(name);
+        fs.writeFile(name, data);
+    }
+    fs.sync();
+    for (int i = 0; i < 1000; ++i) {
+        fs.readFile("/file" + std::to_string(i));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main() {
+    std::cout << "Running CRC32C benchmark (hardware support: "
+              << (Crc32c::hasHardwareSupport() ? "yes" : "no") << ")..." << std::endl;
+    for (size_t bufferSize : {512, 4096, 1 << 20}) {
+        std::cout << bufferSize << "-byte buffers: software " << benchmarkKernel(Crc32c::computeSoftware, bufferSize)
+                  << " GB/s, hardware " << benchmarkKernel(Crc32c::computeHardware, bufferSize) << " GB/s"
+                  << std::endl;
+    }
+
+    double plain = benchmarkFileSystem(false);
+    double checked = benchmarkFileSystem(true);
+    std::cout << "1000 files of 4 KB written and read: " << plain << " seconds without block checksums, "
+              << checked << " seconds with them." << std::endl;
+    return 0;
+}
+
+#endif // BENCHMARK_TEST
@@ -0,0 +1,204 @@
+#include "../Sha256.h"
+#include "../DedupIndex.h"
+#include "../FreeBlockManager.h"
+#include "../LLFS.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <string>
+
+#ifdef TEST_BUILD
+// Hex digest of a string
+static std::string hexDigest(const std::string& text) {
+    Sha256::Digest digest = Sha256::hash(text.data(), text.size());
+    static const char* digits = "0123456789abcdef";
+    std::string hex;
+    for (uint8_t byte : digest) {
+        hex += digits[byte >> 4];
+        hex += digits[byte & 0x0F];
+    }
+    return hex;
+}
+
+// A block of the given byte
+static std::vector<char> filled(size_t size, char c) {
+    return std::vector<char>(size, c);
+}
+
+int main() {
+    const size_t diskSize = 2 * 1024 * 1024; // 2 MB disk, 512-byte blocks
+    const size_t blockSize = 512;
+
+    // SHA-256: the FIPS 180-4 examples, including the two-chunk padding case
+    {
+        assert(hexDigest("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        assert(hexDigest("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        assert(hexDigest("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+               "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+        assert(hexDigest(std::string(1000000, 'a')) ==
+               "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+    }
+
+    // Index: colliding home slots, removal from the middle of a probe run, and bounded memory
+    {
+        DedupIndex index(100);
+        size_t capacity = index.getCapacity();
+        assert(capacity >= 150 && (capacity & (capacity - 1)) == 0);
+        assert(index.getMemoryUsage() == capacity * 24 + 100 * sizeof(uint32_t));
+
+        DedupIndex::Fingerprint first{1, 5}, second{2, 5}, third{3, 5 + capacity}, other{4, 6};
+        index.insert(first, 10);
+        index.insert(second, 11);
+        index.insert(third, 12); // Same home slot as the two before
+        index.insert(other, 13); // Displaced by the run
+        assert(index.find(first) == 10 && index.find(second) == 11 && index.find(third) == 12);
+        assert(index.find(other) == 13);
+        assert(index.find(DedupIndex::Fingerprint{9, 5}) == 0);
+        assert(index.getSize() == 4);
+
+        index.remove(11);
+        assert(index.find(second) == 0);
+        assert(index.find(third) == 12 && index.find(other) == 13); // Shifted back, still found
+        index.remove(11);                                            // Not indexed: no-op
+        assert(index.getSize() == 3);
+
+        index.insert(second, 10); // Block 10 moves to a new fingerprint
+        assert(index.find(first) == 0 && index.find(second) == 10);
+        assert(index.getSize() == 3);
+
+        // Every block indexed at once still fits
+        DedupIndex full(100);
+        for (uint32_t block = 1; block < 100; ++block) {
+            std::vector<char> data = filled(blockSize, static_cast<char>(block));
+            full.insert(DedupIndex::fingerprint(data.data(), data.size()), block);
+        }
+        assert(full.getSize() == 99);
+        for (uint32_t block = 1; block < 100; block += 2) {
+            full.remove(block);
+        }
+        for (uint32_t block = 2; block < 100; block += 2) {
+            std::vector<char> data = filled(blockSize, static_cast<char>(block));
+            assert(full.find(DedupIndex::fingerprint(data.data(), data.size())) == block);
+        }
+        full.clear();
+        assert(full.getSize() == 0);
+    }
+
+    // Reference counts: a shared block is only freed with its last reference
+    {
+        FreeBlockManager blocks(64, 8);
+        int block = blocks.allocateBlock();
+        assert(blocks.getReferenceCount(block) == 1);
+        blocks.addReference(block);
+        blocks.addReference(block);
+        assert(blocks.getReferenceCount(block) == 3 && blocks.getSharedReferences() == 2);
+        size_t freed = 0;
+        blocks.setFreeHook([&](size_t) { ++freed; });
+        assert(!blocks.freeBlock(block) && !blocks.freeBlock(block));
+        assert(!blocks.isBlockFree(block) && freed == 0);
+        assert(blocks.freeBlock(block));
+        assert(blocks.isBlockFree(block) && freed == 1 && blocks.getReferenceCount(block) == 0);
+
+        bool threw = false;
+        try {
+            blocks.addReference(block); // Free blocks cannot be shared
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    // Identical blocks are stored once; deletes and rewrites drop references
+    std::vector<char> report(4 * blockSize);
+    for (size_t i = 0; i < report.size(); ++i) {
+        report[i] = static_cast<char>('a' + i / blockSize); // Four different blocks
+    }
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.setDeduplication(true);
+        fs.createFile("/a");
+        fs.writeFile("/a", report);
+        fs.createFile("/b");
+        fs.writeFile("/b", report);
+        fs.createFile("/repeated");
+        fs.writeFile("/repeated", filled(3 * blockSize, 'z')); // One block, three times
+
+        DedupStats stats = fs.getDedupStats();
+        assert(stats.blocksWritten == 11 && stats.blocksDeduplicated == 6);
+        assert(stats.logicalBlocks == 11 && stats.physicalBlocks == 5);
+        assert(stats.ratio() > 2.1);
+        assert(stats.indexEntries == 5);
+        assert(fs.readFile("/a") == report && fs.readFile("/b") == report);
+
+        const InodeManager& inodes = fs.getInodeManager();
+        Inode a = inodes.getInode(fs.getDirectoryManager().resolvePath("/a"));
+        Inode b = inodes.getInode(fs.getDirectoryManager().resolvePath("/b"));
+        assert(std::memcmp(a.directBlocks, b.directBlocks, sizeof(a.directBlocks)) == 0);
+
+        ConsistencyReport check = fs.checkConsistency(false);
+        assert(check.isConsistent());
+        assert(check.sharedBlocks == 5);
+
+        fs.deleteFile("/a");
+        assert(fs.readFile("/b") == report);
+        assert(fs.getDedupStats().physicalBlocks == 5);
+
+        // A rewrite shares what it can and releases the rest
+        std::vector<char> changed = report;
+        changed[0] = 'x';
+        fs.writeFile("/b", changed);
+        assert(fs.readFile("/b") == changed);
+        assert(fs.getDedupStats().physicalBlocks == 5); // x... replaces a...
+        assert(fs.checkConsistency(false).isConsistent());
+        fs.sync();
+    }
+
+    // Reference counts are rebuilt at mount; deleting every copy frees the block
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.mount();
+        fs.setDeduplication(true);
+        assert(fs.getDedupStats().indexEntries == 5);
+        fs.createFile("/c");
+        fs.writeFile("/c", filled(blockSize, 'z')); // Shares the repeated block
+        assert(fs.getDedupStats().blocksDeduplicated == 1);
+
+        fs.deleteFile("/repeated");
+        fs.deleteFile("/c");
+        ConsistencyReport check = fs.checkConsistency(false);
+        assert(check.isConsistent() && check.sharedBlocks == 0);
+        assert(fs.getDedupStats().logicalBlocks == 4);
+
+        // The freed block left the index: it is stored afresh
+        fs.createFile("/d");
+        fs.writeFile("/d", filled(blockSize, 'z'));
+        assert(fs.getDedupStats().indexEntries == 5);
+    }
+
+    // LFS mode shares logical blocks the same way
+    {
+        LLFS fs("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        fs.formatFileSystem();
+        fs.setDeduplication(true);
+        for (int i = 0; i < 4; ++i) {
+            std::string name = "/copy" + std::to_string(i);
+            fs.createFile(name);
+            fs.writeFile(name, report);
+        }
+        assert(fs.getDedupStats().physicalBlocks == 4);
+        fs.sync();
+    }
+    {
+        LLFS fs("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        fs.mount();
+        fs.deleteFile("/copy0");
+        assert(fs.readFile("/copy3") == report);
+        ConsistencyReport check = fs.checkConsistency(false);
+        assert(check.isConsistent() && check.sharedBlocks == 4);
+    }
+
+    std::cout << "All Dedup tests passed!" << std::endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,89 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "../DedupIndex.h"
+#include "../LLFS.h"
+
+// Seconds since start
+static double since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Write generations of backup-like files: each generation copies the last one and changes one
+// block in every tenth file
+static double writeGenerations(LLFS& fs, int generations, int filesPerGeneration, size_t fileSize) {
+    std::mt19937 random(42);
+    std::vector<std::vector<char>> files(filesPerGeneration, std::vector<char>(fileSize));
+    for (auto& file : files) {
+        for (char& c : file) c = static_cast<char>(random());
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int generation = 0; generation < generations; ++generation) {
+        std::string directory = "/gen" + std::to_string(generation);
+        fs.createDirectory(directory);
+        for (int i = 0; i < filesPerGeneration; ++i) {
+            if (generation > 0 && i % 10 == generation % 10) {
+                files[i][random() % fileSize] ^= 1;
+            }
+            std::string name = directory + "/file" + std::to_string(i);
+            fs.createFile(name);
+            fs.writeFile(name, files[i]);
+        }
+    }
+    fs.sync();
+    return since(start);
+}
+
+int main() {
+    const size_t diskSize = 32 * 1024 * 1024;
+    const size_t blockSize = 512;
+    const int generations = 6;
+    const int filesPerGeneration = 200;
+    const size_t fileSize = 10 * blockSize;
+
+    std::cout << "Running fingerprint benchmark (SHA-256 of 512-byte blocks)..." << std::endl;
+    std::vector<char> block(blockSize, 'x');
+    const int rounds = 100000;
+    uint64_t sink = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        block[0] = static_cast<char>(i);
+        sink ^= DedupIndex::fingerprint(block.data(), block.size()).low;
+    }
+    double seconds = since(start);
+    std::cout << "Fingerprinted " << rounds / seconds / 1e3 << "k blocks/s (" << rounds * blockSize / seconds / 1e6
+              << " MB/s)" << (sink == 0 ? " " : "") << std::endl;
+
+    std::cout << "Running backup benchmark (" << generations << " generations of " << filesPerGeneration
+              << " files of " << fileSize << " bytes)..." << std::endl;
+    double plainSeconds;
+    {
+        LLFS fs("vdisk_bench", diskSize, blockSize);
+        fs.formatFileSystem();
+        plainSeconds = writeGenerations(fs, generations, filesPerGeneration, fileSize);
+        DedupStats stats = fs.getDedupStats();
+        std::cout << "Without dedup: " << plainSeconds << " seconds, " << stats.physicalBlocks << " blocks stored"
+                  << std::endl;
+    }
+    {
+        LLFS fs("vdisk_bench", diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.setDeduplication(true);
+        double dedupSeconds = writeGenerations(fs, generations, filesPerGeneration, fileSize);
+        DedupStats stats = fs.getDedupStats();
+        std::cout << "With dedup: " << dedupSeconds << " seconds, " << stats.logicalBlocks << " blocks in "
+                  << stats.physicalBlocks << " (ratio " << stats.ratio() << "x, " << stats.blocksDeduplicated
+                  << " duplicate writes)" << std::endl;
+        std::cout << "Index: " << stats.indexEntries << " entries, " << stats.indexMemoryBytes / 1024 << " KB ("
+                  << double(stats.indexMemoryBytes) / fs.getDiskManager().getTotalBlocks() << " bytes per block)"
+                  << std::endl;
+    }
+    return 0;
+}
+
+#endif // BENCHMARK_TEST
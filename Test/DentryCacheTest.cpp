@@ -0,0 +1,46 @@
+#include "../DentryCache.h"
+#include <iostream>
+#include <cassert>
+
+#ifdef TEST_BUILD
+int main() {
+    DentryCache cache(2);
+    uint32_t childId = 0;
+
+    // Unknown names miss
+    assert(cache.lookup(0, "a", childId) == DentryCache::Result::Miss);
+
+    // Positive and negative entries
+    cache.insert(0, "a", 5);
+    cache.insertNegative(0, "b");
+    assert(cache.lookup(0, "a", childId) == DentryCache::Result::Positive);
+    assert(childId == 5);
+    assert(cache.lookup(0, "b", childId) == DentryCache::Result::Negative);
+
+    // Same name in another directory is a different entry
+    assert(cache.lookup(1, "a", childId) == DentryCache::Result::Miss);
+
+    // The least recently used entry is evicted ("a" was used before "b")
+    cache.insert(1, "c", 7);
+    assert(cache.getSize() == 2);
+    assert(cache.lookup(0, "a", childId) == DentryCache::Result::Miss);
+    assert(cache.lookup(0, "b", childId) == DentryCache::Result::Negative);
+
+    // Creating a name replaces its negative entry
+    cache.insert(0, "b", 9);
+    assert(cache.lookup(0, "b", childId) == DentryCache::Result::Positive);
+    assert(childId == 9);
+
+    // Invalidation
+    cache.invalidate(0, "b");
+    assert(cache.lookup(0, "b", childId) == DentryCache::Result::Miss);
+    cache.clear();
+    assert(cache.getSize() == 0);
+
+    assert(cache.getHits() == 2);
+    assert(cache.getNegativeHits() == 2);
+
+    std::cout << "All DentryCache tests passed!" << std::endl;
+    return 0;
+}
+#endif
@@ -1,6 +1,8 @@
 #include "../DirectoryManager.h"
 #include <iostream>
 #include <cassert>
+#include <cstring>
+#include <string>
 
 #ifdef TEST_BUILD
 int main() {
@@ -43,6 +45,120 @@ int main() {
         // Expected
     }
 
+    // Test the hash index with many entries, removals and slot reuse
+    for (int i = 0; i < 1000; ++i) {
+        DirectoryEntry entry = {static_cast<uint32_t>(i), ""};
+        std::strncpy(entry.fileName, ("bulk" + std::to_string(i)).c_str(), sizeof(entry.fileName) - 1);
+        dm.addEntry("/", entry);
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        dm.removeEntry("/", "bulk" + std::to_string(i));
+    }
+    assert(dm.getEntryCount("/") == 501); // 500 bulk entries plus file2.txt
+    for (int i = 1; i < 1000; i += 2) {
+        assert(dm.getEntry("/", "bulk" + std::to_string(i)).inodeId == static_cast<uint32_t>(i));
+    }
+    dm.addEntry("/", file1); // Reuses a freed slot
+    assert(dm.getEntry("/", "file1.txt").inodeId == 1);
+    try {
+        dm.getEntry("/", "bulk0");
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+
+    // Test streaming the directory in batches; cookies survive removals behind the cursor
+    std::vector<DirectoryEntry> batch;
+    size_t streamed = 0;
+    for (uint64_t cookie = 0; cookie != READDIR_END;) {
+        batch.clear();
+        cookie = dm.readDirectory("/", cookie, 64, batch);
+        assert(batch.size() <= 64);
+        streamed += batch.size();
+        if (streamed == 64) {
+            dm.removeEntry("/", batch.front().fileName);
+            dm.addEntry("/", batch.front());
+        }
+    }
+    assert(streamed == dm.getEntryCount("/"));
+
+    // Test nested directories and path resolution
+    dm.createDirectory("/docs", 2000);
+    dm.createDirectory("/docs/reports", 2001);
+    DirectoryEntry report = {2002, "q1.txt"};
+    dm.addEntry("/docs/reports", report);
+    assert(dm.resolvePath("/docs/reports/q1.txt") == 2002);
+    assert(dm.resolvePath("docs/./reports/../reports/q1.txt") == 2002);
+    assert(dm.resolvePath("/..") == 0);
+    assert(dm.resolveDirectory("/docs/reports") == 2001);
+    try {
+        dm.resolvePath("/docs/reports/q1.txt/more"); // Walks through a file
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+
+    // Repeated failed lookups are answered by negative dentries
+    size_t negativeHits = dm.getDentryCache().getNegativeHits();
+    for (int i = 0; i < 2; ++i) {
+        try {
+            dm.resolvePath("/docs/missing");
+            assert(false); // Should not reach here
+        } catch (const std::runtime_error&) {
+            // Expected
+        }
+    }
+    assert(dm.getDentryCache().getNegativeHits() == negativeHits + 1);
+
+    // A negative dentry is replaced when the name is created
+    DirectoryEntry created = {2003, "missing"};
+    dm.addEntry("/docs", created);
+    assert(dm.resolvePath("/docs/missing") == 2003);
+
+    // Only empty directories can be removed
+    try {
+        dm.removeDirectory("/docs/reports");
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+    dm.removeEntry("/docs/reports", "q1.txt");
+    assert(dm.removeDirectory("/docs/reports") == 2001);
+    try {
+        dm.resolvePath("/docs/reports");
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+
+    // Batches are grouped by directory and checked before anything changes
+    std::vector<std::string> paths;
+    std::vector<uint32_t> inodeIds;
+    for (int i = 0; i < 100; ++i) {
+        paths.push_back((i % 2 ? "/docs/batch" : "/batch") + std::to_string(i));
+        inodeIds.push_back(3000 + i);
+    }
+    dm.addEntries(paths, inodeIds);
+    assert(dm.resolvePath("/docs/batch51") == 3051);
+    std::vector<uint32_t> found = dm.lookupEntries({"/batch50", "/docs/batch51", "/docs/nothing", "/"});
+    assert(found[0] == 3050 && found[1] == 3051 && found[2] == DirectoryManager::NO_ENTRY && found[3] == 0);
+    try {
+        dm.addEntries({"/fresh", "/batch0"}, {4000, 4001}); // batch0 exists
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+    assert(dm.lookupEntries({"/fresh"})[0] == DirectoryManager::NO_ENTRY);
+    try {
+        dm.removeEntries({"/batch0", "/docs/nothing"});
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+    assert(dm.resolvePath("/batch0") == 3000);
+    dm.removeEntries(paths);
+    assert(dm.getEntryCount("/docs") == 1); // Only "missing"
+
     std::cout << "All DirectoryManager tests passed!" << std::endl;
     return 0;
 }
@@ -0,0 +1,210 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cassert>
+#include <cstring>
+#include "../DiskManager.h"
+#include "../FreeBlockManager.h"
+#include "../InodeManager.h"
+#include "../DirectoryManager.h"
+#include "../Logger.h"
+
+std::vector<DirectoryEntry> makeEntries(size_t count) {
+    std::vector<DirectoryEntry> entries(count);
+    for (size_t i = 0; i < count; ++i) {
+        entries[i].inodeId = static_cast<uint32_t>(i);
+        std::string name = "file" + std::to_string(i) + ".log";
+        std::strncpy(entries[i].fileName, name.c_str(), sizeof(entries[i].fileName) - 1);
+    }
+    return entries;
+}
+
+void benchmarkCreate(DirectoryManager &directoryManager, const std::vector<DirectoryEntry> &entries) {
+    using namespace std::chrono;
+
+    // addEntry logs every insert; mute stdout so the timing measures the directory index
+    auto start = high_resolution_clock::now();
+
+    for (const auto &entry : entries) {
+        directoryManager.addEntry("/", entry);
+    }
+
+    auto end = high_resolution_clock::now();
+    duration<double> elapsed = end - start;
+
+    std::cout << "Create benchmark for " << entries.size() << " entries completed in "
+              << elapsed.count() << " seconds." << std::endl;
+}
+
+void benchmarkLookup(DirectoryManager &directoryManager, const std::vector<DirectoryEntry> &entries) {
+    using namespace std::chrono;
+
+    std::vector<std::string> names;
+    names.reserve(entries.size());
+    for (const auto &entry : entries) {
+        names.emplace_back(entry.fileName);
+    }
+
+    auto start = high_resolution_clock::now();
+
+    size_t found = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (directoryManager.getEntry("/", names[i]).inodeId == entries[i].inodeId) {
+            ++found;
+        }
+    }
+
+    auto end = high_resolution_clock::now();
+    duration<double> elapsed = end - start;
+
+    assert(found == entries.size());
+    std::cout << "Lookup benchmark for " << names.size() << " entries completed in "
+              << elapsed.count() << " seconds." << std::endl;
+}
+
+void benchmarkRemove(DirectoryManager &directoryManager, const std::vector<DirectoryEntry> &entries) {
+    using namespace std::chrono;
+
+    std::vector<std::string> names;
+    for (size_t i = 0; i < entries.size(); i += 2) {
+        names.emplace_back(entries[i].fileName);
+    }
+
+    auto start = high_resolution_clock::now();
+
+    for (const auto &name : names) {
+        directoryManager.removeEntry("/", name);
+    }
+
+    auto end = high_resolution_clock::now();
+    duration<double> elapsed = end - start;
+
+    std::cout << "Remove benchmark for " << names.size() << " entries completed in "
+              << elapsed.count() << " seconds." << std::endl;
+}
+
+void benchmarkOnDisk(size_t entryCount) {
+    using namespace std::chrono;
+
+    // 16 MB disk, the largest that 16-bit block pointers still cover with room to spare
+    DiskManager diskManager("vdisk_bench", 16 * 1024 * 1024, 512);
+    diskManager.formatDisk();
+    Superblock layout = diskManager.loadSuperblock();
+    FreeBlockManager freeBlockManager(layout.totalBlocks, layout.dataStart);
+    InodeManager inodeManager(diskManager, layout.numberOfInodes, layout.inodeTableStart);
+    inodeManager.scanInodeTable();
+    DirectoryManager directoryManager(diskManager, freeBlockManager, inodeManager);
+    directoryManager.createRootDirectory(0);
+
+    std::vector<DirectoryEntry> entries = makeEntries(entryCount);
+
+    auto start = high_resolution_clock::now();
+    for (const auto &entry : entries) {
+        directoryManager.addEntry("/", entry);
+    }
+    auto end = high_resolution_clock::now();
+    duration<double> elapsed = end - start;
+    std::cout << "On-disk create benchmark for " << entries.size() << " entries completed in "
+              << elapsed.count() << " seconds." << std::endl;
+
+    size_t readsBefore = directoryManager.getStore()->getBlocksRead();
+    start = high_resolution_clock::now();
+    for (const auto &entry : entries) {
+        directoryManager.getEntry("/", entry.fileName);
+    }
+    end = high_resolution_clock::now();
+    elapsed = end - start;
+    double readsPerLookup = double(directoryManager.getStore()->getBlocksRead() - readsBefore) / entries.size();
+    std::cout << "On-disk lookup benchmark for " << entries.size() << " entries completed in "
+              << elapsed.count() << " seconds (" << readsPerLookup << " directory blocks per lookup)." << std::endl;
+
+    // Stream the whole directory with one reusable batch buffer
+    std::vector<DirectoryEntry> batch;
+    batch.reserve(256);
+    size_t listed = 0;
+    start = high_resolution_clock::now();
+    for (uint64_t cookie = 0; cookie != READDIR_END;) {
+        batch.clear();
+        cookie = directoryManager.readDirectory("/", cookie, 256, batch);
+        listed += batch.size();
+    }
+    end = high_resolution_clock::now();
+    elapsed = end - start;
+    assert(listed == entries.size());
+    std::cout << "On-disk readdir of " << listed << " entries in batches of 256 completed in "
+              << elapsed.count() << " seconds (buffer capacity " << batch.capacity() << " entries)." << std::endl;
+}
+
+void benchmarkDeepPath(size_t depth, size_t iterations) {
+    using namespace std::chrono;
+
+    DiskManager diskManager("vdisk_bench", 16 * 1024 * 1024, 512);
+    diskManager.formatDisk();
+    Superblock layout = diskManager.loadSuperblock();
+    FreeBlockManager freeBlockManager(layout.totalBlocks, layout.dataStart);
+    InodeManager inodeManager(diskManager, layout.numberOfInodes, layout.inodeTableStart);
+    inodeManager.scanInodeTable();
+    DirectoryManager directoryManager(diskManager, freeBlockManager, inodeManager);
+    directoryManager.createRootDirectory(0);
+
+    // Build /dir0/dir1/.../dir<depth-1>
+    std::string path;
+    for (size_t i = 0; i < depth; ++i) {
+        path += "/dir" + std::to_string(i);
+        int inodeId = inodeManager.allocateInode();
+        Inode inode = {};
+        inode.fileType = 2;
+        inodeManager.updateInode(inodeId, inode);
+        directoryManager.createDirectory(path, inodeId);
+    }
+
+    directoryManager.resolvePath(path); // Warm up
+    size_t readsBefore = directoryManager.getStore()->getBlocksRead();
+    auto start = high_resolution_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        directoryManager.resolvePath(path);
+    }
+    auto end = high_resolution_clock::now();
+    duration<double> elapsed = end - start;
+    std::cout << "Warm resolution of a " << depth << "-component path: "
+              << elapsed.count() * 1e9 / iterations << " ns per lookup, "
+              << directoryManager.getStore()->getBlocksRead() - readsBefore << " directory blocks read, "
+              << directoryManager.getDentryCache().getHits() << " dentry cache hits." << std::endl;
+}
+
+int main() {
+    const size_t entryCount = 1000000; // 1M names in a single directory
+
+    // Per-entry debug records would otherwise dominate the timings
+    Logger::setLevel(LogLevel::Warn);
+
+    DirectoryManager directoryManager;
+    directoryManager.createRootDirectory(0);
+
+    std::vector<DirectoryEntry> entries = makeEntries(entryCount);
+
+    std::cout << "Running create benchmark...\n";
+    benchmarkCreate(directoryManager, entries);
+    assert(directoryManager.getEntryCount("/") == entryCount);
+
+    std::cout << "Running lookup benchmark...\n";
+    benchmarkLookup(directoryManager, entries);
+
+    std::cout << "Running remove benchmark...\n";
+    benchmarkRemove(directoryManager, entries);
+    assert(directoryManager.getEntryCount("/") == entryCount / 2);
+
+    std::cout << "Running on-disk directory benchmark...\n";
+    benchmarkOnDisk(100000);
+
+    std::cout << "Running path resolution benchmark...\n";
+    benchmarkDeepPath(10, 100000);
+
+    return 0;
+}
+
+
+#endif // BENCHMARK_TEST
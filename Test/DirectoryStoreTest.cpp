@@ -0,0 +1,107 @@
+#include "../DiskManager.h"
+#include "../FreeBlockManager.h"
+#include "../InodeManager.h"
+#include "../DirectoryManager.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+
+#ifdef TEST_BUILD
+int main() {
+    DiskManager diskManager("vdisk", 2 * 1024 * 1024, 512); // 2 MB disk, 512-byte blocks
+    diskManager.formatDisk();
+    Superblock layout = diskManager.loadSuperblock();
+
+    FreeBlockManager freeBlockManager(layout.totalBlocks, layout.dataStart);
+    InodeManager inodeManager(diskManager, layout.numberOfInodes, layout.inodeTableStart);
+    inodeManager.scanInodeTable();
+    DirectoryManager dm(diskManager, freeBlockManager, inodeManager);
+    dm.createRootDirectory(0);
+
+    // A few entries fit in a single linear block
+    for (int i = 0; i < 5; ++i) {
+        DirectoryEntry entry = {static_cast<uint32_t>(i + 1), ""};
+        std::strncpy(entry.fileName, ("small" + std::to_string(i)).c_str(), sizeof(entry.fileName) - 1);
+        dm.addEntry("/", entry);
+    }
+    assert(!(inodeManager.getInode(0).flags & INODE_FLAG_HTREE));
+    assert(inodeManager.getInode(0).fileSize == 512);
+
+    // Enough entries to need a multi-level hashed tree
+    const int count = 3000;
+    for (int i = 0; i < count; ++i) {
+        DirectoryEntry entry = {static_cast<uint32_t>(i + 100), ""};
+        std::strncpy(entry.fileName, ("entry" + std::to_string(i)).c_str(), sizeof(entry.fileName) - 1);
+        dm.addEntry("/", entry);
+    }
+    assert(inodeManager.getInode(0).flags & INODE_FLAG_HTREE);
+    assert(dm.getEntryCount("/") == count + 5);
+
+    // Duplicates are still rejected
+    try {
+        DirectoryEntry duplicate = {1, "entry42"};
+        dm.addEntry("/", duplicate);
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+
+    // Every lookup reads one block per tree level
+    size_t readsBefore = dm.getStore()->getBlocksRead();
+    for (int i = 0; i < count; ++i) {
+        assert(dm.getEntry("/", "entry" + std::to_string(i)).inodeId == static_cast<uint32_t>(i + 100));
+    }
+    size_t readsPerLookup = (dm.getStore()->getBlocksRead() - readsBefore) / count;
+    assert(readsPerLookup <= 3);
+
+    // Remove half of the entries
+    for (int i = 0; i < count; i += 2) {
+        dm.removeEntry("/", "entry" + std::to_string(i));
+    }
+    assert(dm.getEntryCount("/") == count / 2 + 5);
+
+    // The directory survives a remount with fresh managers
+    inodeManager.flush();
+    InodeManager inodeManager2(diskManager, layout.numberOfInodes, layout.inodeTableStart);
+    inodeManager2.scanInodeTable();
+    DirectoryManager dm2(diskManager, freeBlockManager, inodeManager2);
+    dm2.loadRootDirectory(0, inodeManager2.getInode(0));
+    assert(dm2.getEntry("/", "small3").inodeId == 4);
+    assert(dm2.getEntry("/", "entry1").inodeId == 101);
+    try {
+        dm2.getEntry("/", "entry0");
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected: removed before the remount
+    }
+
+    // Stream the directory in small batches while inserts split leaves under the cursor;
+    // every existing entry is returned exactly once
+    std::unordered_set<std::string> seen;
+    std::vector<DirectoryEntry> batch;
+    int added = 0;
+    for (uint64_t cookie = 0; cookie != READDIR_END;) {
+        batch.clear();
+        cookie = dm2.readDirectory("/", cookie, 7, batch);
+        assert(batch.size() <= 7);
+        for (const auto& entry : batch) {
+            assert(seen.insert(entry.fileName).second);
+        }
+        for (int i = 0; i < 3; ++i, ++added) {
+            DirectoryEntry entry = {static_cast<uint32_t>(added + 10000), ""};
+            std::strncpy(entry.fileName, ("late" + std::to_string(added)).c_str(), sizeof(entry.fileName) - 1);
+            dm2.addEntry("/", entry);
+        }
+    }
+    for (int i = 1; i < count; i += 2) {
+        assert(seen.count("entry" + std::to_string(i)) == 1);
+    }
+    assert(seen.count("small0") == 1);
+    assert(dm2.listEntries("/").size() == static_cast<size_t>(count / 2 + 5 + added));
+
+    std::cout << "All DirectoryStore tests passed!" << std::endl;
+    return 0;
+}
+#endif
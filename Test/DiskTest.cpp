@@ -3,6 +3,7 @@
 #include "../InodeManager.h"
 #include <iostream>
 #include <cassert>
+#include <cstring>
 
 int main() {
     try {
@@ -17,13 +18,20 @@ int main() {
         std::cout << "Superblock verified.\n";
 
         // Read and verify the root inode
-        auto inodeTableBlock = diskManager.readBlock(2);
+        auto inodeTableBlock = diskManager.readBlock(diskManager.computeLayout().inodeTableStart);
         Inode rootInode;
         std::memcpy(&rootInode, inodeTableBlock.data(), sizeof(Inode));
         assert(rootInode.fileType == 2); // Directory
         std::cout << "Root directory inode verified.\n";
 
         std::cout << "FormatDisk test passed successfully.\n";
+
+        // A disk larger than 16-bit block pointers can address only uses the blocks they can
+        DiskManager large("vdisk", 48 * 1024 * 1024, 512);
+        Superblock layout = large.computeLayout();
+        assert(layout.totalBlocks == 3 * 32768 && layout.volumeBlocks == DiskManager::MAX_VOLUME_BLOCKS);
+        assert(layout.dataStart < layout.volumeBlocks);
+        std::cout << "Large disk layout verified.\n";
     } catch (const std::exception& e) {
         std::cerr << "Test failed: " << e.what() << "\n";
         return 1;
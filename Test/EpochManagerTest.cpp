@@ -0,0 +1,169 @@
+#include "../EpochManager.h"
+#include "../LLFS.h"
+#include <iostream>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef TEST_BUILD
+// Contents of one version of a file (every block tells the version)
+static std::vector<char> version(size_t size, int round) {
+    return std::vector<char>(size, static_cast<char>('a' + round % 26));
+}
+
+int main() {
+    const size_t diskSize = 2 * 1024 * 1024; // 2 MB disk, 512-byte blocks
+    const size_t blockSize = 512;
+
+    // Callbacks wait for the readers that entered before they were retired, not for later ones
+    {
+        EpochManager epochs;
+        int ran = 0;
+        epochs.retire([&ran] { ++ran; });
+        assert(epochs.reclaim() == 1 && ran == 1); // No reader: runs at once
+
+        {
+            EpochManager::Guard early = epochs.enter();
+            epochs.retire([&ran] { ++ran; });
+            EpochManager::Guard late = epochs.enter();
+            assert(epochs.reclaim() == 0 && ran == 1 && epochs.getPending() == 1);
+        }
+        assert(epochs.reclaim() == 1 && ran == 2);
+        assert(epochs.getPending() == 0 && epochs.getReclaimed() == 2);
+
+        // A reader entered after the retire does not hold it back
+        epochs.retire([&ran] { ++ran; });
+        EpochManager::Guard reader = epochs.enter();
+        assert(epochs.reclaim() == 1 && ran == 3);
+    }
+
+    // Guards move, and leave their slot once
+    {
+        EpochManager epochs;
+        std::vector<EpochManager::Guard> guards;
+        for (size_t i = 0; i < EpochManager::SLOTS; ++i) {
+            guards.push_back(epochs.enter()); // Every slot taken
+        }
+        int ran = 0;
+        epochs.retire([&ran] { ++ran; });
+        std::thread waiter([&] { epochs.synchronize(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        assert(ran == 0);
+        guards.clear();
+        waiter.join();
+        assert(ran == 1);
+    }
+
+    // Reads after the first skip the locks, and see each write whole
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.createFile("/file");
+        fs.writeFile("/file", version(3 * blockSize + 7, 0));
+        fs.readFile("/file");
+        size_t locked = fs.getReadPathStats().lockedReads;
+        for (int round = 1; round < 5; ++round) {
+            fs.writeFile("/file", version(3 * blockSize + 7, round));
+            assert(fs.readFile("/file") == version(3 * blockSize + 7, round));
+        }
+        assert(fs.getReadPathStats().lockedReads == locked);
+
+        // Holes read back as zeros
+        fs.punchHole("/file", blockSize, blockSize);
+        std::vector<char> expected = version(3 * blockSize + 7, 4);
+        std::fill(expected.begin() + blockSize, expected.begin() + 2 * blockSize, 0);
+        assert(fs.readFile("/file") == expected);
+
+        // A deleted file is not found through the published inode
+        fs.deleteFile("/file");
+        try {
+            fs.readFile("/file");
+            assert(false);
+        } catch (const std::runtime_error&) {}
+        assert(fs.getReadPathStats().retiredPending == 0);
+        assert(fs.checkConsistency(false).isConsistent());
+    }
+
+    // Blocks a reader may hold are not reused until it leaves: readers racing writers and
+    // deletes only ever see a whole version
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        const size_t size = 6 * blockSize;
+        const int rounds = 200;
+        fs.createFile("/hot");
+        fs.writeFile("/hot", version(size, 0));
+
+        std::atomic<bool> done{false};
+        std::atomic<int> failures{0};
+        std::vector<std::thread> readers;
+        for (int thread = 0; thread < 3; ++thread) {
+            readers.emplace_back([&] {
+                while (!done) {
+                    std::vector<char> data = fs.readFile("/hot");
+                    if (data.size() != size || data != version(size, data[0] - 'a')) ++failures;
+                }
+            });
+        }
+        for (int round = 1; round < rounds; ++round) {
+            fs.writeFile("/hot", version(size, round));
+            std::string scratch = "/scratch" + std::to_string(round % 4);
+            if (round > 4) fs.deleteFile(scratch);
+            fs.createFile(scratch);
+            fs.writeFile(scratch, version(size, round + 1));
+        }
+        done = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        assert(failures == 0);
+        assert(fs.checkConsistency(false).isConsistent());
+        assert(fs.getReadPathStats().retiredPending == 0);
+    }
+
+    // After a remount the published inodes are gone, and reads take the locks again
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.createFile("/file");
+        fs.writeFile("/file", version(blockSize, 1));
+        fs.sync();
+        fs.mount();
+        size_t locked = fs.getReadPathStats().lockedReads;
+        assert(fs.readFile("/file") == version(blockSize, 1));
+        assert(fs.getReadPathStats().lockedReads == locked + 1);
+
+        // Turned off, every read takes the locks
+        fs.setLockFreeReads(false);
+        assert(fs.readFile("/file") == version(blockSize, 1));
+        assert(fs.getReadPathStats().lockedReads == locked + 2);
+    }
+
+    // Compressed files and the log are always read under the locks
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.setCompression(true);
+        fs.createFile("/file");
+        fs.writeFile("/file", version(blockSize, 2));
+        fs.readFile("/file");
+        fs.readFile("/file");
+        assert(fs.getReadPathStats().lockedReads == 2);
+    }
+    {
+        LLFS fs("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        fs.formatFileSystem();
+        fs.createFile("/file");
+        fs.writeFile("/file", version(blockSize, 2));
+        fs.readFile("/file");
+        fs.readFile("/file");
+        assert(fs.getReadPathStats().lockedReads == 2);
+    }
+
+    std::cout << "All EpochManager tests passed!" << std::endl;
+    return 0;
+}
+#endif
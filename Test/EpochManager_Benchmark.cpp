@@ -0,0 +1,88 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../LLFS.h"
+
+// Seconds since start
+static double since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Read the files from count threads (while a writer rewrites others, if asked); returns reads/s
+static double readRate(LLFS& fs, int count, int files, int operations, bool withWriter) {
+    std::atomic<bool> done{false};
+    std::thread writer;
+    if (withWriter) {
+        writer = std::thread([&] {
+            const std::vector<char> data(10 * 512, 'w');
+            for (int i = 0; !done; ++i) {
+                fs.writeFile("/hot" + std::to_string(i % 4), data);
+            }
+        });
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < count; ++thread) {
+        threads.emplace_back([&, thread] {
+            for (int i = 0; i < operations / count; ++i) {
+                fs.readFile("/file" + std::to_string((thread + i * count) % files));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = since(start);
+    done = true;
+    if (writer.joinable()) {
+        writer.join();
+    }
+    return operations / seconds;
+}
+
+int main() {
+    const size_t diskSize = 32 * 1024 * 1024;
+    const size_t blockSize = 512;
+    const int files = 64;
+    const int operations = 40000; // Split over the threads
+    const std::vector<char> data(10 * blockSize, 'r');
+
+    for (bool lockFree : {false, true}) {
+        LLFS fs("vdisk_bench", diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.setLockFreeReads(lockFree);
+        for (int i = 0; i < files; ++i) {
+            std::string name = "/file" + std::to_string(i);
+            fs.createFile(name);
+            fs.writeFile(name, data);
+        }
+        for (int i = 0; i < 4; ++i) {
+            fs.createFile("/hot" + std::to_string(i));
+        }
+        fs.sync();
+
+        std::cout << "Running read benchmark, " << (lockFree ? "lock-free" : "locked")
+                  << " reads (" << operations << " reads of 5 KB files, " << std::thread::hardware_concurrency()
+                  << " cores)..." << std::endl;
+        for (bool withWriter : {false, true}) {
+            for (int threadCount : {1, 2, 4, 8}) {
+                size_t lockedBefore = fs.getReadPathStats().lockedReads;
+                double rate = readRate(fs, threadCount, files, operations, withWriter);
+                size_t locked = fs.getReadPathStats().lockedReads - lockedBefore;
+                std::cout << threadCount << " threads" << (withWriter ? " + writer: " : ": ") << rate / 1e3
+                          << "k reads/s, " << 100.0 * locked / operations << "% locked" << std::endl;
+            }
+        }
+        ReadPathStats stats = fs.getReadPathStats();
+        std::cout << "Retired: " << stats.retiredReclaimed << " reclaimed, " << stats.retiredPending
+                  << " pending" << std::endl;
+    }
+    return 0;
+}
+
+#endif // BENCHMARK_TEST
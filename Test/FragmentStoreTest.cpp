@@ -0,0 +1,174 @@
+#include "../FragmentStore.h"
+#include "../LLFS.h"
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef TEST_BUILD
+// Contents of a small file
+static std::vector<char> smallFile(size_t size, char tag) {
+    std::vector<char> data(size, tag);
+    data[0] = 'S';
+    return data;
+}
+
+int main() {
+    const size_t diskSize = 2 * 1024 * 1024; // 2 MB disk, 512-byte blocks
+    const size_t blockSize = 512;
+
+    // Slots: the smallest of 64, 128 and 256 bytes that fits; freed slots wait for a release
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        diskManager.formatDisk();
+        FreeBlockManager freeBlockManager(diskManager.getTotalBlocks(), diskManager.computeLayout().dataStart);
+        FragmentStore store(diskManager, freeBlockManager, 2);
+        assert(store.getMaxFragmentSize() == 256);
+
+        std::vector<Fragment> tiny;
+        for (int i = 0; i < 9; ++i) {
+            tiny.push_back(store.store(smallFile(50, 'a' + i).data(), 50));
+        }
+        assert(tiny[0].block == tiny[7].block && tiny[8].block != tiny[0].block); // 8 slots per block
+        assert(tiny[3].slot == 3 && tiny[8].slot == 0);
+        assert(freeBlockManager.getReferenceCount(tiny[0].block) == 8);
+        Fragment medium = store.store(smallFile(100, 'm').data(), 100);
+        Fragment half = store.store(smallFile(256, 'h').data(), 256);
+        assert(medium.block != tiny[0].block && half.block != medium.block);
+        assert(store.getPackBlocks() == 4 && store.getFragments() == 11);
+        for (int i = 0; i < 9; ++i) {
+            assert(store.read(tiny[i], 50) == smallFile(50, 'a' + i));
+        }
+        assert(store.read(medium, 100) == smallFile(100, 'm'));
+        assert(store.read(half, 256) == smallFile(256, 'h'));
+        assert(store.getCacheMisses() > 0 && store.getCacheHits() > 0);
+
+        // The same data through a cold cache
+        FragmentStore cold(diskManager, freeBlockManager);
+        assert(cold.read(tiny[5], 50) == smallFile(50, 'f') && cold.read(tiny[6], 50) == smallFile(50, 'g'));
+        assert(cold.getCacheMisses() == 1 && cold.getCacheHits() == 1); // Neighbours come together
+
+        try {
+            store.store(smallFile(300, 'x').data(), 300);
+            assert(false); // Should not reach here
+        } catch (const std::invalid_argument&) {
+            // Expected
+        }
+
+        store.release(tiny[2]);
+        assert(store.store(smallFile(50, 'n').data(), 50).block == tiny[8].block); // Slot still held
+        store.releaseHeldSlots();
+        Fragment reused = store.store(smallFile(50, 'r').data(), 50);
+        assert(reused.block == tiny[0].block && reused.slot == 2);
+        assert(store.read(tiny[1], 50) == smallFile(50, 'b')); // Neighbours unchanged
+
+        store.release(half);
+        store.releaseHeldSlots();
+        assert(freeBlockManager.isBlockFree(half.block) && store.getPackBlocks() == 3);
+
+        // Rebuilt from the fragments the inodes name
+        FragmentStore rebuilt(diskManager, freeBlockManager);
+        rebuilt.addFragment(tiny[0], 50);
+        rebuilt.addFragment(tiny[0], 50); // A clash is ignored
+        rebuilt.addFragment(medium, 100);
+        assert(rebuilt.getFragments() == 2 && rebuilt.getPackBlocks() == 2);
+        assert(rebuilt.store(smallFile(60, 'q').data(), 60).block == tiny[0].block);
+    }
+
+    // Through LLFS: small files share blocks, change independently and survive a crash
+    for (WriteMode mode : {WriteMode::InPlace, WriteMode::LogStructured}) {
+        {
+            LLFS fs("vdisk", diskSize, blockSize, mode);
+            fs.formatFileSystem();
+            fs.setPacking(true);
+            fs.createDirectory("/small");
+            size_t plainBlocks = fs.getDedupStats().physicalBlocks;
+            for (int i = 0; i < 40; ++i) {
+                std::string name = "/small/f" + std::to_string(i);
+                fs.createFile(name);
+                fs.writeFile(name, smallFile(20 + i, 'a' + i % 26));
+            }
+            PackingStats stats = fs.getPackingStats();
+            assert(stats.filesPacked == 40 && stats.packBlocks == 5); // All in 64-byte slots
+            assert(fs.getDedupStats().physicalBlocks == plainBlocks); // Not counted as plain data
+            assert(fs.readFile("/small/f7") == smallFile(27, 'h'));
+
+            // A file that grows leaves its slot; one that shrinks moves into one
+            fs.createFile("/big");
+            fs.writeFile("/big", std::vector<char>(2000, 'B'));
+            fs.writeFile("/small/f3", std::vector<char>(1500, 'g'));
+            fs.writeFile("/big", smallFile(30, 'b'));
+            assert(fs.readFile("/small/f3") == std::vector<char>(1500, 'g'));
+            assert(fs.readFile("/big") == smallFile(30, 'b'));
+            assert(fs.readFile("/small/f2") == smallFile(22, 'c') && fs.readFile("/small/f4") == smallFile(24, 'e'));
+
+            // Holes, clones and deletes
+            fs.punchHole("/small/f5", 5, 10);
+            std::vector<char> punched = smallFile(25, 'f');
+            std::fill(punched.begin() + 5, punched.begin() + 15, 0);
+            assert(fs.readFile("/small/f5") == punched);
+            fs.cloneFile("/small/f6", "/clone");
+            fs.writeFile("/small/f6", smallFile(10, 'z'));
+            assert(fs.readFile("/clone") == smallFile(26, 'g'));
+            fs.deleteFiles({"/small/f8", "/small/f9"});
+            fs.deleteFile("/small/f10");
+
+            // A transaction's rewrites go to new slots; its freed slots come back at the commit
+            fs.beginTransaction();
+            fs.writeFile("/small/f11", smallFile(31, 'X'));
+            fs.writeFile("/small/f12", smallFile(32, 'Y'));
+            fs.commit();
+            assert(fs.checkConsistency(false).isConsistent());
+            fs.writeFile("/small/f13", smallFile(33, 'Z'));
+            fs.commit();
+        }
+
+        // The slots in use come back from the inodes
+        LLFS fs("vdisk", diskSize, blockSize, mode);
+        fs.mount();
+        PackingStats stats = fs.getPackingStats();
+        assert(stats.filesPacked == 38 && stats.packBlocks <= 7);
+        assert(fs.readFile("/small/f11") == smallFile(31, 'X') && fs.readFile("/small/f13") == smallFile(33, 'Z'));
+        assert(fs.readFile("/clone") == smallFile(26, 'g') && fs.readFile("/big") == smallFile(30, 'b'));
+        assert(fs.readFile("/small/f39") == smallFile(59, 'a' + 39 % 26));
+        assert(fs.statFiles({"/small/f9"})[0].fileType == 0);
+        assert(fs.checkConsistency(false).isConsistent());
+
+        // Packing off: packed files stay readable and are rewritten as plain files
+        fs.writeFile("/small/f0", smallFile(20, 'p'));
+        assert(fs.readFile("/small/f0") == smallFile(20, 'p'));
+        std::vector<std::string> names;
+        for (int i = 0; i < 40; ++i) {
+            if (i < 8 || i > 10) names.push_back("/small/f" + std::to_string(i));
+        }
+        fs.deleteFiles(names);
+        fs.deleteFiles({"/clone", "/big"});
+        fs.commit();
+        assert(fs.getPackingStats().filesPacked == 0 && fs.getPackingStats().packBlocks == 0);
+        assert(fs.checkConsistency(false).isConsistent());
+    }
+
+    // A pack block rewritten in place is copied out for a snapshot first
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.setPacking(true);
+        fs.createFiles({"/a", "/b"});
+        fs.writeFile("/a", smallFile(40, 'a'));
+        fs.writeFile("/b", smallFile(40, 'b'));
+        fs.snapshot("before");
+        fs.deleteFile("/a");
+        fs.commit();
+        fs.createFile("/c");
+        fs.writeFile("/c", smallFile(40, 'c')); // Takes the slot /a had
+        assert(fs.getPackingStats().packBlocks == 1);
+        std::unique_ptr<LLFS> view = fs.mountSnapshot("before");
+        assert(view->readFile("/a") == smallFile(40, 'a') && view->readFile("/b") == smallFile(40, 'b'));
+        assert(fs.readFile("/c") == smallFile(40, 'c'));
+    }
+
+    std::cout << "All FragmentStore tests passed!" << std::endl;
+    return 0;
+}
+#endif
@@ -1,6 +1,8 @@
 #include "../FreeBlockManager.h"
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <vector>
 
 #ifdef TEST_BUILD
 int main() {
@@ -15,6 +17,47 @@ int main() {
     fbm.freeBlock(block);
     assert(fbm.isBlockFree(block)); // Block should now be free again
 
+    // Test holding freed blocks: they stay allocated until released
+    int held = fbm.allocateBlock();
+    fbm.holdFreedBlocks();
+    assert(fbm.freeBlock(held));
+    assert(!fbm.isBlockFree(held) && fbm.getHeldBlocks() == 1);
+    assert(fbm.allocateBlock() != held);
+    fbm.releaseHeldBlocks();
+    assert(fbm.isBlockFree(held) && fbm.getHeldBlocks() == 0);
+
+    // Held blocks taken off the list stay allocated until released; later frees are still held
+    fbm.holdFreedBlocks();
+    int taken = fbm.allocateBlock();
+    fbm.freeBlock(taken);
+    std::vector<uint32_t> blocks = fbm.takeHeldBlocks();
+    assert(blocks.size() == 1 && blocks[0] == static_cast<uint32_t>(taken) && fbm.getHeldBlocks() == 0);
+    assert(!fbm.isBlockFree(taken));
+    int later = fbm.allocateBlock();
+    fbm.freeBlock(later);
+    fbm.releaseBlocks(blocks);
+    assert(fbm.isBlockFree(taken) && !fbm.isBlockFree(later) && fbm.getHeldBlocks() == 1);
+    fbm.releaseHeldBlocks();
+    assert(fbm.isBlockFree(later));
+
+    // Test pinned blocks: never handed out, even once freed; pinning a free block keeps it free
+    int kept = fbm.allocateBlock();
+    std::vector<uint8_t> pins(4096 / 8, 0);
+    pins[kept / 8] |= 1 << (kept % 8);
+    fbm.setPinnedBlocks(pins);
+    fbm.freeBlock(kept);
+    assert(fbm.isBlockFree(kept) && fbm.isBlockPinned(kept));
+    int copy = fbm.pinFreeBlock();
+    assert(copy != kept && fbm.isBlockFree(copy) && fbm.isBlockPinned(copy) && fbm.getPinnedBlocks() == 2);
+    for (int i = 0; i < 100; ++i) {
+        int next = fbm.allocateBlock();
+        assert(next != kept && next != copy);
+    }
+    fbm.setPinnedBlocks(std::vector<uint8_t>(4096 / 8, 0));
+    int reused = fbm.allocateBlock();
+    assert(fbm.getPinnedBlocks() == 0 && reused == std::min(kept, copy));
+    fbm.freeBlock(reused);
+
     // Test reserved blocks
     for (int i = 0; i < 10; ++i) {
         assert(!fbm.isBlockFree(i)); // Reserved blocks should not be free
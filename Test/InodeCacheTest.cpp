@@ -0,0 +1,57 @@
+#include "../DiskManager.h"
+#include "../InodeManager.h"
+#include <iostream>
+#include <cassert>
+
+#ifdef TEST_BUILD
+int main() {
+    DiskManager diskManager("vdisk", 2 * 1024 * 1024, 512); // 2 MB disk, 512-byte blocks
+    diskManager.formatDisk();
+    Superblock layout = diskManager.loadSuperblock();
+
+    // Keep at most 4 unreferenced inodes resident
+    InodeManager im(diskManager, layout.numberOfInodes, layout.inodeTableStart, 4);
+    im.scanInodeTable();
+    assert(im.getInode(0).fileType == 2); // Root inode written by formatDisk
+
+    // Allocate and update more inodes than the cache can hold
+    for (int i = 0; i < 32; ++i) {
+        int inodeId = im.allocateInode();
+        Inode inode = im.getInode(inodeId);
+        inode.fileSize = 100 + inodeId;
+        im.updateInode(inodeId, inode);
+    }
+    assert(im.getCache().getResidentCount() <= 4);
+
+    // Evicted inodes were written back and load again on demand
+    for (int i = 1; i <= 32; ++i) {
+        InodeHandle handle = im.acquireInode(i);
+        assert(handle->fileSize == static_cast<uint32_t>(100 + i));
+    }
+
+    // Referenced inodes stay resident even when over capacity
+    std::vector<InodeHandle> pinned;
+    for (int i = 1; i <= 8; ++i) {
+        pinned.push_back(im.acquireInode(i));
+    }
+    assert(im.getCache().getResidentCount() >= 8);
+    InodeHandle copy = pinned.front();
+    pinned.clear();
+    assert(copy->fileSize == 101);
+
+    // A second manager sees the flushed table
+    im.flush();
+    InodeManager im2(diskManager, layout.numberOfInodes, layout.inodeTableStart, 4);
+    im2.scanInodeTable();
+    assert(im2.getInode(32).fileSize == 132);
+    try {
+        im2.getInode(33);
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected: never allocated
+    }
+
+    std::cout << "All InodeCache tests passed!" << std::endl;
+    return 0;
+}
+#endif
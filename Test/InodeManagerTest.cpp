@@ -27,6 +27,19 @@ int main() {
         // Expected behavior
     }
 
+    // Test bulk allocation: one scan, and nothing allocated when there are too few
+    std::vector<uint32_t> bulk = im.allocateInodes(100);
+    assert(bulk.size() == 100 && bulk.front() == 0 && bulk.back() == 99);
+    assert(im.isAllocated(50) && im.getInode(50).fileType == 1);
+    try {
+        im.allocateInodes(29);
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+    assert(!im.isAllocated(100));
+    assert(im.allocateInodes(28).back() == 127);
+
     // Test saving and loading inode table
     auto savedData = im.saveInodeTable();
     InodeManager im2(128);
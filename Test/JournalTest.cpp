@@ -0,0 +1,237 @@
+#include "../DiskManager.h"
+#include "../Journal.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+
+#ifdef TEST_BUILD
+// Block filled with one byte value
+static std::vector<char> filled(size_t blockSize, char value) {
+    return std::vector<char>(blockSize, value);
+}
+
+int main() {
+    const size_t diskSize = 2 * 1024 * 1024; // 2 MB disk, 512-byte blocks
+    const size_t blockSize = 512;
+    Superblock layout;
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        diskManager.formatDisk();
+        layout = diskManager.loadSuperblock();
+
+        // Formatting leaves data blocks alone; start the blocks used below out empty
+        diskManager.writeBlocks(layout.dataStart, std::vector<char>(64 * blockSize, 0));
+    }
+    assert(layout.journalStart == layout.inodeTableStart + layout.inodeTableBlocks);
+    assert(layout.dataStart == layout.journalStart + layout.journalBlocks);
+    const size_t target = layout.dataStart + 10;
+
+    // Journaled writes are visible at once but stay out of their home location until a checkpoint
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal journal(diskManager, layout);
+        assert(journal.recover() == 0);
+        diskManager.setJournal(&journal);
+
+        diskManager.writeMetadataBlock(target, filled(blockSize, 'A'));
+        assert(diskManager.readBlock(target) == filled(blockSize, 'A'));
+        assert(journal.getPendingBlocks() == 1);
+
+        DiskManager home("vdisk", diskSize, blockSize);
+        assert(home.readBlock(target) == filled(blockSize, 0));
+
+        // Committed transactions survive a crash: replay writes them home
+        journal.commit();
+        assert(journal.getPendingBlocks() == 0);
+        assert(journal.getCommits() == 1);
+        assert(home.readBlock(target) == filled(blockSize, 0));
+
+        // Uncommitted changes are lost in the crash
+        diskManager.writeMetadataBlock(target + 1, filled(blockSize, 'B'));
+    }
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal journal(diskManager, layout);
+        assert(journal.recover() == 1);
+        assert(diskManager.readBlock(target) == filled(blockSize, 'A'));
+        assert(diskManager.readBlock(target + 1) == filled(blockSize, 0));
+
+        // Replay already happened; a second recovery finds nothing
+        assert(journal.recover() == 0);
+    }
+
+    // A transaction with a torn commit record is not replayed
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal journal(diskManager, layout);
+        journal.recover();
+        diskManager.setJournal(&journal);
+        diskManager.writeMetadataBlock(target, filled(blockSize, 'C'));
+        journal.commit();
+
+        // The first transaction used ring positions 0-2; this one has its descriptor at 3,
+        // the image at 4 and the commit record at 5 (the ring starts after the header block)
+        std::vector<char> record = diskManager.readBlock(layout.journalStart + 1 + 5);
+        record[16] ^= 0x5A; // Checksum
+        diskManager.writeBlocks(layout.journalStart + 1 + 5, record);
+    }
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal journal(diskManager, layout);
+        assert(journal.recover() == 0);
+        assert(diskManager.readBlock(target) == filled(blockSize, 'A'));
+    }
+
+    // Many commits wrap around the ring; full rings are checkpointed first
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal journal(diskManager, layout);
+        journal.recover();
+        diskManager.setJournal(&journal);
+        for (int round = 0; round < 200; ++round) {
+            for (size_t i = 0; i < 5; ++i) {
+                diskManager.writeMetadataBlock(target + i, filled(blockSize, static_cast<char>(round + i)));
+            }
+            journal.commit();
+        }
+        assert(journal.getCommits() == 200);
+        assert(journal.getCheckpoints() > 0);
+        assert(journal.getJournaledBlocks() == 1000);
+    }
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal journal(diskManager, layout);
+        assert(journal.recover() > 0);
+        for (size_t i = 0; i < 5; ++i) {
+            assert(diskManager.readBlock(target + i) == filled(blockSize, static_cast<char>(199 + i)));
+        }
+    }
+
+    // Overwriting a journaled block in place drops the journaled copy
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal journal(diskManager, layout);
+        journal.recover();
+        diskManager.setJournal(&journal);
+        diskManager.writeMetadataBlock(target, filled(blockSize, 'D'));
+        journal.commit();
+        diskManager.writeBlock(target, filled(blockSize, 'E'));
+        assert(diskManager.readBlock(target) == filled(blockSize, 'E'));
+    }
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal journal(diskManager, layout);
+        journal.recover();
+        assert(diskManager.readBlock(target) == filled(blockSize, 'E'));
+    }
+
+    // Transactions larger than the ring are refused and stay pending
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal journal(diskManager, layout);
+        journal.recover();
+        diskManager.setJournal(&journal);
+        for (size_t i = 0; i < journal.getCapacity(); ++i) {
+            diskManager.writeMetadataBlock(layout.dataStart + i, filled(blockSize, 'F'));
+        }
+        bool threw = false;
+        try {
+            journal.commit();
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+        assert(journal.getPendingBlocks() == journal.getCapacity());
+    }
+
+    // Concurrent committers share journal writes
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal journal(diskManager, layout);
+        journal.recover();
+        diskManager.setJournal(&journal);
+
+        const int threadCount = 8;
+        const int commitsPerThread = 20;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < commitsPerThread; ++i) {
+                    journal.logBlock(target + t, filled(blockSize, static_cast<char>(i)));
+                    journal.commit();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        assert(journal.getCommitRequests() == threadCount * commitsPerThread);
+        assert(journal.getCommits() <= journal.getCommitRequests());
+        assert(journal.getPendingBlocks() == 0);
+    }
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal journal(diskManager, layout);
+        journal.recover();
+        for (int t = 0; t < 8; ++t) {
+            assert(diskManager.readBlock(target + t) == filled(blockSize, 19));
+        }
+    }
+
+    // A reformatted journal does not replay the previous file system's transactions
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal::formatRegion(diskManager, layout);
+        Journal journal(diskManager, layout);
+        assert(journal.recover() == 0);
+        diskManager.setJournal(&journal);
+        diskManager.writeMetadataBlock(target, filled(blockSize, 'R'));
+        journal.commit();
+        journal.checkpoint();
+        diskManager.setJournal(nullptr);
+
+        diskManager.writeBlocks(target, filled(blockSize, 'N'));
+        Journal::formatRegion(diskManager, layout);
+        Journal fresh(diskManager, layout);
+        assert(fresh.recover() == 0);
+        assert(diskManager.readBlock(target) == filled(blockSize, 'N'));
+    }
+
+    // Nor the later ones the new journal's sequence catches up with
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        Journal::formatRegion(diskManager, layout);
+        {
+            Journal old(diskManager, layout);
+            old.recover();
+            diskManager.setJournal(&old);
+            for (int t = 0; t < 3; ++t) {
+                diskManager.writeMetadataBlock(target + t, filled(blockSize, 'O'));
+                old.commit(); // Sequences 1 to 3, left in the ring
+            }
+            diskManager.setJournal(nullptr);
+        }
+        for (int t = 0; t < 3; ++t) {
+            diskManager.writeBlocks(target + t, filled(blockSize, 'N'));
+        }
+
+        Journal::formatRegion(diskManager, layout);
+        {
+            Journal fresh(diskManager, layout);
+            fresh.recover();
+            diskManager.setJournal(&fresh);
+            diskManager.writeMetadataBlock(target, filled(blockSize, 'R'));
+            fresh.commit(); // Sequence 1 again, in the same place; then a crash
+            diskManager.setJournal(nullptr);
+        }
+        Journal recovered(diskManager, layout);
+        assert(recovered.recover() == 1);
+        assert(diskManager.readBlock(target) == filled(blockSize, 'R'));
+        assert(diskManager.readBlock(target + 1) == filled(blockSize, 'N'));
+        assert(diskManager.readBlock(target + 2) == filled(blockSize, 'N'));
+    }
+
+    std::cout << "All Journal tests passed!" << std::endl;
+    return 0;
+}
+#endif
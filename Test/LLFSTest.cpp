@@ -1,6 +1,9 @@
 #include "../LLFS.h"
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 #ifdef TEST_BUILD
 int main() {
@@ -16,9 +19,313 @@ int main() {
     auto readData = fs.readFile("file1.txt");
     assert(readData == data);
 
+    // Metadata queries see the new size and modification time
+    InodeQuery query;
+    query.fileType = 1;
+    query.minSize = 1000;
+    assert(fs.findInodes(query).size() == 1);
+    assert(fs.findModifiedSince(0).size() == 2); // Root directory and file1.txt
+
     // Delete the file
     fs.deleteFile("file1.txt");
 
+    // Nested directories
+    fs.createDirectory("/a");
+    fs.createDirectory("/a/b");
+    fs.createFile("/a/b/file2.txt");
+    std::vector<char> nested(100, 'B');
+    fs.writeFile("/a/b/file2.txt", nested);
+    assert(fs.readFile("a/./b/../b/file2.txt") == nested);
+    assert(fs.listDirectory("/a").size() == 1);
+
+    try {
+        fs.deleteDirectory("/a/b"); // Not empty
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+    try {
+        fs.readFile("/a/b"); // A directory is not a file
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+    try {
+        fs.createFile("/missing/file3.txt"); // Parent does not exist
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+
+    fs.deleteFile("/a/b/file2.txt");
+    fs.deleteDirectory("/a/b");
+    fs.deleteDirectory("/a");
+    assert(fs.listDirectory("/").empty());
+
+    // Directories survive a remount
+    fs.createDirectory("/kept");
+    fs.createFile("/kept/file4.txt");
+    fs.writeFile("/kept/file4.txt", data);
+    fs.sync();
+    {
+        LLFS remounted("vdisk", 2 * 1024 * 1024);
+        remounted.mount();
+        assert(remounted.readFile("/kept/file4.txt") == data);
+    }
+
+    // A commit is enough: the remount replays the journal
+    fs.createDirectory("/journaled");
+    fs.createFile("/journaled/file5.txt");
+    fs.writeFile("/journaled/file5.txt", data);
+    size_t commitsBefore = fs.getJournal().getCommits();
+    fs.commit();
+    assert(fs.getJournal().getCommits() == commitsBefore + 1);
+    assert(fs.getJournal().getPendingBlocks() == 0);
+    {
+        LLFS remounted("vdisk", 2 * 1024 * 1024);
+        remounted.mount();
+        assert(remounted.readFile("/journaled/file5.txt") == data);
+        assert(remounted.readFile("/kept/file4.txt") == data);
+    }
+
+    // LFS mode: the same operations, with every write appended to segments
+    {
+        LLFS lfs("vdisk", 2 * 1024 * 1024, 512, WriteMode::LogStructured);
+        lfs.formatFileSystem();
+        lfs.createDirectory("/logged");
+        for (int i = 0; i < 50; ++i) {
+            lfs.createFile("/logged/file" + std::to_string(i));
+        }
+        lfs.writeFile("/logged/file7", data);
+        lfs.deleteFile("/logged/file8");
+        assert(lfs.readFile("/logged/file7") == data);
+        assert(lfs.listDirectory("/logged").size() == 49);
+        assert(lfs.getSegmentManager().getBlocksWritten() > 0);
+        // A commit only marks the log; the remount rolls forward from the format's checkpoint
+        lfs.commit();
+        assert(lfs.getSegmentManager().getCommits() >= 1);
+        assert(lfs.getSegmentManager().getCheckpoints() == 0);
+
+        // Opening the disk in the wrong mode fails
+        {
+            LLFS inPlace("vdisk", 2 * 1024 * 1024);
+            bool threw = false;
+            try {
+                inPlace.mount();
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            assert(threw);
+        }
+    }
+    {
+        LLFS remounted("vdisk", 2 * 1024 * 1024, 512, WriteMode::LogStructured);
+        remounted.mount();
+        assert(remounted.readFile("/logged/file7") == data);
+        assert(remounted.listDirectory("/logged").size() == 49);
+
+        // Churn with the cleaner running: freed blocks stop counting as live, and the log
+        // wraps around without running out of clean segments
+        const SegmentManager& segments = remounted.getSegmentManager();
+        std::vector<char> churn(4096, 'c');
+        remounted.startCleaner();
+        for (int i = 0; i < 1000; ++i) {
+            std::string name = "/logged/churn" + std::to_string(i % 10);
+            remounted.createFile(name);
+            remounted.writeFile(name, churn);
+            remounted.deleteFile(name);
+        }
+        remounted.stopCleaner();
+        size_t live = 0;
+        for (size_t segment = 0; segment < segments.getSegmentCount(); ++segment) {
+            live += segments.getLiveBlocks(segment);
+        }
+        assert(live < segments.getSlotsPerSegment() * segments.getSegmentCount() / 4);
+        assert(segments.getBlocksWritten() > segments.getSlotsPerSegment() * segments.getSegmentCount());
+        assert(remounted.readFile("/logged/file7") == data);
+        remounted.sync();
+        assert(segments.getCheckpoints() >= 1);
+    }
+    {
+        LLFS remounted("vdisk", 2 * 1024 * 1024, 512, WriteMode::LogStructured);
+        remounted.mount();
+        assert(remounted.readFile("/logged/file7") == data);
+        assert(remounted.listDirectory("/logged").size() == 49);
+    }
+
+    // Batched creates, deletes and stats: each batch is one journal commit, all or nothing
+    {
+        LLFS batched("vdisk", 2 * 1024 * 1024);
+        batched.formatFileSystem();
+        batched.createDirectory("/a");
+        batched.createDirectory("/b");
+        std::vector<std::string> names;
+        for (int i = 0; i < 300; ++i) {
+            names.push_back((i % 2 ? "/a/file" : "/b/file") + std::to_string(i));
+        }
+        size_t commits = batched.getJournal().getCommits();
+        batched.createFiles(names);
+        assert(batched.getJournal().getCommits() == commits + 1);
+        assert(batched.getJournal().getPendingBlocks() == 0);
+        assert(batched.listDirectory("/a").size() == 150 && batched.listDirectory("/b").size() == 150);
+        batched.writeFile(names[1], data);
+
+        std::vector<FileStat> stats = batched.statFiles({names[1], "/a", "/a/missing", "/", names[0]});
+        assert(stats[0].fileType == 1 && stats[0].fileSize == data.size());
+        assert(stats[1].fileType == 2 && stats[2].fileType == 0);
+        assert(stats[3].fileType == 2 && stats[3].inodeId == 0);
+        assert(stats[4].fileType == 1 && stats[4].fileSize == 0 && stats[4].inodeId != stats[0].inodeId);
+
+        // Existing, repeated and invalid names, and missing directories, fail the whole batch
+        const std::vector<std::vector<std::string>> badBatches = {
+            {"/a/new", names[1]}, {"/a/new", "/a/new"}, {"/a/new", "/missing/file"},
+            {"/a/new", "/a/" + std::string(31, 'x')}};
+        for (const auto& bad : badBatches) {
+            try {
+                batched.createFiles(bad);
+                assert(false); // Should not reach here
+            } catch (const std::exception&) {
+                // Expected
+            }
+            assert(batched.statFiles({"/a/new"})[0].fileType == 0);
+        }
+        const std::vector<std::vector<std::string>> badDeletes = {
+            {names[2], "/a/missing"}, {names[2], names[2]}, {names[2], "/a"}};
+        for (const auto& bad : badDeletes) {
+            try {
+                batched.deleteFiles(bad);
+                assert(false); // Should not reach here
+            } catch (const std::exception&) {
+                // Expected
+            }
+            assert(batched.statFiles({names[2]})[0].fileType == 1);
+        }
+
+        commits = batched.getJournal().getCommits();
+        batched.deleteFiles(std::vector<std::string>(names.begin(), names.begin() + 100));
+        assert(batched.getJournal().getCommits() == commits + 1);
+        assert(batched.listDirectory("/a").size() == 100 && batched.listDirectory("/b").size() == 100);
+        assert(batched.statFiles({names[1]})[0].fileType == 0);
+        assert(batched.checkConsistency(false).isConsistent());
+    }
+    {
+        // Both batches were committed, so they survive without a sync
+        LLFS remounted("vdisk", 2 * 1024 * 1024);
+        remounted.mount();
+        assert(remounted.listDirectory("/a").size() == 100);
+        std::vector<FileStat> stats = remounted.statFiles({"/a/file99", "/a/file101", "/b/file298"});
+        assert(stats[0].fileType == 0 && stats[1].fileType == 1 && stats[2].fileType == 1);
+        assert(remounted.checkConsistency(false).isConsistent());
+    }
+
+    // Clones share the source's blocks; a write to either goes to new blocks
+    {
+        LLFS cloned("vdisk", 2 * 1024 * 1024);
+        cloned.formatFileSystem();
+        std::vector<char> original(5 * 512, 'a');
+        original[3 * 512] = 'z';
+        cloned.createFile("/src");
+        cloned.writeFile("/src", original);
+        DedupStats before = cloned.getDedupStats();
+        size_t writes = cloned.getDiskManager().getWriteCount();
+        cloned.cloneFile("/src", "/copy");
+        assert(cloned.getDiskManager().getWriteCount() == writes); // Nothing committed yet, no data written
+        assert(cloned.readFile("/copy") == original);
+        DedupStats after = cloned.getDedupStats();
+        assert(after.logicalBlocks == 2 * before.logicalBlocks && after.physicalBlocks == before.physicalBlocks);
+
+        cloned.writeFile("/copy", std::vector<char>(700, 'b'));
+        cloned.punchHole("/src", 0, 512);
+        assert(cloned.readFile("/copy") == std::vector<char>(700, 'b'));
+        std::vector<char> punched = original;
+        std::fill(punched.begin(), punched.begin() + 512, 0);
+        assert(cloned.readFile("/src") == punched);
+
+        // The clone outlives its source; names are checked like creates
+        cloned.createDirectory("/dir");
+        cloned.cloneFile("/src", "/dir/second");
+        cloned.deleteFile("/src");
+        assert(cloned.readFile("/dir/second") == punched);
+        for (auto bad : {std::make_pair("/copy", "/dir/second"), std::make_pair("/dir", "/other"),
+                         std::make_pair("/missing", "/other")}) {
+            try {
+                cloned.cloneFile(bad.first, bad.second);
+                assert(false); // Should not reach here
+            } catch (const std::exception&) {
+                // Expected
+            }
+        }
+
+        // Compressed files are copied
+        cloned.setCompression(true);
+        cloned.createFile("/packed");
+        cloned.writeFile("/packed", std::vector<char>(3000, 'p'));
+        cloned.cloneFile("/packed", "/packed.copy");
+        cloned.deleteFile("/packed");
+        assert(cloned.readFile("/packed.copy") == std::vector<char>(3000, 'p'));
+        cloned.cloneFile("/dir/second", "/third");
+        cloned.commit();
+        assert(cloned.checkConsistency(false).isConsistent());
+    }
+    {
+        // The shared references are rebuilt at mount: deleting one clone keeps the other's data
+        LLFS remounted("vdisk", 2 * 1024 * 1024);
+        remounted.mount();
+        remounted.deleteFile("/dir/second");
+        remounted.createFile("/filler");
+        remounted.writeFile("/filler", std::vector<char>(5 * 512, 'f'));
+        std::vector<char> expected(5 * 512, 'a');
+        std::fill(expected.begin(), expected.begin() + 512, 0);
+        expected[3 * 512] = 'z';
+        assert(remounted.readFile("/third") == expected);
+        assert(remounted.readFile("/packed.copy") == std::vector<char>(3000, 'p'));
+        assert(remounted.checkConsistency(false).isConsistent());
+    }
+
+    // A freed block is not reused before the commit that frees it: after a crash, the
+    // committed inode still finds its old data
+    {
+        LLFS crashed("vdisk", 2 * 1024 * 1024);
+        crashed.formatFileSystem();
+        crashed.createFiles({"/a", "/b"});
+        crashed.writeFile("/a", std::vector<char>(512, 'A'));
+        crashed.commit();
+        crashed.writeFile("/a", std::vector<char>(512, 'C')); // Frees the block holding 'A'
+        crashed.writeFile("/b", std::vector<char>(512, 'B'));
+    } // Crash before the next commit
+    {
+        LLFS remounted("vdisk", 2 * 1024 * 1024);
+        remounted.mount();
+        assert(remounted.readFile("/a") == std::vector<char>(512, 'A'));
+        assert(remounted.readFile("/b").empty());
+        assert(remounted.checkConsistency(false).isConsistent());
+    }
+
+    // A disk past 32 MB fills up without handing out blocks an inode cannot address
+    {
+        LLFS large("vdisk", 48 * 1024 * 1024);
+        large.formatFileSystem();
+        std::vector<std::string> names;
+        for (int i = 0; i < 7000; ++i) {
+            names.push_back("/f" + std::to_string(i));
+        }
+        large.createFiles(names);
+        size_t written = 0;
+        try {
+            for (; written < names.size(); ++written) {
+                large.writeFile(names[written], std::vector<char>(10 * 512, 'a' + written % 26));
+            }
+            assert(false); // The disk fills first
+        } catch (const std::runtime_error&) {
+            // Expected
+        }
+        assert(written > 5000);
+        for (size_t i = 0; i < written; ++i) {
+            assert(large.readFile(names[i]) == std::vector<char>(10 * 512, 'a' + i % 26));
+        }
+        assert(large.checkConsistency(false).isConsistent());
+    }
+
     std::cout << "All LLFS tests passed!" << std::endl;
     return 0;
 }
@@ -5,6 +5,8 @@
 #include <string>
 #include <chrono>
 #include <cassert>
+#include <algorithm>
+#include <random>
 #include "../LLFS.h"
 
 void benchmarkWrite(LLFS &fileSystem, const std::string &fileName, const std::string &data, int iterations, size_t maxFileSize) {
@@ -45,6 +47,229 @@ void benchmarkRead(LLFS &fileSystem, const std::string &fileName, int iterations
               << elapsed.count() << " seconds." << std::endl;
 }
 
+// Create and delete files, committing after every operation or once per batch
+void benchmarkCommit(LLFS &fileSystem, int files, int batchSize) {
+    using namespace std::chrono;
+
+    const Journal& journal = fileSystem.getJournal();
+    size_t commitsBefore = journal.getCommits();
+    size_t blocksBefore = journal.getJournaledBlocks();
+    auto start = high_resolution_clock::now();
+
+    for (int i = 0; i < files; ++i) {
+        fileSystem.createFile("commit" + std::to_string(i));
+        if ((i + 1) % batchSize == 0) {
+            fileSystem.commit();
+        }
+    }
+    for (int i = 0; i < files; ++i) {
+        fileSystem.deleteFile("commit" + std::to_string(i));
+        if ((i + 1) % batchSize == 0) {
+            fileSystem.commit();
+        }
+    }
+    fileSystem.commit();
+
+    auto end = high_resolution_clock::now();
+    duration<double> elapsed = end - start;
+
+    std::cout << "Commit every " << batchSize << " operations: " << 2 * files << " operations in "
+              << elapsed.count() << " seconds, " << journal.getCommits() - commitsBefore << " journal writes, "
+              << journal.getJournaledBlocks() - blocksBefore << " blocks journaled." << std::endl;
+}
+
+// Rewrite small files in random order and count the write calls that reach the disk file
+void benchmarkSmallWrites(const std::string &diskName, size_t diskSize, size_t blockSize, WriteMode writeMode,
+                          int files, int passes) {
+    using namespace std::chrono;
+
+    LLFS fileSystem(diskName, diskSize, blockSize, writeMode);
+    fileSystem.formatFileSystem();
+    for (int i = 0; i < files; ++i) {
+        fileSystem.createFile("small" + std::to_string(i));
+    }
+    fileSystem.commit();
+
+    std::vector<int> order;
+    for (int pass = 0; pass < passes; ++pass) {
+        for (int i = 0; i < files; ++i) {
+            order.push_back(i);
+        }
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    std::vector<char> data(blockSize / 2, 'S');
+
+    size_t writesBefore = fileSystem.getDiskManager().getWriteCount();
+    auto start = high_resolution_clock::now();
+    for (int i : order) {
+        fileSystem.writeFile("small" + std::to_string(i), data);
+    }
+    fileSystem.commit();
+    auto end = high_resolution_clock::now();
+    duration<double> elapsed = end - start;
+
+    std::cout << (writeMode == WriteMode::LogStructured ? "LFS" : "In-place") << " mode: " << order.size()
+              << " small writes in " << elapsed.count() << " seconds, "
+              << fileSystem.getDiskManager().getWriteCount() - writesBefore << " disk writes." << std::endl;
+}
+
+// Create, stat and delete files one call at a time and then in batches
+void benchmarkBatch(const std::string &diskName, int files) {
+    using namespace std::chrono;
+
+    LLFS fileSystem(diskName, 16 * 1024 * 1024);
+    fileSystem.formatFileSystem();
+    fileSystem.createDirectory("/import");
+    std::vector<std::string> names;
+    for (int i = 0; i < files; ++i) {
+        names.push_back("/import/file" + std::to_string(i));
+    }
+
+    for (bool batched : {false, true}) {
+        auto start = high_resolution_clock::now();
+        if (batched) {
+            fileSystem.createFiles(names);
+        } else {
+            for (const auto &name : names) {
+                fileSystem.createFile(name);
+            }
+            fileSystem.commit();
+        }
+        double createSeconds = duration<double>(high_resolution_clock::now() - start).count();
+
+        start = high_resolution_clock::now();
+        size_t found = 0;
+        if (batched) {
+            for (const FileStat &stat : fileSystem.statFiles(names)) {
+                found += stat.fileType == 1;
+            }
+        } else {
+            for (const auto &name : names) {
+                found += fileSystem.statFiles({name})[0].fileType == 1;
+            }
+        }
+        double statSeconds = duration<double>(high_resolution_clock::now() - start).count();
+        assert(found == names.size());
+
+        start = high_resolution_clock::now();
+        if (batched) {
+            fileSystem.deleteFiles(names);
+        } else {
+            for (const auto &name : names) {
+                fileSystem.deleteFile(name);
+            }
+            fileSystem.commit();
+        }
+        double deleteSeconds = duration<double>(high_resolution_clock::now() - start).count();
+
+        std::cout << (batched ? "Batched: " : "One at a time: ") << files << " creates in " << createSeconds
+                  << " s, stats in " << statSeconds << " s, deletes in " << deleteSeconds << " s." << std::endl;
+    }
+}
+
+// Write and read back many tiny files, each in a block of its own or packed into shared blocks
+void benchmarkPacking(const std::string &diskName, int files, size_t fileSize, bool packing) {
+    using namespace std::chrono;
+
+    LLFS fileSystem(diskName, 16 * 1024 * 1024);
+    fileSystem.formatFileSystem();
+    fileSystem.setPacking(packing);
+    fileSystem.setLockFreeReads(false); // Packed files are always read under the locks
+    fileSystem.createDirectory("/tiny");
+    std::vector<std::string> names;
+    for (int i = 0; i < files; ++i) {
+        names.push_back("/tiny/file" + std::to_string(i));
+    }
+    fileSystem.createFiles(names);
+
+    auto start = high_resolution_clock::now();
+    for (const auto &name : names) {
+        fileSystem.writeFile(name, std::vector<char>(fileSize, 'T'));
+    }
+    fileSystem.sync();
+    double writeSeconds = duration<double>(high_resolution_clock::now() - start).count();
+
+    // Remount, so reads start from a cold cache
+    LLFS remounted(diskName, 16 * 1024 * 1024);
+    remounted.mount();
+    start = high_resolution_clock::now();
+    for (const auto &name : names) {
+        remounted.readFile(name);
+    }
+    double readSeconds = duration<double>(high_resolution_clock::now() - start).count();
+
+    PackingStats stats = remounted.getPackingStats();
+    size_t blocksUsed = packing ? stats.packBlocks : remounted.getDedupStats().physicalBlocks;
+    std::cout << (packing ? "Packed: " : "A block each: ") << files << " files of " << fileSize << " bytes in "
+              << blocksUsed << " blocks (" << 100.0 * files * fileSize / (blocksUsed * 512.0)
+              << "% of the space used), written in " << writeSeconds << " s, read in " << readSeconds << " s ("
+              << stats.cacheMisses << " pack block reads)." << std::endl;
+}
+
+// Update a data file and its index file together, committing after each write or once per pair
+// in a transaction
+void benchmarkTransactions(LLFS &fileSystem, int pairs, bool transactions) {
+    using namespace std::chrono;
+
+    fileSystem.createFile("/ingest.data");
+    fileSystem.createFile("/ingest.index");
+    std::vector<char> data(4096, 'D');
+    std::vector<char> index(512, 'I');
+    const Journal& journal = fileSystem.getJournal();
+    size_t commitsBefore = journal.getCommits();
+    auto start = high_resolution_clock::now();
+
+    for (int i = 0; i < pairs; ++i) {
+        if (transactions) {
+            fileSystem.beginTransaction();
+            fileSystem.writeFile("/ingest.data", data);
+            fileSystem.writeFile("/ingest.index", index);
+            fileSystem.commit();
+        } else {
+            fileSystem.writeFile("/ingest.data", data);
+            fileSystem.commit();
+            fileSystem.writeFile("/ingest.index", index);
+            fileSystem.commit();
+        }
+    }
+
+    duration<double> elapsed = high_resolution_clock::now() - start;
+    std::cout << (transactions ? "One transaction per pair: " : "Commit after each write: ") << pairs
+              << " pairs in " << elapsed.count() << " seconds, " << journal.getCommits() - commitsBefore
+              << " journal writes." << std::endl;
+    fileSystem.deleteFile("/ingest.data");
+    fileSystem.deleteFile("/ingest.index");
+}
+
+// Duplicate a file many times, copying it through readFile and writeFile or cloning it
+void benchmarkClone(LLFS &fileSystem, int copies, size_t fileSize, bool clone) {
+    using namespace std::chrono;
+
+    fileSystem.createFile("/original");
+    fileSystem.writeFile("/original", std::vector<char>(fileSize, 'C'));
+    size_t writesBefore = fileSystem.getDiskManager().getWriteCount();
+    auto start = high_resolution_clock::now();
+
+    std::vector<std::string> names;
+    for (int i = 0; i < copies; ++i) {
+        names.push_back("/duplicate" + std::to_string(i));
+        if (clone) {
+            fileSystem.cloneFile("/original", names.back());
+        } else {
+            fileSystem.createFile(names.back());
+            fileSystem.writeFile(names.back(), fileSystem.readFile("/original"));
+        }
+    }
+    fileSystem.commit();
+
+    duration<double> elapsed = high_resolution_clock::now() - start;
+    std::cout << (clone ? "Clone: " : "Read and write: ") << copies << " copies of " << fileSize << " bytes in "
+              << elapsed.count() << " seconds (" << elapsed.count() / copies * 1e6 << " us each), "
+              << fileSystem.getDiskManager().getWriteCount() - writesBefore << " disk writes." << std::endl;
+    fileSystem.deleteFiles(names);
+    fileSystem.deleteFile("/original");
+}
+
 void functionalTest(LLFS &fileSystem) {
     std::string testData = "Hello, LLFS!";
     fileSystem.createFile("testfile.txt");
@@ -83,6 +308,40 @@ int main() {
     std::cout << "Running read benchmark...\n";
     benchmarkRead(fileSystem, "largefile.txt", 10); // Read 10 times
 
+    // Group commit: metadata for a batch of operations goes out in one sequential journal write
+    std::cout << "Running commit benchmark...\n";
+    benchmarkCommit(fileSystem, 200, 1);
+    benchmarkCommit(fileSystem, 200, 50);
+
+    // A transaction makes a data file and its index durable together with one journal write
+    std::cout << "Running transaction benchmark...\n";
+    benchmarkTransactions(fileSystem, 500, false);
+    benchmarkTransactions(fileSystem, 500, true);
+
+    // A clone shares the blocks: only its inode and directory entry are written
+    std::cout << "Running clone benchmark...\n";
+    benchmarkClone(fileSystem, 200, maxFileSize, false);
+    benchmarkClone(fileSystem, 200, maxFileSize, true);
+
+    const InodeCache& inodeCache = fileSystem.getInodeManager().getCache();
+    std::cout << "Inode cache: " << inodeCache.getResidentCount() << " resident, "
+              << inodeCache.getHits() << " hits, " << inodeCache.getMisses() << " misses." << std::endl;
+
+
+    // LFS mode turns the random small writes into a few segment-sized sequential writes
+    std::cout << "Running small write benchmark...\n";
+    benchmarkSmallWrites(diskName, diskSize, blockSize, WriteMode::InPlace, 200, 3);
+    benchmarkSmallWrites(diskName, diskSize, blockSize, WriteMode::LogStructured, 200, 3);
+
+    // Packing puts eight 50-byte files in a block, and reads them back with one disk read
+    std::cout << "Running small file packing benchmark...\n";
+    benchmarkPacking(diskName, 2000, 50, false);
+    benchmarkPacking(diskName, 2000, 50, true);
+
+    // Batches resolve each directory once, allocate inodes in one scan and commit once
+    std::cout << "Running batch benchmark...\n";
+    benchmarkBatch(diskName, 3000);
+
     return 0;
 }
 
@@ -0,0 +1,89 @@
+#include "../Logger.h"
+#include <iostream>
+#include <cassert>
+#include <sstream>
+#include <string>
+
+#ifdef TEST_BUILD
+int evaluations = 0;
+
+int expensive() {
+    ++evaluations;
+    return 42;
+}
+
+int main() {
+    std::ostringstream output;
+    Logger::setOutput(output);
+
+    // Enabled levels are formatted into one structured line
+    Logger::setLevel(LogLevel::Info);
+    LLFS_LOG_INFO("Test", "value=", 7, " name=", std::string("abc"), " ok=", true, " size=", size_t(3));
+    assert(output.str() == "[INFO] Test: value=7 name=abc ok=true size=3\n");
+
+    // Disabled levels do not evaluate their arguments
+    output.str("");
+    LLFS_LOG_DEBUG("Test", "result=", expensive());
+    assert(evaluations == 0);
+    assert(output.str().empty());
+
+    Logger::setLevel(LogLevel::Debug);
+    LLFS_LOG_DEBUG("Test", "result=", expensive());
+    assert(evaluations == 1);
+    assert(output.str() == "[DEBUG] Test: result=42\n");
+
+    Logger::setLevel(LogLevel::Off);
+    LLFS_LOG_ERROR("Test", "suppressed");
+    assert(output.str() == "[DEBUG] Test: result=42\n");
+
+    // Long messages are truncated rather than overflowing the record
+    Logger::setLevel(LogLevel::Info);
+    output.str("");
+    LLFS_LOG_INFO("Test", std::string(1000, 'x'));
+    assert(output.str().size() == std::string("[INFO] Test: \n").size() + Logger::MAX_MESSAGE);
+
+    // Level names
+    assert(Logger::parseLevel("warn") == LogLevel::Warn);
+    try {
+        Logger::parseLevel("loud");
+        assert(false); // Should not reach here
+    } catch (const std::invalid_argument&) {
+        // Expected
+    }
+
+    // Async mode keeps order and writes everything once flushed
+    output.str("");
+    Logger::startAsync(1024);
+    for (int i = 0; i < 500; ++i) {
+        LLFS_LOG_INFO("Async", i);
+    }
+    Logger::flush();
+    std::istringstream lines(output.str());
+    std::string line;
+    int expected = 0;
+    while (std::getline(lines, line)) {
+        assert(line == "[INFO] Async: " + std::to_string(expected));
+        ++expected;
+    }
+    assert(expected == 500);
+
+    // A full ring drops records instead of blocking; nothing is lost without being counted
+    Logger::stopAsync();
+    output.str("");
+    Logger::startAsync(1);
+    size_t droppedBefore = Logger::getDroppedCount();
+    for (int i = 0; i < 10000; ++i) {
+        LLFS_LOG_INFO("Async", i);
+    }
+    Logger::stopAsync();
+    size_t written = 0;
+    for (char c : output.str()) {
+        written += c == '\n';
+    }
+    assert(written + (Logger::getDroppedCount() - droppedBefore) == 10000);
+
+    Logger::setOutput(std::cout);
+    std::cout << "All Logger tests passed!" << std::endl;
+    return 0;
+}
+#endif
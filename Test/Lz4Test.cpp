@@ -0,0 +1,206 @@
+#include "../Lz4.h"
+#include "../ClusterCache.h"
+#include "../LLFS.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <random>
+#include <string>
+
+#ifdef TEST_BUILD
+// Log-like text that compresses well
+static std::vector<char> logText(size_t size) {
+    std::string text;
+    for (size_t i = 0; text.size() < size; ++i) {
+        text += "2026-10-19 12:00:" + std::to_string(i % 60) + " INFO request=" + std::to_string(i * 7919 % 100000) +
+                " path=/api/items status=200 latency_ms=" + std::to_string(i % 300) + "\n";
+    }
+    return std::vector<char>(text.begin(), text.begin() + size);
+}
+
+// Bytes that do not compress
+static std::vector<char> randomBytes(size_t size, unsigned seed) {
+    std::mt19937 random(seed);
+    std::vector<char> data(size);
+    for (char& c : data) c = static_cast<char>(random());
+    return data;
+}
+
+// Round trip through the codec
+static bool roundTrips(const std::vector<char>& data) {
+    std::vector<char> compressed = Lz4::compress(data.data(), data.size());
+    assert(compressed.size() <= Lz4::maxCompressedSize(data.size()));
+    std::vector<char> output(data.size() + 16);
+    size_t produced = Lz4::decompress(compressed.data(), compressed.size(), output.data(), output.size());
+    return produced == data.size() && std::equal(data.begin(), data.end(), output.begin());
+}
+
+int main() {
+    const size_t diskSize = 2 * 1024 * 1024; // 2 MB disk, 512-byte blocks
+    const size_t blockSize = 512;
+
+    // Codec: round trips of every kind of input, and a worthwhile ratio on log text
+    {
+        assert(roundTrips({}));
+        assert(roundTrips({'x'}));
+        assert(roundTrips(std::vector<char>(13, 'a')));
+        assert(roundTrips(std::vector<char>(100000, 0)));
+        assert(roundTrips(randomBytes(70000, 1)));
+        for (size_t size = 0; size < 300; ++size) {
+            assert(roundTrips(logText(size)));
+            assert(roundTrips(randomBytes(size, static_cast<unsigned>(size))));
+        }
+        std::vector<char> text = logText(LLFS::CLUSTER_SIZE);
+        assert(roundTrips(text));
+        assert(Lz4::compress(text.data(), text.size()).size() * 4 < text.size());
+
+        // A literal run of 15 + 255 + 255 bytes and a long match use length continuations
+        std::vector<char> runs = randomBytes(525, 2);
+        runs.insert(runs.end(), 2000, 'r');
+        assert(roundTrips(runs));
+    }
+
+    // Codec: damaged input throws instead of overrunning either buffer
+    {
+        std::vector<char> text = logText(4096);
+        std::vector<char> compressed = Lz4::compress(text.data(), text.size());
+        std::vector<char> output(text.size());
+        // A cut right after literals is well-formed, but comes up short
+        for (size_t cut = 0; cut < compressed.size(); ++cut) {
+            try {
+                assert(Lz4::decompress(compressed.data(), cut, output.data(), output.size()) < text.size());
+            } catch (const std::runtime_error&) {
+            }
+        }
+
+        bool threw = false;
+        try {
+            Lz4::decompress(compressed.data(), compressed.size(), output.data(), output.size() - 1);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+
+        std::vector<char> badOffset = {0x04, 'a', 'b', 'c', 'd', 0x10, 0x00, 0x00}; // Offset 16 > 4 bytes written
+        threw = false;
+        try {
+            Lz4::decompress(badOffset.data(), badOffset.size(), output.data(), output.size());
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    // Cluster cache: LRU eviction and per-inode invalidation
+    {
+        ClusterCache cache(3);
+        cache.insert(1, 0, {'a'});
+        cache.insert(1, 1, {'b'});
+        cache.insert(2, 0, {'c'});
+        assert(cache.lookup(1, 0) && (*cache.lookup(1, 0))[0] == 'a'); // Now most recently used
+        cache.insert(3, 0, {'d'});                                     // Evicts (1, 1)
+        assert(!cache.lookup(1, 1));
+        assert(cache.getSize() == 3);
+        cache.invalidate(1);
+        assert(!cache.lookup(1, 0) && cache.lookup(2, 0) && cache.lookup(3, 0));
+        assert(cache.getSize() == 2);
+        cache.clear();
+        assert(cache.getSize() == 0);
+    }
+
+    // Compressed files: several clusters, a raw cluster, a short last cluster
+    std::vector<char> text = logText(3 * LLFS::CLUSTER_SIZE + 1000);
+    std::vector<char> noise = randomBytes(LLFS::CLUSTER_SIZE + 10, 3);
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.setCompression(true);
+        fs.createFile("/log");
+        fs.writeFile("/log", text);
+        fs.createFile("/noise");
+        fs.writeFile("/noise", noise);
+        fs.createFile("/empty");
+        fs.writeFile("/empty", {});
+
+        CompressionStats stats = fs.getCompressionStats();
+        assert(stats.clustersCompressed == 4);
+        assert(stats.clustersStoredRaw == 2);
+        assert(stats.bytesWritten == text.size() + noise.size());
+        assert(stats.bytesStored < text.size() / 4 + noise.size() + 2 * blockSize);
+
+        assert(fs.readFile("/log") == text);
+        size_t misses = fs.getClusterCache().getMisses();
+        assert(fs.readFile("/log") == text); // Served from the cluster cache
+        assert(fs.getClusterCache().getMisses() == misses);
+        assert(fs.getClusterCache().getHits() >= 4);
+        assert(fs.readFile("/noise") == noise);
+        assert(fs.readFile("/empty").empty());
+
+        // Uncompressed files still work next to compressed ones
+        fs.setCompression(false);
+        fs.createFile("/plain");
+        fs.writeFile("/plain", std::vector<char>(1000, 'p'));
+        assert(fs.readFile("/plain") == std::vector<char>(1000, 'p'));
+        fs.sync();
+    }
+
+    // Contents survive a remount; rewrites and deletes free the old clusters
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.mount();
+        assert(fs.readFile("/log") == text);
+        assert(fs.readFile("/noise") == noise);
+        assert(fs.getInodeManager().getInode(fs.getDirectoryManager().resolvePath("/log")).flags &
+               INODE_FLAG_COMPRESSED);
+
+        fs.setCompression(true);
+        std::vector<char> shorter = logText(5000);
+        fs.writeFile("/log", shorter);
+        assert(fs.readFile("/log") == shorter);
+        fs.setCompression(false);
+        fs.writeFile("/noise", std::vector<char>(100, 'n')); // Back to plain blocks
+        assert(fs.readFile("/noise") == std::vector<char>(100, 'n'));
+        assert(!(fs.getInodeManager().getInode(fs.getDirectoryManager().resolvePath("/noise")).flags &
+                 INODE_FLAG_COMPRESSED));
+        fs.deleteFile("/log");
+        assert(fs.checkConsistency(false).isConsistent()); // No leaked or shared blocks
+
+        // A plain rewrite too large for the direct blocks leaves the compressed file as it was
+        fs.setCompression(true);
+        fs.createFile("/big");
+        fs.writeFile("/big", text);
+        fs.setCompression(false);
+        try {
+            fs.writeFile("/big", std::vector<char>(6000, 'b'));
+            assert(false); // Should not reach here
+        } catch (const std::runtime_error&) {
+            // Expected
+        }
+        fs.setCompression(true);
+        fs.createFile("/other");
+        fs.writeFile("/other", noise); // Would take any blocks the failed write let go
+        assert(fs.readFile("/big") == text);
+        assert(fs.checkConsistency(false).isConsistent());
+        fs.deleteFiles({"/big", "/other"});
+        assert(fs.checkConsistency(false).isConsistent());
+    }
+
+    // LFS mode stores compressed clusters the same way
+    {
+        LLFS fs("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        fs.formatFileSystem();
+        fs.setCompression(true);
+        fs.createFile("/log");
+        fs.writeFile("/log", text);
+        fs.sync();
+    }
+    {
+        LLFS fs("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        fs.mount();
+        assert(fs.readFile("/log") == text);
+    }
+
+    std::cout << "All Lz4 tests passed!" << std::endl;
+    return 0;
+}
+#endif
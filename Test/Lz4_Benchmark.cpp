@@ -0,0 +1,84 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../Lz4.h"
+#include "../LLFS.h"
+
+// Log-like text that compresses well
+static std::vector<char> logText(size_t size) {
+    std::string text;
+    for (size_t i = 0; text.size() < size; ++i) {
+        text += "2026-10-19 12:00:" + std::to_string(i % 60) + " INFO request=" + std::to_string(i * 7919 % 100000) +
+                " path=/api/items status=200 latency_ms=" + std::to_string(i % 300) + "\n";
+    }
+    return std::vector<char>(text.begin(), text.begin() + size);
+}
+
+// Seconds since start
+static double since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main() {
+    const size_t diskSize = 32 * 1024 * 1024;
+    const size_t fileSize = 1024 * 1024;
+    const int files = 4;
+    std::vector<char> text = logText(fileSize);
+
+    std::cout << "Running LZ4 codec benchmark (1 MB of log text)..." << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<char> compressed;
+    for (int i = 0; i < 20; ++i) {
+        compressed = Lz4::compress(text.data(), text.size());
+    }
+    double compressSeconds = since(start);
+    std::vector<char> output(text.size());
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 20; ++i) {
+        Lz4::decompress(compressed.data(), compressed.size(), output.data(), output.size());
+    }
+    double decompressSeconds = since(start);
+    std::cout << "Ratio " << double(text.size()) / compressed.size() << ", compress "
+              << 20 * text.size() / compressSeconds / 1e6 << " MB/s, decompress "
+              << 20 * text.size() / decompressSeconds / 1e6 << " MB/s" << std::endl;
+
+    std::cout << "Running compressed file benchmark (" << files << " files of 1 MB)..." << std::endl;
+    {
+        LLFS fs("vdisk_bench", diskSize);
+        fs.formatFileSystem();
+        fs.setCompression(true);
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < files; ++i) {
+            std::string name = "/log" + std::to_string(i);
+            fs.createFile(name);
+            fs.writeFile(name, text);
+        }
+        fs.sync();
+        double writeSeconds = since(start);
+        CompressionStats stats = fs.getCompressionStats();
+        std::cout << "Written in " << writeSeconds << " seconds: " << stats.bytesWritten / 512 << " blocks of data in "
+                  << stats.bytesStored / 512 << " blocks (" << double(stats.bytesWritten) / stats.bytesStored
+                  << "x)" << std::endl;
+    }
+
+    LLFS fs("vdisk_bench", diskSize);
+    fs.mount();
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < files; ++i) {
+        fs.readFile("/log" + std::to_string(i));
+    }
+    double coldSeconds = since(start);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < files; ++i) {
+        fs.readFile("/log" + std::to_string(i));
+    }
+    double warmSeconds = since(start);
+    std::cout << "Read from disk in " << coldSeconds << " seconds, from the cluster cache in " << warmSeconds
+              << " seconds (" << fs.getClusterCache().getHits() << " cluster hits)" << std::endl;
+    return 0;
+}
+
+#endif // BENCHMARK_TEST
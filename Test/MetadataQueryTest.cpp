@@ -0,0 +1,87 @@
+#include "../InodeManager.h"
+#include "../MetadataQuery.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+
+#ifdef TEST_BUILD
+// Reference answer: check every inode one at a time
+std::vector<uint32_t> scanSlowly(InodeManager& im, const InodeQuery& query) {
+    std::vector<uint32_t> matches;
+    for (size_t i = 0; i < im.getTotalInodes(); ++i) {
+        if (!im.isAllocated(i)) continue;
+        Inode inode = im.getInode(i);
+        if ((query.fileType == 0 || inode.fileType == query.fileType) &&
+            inode.fileSize >= query.minSize && inode.fileSize <= query.maxSize &&
+            inode.modificationTime >= query.modifiedAfter && inode.modificationTime <= query.modifiedBefore) {
+            matches.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    return matches;
+}
+
+int main() {
+    // Enough inodes for several parallel chunks plus a partial SIMD group at the end
+    const size_t totalInodes = 3 * MetadataQuery::CHUNK_SIZE + 7;
+    InodeManager im(totalInodes);
+
+    std::vector<uint8_t> table(totalInodes * sizeof(Inode), 0);
+    for (size_t i = 0; i < totalInodes; ++i) {
+        Inode inode = {};
+        inode.fileType = static_cast<uint8_t>(i % 3);          // Every third inode is unused
+        inode.fileSize = static_cast<uint32_t>((i * 7919) % 5000000);
+        inode.modificationTime = static_cast<uint32_t>(1000 + (i * 104729) % 100000);
+        std::memcpy(table.data() + i * sizeof(Inode), &inode, sizeof(Inode));
+    }
+    im.loadInodeTable(table);
+
+    MetadataQuery parallel(im.getColumns(), 4);
+    MetadataQuery serial(im.getColumns(), 1);
+
+    // Files over 1 MB
+    InodeQuery large;
+    large.fileType = 1;
+    large.minSize = 1024 * 1024;
+    auto expected = scanSlowly(im, large);
+    assert(!expected.empty());
+    assert(parallel.find(large) == expected);
+    assert(serial.find(large) == expected);
+
+    // Everything allocated, with sizes and times near the unsigned limits
+    InodeQuery all;
+    assert(parallel.find(all) == scanSlowly(im, all));
+
+    InodeQuery window;
+    window.minSize = 100;
+    window.maxSize = 200000;
+    window.modifiedAfter = 50000;
+    window.modifiedBefore = 60000;
+    assert(parallel.find(window) == scanSlowly(im, window));
+
+    // Updates are reflected in the columns and the time index
+    Inode changed = im.getInode(1);
+    changed.fileSize = 4000000000u;
+    changed.modificationTime = 2000000;
+    im.updateInode(1, changed);
+    im.freeInode(2);
+
+    auto recent = parallel.modifiedSince(2000000);
+    assert(recent.size() == 1 && recent[0] == 1);
+
+    InodeQuery huge;
+    huge.minSize = 3000000000u;
+    assert(parallel.find(huge) == std::vector<uint32_t>{1});
+
+    // The time index lists results oldest first and skips freed inodes
+    auto since = parallel.modifiedSince(100000);
+    InodeQuery sinceQuery;
+    sinceQuery.modifiedAfter = 100000;
+    assert(since.size() == parallel.find(sinceQuery).size());
+    for (size_t i = 1; i < since.size(); ++i) {
+        assert(im.getInode(since[i - 1]).modificationTime <= im.getInode(since[i]).modificationTime);
+    }
+
+    std::cout << "All MetadataQuery tests passed!" << std::endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,77 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cassert>
+#include <cstring>
+#include "../InodeManager.h"
+#include "../MetadataQuery.h"
+
+// Fill an in-memory inode table with a mix of files, directories and unused inodes
+void fillInodeTable(InodeManager& inodeManager) {
+    size_t totalInodes = inodeManager.getTotalInodes();
+    std::vector<uint8_t> table(totalInodes * sizeof(Inode), 0);
+    for (size_t i = 0; i < totalInodes; ++i) {
+        Inode inode = {};
+        inode.fileType = static_cast<uint8_t>(i % 10 == 0 ? 0 : (i % 10 == 1 ? 2 : 1));
+        inode.fileSize = static_cast<uint32_t>((i * 2654435761u) % (4 * 1024 * 1024));
+        inode.modificationTime = static_cast<uint32_t>(1700000000 + (i * 40503u) % 86400);
+        std::memcpy(table.data() + i * sizeof(Inode), &inode, sizeof(Inode));
+    }
+    inodeManager.loadInodeTable(table);
+}
+
+int main() {
+    using namespace std::chrono;
+    const size_t totalInodes = 1 << 20; // 1M inodes
+
+    InodeManager inodeManager(totalInodes);
+    fillInodeTable(inodeManager);
+
+    InodeQuery large;
+    large.fileType = 1;
+    large.minSize = 1024 * 1024; // Files over 1 MB
+
+    // Baseline: copy every inode through the inode manager
+    auto start = high_resolution_clock::now();
+    size_t baselineMatches = 0;
+    for (size_t i = 0; i < totalInodes; ++i) {
+        if (!inodeManager.isAllocated(i)) continue;
+        Inode inode = inodeManager.getInode(i);
+        if (inode.fileType == 1 && inode.fileSize >= large.minSize) ++baselineMatches;
+    }
+    duration<double> elapsed = high_resolution_clock::now() - start;
+    std::cout << "Per-inode scan: " << baselineMatches << " matches in " << elapsed.count() << " seconds." << std::endl;
+
+    for (size_t threads : {size_t(1), size_t(0)}) {
+        MetadataQuery query(inodeManager.getColumns(), threads);
+        start = high_resolution_clock::now();
+        std::vector<uint32_t> matches = query.find(large);
+        elapsed = high_resolution_clock::now() - start;
+        assert(matches.size() == baselineMatches);
+        std::cout << "Column scan (" << (threads == 0 ? "all cores" : "1 thread") << "): " << matches.size()
+                  << " matches in " << elapsed.count() << " seconds." << std::endl;
+    }
+
+    // "Changed in the last minute": the time index only visits the results
+    MetadataQuery query(inodeManager.getColumns());
+    uint32_t since = 1700000000 + 86400 - 60;
+    start = high_resolution_clock::now();
+    std::vector<uint32_t> recent = query.modifiedSince(since);
+    elapsed = high_resolution_clock::now() - start;
+    std::cout << "Time index: " << recent.size() << " inodes changed since the cutoff in "
+              << elapsed.count() << " seconds." << std::endl;
+
+    InodeQuery recentQuery;
+    recentQuery.modifiedAfter = since;
+    start = high_resolution_clock::now();
+    size_t scanned = query.find(recentQuery).size();
+    elapsed = high_resolution_clock::now() - start;
+    assert(scanned == recent.size());
+    std::cout << "Column scan for the same question: " << elapsed.count() << " seconds." << std::endl;
+
+    return 0;
+}
+
+#endif // BENCHMARK_TEST
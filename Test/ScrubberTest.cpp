@@ -0,0 +1,164 @@
+#include "../DiskManager.h"
+#include "../FreeBlockManager.h"
+#include "../InodeManager.h"
+#include "../LLFS.h"
+#include "../Scrubber.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifdef TEST_BUILD
+// Wait until the scrubber has finished a pass (false on timeout)
+static bool waitForPass(LLFS& fs, uint64_t passes) {
+    for (int i = 0; i < 500; ++i) {
+        if (fs.getScrubStats().passesCompleted > passes) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+int main() {
+    const size_t diskSize = 2 * 1024 * 1024; // 2 MB disk, 512-byte blocks
+    const size_t blockSize = 512;
+
+    // Scrubbing step by step: bitmap disagreements and bad pointers are found
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        diskManager.formatDisk();
+        Superblock layout = diskManager.loadSuperblock();
+        InodeManager inodeManager(diskManager, layout.numberOfInodes, layout.inodeTableStart);
+        inodeManager.scanInodeTable();
+        FreeBlockManager freeBlockManager(layout.volumeBlocks, layout.dataStart);
+
+        Inode file = {};
+        file.fileType = 1;
+        file.directBlocks[0] = static_cast<uint16_t>(freeBlockManager.allocateBlock());
+        file.directBlocks[1] = static_cast<uint16_t>(freeBlockManager.allocateBlock());
+        inodeManager.updateInode(inodeManager.allocateInode(), file); // Inode 1
+
+        Inode unmarked = {};
+        unmarked.fileType = 1;
+        unmarked.directBlocks[0] = static_cast<uint16_t>(layout.dataStart + 100); // Free in the bitmap
+        inodeManager.updateInode(inodeManager.allocateInode(), unmarked);
+
+        Inode invalid = {};
+        invalid.fileType = 1;
+        invalid.directBlocks[0] = 1; // The free block vector
+        inodeManager.updateInode(inodeManager.allocateInode(), invalid);
+
+        Inode indirect = {};
+        indirect.fileType = 1;
+        indirect.singleIndirect = static_cast<uint16_t>(freeBlockManager.allocateBlock());
+        std::vector<char> pointers(blockSize, 0);
+        for (size_t i = 0; i < 2; ++i) {
+            uint16_t pointer = static_cast<uint16_t>(freeBlockManager.allocateBlock());
+            std::memcpy(pointers.data() + i * sizeof(pointer), &pointer, sizeof(pointer));
+        }
+        diskManager.writeBlock(indirect.singleIndirect, pointers);
+        inodeManager.updateInode(inodeManager.allocateInode(), indirect);
+
+        std::shared_mutex lock;
+        {
+            Scrubber scrubber(diskManager, inodeManager, freeBlockManager, nullptr, layout, lock);
+            assert(scrubber.getStats().cursor == 0);
+            assert(scrubber.scrubNext(1) == 2); // The root has no blocks; inode 1 has two
+            assert(scrubber.getStats().cursor == 2);
+            assert(scrubber.getStats().inodesScrubbed == 2);
+            scrubber.saveCursor();
+        }
+
+        // A new scrubber resumes at the saved cursor
+        Scrubber scrubber(diskManager, inodeManager, freeBlockManager, nullptr, layout, lock);
+        assert(scrubber.getStats().cursor == 2);
+        scrubber.scrubNext(SIZE_MAX);
+        ScrubStats stats = scrubber.getStats();
+        assert(stats.passesCompleted == 1);
+        assert(stats.inodesScrubbed == 3 + 2); // The rest, then the root and inode 1 again
+        assert(stats.bitmapErrors == 1);
+        assert(stats.invalidPointers == 1);
+        assert(stats.checksumErrors == 0 && stats.readErrors == 0);
+        assert(stats.blocksScrubbed == 1 + 3 + 2);
+        assert(!stats.running);
+    }
+
+    // In the background, next to regular operations, within the I/O budget
+    {
+        LLFS fs("vdisk", diskSize);
+        fs.formatFileSystem();
+        for (int i = 0; i < 20; ++i) {
+            std::string name = "/file" + std::to_string(i);
+            fs.createFile(name);
+            fs.writeFile(name, std::vector<char>(1000, 'x'));
+        }
+        assert(fs.getScrubStats().passesCompleted == 0);
+
+        fs.startScrubber(20);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        ScrubStats stats = fs.getScrubStats();
+        assert(stats.running);
+        assert(stats.blocksScrubbed > 0 && stats.blocksScrubbed <= 20);
+
+        fs.startScrubber(100000);
+        for (int i = 20; i < 40; ++i) {
+            std::string name = "/file" + std::to_string(i);
+            fs.createFile(name);
+            fs.writeFile(name, std::vector<char>(1000, 'y'));
+        }
+        assert(waitForPass(fs, 0));
+        fs.stopScrubber();
+        stats = fs.getScrubStats();
+        assert(!stats.running);
+        assert(stats.bitmapErrors == 0 && stats.invalidPointers == 0 && stats.checksumErrors == 0);
+        fs.sync();
+    }
+    {
+        LLFS fs("vdisk", diskSize);
+        fs.mount();
+        fs.startScrubber(1);
+        assert(fs.getScrubStats().passesCompleted >= 1); // Persisted with the cursor
+        fs.stopScrubber();
+    }
+
+    // LFS mode: a damaged segment fails its summary checksum
+    uint32_t physicalBlock;
+    {
+        LLFS fs("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        fs.formatFileSystem();
+        for (int i = 0; i < 100; ++i) {
+            std::string name = "/file" + std::to_string(i);
+            fs.createFile(name);
+            fs.writeFile(name, std::vector<char>(1000, 'l'));
+        }
+        fs.sync();
+        Inode inode = fs.getInodeManager().getInode(fs.getDirectoryManager().resolvePath("/file0"));
+        physicalBlock = fs.getSegmentManager().locateBlock(inode.directBlocks[0]);
+
+        fs.startScrubber(100000);
+        assert(waitForPass(fs, 0));
+        fs.stopScrubber();
+        assert(fs.getScrubStats().checksumErrors == 0);
+        assert(fs.getScrubStats().bitmapErrors == 0);
+    }
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        diskManager.writeBlocks(physicalBlock, std::vector<char>(blockSize, 'Z'));
+    }
+    {
+        LLFS fs("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        fs.mount();
+        uint64_t passes = fs.getScrubStats().passesCompleted;
+        fs.startScrubber(100000);
+        assert(waitForPass(fs, fs.getScrubStats().passesCompleted));
+        fs.stopScrubber();
+        assert(fs.getScrubStats().passesCompleted > passes);
+        assert(fs.getScrubStats().checksumErrors >= 1);
+    }
+
+    std::cout << "All Scrubber tests passed!" << std::endl;
+    return 0;
+}
+#endif
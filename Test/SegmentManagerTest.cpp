@@ -0,0 +1,328 @@
+#include "../DiskManager.h"
+#include "../InodeManager.h"
+#include "../SegmentManager.h"
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <random>
+
+#ifdef TEST_BUILD
+// Block filled with one byte value
+static std::vector<char> filled(size_t blockSize, char value) {
+    return std::vector<char>(blockSize, value);
+}
+
+int main() {
+    const size_t diskSize = 2 * 1024 * 1024; // 2 MB disk, 512-byte blocks
+    const size_t blockSize = 512;
+    Superblock layout;
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        diskManager.formatDisk();
+        layout = diskManager.loadSuperblock();
+    }
+    assert(layout.writeMode == static_cast<uint32_t>(WriteMode::LogStructured));
+    assert(layout.journalBlocks == 0);
+    assert(layout.volumeBlocks < layout.totalBlocks);
+    assert(layout.segmentStart == layout.checkpointStart + layout.checkpointBlocks);
+    assert(layout.segmentStart + layout.segmentCount * layout.segmentBlocks <= layout.totalBlocks);
+
+    // An LFS disk cannot be opened in place
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize);
+        bool threw = false;
+        try {
+            diskManager.loadSuperblock();
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    std::vector<std::pair<size_t, char>> written;
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        SegmentManager segments(diskManager, layout);
+        segments.recover();
+        diskManager.setSegmentManager(&segments);
+
+        // Formatting wrote the root inode through the log
+        std::vector<char> inodeBlock = diskManager.readBlock(layout.inodeTableStart);
+        Inode root;
+        std::memcpy(&root, inodeBlock.data(), sizeof(root));
+        assert(root.fileType == 2);
+        assert(segments.locateInode(0) != 0);
+        assert(segments.locateInode(0) == segments.locateBlock(layout.inodeTableStart));
+
+        // Never-written blocks read as zeros
+        assert(diskManager.readBlock(layout.dataStart) == filled(blockSize, 0));
+
+        // Small random writes become a few large sequential ones
+        std::mt19937 random(7);
+        size_t writesBefore = diskManager.getWriteCount();
+        for (int i = 0; i < 300; ++i) {
+            size_t blockNumber = layout.dataStart + random() % (layout.volumeBlocks - layout.dataStart);
+            char value = static_cast<char>(1 + i % 120);
+            diskManager.writeBlock(blockNumber, filled(blockSize, value));
+            written.emplace_back(blockNumber, value);
+        }
+        size_t fullSegments = 300 / segments.getSlotsPerSegment();
+        assert(segments.getSegmentWrites() >= fullSegments);
+        assert(diskManager.getWriteCount() - writesBefore <= fullSegments + 1);
+
+        // Reads see the newest copy, whether it is still in memory or already on disk
+        for (auto it = written.rbegin(); it != written.rend(); ++it) {
+            bool newest = std::none_of(written.rbegin(), it, [&](const auto& later) { return later.first == it->first; });
+            if (newest) {
+                assert(diskManager.readBlock(it->first) == filled(blockSize, it->second));
+            }
+        }
+
+        // Every block written is live exactly once
+        size_t live = 0;
+        for (size_t segment = 0; segment < segments.getSegmentCount(); ++segment) {
+            live += segments.getLiveBlocks(segment);
+        }
+        size_t distinct = 0;
+        for (size_t blockNumber = 1; blockNumber < layout.volumeBlocks; ++blockNumber) {
+            distinct += segments.locateBlock(blockNumber) != 0;
+        }
+        assert(live == distinct + 1); // Plus the map block written by the format checkpoint
+
+        segments.checkpoint();
+        assert(segments.getCheckpoints() == 1);
+
+        // Lost in the crash: not checkpointed
+        diskManager.writeBlock(layout.dataStart, filled(blockSize, 'X'));
+        segments.flush();
+    }
+
+    // Mounting loads the last checkpoint
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        SegmentManager segments(diskManager, layout);
+        segments.recover();
+        diskManager.setSegmentManager(&segments);
+        for (auto it = written.rbegin(); it != written.rend(); ++it) {
+            bool newest = std::none_of(written.rbegin(), it, [&](const auto& later) { return later.first == it->first; });
+            if (newest) {
+                assert(diskManager.readBlock(it->first) == filled(blockSize, it->second));
+            }
+        }
+        bool dataStartWritten = std::any_of(written.begin(), written.end(),
+                                            [&](const auto& entry) { return entry.first == layout.dataStart; });
+        assert(dataStartWritten || diskManager.readBlock(layout.dataStart) == filled(blockSize, 0));
+
+        // Overwriting the same blocks over and over reuses segments whose blocks all died
+        size_t capacity = segments.getSegmentCount() * segments.getSlotsPerSegment();
+        for (size_t i = 0; i < 2 * capacity; ++i) {
+            diskManager.writeBlock(layout.dataStart + i % 8, filled(blockSize, static_cast<char>(i)));
+        }
+        for (size_t i = 2 * capacity - 8; i < 2 * capacity; ++i) {
+            assert(diskManager.readBlock(layout.dataStart + i % 8) == filled(blockSize, static_cast<char>(i)));
+        }
+        assert(segments.getCleanSegments() > 0);
+    }
+
+    // Cleaning: cold blocks written once, hot blocks overwritten at random
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        diskManager.formatDisk();
+    }
+    std::vector<char> expected(layout.volumeBlocks, 0);
+    const size_t coldBlocks = 1600, hotBlocks = 600;
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        SegmentManager segments(diskManager, layout);
+        segments.recover();
+        diskManager.setSegmentManager(&segments);
+
+        std::mt19937 random(11);
+        auto write = [&](size_t blockNumber) {
+            char value = static_cast<char>(1 + random() % 120);
+            diskManager.writeBlock(blockNumber, filled(blockSize, value));
+            expected[blockNumber] = value;
+            if (segments.needsCheckpoint()) {
+                segments.checkpoint();
+            }
+        };
+        std::vector<size_t> order(coldBlocks + hotBlocks);
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = layout.dataStart + i;
+        }
+        std::shuffle(order.begin(), order.end(), random);
+        for (size_t blockNumber : order) {
+            write(blockNumber);
+        }
+        size_t capacity = segments.getSegmentCount() * segments.getSlotsPerSegment();
+        for (size_t i = 0; i < 2 * capacity; ++i) {
+            write(layout.dataStart + coldBlocks + random() % hotBlocks);
+        }
+        assert(segments.getSegmentsCleaned() > 0);
+        assert(segments.getUserBlocksWritten() == coldBlocks + hotBlocks + 2 * capacity);
+        assert(segments.getBlocksWritten() > segments.getUserBlocksWritten());
+        assert(segments.getWriteAmplification() > 1.0);
+        assert(segments.getCleaningCost() >= 2.0); // Reading the victim costs as much as the space it frees
+        assert(segments.getCleaningSeconds() >= 0);
+
+        // Cleaning moved blocks without changing them
+        for (size_t i = 0; i < coldBlocks + hotBlocks; ++i) {
+            size_t blockNumber = layout.dataStart + i;
+            assert(diskManager.readBlock(blockNumber) == filled(blockSize, expected[blockNumber]));
+        }
+
+        // The usage table agrees with the address map
+        size_t live = 0;
+        for (size_t segment = 0; segment < segments.getSegmentCount(); ++segment) {
+            SegmentManager::SegmentUsage usage = segments.getUsage(segment);
+            assert(usage.liveBlocks == segments.getLiveBlocks(segment));
+            assert(!usage.clean || usage.liveBlocks == 0);
+            live += usage.liveBlocks;
+        }
+        size_t mapped = 0;
+        for (size_t blockNumber = 1; blockNumber < layout.volumeBlocks; ++blockNumber) {
+            mapped += segments.locateBlock(blockNumber) != 0;
+        }
+        assert(live >= mapped && live - mapped <= (layout.volumeBlocks + blockSize / 4 - 1) / (blockSize / 4));
+
+        // Discarding a block makes its copy dead
+        size_t segment = (segments.locateBlock(layout.dataStart) - layout.segmentStart) / layout.segmentBlocks;
+        size_t before = segments.getLiveBlocks(segment);
+        segments.discardBlock(layout.dataStart);
+        expected[layout.dataStart] = 0;
+        assert(segments.getLiveBlocks(segment) == before - 1);
+        assert(segments.locateBlock(layout.dataStart) == 0);
+        assert(diskManager.readBlock(layout.dataStart) == filled(blockSize, 0));
+
+        // The background cleaner keeps segments clean while the writer only checkpoints
+        size_t cleanedBefore = segments.getSegmentsCleaned();
+        segments.startCleaner();
+        for (size_t i = 0; i < capacity; ++i) {
+            write(layout.dataStart + coldBlocks + random() % hotBlocks);
+        }
+        segments.stopCleaner();
+        segments.stopCleaner(); // Stopping twice is harmless
+        assert(segments.getSegmentsCleaned() > cleanedBefore);
+        segments.checkpoint();
+    }
+
+    // Moved blocks survive a remount
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        SegmentManager segments(diskManager, layout);
+        segments.recover();
+        diskManager.setSegmentManager(&segments);
+        for (size_t i = 0; i < coldBlocks + hotBlocks; ++i) {
+            size_t blockNumber = layout.dataStart + i;
+            assert(diskManager.readBlock(blockNumber) == filled(blockSize, expected[blockNumber]));
+        }
+        assert(segments.getCleanSegments() > 0);
+    }
+
+    // Roll-forward: commits without a checkpoint survive a remount, later writes do not
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        diskManager.formatDisk();
+    }
+    std::vector<char> committed(layout.volumeBlocks, 0);
+    const size_t rollBlocks = 400; // Several segments
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        SegmentManager segments(diskManager, layout);
+        assert(segments.recover() == 0);
+        diskManager.setSegmentManager(&segments);
+        assert(segments.getCheckpointInterval() >= 2);
+        for (size_t i = 0; i < rollBlocks; ++i) {
+            char value = static_cast<char>(1 + i % 100);
+            diskManager.writeBlock(layout.dataStart + i, filled(blockSize, value));
+            committed[layout.dataStart + i] = value;
+        }
+        segments.discardBlock(layout.dataStart);
+        committed[layout.dataStart] = 0;
+        segments.commit();
+        assert(segments.getCommits() == 1);
+        assert(segments.getCheckpoints() == 0);
+
+        diskManager.writeBlock(layout.dataStart + 1, filled(blockSize, 'U'));
+        diskManager.writeBlock(layout.dataStart + rollBlocks, filled(blockSize, 'U'));
+        segments.flush();
+    }
+    const size_t chainBlocks = 50;
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        SegmentManager segments(diskManager, layout);
+        assert(segments.recover() >= rollBlocks);
+        diskManager.setSegmentManager(&segments);
+        for (size_t i = 0; i <= rollBlocks; ++i) {
+            size_t blockNumber = layout.dataStart + i;
+            assert(diskManager.readBlock(blockNumber) == filled(blockSize, committed[blockNumber]));
+        }
+        assert(segments.locateBlock(layout.dataStart) == 0);
+
+        // The interval forces a checkpoint after that many segments
+        segments.setCheckpointInterval(2);
+        assert(!segments.needsCheckpoint());
+        for (size_t i = 0; i < chainBlocks; ++i) {
+            size_t blockNumber = layout.dataStart + rollBlocks + i;
+            diskManager.writeBlock(blockNumber, filled(blockSize, 'A'));
+            committed[blockNumber] = 'A';
+        }
+        segments.commit();
+        for (size_t i = 0; i < 2 * segments.getSlotsPerSegment(); ++i) {
+            size_t blockNumber = layout.dataStart + rollBlocks + chainBlocks + i % chainBlocks;
+            diskManager.writeBlock(blockNumber, filled(blockSize, 'B'));
+            committed[blockNumber] = 'B';
+        }
+        segments.commit();
+        assert(segments.needsCheckpoint());
+        segments.checkpoint();
+        assert(segments.getCheckpoints() == 1);
+        for (size_t i = 0; i < chainBlocks; ++i) {
+            size_t blockNumber = layout.dataStart + rollBlocks + 2 * chainBlocks + i;
+            diskManager.writeBlock(blockNumber, filled(blockSize, 'C'));
+            committed[blockNumber] = 'C';
+        }
+        segments.commit();
+    }
+
+    // A torn newest checkpoint (the format wrote #1, the two mounts #2 and #3, then #4 into
+    // slot 0) falls back to the older slot and rolls forward over the newer one's segments
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        std::vector<char> slot = diskManager.readBlock(layout.checkpointStart);
+        slot[blockSize - 1] ^= 0x5a;
+        diskManager.writeBlock(layout.checkpointStart, slot);
+    }
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        SegmentManager segments(diskManager, layout);
+        assert(segments.recover() >= 2 * chainBlocks + 2 * segments.getSlotsPerSegment());
+        diskManager.setSegmentManager(&segments);
+        for (size_t i = 0; i <= rollBlocks + 3 * chainBlocks; ++i) {
+            size_t blockNumber = layout.dataStart + i;
+            assert(diskManager.readBlock(blockNumber) == filled(blockSize, committed[blockNumber]));
+        }
+    }
+
+    // Both slots torn: nothing to mount
+    {
+        DiskManager diskManager("vdisk", diskSize, blockSize, WriteMode::LogStructured);
+        for (size_t slot = 0; slot < 2; ++slot) {
+            diskManager.writeBlock(layout.checkpointStart + slot * layout.checkpointBlocks / 2,
+                                   filled(blockSize, 'T'));
+        }
+        SegmentManager segments(diskManager, layout);
+        bool threw = false;
+        try {
+            segments.recover();
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    std::cout << "All SegmentManager tests passed!" << std::endl;
+    return 0;
+}
+#endif
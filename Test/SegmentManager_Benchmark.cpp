@@ -0,0 +1,124 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "../DiskManager.h"
+#include "../SegmentManager.h"
+
+// Overwrite blocks at random until the log has been written several times over and report
+// what cleaning cost. hotFraction of the writes go to hotBlocks of the live blocks.
+void benchmarkCleaning(const std::string& name, size_t liveBlocks, double hotFraction, double hotBlocks,
+                       bool backgroundCleaner) {
+    using namespace std::chrono;
+    const size_t diskSize = 8 * 1024 * 1024;
+    const size_t blockSize = 512;
+
+    Superblock layout;
+    {
+        DiskManager diskManager("vdisk_bench", diskSize, blockSize, WriteMode::LogStructured);
+        diskManager.formatDisk();
+        layout = diskManager.loadSuperblock();
+    }
+    DiskManager diskManager("vdisk_bench", diskSize, blockSize, WriteMode::LogStructured);
+    SegmentManager segments(diskManager, layout);
+    segments.recover();
+    diskManager.setSegmentManager(&segments);
+
+    liveBlocks = std::min<size_t>(liveBlocks, layout.volumeBlocks - layout.dataStart);
+    size_t hot = std::max<size_t>(1, static_cast<size_t>(liveBlocks * hotBlocks));
+    std::vector<char> data(blockSize, 'L');
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> coin(0, 1);
+    auto write = [&](size_t blockNumber) {
+        diskManager.writeBlock(blockNumber, data);
+        if (segments.needsCheckpoint()) {
+            segments.checkpoint();
+        }
+    };
+
+    // Fill, then overwrite
+    for (size_t i = 0; i < liveBlocks; ++i) {
+        write(layout.dataStart + i);
+    }
+    if (backgroundCleaner) {
+        segments.startCleaner();
+    }
+    size_t overwrites = 4 * segments.getSegmentCount() * segments.getSlotsPerSegment();
+    auto start = high_resolution_clock::now();
+    for (size_t i = 0; i < overwrites; ++i) {
+        size_t offset = coin(random) < hotFraction ? random() % hot : hot + random() % (liveBlocks - hot);
+        write(layout.dataStart + offset);
+    }
+    segments.checkpoint();
+    duration<double> elapsed = high_resolution_clock::now() - start;
+    segments.stopCleaner();
+
+    double utilization = static_cast<double>(liveBlocks) / (segments.getSegmentCount() * segments.getSlotsPerSegment());
+    std::cout << name << " (disk utilization " << static_cast<int>(utilization * 100) << "%"
+              << (backgroundCleaner ? ", background cleaner" : "") << "): " << overwrites << " overwrites in "
+              << elapsed.count() << " seconds" << std::endl
+              << "  write amplification " << segments.getWriteAmplification() << ", cleaning cost "
+              << segments.getCleaningCost() << ", " << segments.getSegmentsCleaned() << " segments cleaned, "
+              << segments.getBlocksMoved() << " blocks moved, " << segments.getCleaningSeconds()
+              << " seconds cleaning" << std::endl;
+}
+
+// Commit after every block, crash, and time the mount: it rolls forward at most a checkpoint
+// interval of segments
+void benchmarkMount(size_t checkpointInterval) {
+    using namespace std::chrono;
+    const size_t diskSize = 8 * 1024 * 1024;
+    const size_t blockSize = 512;
+
+    Superblock layout;
+    {
+        DiskManager diskManager("vdisk_bench", diskSize, blockSize, WriteMode::LogStructured);
+        diskManager.formatDisk();
+        layout = diskManager.loadSuperblock();
+    }
+    {
+        DiskManager diskManager("vdisk_bench", diskSize, blockSize, WriteMode::LogStructured);
+        SegmentManager segments(diskManager, layout);
+        segments.recover();
+        diskManager.setSegmentManager(&segments);
+        segments.setCheckpointInterval(checkpointInterval);
+        std::vector<char> data(blockSize, 'M');
+        size_t blocks = segments.getSegmentCount() * segments.getSlotsPerSegment() / 2;
+        for (size_t i = 0; i < blocks; ++i) {
+            diskManager.writeBlock(layout.dataStart + i % 2000, data);
+            segments.commit();
+            if (segments.needsCheckpoint()) {
+                segments.checkpoint();
+            }
+        }
+    }
+
+    DiskManager diskManager("vdisk_bench", diskSize, blockSize, WriteMode::LogStructured);
+    SegmentManager segments(diskManager, layout);
+    auto start = high_resolution_clock::now();
+    size_t rolledForward = segments.recover();
+    duration<double> elapsed = high_resolution_clock::now() - start;
+    std::cout << "Mount with a checkpoint every " << checkpointInterval << " segments: " << rolledForward
+              << " blocks rolled forward in " << elapsed.count() << " seconds" << std::endl;
+}
+
+int main() {
+    std::cout << "Running segment cleaning benchmark..." << std::endl;
+    for (size_t liveBlocks : {5000, 9000}) {
+        benchmarkCleaning("Uniform", liveBlocks, 0.5, 0.5, false);
+        benchmarkCleaning("Hot-and-cold 90/10", liveBlocks, 0.9, 0.1, false);
+    }
+    benchmarkCleaning("Hot-and-cold 90/10", 9000, 0.9, 0.1, true);
+
+    std::cout << "Running mount benchmark..." << std::endl;
+    for (size_t checkpointInterval : {2, 4, 8}) {
+        benchmarkMount(checkpointInterval);
+    }
+    return 0;
+}
+
+#endif // BENCHMARK_TEST
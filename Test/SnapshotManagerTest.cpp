@@ -0,0 +1,163 @@
+#include "../LLFS.h"
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef TEST_BUILD
+// Contents of one version of a file
+static std::vector<char> version(char tag, size_t size = 2048) {
+    return std::vector<char>(size, tag);
+}
+
+// Check that a call throws a runtime_error
+template <typename Call>
+static void expectFailure(Call call) {
+    try {
+        call();
+        assert(false); // Should not reach here
+    } catch (const std::runtime_error&) {
+        // Expected
+    }
+}
+
+// Check the state when the first snapshot was taken
+static void checkFirst(LLFS& fs) {
+    assert(fs.readFile("/data") == version('1'));
+    assert(fs.readFile("/docs/old") == version('o', 700));
+    assert(fs.statFiles({"/new"})[0].fileType == 0);
+    assert(fs.listDirectory("/docs").size() == 11);
+}
+
+// Check the state when the second snapshot was taken
+static void checkSecond(LLFS& fs) {
+    assert(fs.readFile("/data") == version('2'));
+    assert(fs.statFiles({"/docs/old"})[0].fileType == 0);
+    assert(fs.readFile("/new") == version('n', 5000));
+    assert(fs.listDirectory("/docs").size() == 10);
+}
+
+// Check the live state at the end
+static void checkLive(LLFS& fs) {
+    assert(fs.readFile("/data") == version('3'));
+    assert(fs.statFiles({"/new"})[0].fileType == 0);
+    assert(fs.listDirectory("/docs").size() == 60);
+}
+
+// Mount a snapshot and check it, including that it cannot change
+static void checkSnapshot(LLFS& fs, const std::string& name, void (*check)(LLFS&)) {
+    std::unique_ptr<LLFS> view = fs.mountSnapshot(name);
+    check(*view);
+    assert(view->checkConsistency(false).isConsistent());
+    expectFailure([&] { view->writeFile("/data", version('x')); });
+    expectFailure([&] { view->createFile("/other"); });
+    expectFailure([&] { view->commit(); });
+    expectFailure([&] { view->checkConsistency(true); });
+}
+
+static void run(bool blockChecksums) {
+    const size_t diskSize = 2 * 1024 * 1024;
+    {
+        LLFS fs("vdisk", diskSize, 512, WriteMode::InPlace, blockChecksums);
+        fs.formatFileSystem();
+        fs.createDirectory("/docs");
+        fs.createFile("/data");
+        fs.writeFile("/data", version('1'));
+        fs.createFile("/docs/old");
+        fs.writeFile("/docs/old", version('o', 700));
+        for (int i = 0; i < 10; ++i) {
+            fs.createFile("/docs/file" + std::to_string(i));
+        }
+
+        // Taking a snapshot copies nothing
+        fs.snapshot("first");
+        assert(fs.getSnapshotManager().getCopiedBlocks() == 0);
+        expectFailure([&] { fs.snapshot("first"); });
+        fs.beginTransaction();
+        expectFailure([&] { fs.snapshot("inside"); });
+        fs.commit();
+
+        // Overwritten data goes to fresh blocks; metadata is copied out once
+        fs.writeFile("/data", version('2'));
+        fs.deleteFile("/docs/old");
+        fs.createFile("/new");
+        fs.writeFile("/new", version('n', 5000));
+        fs.sync();
+        size_t copied = fs.getSnapshotManager().getCopiedBlocks();
+        assert(copied > 0);
+        fs.writeFile("/data", version('2'));
+        fs.sync();
+        if (!blockChecksums) { // Otherwise the new blocks' checksums may land in other table blocks
+            assert(fs.getSnapshotManager().getCopiedBlocks() == copied);
+        }
+        checkSecond(fs);
+        checkSnapshot(fs, "first", checkFirst);
+
+        fs.snapshot("second");
+        std::vector<SnapshotInfo> listed = fs.listSnapshots();
+        assert(listed.size() == 2 && listed[0].name == "first" && listed[1].name == "second");
+        assert(listed[0].copiedBlocks == copied && listed[1].copiedBlocks == 0);
+
+        // Commit without a checkpoint, then crash: the replay finds the journaled blocks copied out
+        fs.writeFile("/data", version('3'));
+        fs.deleteFile("/new");
+        for (int i = 10; i < 60; ++i) {
+            fs.createFile("/docs/file" + std::to_string(i));
+        }
+        fs.commit();
+    }
+
+    LLFS fs("vdisk", diskSize, 512, WriteMode::InPlace, blockChecksums);
+    fs.mount();
+    assert(fs.listSnapshots().size() == 2);
+    checkLive(fs);
+    checkSnapshot(fs, "first", checkFirst);
+    checkSnapshot(fs, "second", checkSecond);
+    assert(fs.checkConsistency(false).isConsistent());
+
+    // A mounted snapshot cannot be deleted, nor the disk formatted under it
+    {
+        std::unique_ptr<LLFS> view = fs.mountSnapshot("second");
+        expectFailure([&] { fs.deleteSnapshot("second"); });
+        expectFailure([&] { fs.formatFileSystem(); });
+        // Live writes while it is mounted do not show through
+        fs.writeFile("/data", version('4'));
+        fs.createFile("/later");
+        fs.sync();
+        checkSecond(*view);
+        expectFailure([&] { view->mountSnapshot("first"); });
+    }
+    expectFailure([&] { fs.mountSnapshot("missing"); });
+
+    // Deleting the newer snapshot hands its copies to the older one; deleting both unpins all
+    size_t pinned = fs.getSnapshotManager().getPinnedBlocks();
+    fs.deleteSnapshot("second");
+    assert(fs.getSnapshotManager().getPinnedBlocks() < pinned);
+    checkSnapshot(fs, "first", checkFirst);
+    fs.deleteSnapshot("first");
+    assert(fs.listSnapshots().empty() && fs.getSnapshotManager().getPinnedBlocks() == 0);
+    expectFailure([&] { fs.mountSnapshot("first"); });
+    assert(fs.readFile("/data") == version('4'));
+    assert(fs.checkConsistency(false).isConsistent());
+
+    // The snapshots are gone for good
+    LLFS remounted("vdisk", diskSize, 512, WriteMode::InPlace, blockChecksums);
+    remounted.mount();
+    assert(remounted.listSnapshots().empty());
+    assert(remounted.readFile("/data") == version('4'));
+}
+
+int main() {
+    run(false);
+    run(true);
+
+    // Snapshots need in-place mode
+    LLFS lfs("vdisk", 2 * 1024 * 1024, 512, WriteMode::LogStructured);
+    lfs.formatFileSystem();
+    expectFailure([&] { lfs.snapshot("first"); });
+
+    std::cout << "All SnapshotManager tests passed!" << std::endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,78 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../LLFS.h"
+
+// Seconds since start
+static double since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Fill the file system with files of a size
+static void fill(LLFS& fs, int files, size_t fileSize) {
+    std::vector<char> data(fileSize, 'd');
+    for (int i = 0; i < files; ++i) {
+        std::string name = "/file" + std::to_string(i);
+        fs.createFile(name);
+        fs.writeFile(name, data);
+    }
+    fs.sync();
+}
+
+// Rewrite every file once and sync
+static double rewrite(LLFS& fs, int files, size_t fileSize) {
+    std::vector<char> data(fileSize, 'r');
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < files; ++i) {
+        fs.writeFile("/file" + std::to_string(i), data);
+    }
+    fs.sync();
+    return since(start);
+}
+
+int main() {
+    const size_t diskSize = 32 * 1024 * 1024;
+    const size_t blockSize = 512;
+    const size_t fileSize = 10 * blockSize;
+
+    std::cout << "Running snapshot creation benchmark (files of " << fileSize << " bytes)..." << std::endl;
+    for (int count : {50, 400, 3200}) {
+        LLFS fs("vdisk_bench", diskSize, blockSize, WriteMode::InPlace);
+        fs.formatFileSystem();
+        fill(fs, count, fileSize);
+        auto start = std::chrono::high_resolution_clock::now();
+        fs.snapshot("backup");
+        double seconds = since(start);
+        std::cout << count * fileSize / 1024 << " KB of data: snapshot in " << seconds * 1e3 << " ms, "
+                  << fs.getSnapshotManager().getPinnedBlocks() << " blocks pinned" << std::endl;
+    }
+
+    const int files = 400;
+    std::cout << "Running rewrite benchmark (" << files << " files of " << fileSize << " bytes)..." << std::endl;
+    double plainSeconds;
+    {
+        LLFS fs("vdisk_bench", diskSize, blockSize, WriteMode::InPlace);
+        fs.formatFileSystem();
+        fill(fs, files, fileSize);
+        plainSeconds = rewrite(fs, files, fileSize);
+        std::cout << "Without a snapshot: " << plainSeconds << " seconds" << std::endl;
+    }
+    {
+        LLFS fs("vdisk_bench", diskSize, blockSize, WriteMode::InPlace);
+        fs.formatFileSystem();
+        fill(fs, files, fileSize);
+        fs.snapshot("backup");
+        double firstSeconds = rewrite(fs, files, fileSize);
+        size_t copied = fs.getSnapshotManager().getCopiedBlocks();
+        double secondSeconds = rewrite(fs, files, fileSize);
+        std::cout << "With a snapshot: " << firstSeconds << " seconds (" << copied
+                  << " metadata blocks copied out), then " << secondSeconds << " seconds ("
+                  << fs.getSnapshotManager().getCopiedBlocks() - copied << " more)" << std::endl;
+    }
+    return 0;
+}
+
+#endif // BENCHMARK_TEST
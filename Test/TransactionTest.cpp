@@ -0,0 +1,111 @@
+#include "../LLFS.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#ifdef TEST_BUILD
+// Contents of one version of a file
+static std::vector<char> version(char tag, size_t size = 2048) {
+    return std::vector<char>(size, tag);
+}
+
+// Check that the file system holds the state before the transaction
+static void checkBefore(LLFS& fs) {
+    assert(fs.readFile("/data") == version('1'));
+    assert(fs.readFile("/index") == version('i', 512));
+    assert(fs.readFile("/old") == version('o'));
+    assert(fs.statFiles({"/extra", "/batch0"})[0].fileType == 0);
+}
+
+// Check that the file system holds the state after the transaction
+static void checkAfter(LLFS& fs) {
+    assert(fs.readFile("/data") == version('2'));
+    assert(fs.readFile("/index") == version('j', 1024));
+    assert(fs.statFiles({"/old"})[0].fileType == 0);
+    assert(fs.readFile("/extra") == version('e'));
+    assert(fs.statFiles({"/batch0", "/batch9"})[1].fileType == 1);
+}
+
+// Set up the state before, then run the transaction; crash (drop the LLFS) or commit
+static void run(WriteMode writeMode, bool commit) {
+    const size_t diskSize = 2 * 1024 * 1024;
+    {
+        LLFS fs("vdisk", diskSize, 512, writeMode);
+        fs.formatFileSystem();
+        for (const char* name : {"/data", "/index", "/old"}) {
+            fs.createFile(name);
+        }
+        fs.writeFile("/data", version('1'));
+        fs.writeFile("/index", version('i', 512));
+        fs.writeFile("/old", version('o'));
+        fs.commit();
+
+        fs.beginTransaction();
+        try {
+            fs.beginTransaction();
+            assert(false); // Should not reach here
+        } catch (const std::runtime_error&) {
+            // Expected: one transaction at a time
+        }
+        fs.writeFile("/data", version('2'));
+        fs.writeFile("/index", version('j', 1024));
+        fs.deleteFile("/old");
+        std::vector<std::string> batch;
+        for (int i = 0; i < 10; ++i) {
+            batch.push_back("/batch" + std::to_string(i));
+        }
+        fs.createFiles(batch); // Joins the transaction instead of committing
+        // The new file may only get the blocks of the old versions if they were reused
+        fs.createFile("/extra");
+        fs.writeFile("/extra", version('e'));
+        // Many more operations than would otherwise trigger a commit
+        for (int i = 0; i < 200; ++i) {
+            fs.writeFile("/extra", version(static_cast<char>('a' + i % 4)));
+        }
+        fs.writeFile("/extra", version('e'));
+        checkAfter(fs); // Visible at once
+        if (writeMode == WriteMode::InPlace) {
+            assert(fs.getJournal().getPendingBlocks() > 0);
+        }
+
+        if (commit) {
+            size_t commits = writeMode == WriteMode::InPlace ? fs.getJournal().getCommits()
+                                                             : fs.getSegmentManager().getCommits();
+            fs.commit();
+            if (writeMode == WriteMode::InPlace) {
+                assert(fs.getJournal().getCommits() == commits + 1);
+            } else {
+                assert(fs.getSegmentManager().getCommits() == commits + 1);
+            }
+            fs.beginTransaction(); // A new one may begin, and the crash discards it
+            fs.deleteFile("/extra");
+        }
+    } // Crash: nothing after the last commit reaches the disk
+
+    LLFS remounted("vdisk", diskSize, 512, writeMode);
+    remounted.mount();
+    if (commit) {
+        checkAfter(remounted);
+    } else {
+        checkBefore(remounted);
+    }
+    assert(remounted.checkConsistency(false).isConsistent());
+
+    // A transaction left open at the mount is gone; operations commit on their own again
+    remounted.beginTransaction();
+    remounted.mount();
+    remounted.beginTransaction();
+    remounted.commit();
+}
+
+int main() {
+    for (WriteMode writeMode : {WriteMode::InPlace, WriteMode::LogStructured}) {
+        run(writeMode, false);
+        run(writeMode, true);
+    }
+
+    std::cout << "All Transaction tests passed!" << std::endl;
+    return 0;
+}
+#endif
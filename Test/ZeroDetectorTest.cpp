@@ -0,0 +1,133 @@
+#include "../ZeroDetector.h"
+#include "../LLFS.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+#ifdef TEST_BUILD
+// Blocks reachable from inodes (data, indirect and directory blocks)
+static size_t blocksInUse(LLFS& fs) {
+    ConsistencyReport report = fs.checkConsistency(false);
+    assert(report.isConsistent());
+    return report.blocksReferenced;
+}
+
+int main() {
+    const size_t diskSize = 2 * 1024 * 1024; // 2 MB disk, 512-byte blocks
+    const size_t blockSize = 512;
+
+    // Detector: a single set bit anywhere, at any alignment and length, is found by every path
+    {
+        std::vector<char> buffer(1100, 0);
+        for (size_t start = 0; start < 8; ++start) {
+            for (size_t length : {0, 1, 7, 63, 64, 65, 127, 128, 129, 512, 1000}) {
+                const char* p = buffer.data() + start;
+                assert(ZeroDetector::isZero(p, length) && ZeroDetector::isZeroPortable(p, length));
+                if (ZeroDetector::hasAvx2Support()) {
+                    assert(ZeroDetector::isZeroAvx2(p, length));
+                }
+                for (size_t position = 0; position < length; ++position) {
+                    buffer[start + position] = static_cast<char>(0x80);
+                    assert(!ZeroDetector::isZero(p, length) && !ZeroDetector::isZeroPortable(p, length));
+                    if (ZeroDetector::hasAvx2Support()) {
+                        assert(!ZeroDetector::isZeroAvx2(p, length));
+                    }
+                    buffer[start + position] = 0;
+                }
+            }
+        }
+    }
+
+    // Plain files: zero blocks are holes, which read back as zeros
+    std::vector<char> sparse(10 * blockSize, 0);
+    std::fill(sparse.begin() + 3 * blockSize, sparse.begin() + 4 * blockSize, 's');
+    sparse.back() = 'e';
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.createFile("/sparse");
+        fs.createFile("/zeros");
+        size_t empty = blocksInUse(fs); // The root directory's block
+        fs.writeFile("/sparse", sparse);
+        fs.writeFile("/zeros", std::vector<char>(10 * blockSize, 0));
+        assert(blocksInUse(fs) == empty + 2);
+        assert(fs.readFile("/sparse") == sparse);
+        assert(fs.readFile("/zeros") == std::vector<char>(10 * blockSize, 0));
+
+        // Punch: a whole block is freed, a cut block is zeroed in a new copy, the size stays
+        fs.punchHole("/sparse", 3 * blockSize + 100, 10 * blockSize); // Clipped at the end of the file
+        std::vector<char> expected = sparse;
+        std::fill(expected.begin() + 3 * blockSize + 100, expected.end(), 0);
+        assert(fs.readFile("/sparse") == expected);
+        assert(blocksInUse(fs) == empty + 1);
+        fs.punchHole("/sparse", 0, 3 * blockSize + 100);
+        assert(fs.readFile("/sparse") == std::vector<char>(10 * blockSize, 0));
+        assert(blocksInUse(fs) == empty);
+        fs.punchHole("/sparse", 20 * blockSize, 5); // Past the end: nothing to do
+        fs.sync();
+    }
+
+    // Holes survive a remount; a cut block shared by deduplication keeps the other file intact
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.mount();
+        assert(fs.readFile("/sparse") == std::vector<char>(10 * blockSize, 0));
+        fs.setDeduplication(true);
+        std::vector<char> text(2 * blockSize, 't');
+        fs.createFile("/one");
+        fs.writeFile("/one", text);
+        fs.createFile("/two");
+        fs.writeFile("/two", text);
+        fs.punchHole("/one", 10, 20);
+        std::vector<char> punched = text;
+        std::fill(punched.begin() + 10, punched.begin() + 30, 0);
+        assert(fs.readFile("/one") == punched);
+        assert(fs.readFile("/two") == text);
+        blocksInUse(fs); // Still consistent
+    }
+
+    // Compressed files: zero clusters are holes, so a mostly-empty file takes almost no space
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.formatFileSystem();
+        fs.setCompression(true);
+        std::vector<char> large(8 * LLFS::CLUSTER_SIZE, 0);
+        large[5 * LLFS::CLUSTER_SIZE + 7] = 'x';
+        fs.createFile("/large");
+        size_t empty = blocksInUse(fs);
+        fs.writeFile("/large", large);
+        assert(fs.getCompressionStats().clustersSkipped == 7);
+        assert(blocksInUse(fs) <= empty + 3); // One cluster, plus the indirect block mapping it
+        assert(fs.readFile("/large") == large);
+
+        // Punching the last set byte frees the cluster and its indirect block
+        fs.punchHole("/large", 5 * LLFS::CLUSTER_SIZE, LLFS::CLUSTER_SIZE);
+        assert(blocksInUse(fs) == empty);
+        assert(fs.readFile("/large") == std::vector<char>(large.size(), 0));
+
+        // A cut cluster is stored again without the range
+        std::vector<char> text(3 * LLFS::CLUSTER_SIZE);
+        for (size_t i = 0; i < text.size(); ++i) text[i] = static_cast<char>('a' + i % 23);
+        fs.createFile("/text");
+        fs.writeFile("/text", text);
+        fs.punchHole("/text", LLFS::CLUSTER_SIZE - 10, LLFS::CLUSTER_SIZE + 20);
+        std::fill(text.begin() + LLFS::CLUSTER_SIZE - 10, text.begin() + 2 * LLFS::CLUSTER_SIZE + 10, 0);
+        assert(fs.readFile("/text") == text);
+        fs.sync();
+    }
+    {
+        LLFS fs("vdisk", diskSize, blockSize);
+        fs.mount();
+        std::vector<char> text(3 * LLFS::CLUSTER_SIZE);
+        for (size_t i = 0; i < text.size(); ++i) text[i] = static_cast<char>('a' + i % 23);
+        std::fill(text.begin() + LLFS::CLUSTER_SIZE - 10, text.begin() + 2 * LLFS::CLUSTER_SIZE + 10, 0);
+        assert(fs.readFile("/text") == text);
+        fs.deleteFile("/large");
+        fs.deleteFile("/text");
+        blocksInUse(fs);
+    }
+
+    std::cout << "All ZeroDetector tests passed!" << std::endl;
+    return 0;
+}
+#endif
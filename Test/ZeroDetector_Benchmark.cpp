@@ -0,0 +1,75 @@
+#ifdef BENCHMARK_TEST
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../ZeroDetector.h"
+#include "../LLFS.h"
+
+// Seconds since start
+static double since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Scan throughput of one implementation over zero buffers (the worst case: every byte is read)
+template <typename Scan>
+static double scanRate(Scan scan, const std::vector<char>& buffer, size_t chunk) {
+    size_t total = 0;
+    bool allZero = true;
+    auto start = std::chrono::high_resolution_clock::now();
+    while (total < 2000u * 1000 * 1000) {
+        for (size_t offset = 0; offset + chunk <= buffer.size(); offset += chunk) {
+            allZero &= scan(buffer.data() + offset, chunk);
+        }
+        total += buffer.size();
+    }
+    double seconds = since(start);
+    return allZero ? total / seconds / 1e9 : 0;
+}
+
+int main() {
+    const size_t diskSize = 32 * 1024 * 1024;
+    const size_t blockSize = 512;
+
+    std::cout << "Running zero scan benchmark (GB/s on zero buffers)..." << std::endl;
+    std::vector<char> buffer(1024 * 1024, 0);
+    for (size_t chunk : {blockSize, buffer.size()}) {
+        std::cout << chunk << "-byte buffers: portable " << scanRate(ZeroDetector::isZeroPortable, buffer, chunk);
+        if (ZeroDetector::hasAvx2Support()) {
+            std::cout << ", AVX2 " << scanRate(ZeroDetector::isZeroAvx2, buffer, chunk);
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "Running sparse file benchmark (16 MB compressed file, one cluster of data)..." << std::endl;
+    std::vector<char> file(16 * 1024 * 1024, 0);
+    for (size_t i = 0; i < LLFS::CLUSTER_SIZE; ++i) {
+        file[3 * 1024 * 1024 + i] = static_cast<char>(i * 2654435761u >> 24);
+    }
+    LLFS fs("vdisk_bench", diskSize, blockSize);
+    fs.formatFileSystem();
+    fs.setCompression(true);
+    fs.createFile("/sparse");
+    size_t before = fs.checkConsistency(false).blocksReferenced;
+    auto start = std::chrono::high_resolution_clock::now();
+    fs.writeFile("/sparse", file);
+    fs.sync();
+    double writeSeconds = since(start);
+    size_t blocks = fs.checkConsistency(false).blocksReferenced - before;
+    start = std::chrono::high_resolution_clock::now();
+    fs.readFile("/sparse");
+    double readSeconds = since(start);
+    std::cout << "Written in " << writeSeconds << " seconds, read in " << readSeconds << " seconds; " << blocks
+              << " blocks (" << blocks * blockSize / 1024 << " KB) for " << file.size() / 1024 << " KB, "
+              << fs.getCompressionStats().clustersSkipped << " clusters left as holes" << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    fs.punchHole("/sparse", 0, file.size());
+    fs.sync();
+    std::cout << "Punched the whole file in " << since(start) << " seconds; "
+              << fs.checkConsistency(false).blocksReferenced - before << " blocks left" << std::endl;
+    return 0;
+}
+
+#endif // BENCHMARK_TEST
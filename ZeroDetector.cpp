@@ -0,0 +1,92 @@
+#include "ZeroDetector.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define LLFS_ZERO_X86 1
+#endif
+
+namespace {
+
+// Check the bytes a vector loop left over, a word at a time
+bool isZeroTail(const uint8_t* p, size_t length) {
+    uint64_t bits = 0;
+    for (; length >= 8; p += 8, length -= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        bits |= word;
+    }
+    while (length-- > 0) {
+        bits |= *p++;
+    }
+    return bits == 0;
+}
+
+#ifdef LLFS_ZERO_X86
+__attribute__((target("avx2")))
+bool isZeroAvx2Loop(const uint8_t* p, size_t length) {
+    for (; length >= 128; p += 128, length -= 128) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 64));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 96));
+        __m256i bits = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+        if (!_mm256_testz_si256(bits, bits)) {
+            return false;
+        }
+    }
+    return isZeroTail(p, length);
+}
+#endif
+
+} // namespace
+
+// Check whether length bytes are all zero, with AVX2 when the CPU has it
+bool ZeroDetector::isZero(const void* data, size_t length) {
+    static const bool avx2 = hasAvx2Support();
+    return avx2 ? isZeroAvx2(data, length) : isZeroPortable(data, length);
+}
+
+// SSE2 implementation (eight-byte words where SSE2 is not available)
+bool ZeroDetector::isZeroPortable(const void* data, size_t length) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+#ifdef LLFS_ZERO_X86
+    const __m128i zero = _mm_setzero_si128();
+    for (; length >= 64; p += 64, length -= 64) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48));
+        __m128i bits = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(bits, zero)) != 0xFFFF) {
+            return false;
+        }
+    }
+#else
+    for (; length >= 64; p += 64, length -= 64) {
+        if (!isZeroTail(p, 64)) {
+            return false;
+        }
+    }
+#endif
+    return isZeroTail(p, length);
+}
+
+// AVX2 implementation (falls back to the portable one where it is not compiled in)
+bool ZeroDetector::isZeroAvx2(const void* data, size_t length) {
+#ifdef LLFS_ZERO_X86
+    return isZeroAvx2Loop(static_cast<const uint8_t*>(data), length);
+#else
+    return isZeroPortable(data, length);
+#endif
+}
+
+// Check whether this CPU has AVX2
+bool ZeroDetector::hasAvx2Support() {
+#ifdef LLFS_ZERO_X86
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
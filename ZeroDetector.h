@@ -0,0 +1,24 @@
+#ifndef ZERODETECTOR_H
+#define ZERODETECTOR_H
+
+#include <cstddef>
+
+// Finds all-zero buffers, so blocks and clusters of zeros can be left as holes instead of
+// being written. Scans 128 bytes per step with AVX2 where the CPU has it, 64 bytes with SSE2
+// (or eight-byte words off x86-64) elsewhere, and stops at the first step holding a set bit.
+class ZeroDetector {
+public:
+    // Check whether length bytes are all zero
+    static bool isZero(const void* data, size_t length);
+
+    // SSE2 implementation (eight-byte words where SSE2 is not available)
+    static bool isZeroPortable(const void* data, size_t length);
+
+    // AVX2 implementation; only call when hasAvx2Support() is true
+    static bool isZeroAvx2(const void* data, size_t length);
+
+    // Check whether this CPU has AVX2
+    static bool hasAvx2Support();
+};
+
+#endif // ZERODETECTOR_H
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -7,6 +8,7 @@
 #include "DirectoryManager.h"
 #include "CrashRecovery.h"
 #include "LLFS.h"
+#include "Logger.h"
 
 void printHelp() {
     std::cout << "Available commands:\n";
@@ -16,35 +18,71 @@ void printHelp() {
     std::cout << "  write <filename> <data>    - Write data to a file\n";
     std::cout << "  read <filename>            - Read data from a file\n";
     std::cout << "  delete <filename>          - Delete a file\n";
+    std::cout << "  clone <source> <clone>     - Create a file sharing another file's data\n";
+    std::cout << "  punch <file> <off> <len>   - Free a byte range of a file (it reads as zeros)\n";
+    std::cout << "  mkdir <path>               - Create a directory\n";
+    std::cout << "  rmdir <path>               - Delete an empty directory\n";
     std::cout << "  recover                    - Perform crash recovery\n";
+    std::cout << "  fsck                       - Check consistency and repair what can be repaired\n";
+    std::cout << "  scrub <blocks/s>           - Scrub in the background at this rate (0 = stop); shows progress\n";
+    std::cout << "  dedup                      - Show the dedup ratio and index size\n";
+    std::cout << "  snapshot <name>            - Take a snapshot of the file system\n";
+    std::cout << "  snapshots                  - List the snapshots\n";
+    std::cout << "  rmsnapshot <name>          - Delete a snapshot\n";
+    std::cout << "  loglevel <level>           - Set logging (trace, debug, info, warn, error, off)\n";
     std::cout << "  exit                       - Exit the program\n";
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     // Constants
     const std::string diskName = "vdisk";
     const size_t diskSize = 2 * 1024 * 1024; // 2 MB
     const size_t blockSize = 512;
 
+    // "--lfs" selects log-structured mode, "--checksums" per-block checksums; the disk must
+    // have been formatted the same way. "--compress" compresses the files written, "--dedup"
+    // deduplicates their blocks, "--pack" packs small files into shared blocks.
+    WriteMode writeMode = WriteMode::InPlace;
+    bool blockChecksums = false;
+    bool compression = false;
+    bool deduplication = false;
+    bool packing = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--lfs") {
+            writeMode = WriteMode::LogStructured;
+        } else if (std::string(argv[i]) == "--checksums") {
+            blockChecksums = true;
+        } else if (std::string(argv[i]) == "--compress") {
+            compression = true;
+        } else if (std::string(argv[i]) == "--dedup") {
+            deduplication = true;
+        } else if (std::string(argv[i]) == "--pack") {
+            packing = true;
+        }
+    }
+
+    LLFS fileSystem(diskName, diskSize, blockSize, writeMode, blockChecksums);
+    fileSystem.setCompression(compression);
+    fileSystem.setDeduplication(deduplication);
+    fileSystem.setPacking(packing);
+
     try {
         std::cout << "Performing crash recovery...\n";
 
-        DiskManager diskManager(diskName, diskSize, blockSize);
-
         // Check if the disk is formatted
-        auto superblock = diskManager.readBlock(0);
-        if (std::all_of(superblock.begin(), superblock.end(), [](char c) { return c == 0; })) {
+        bool formatted;
+        {
+            DiskManager diskManager(diskName, diskSize, blockSize);
+            auto superblock = diskManager.readBlock(0);
+            formatted = !std::all_of(superblock.begin(), superblock.end(), [](char c) { return c == 0; });
+        }
+        if (!formatted) {
             std::cout << "Disk is unformatted. Formatting the disk...\n";
-            diskManager.formatDisk();
+            fileSystem.formatFileSystem();
             std::cout << "Disk formatted successfully. Proceeding with recovery...\n";
         }
 
-        FreeBlockManager freeBlockManager(diskManager.getTotalBlocks());
-        InodeManager inodeManager(diskSize / (blockSize * 8)); // Example: 1 inode per 8 blocks
-        DirectoryManager directoryManager;
-
-        CrashRecovery recovery(diskManager, freeBlockManager, inodeManager, directoryManager);
-        recovery.recover();
+        fileSystem.mount();
 
         std::cout << "Crash recovery completed successfully.\n";
     } catch (const std::exception& e) {
@@ -55,8 +93,6 @@ int main() {
     std::cout << "Welcome to the Little Log File System (LLFS)!\n";
     std::cout << "Type 'help' for a list of commands.\n";
 
-    LLFS fileSystem(diskName, diskSize, blockSize);
-
     std::string command;
     while (true) {
         std::cout << "> ";
@@ -91,26 +127,109 @@ int main() {
                 std::cin >> fileName;
                 fileSystem.deleteFile(fileName);
                 std::cout << "File '" << fileName << "' deleted successfully.\n";
+            } else if (command == "clone") {
+                std::string sourceName, cloneName;
+                std::cin >> sourceName >> cloneName;
+                fileSystem.cloneFile(sourceName, cloneName);
+                std::cout << "File '" << cloneName << "' cloned from '" << sourceName << "'.\n";
+            } else if (command == "punch") {
+                std::string fileName;
+                size_t offset, length;
+                std::cin >> fileName >> offset >> length;
+                fileSystem.punchHole(fileName, offset, length);
+                std::cout << "Punched " << length << " bytes at " << offset << " in '" << fileName << "'.\n";
+            } else if (command == "mkdir") {
+                std::string path;
+                std::cin >> path;
+                fileSystem.createDirectory(path);
+                std::cout << "Directory '" << path << "' created successfully.\n";
+            } else if (command == "rmdir") {
+                std::string path;
+                std::cin >> path;
+                fileSystem.deleteDirectory(path);
+                std::cout << "Directory '" << path << "' deleted successfully.\n";
             } else if (command == "recover") {
-                DiskManager diskManager(diskName, diskSize, blockSize);
-                FreeBlockManager freeBlockManager(diskManager.getTotalBlocks());
-                InodeManager inodeManager(diskSize / (blockSize * 8)); // Example ratio: 1 inode per 8 blocks
-                DirectoryManager directoryManager;
-                CrashRecovery recovery(diskManager, freeBlockManager, inodeManager, directoryManager);
-                recovery.recover();
+                fileSystem.mount();
                 std::cout << "Crash recovery completed successfully.\n";
+            } else if (command == "fsck") {
+                ConsistencyReport report = fileSystem.checkConsistency();
+                std::cout << report.inodesChecked << " inodes, " << report.blocksReferenced << " blocks checked in "
+                          << report.seconds << " seconds.\n";
+                if (report.isConsistent()) {
+                    std::cout << "File system is consistent.\n";
+                } else {
+                    std::cout << "Leaked blocks: " << report.leakedBlocks << ", unmarked blocks: " << report.unmarkedBlocks
+                              << ", doubly referenced blocks: " << report.doublyReferencedBlocks.size()
+                              << ", invalid pointers: " << report.invalidPointers
+                              << ", orphan inodes: " << report.orphanInodes.size()
+                              << ", dangling entries: " << report.danglingEntries
+                              << ", damaged directories: " << report.damagedDirectories << "\n";
+                    std::cout << (report.repaired ? "Repaired (orphans are in /lost+found).\n" : "Not repaired.\n");
+                }
+            } else if (command == "scrub") {
+                size_t blocksPerSecond;
+                std::cin >> blocksPerSecond;
+                if (blocksPerSecond == 0) {
+                    fileSystem.stopScrubber();
+                } else {
+                    fileSystem.startScrubber(blocksPerSecond);
+                }
+                ScrubStats stats = fileSystem.getScrubStats();
+                std::cout << "Scrubber " << (stats.running ? "running" : "stopped") << ": cursor " << stats.cursor
+                          << ", " << stats.passesCompleted << " passes, " << stats.blocksScrubbed
+                          << " blocks scrubbed, " << stats.checksumErrors << " checksum errors, "
+                          << stats.bitmapErrors << " bitmap errors, " << stats.invalidPointers
+                          << " invalid pointers, " << stats.readErrors << " read errors.\n";
+            } else if (command == "dedup") {
+                DedupStats stats = fileSystem.getDedupStats();
+                std::cout << stats.logicalBlocks << " file blocks stored in " << stats.physicalBlocks
+                          << " (dedup ratio " << stats.ratio() << "x), " << stats.blocksDeduplicated << " of "
+                          << stats.blocksWritten << " blocks written were duplicates.\n";
+                std::cout << "Index: " << stats.indexEntries << " fingerprints, " << stats.indexMemoryBytes
+                          << " bytes.\n";
+            } else if (command == "snapshot") {
+                std::string name;
+                std::cin >> name;
+                fileSystem.snapshot(name);
+                std::cout << "Snapshot '" << name << "' taken.\n";
+            } else if (command == "snapshots") {
+                std::vector<SnapshotInfo> snapshots = fileSystem.listSnapshots();
+                for (const auto& snapshot : snapshots) {
+                    std::cout << snapshot.name << " (" << snapshot.copiedBlocks << " blocks copied out)\n";
+                }
+                if (snapshots.empty()) {
+                    std::cout << "<No snapshots>\n";
+                }
+            } else if (command == "rmsnapshot") {
+                std::string name;
+                std::cin >> name;
+                fileSystem.deleteSnapshot(name);
+                std::cout << "Snapshot '" << name << "' deleted.\n";
             } else if (command == "ls") {
                 std::string path;
                 std::cin >> path;
-                auto entries = fileSystem.listDirectory(path);
-                if (entries.empty()) {
-                    std::cout << "<No entries>\n";
-                } else {
-                    for (const auto& entry : entries) {
+                // Stream the directory in batches so large directories list in constant memory
+                std::vector<DirectoryEntry> batch;
+                size_t count = 0;
+                for (uint64_t cookie = 0; cookie != READDIR_END;) {
+                    batch.clear();
+                    cookie = fileSystem.readDirectory(path, cookie, 256, batch);
+                    for (const auto& entry : batch) {
                         std::cout << entry.fileName << "\n";
                     }
+                    count += batch.size();
+                }
+                if (count == 0) {
+                    std::cout << "<No entries>\n";
                 }
+            } else if (command == "loglevel") {
+                std::string level;
+                std::cin >> level;
+                Logger::setLevel(Logger::parseLevel(level));
+                std::cout << "Log level set to '" << level << "'.\n";
             } else if (command == "exit") {
+                fileSystem.stopScrubber();
+                fileSystem.sync();
                 std::cout << "Exiting LLFS. Goodbye!\n";
                 break;
             } else {